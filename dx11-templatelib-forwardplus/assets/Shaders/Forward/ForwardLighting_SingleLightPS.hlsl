@@ -12,8 +12,13 @@ cbuffer LightProperties : register(b1)
     //----------------------------------- (16 byte boundary)
     float4 GlobalAmbient;               // 16 bytes
     //----------------------------------- (16 byte boundary)
-    struct LightProperties Lights[MAX_LIGHTS];    // 80 * 8 = 640 bytes
-};  // Total:                           // 672 bytes (42 * 16 byte boundary)
+    uint LightCount;                    // 4 bytes
+    uint3 LightPadding;                 // 12 bytes
+    //----------------------------------- (16 byte boundary)
+};  // Total:                           // 48 bytes (3 * 16 byte boundary)
+
+// All scene lights, see LIGHT_BUFFER_SLOT
+StructuredBuffer<LightProperties> Lights : register(t8);
 
 cbuffer LightingCalculationOptions : register(b2)
 {
@@ -1,6 +1,12 @@
 #include "Common.hlsli"
 
+// Tile size in pixels, same as CullLight.hlsl. Set per permutation by SimpleObj::LoadShaderResources()
+#ifndef BLOCK_SIZE
 #define BLOCK_SIZE 16
+#endif
+
+// Same as SimpleObj.h
+#define FRUSTUM_PLANE_GROUP_SIZE 64
 
 //  =========================
 //      Constant Buffers
@@ -45,7 +51,8 @@ float4 ScreenToView( float4 screen )
     return ClipToView( clip );
 }
 
-// right-handed (counter-clockwise winding order), so the normal points to inside of the frustum
+// The normal points to the inside of the frustum when p0, p1, p2 are clockwise seen from the inside
+// Keep in sync with Cpu::ComputePlane() in inc/Cpu/Culling.h
 Plane ComputePlane(float3 p0, float3 p1, float3 p2)
 {
     Plane plane;
@@ -63,7 +70,10 @@ Plane ComputePlane(float3 p0, float3 p1, float3 p2)
 //      Main Functions
 //  =========================
 
-RWStructuredBuffer<Frustum> out_Frustums : register( u0 );
+// Shared edge planes of the tile grid, same layout as Cpu::FrustumPlaneGrid:
+// numThreads.x + 1 vertical planes facing +x, then numThreads.y + 1 horizontal planes facing down the screen.
+// The left / top planes of a tile are its own edge planes, the right / bottom planes the next ones flipped.
+RWStructuredBuffer<Plane> out_FrustumPlanes : register( u0 );
 
 struct ComputeShaderInput
 {
@@ -73,34 +83,36 @@ struct ComputeShaderInput
     uint  groupIndex        : SV_GroupIndex;        // Flattened local index of the thread within a thread g
 };
 
-[numthreads(BLOCK_SIZE, BLOCK_SIZE, 1)]
+// One thread per edge plane, numThreads holds the tile count of the grid
+[numthreads(FRUSTUM_PLANE_GROUP_SIZE, 1, 1)]
 void main(ComputeShaderInput IN)
 {
     const float3 eyePos = float3(0, 0, 0);
-
-    float4 screenSpace[4];
     int z = 1; // z = 1 for left-hand coodinate system
-    screenSpace[0] = float4(float2(IN.dispatchThreadID.x    , IN.dispatchThreadID.y    ) * BLOCK_SIZE, z, 1.0f); // top-left point
-    screenSpace[1] = float4(float2(IN.dispatchThreadID.x + 1, IN.dispatchThreadID.y    ) * BLOCK_SIZE, z, 1.0f); // top-right point
-    screenSpace[2] = float4(float2(IN.dispatchThreadID.x    , IN.dispatchThreadID.y + 1) * BLOCK_SIZE, z, 1.0f); // bottom-left point
-    screenSpace[3] = float4(float2(IN.dispatchThreadID.x + 1, IN.dispatchThreadID.y + 1) * BLOCK_SIZE, z, 1.0f); // bottom-right point
 
-    float3 viewSpace[4];
-    for(int i = 0; i < 4; ++i)
+    uint index = IN.dispatchThreadID.x;
+    uint verticalCount = numThreads.x + 1;
+    uint2 gridSize = numThreads.xy * BLOCK_SIZE;
+
+    // every edge spans the whole grid
+    float4 screenSpace[2];
+    if (index < verticalCount)
     {
-        viewSpace[i] = ScreenToView(screenSpace[i]).xyz;
+        screenSpace[0] = float4(float2(index * BLOCK_SIZE, 0), z, 1.0f);            // top point
+        screenSpace[1] = float4(float2(index * BLOCK_SIZE, gridSize.y), z, 1.0f);   // bottom point
+    }
+    else
+    {
+        uint y = index - verticalCount;
+        screenSpace[0] = float4(float2(gridSize.x, y * BLOCK_SIZE), z, 1.0f);       // right point
+        screenSpace[1] = float4(float2(0, y * BLOCK_SIZE), z, 1.0f);                // left point
     }
 
-    Frustum frustum;
-    frustum.planes[0] = ComputePlane(eyePos, viewSpace[2], viewSpace[0]); // left plane
-    frustum.planes[1] = ComputePlane(eyePos, viewSpace[1], viewSpace[3]); // right plane
-    frustum.planes[2] = ComputePlane(eyePos, viewSpace[0], viewSpace[1]); // top plane
-    frustum.planes[3] = ComputePlane(eyePos, viewSpace[3], viewSpace[2]); // bottom plane
+    // winding order of the left / top planes of ComputeTileFrustum() so the normals point inside
+    Plane plane = ComputePlane(eyePos, ScreenToView(screenSpace[0]).xyz, ScreenToView(screenSpace[1]).xyz);
 
-    // first check current thread ID is bound of the grid
-    if (IN.dispatchThreadID.x < numThreads.x && IN.dispatchThreadID.y < numThreads.y)
+    if (index < verticalCount + numThreads.y + 1)
     {
-        uint index = IN.dispatchThreadID.x + (IN.dispatchThreadID.y * numThreads.x);
-        out_Frustums[index] = frustum;
+        out_FrustumPlanes[index] = plane;
     }
-}
\ No newline at end of file
+}
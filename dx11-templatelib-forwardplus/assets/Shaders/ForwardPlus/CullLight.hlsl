@@ -1,7 +1,20 @@
 #include "../Structures.hlsli"
-#include "Common.hlsli"
+#include "Culling.hlsli"
 
-#define BLOCK_SIZE 16
+// BLOCK_SIZE, the tile size in pixels, comes from Culling.hlsli or the shader macros
+
+// Size of the group shared light lists, lights past it are dropped from the tile and counted in the light index counters
+#define MAX_LIGHTS_PER_TILE 1024
+
+// 2.5D culling: split the depth range of a tile into 32 cells and reject lights
+// that only cover cells without geometry
+#define USE_DEPTH_MASK 1
+
+// Hierarchical culling: only test the candidates CullSuperTile.hlsl found for the super-tile of the tile.
+// Set by CullLightHierarchical.hlsl
+#ifndef USE_SUPER_TILES
+#define USE_SUPER_TILES 0
+#endif
 
 //  =========================
 //        Input  Buffers
@@ -10,13 +23,17 @@ cbuffer DispatchParams : register(b0)
 {
     // Number of groups dispatched
     uint3 numThreadGroups;
-    uint padding1;
+    uint UseDepthPyramid;   // read the tile bounds from in_DepthPyramid instead of reducing every pixel
 
     // Total number of threads dispatched
     // Note this value may be less than the actual number of threads executed
     // if the screen size is not divisible by the block size
     uint3 numThreads;
-    uint padding2;
+    uint DeterministicLightLists;   // append in test order, the grid holds staging offsets for ScatterLightLists.hlsl
+
+    uint2 LightIndexListCapacity;   // entries of o_LightIndexList / t_LightIndexList, tiles past it keep what still fits
+    uint MaxLightsPerTile;          // per tile light budget, keep the lights of largest GetLightContribution(), 0 = off
+    uint DispatchPadding;
 }
 
 cbuffer ScreenToViewParams : register(b1)
@@ -32,146 +49,216 @@ cbuffer LightProperties : register(b2)
     //----------------------------------- (16 byte boundary)
     float4 GlobalAmbient;               // 16 bytes
     //----------------------------------- (16 byte boundary)
-    struct LightProperties Lights[MAX_LIGHTS];    // 80 * 8 = 640 bytes
-};  // Total:  
+    uint LightCount;                    // 4 bytes
+    uint3 LightPadding;                 // 12 bytes
+    //----------------------------------- (16 byte boundary)
+};  // Total:                           // 48 bytes (3 * 16 byte boundary)
+
+// All scene lights, see LIGHT_BUFFER_SLOT
+StructuredBuffer<LightProperties> Lights : register( t8 );
+
+// Radius and spot volume of every light, derived once per dirty light on the cpu, see DERIVED_LIGHT_BUFFER_SLOT
+StructuredBuffer<DerivedLightProperties> DerivedLights : register( t12 );
 
 // The depth from the screen space texture.
 Texture2D DepthTextureVS : register( t0 );
 
-// Precomputed frustums for the grid.
-StructuredBuffer<Frustum> in_Frustums : register( t1 );
+// Precomputed shared edge planes of the grid from ComputeFrustum.hlsl:
+// numThreadGroups.x + 1 vertical planes followed by numThreadGroups.y + 1 horizontal planes.
+StructuredBuffer<Plane> in_FrustumPlanes : register( t1 );
+
+#if USE_SUPER_TILES
+// Candidate lights of every super-tile, MAX_LIGHTS_PER_SUPER_TILE slots per super-tile.
+// The count is not clamped, a count past the slots means every light has to be tested.
+StructuredBuffer<uint> in_SuperTileLightCount : register( t2 );
+StructuredBuffer<uint> in_SuperTileLightIndexList : register( t3 );
+#endif
+
+// Min / max depth pyramid from DepthPyramid.hlsl, mip k - 1 holds the bounds of 2^k x 2^k pixels
+Texture2D<float2> in_DepthPyramid : register( t4 );
 
 // "o_" prefix indicates light lists for opaque geometry while 
 // "t_" prefix indicates light lists for transparent geometry.
+// The light index counters hold, cleared every frame:
+//   [0] the entries the tiles asked for, more than LightIndexListCapacity if the index list overflowed
+//   [1] the tiles that lost lights: past MAX_LIGHTS_PER_TILE, the budget or the capacity of the index list
+//   [2] the lights they lost
 RWStructuredBuffer<uint> o_LightIndexCounter : register( u0 );
 RWStructuredBuffer<uint> o_LightIndexList : register( u1 );
 RWTexture2D<uint2> o_LightGrid : register( u2 );
 RWStructuredBuffer<float> debugList : register( u3 );
 
-// RWStructuredBuffer<uint> t_LightIndexCounter : register( u2 );
-// RWStructuredBuffer<uint> t_LightIndexList : register( u4 );
-// RWTexture2D<uint2> t_LightGrid : register( u6 );
+RWStructuredBuffer<uint> t_LightIndexCounter : register( u4 );
+RWStructuredBuffer<uint> t_LightIndexList : register( u5 );
+RWTexture2D<uint2> t_LightGrid : register( u6 );
 
 // shader model 5.0 does not provide atomic functions for floating point values,
 // so we use unsigned int to atomically compared and updated per thread.
 groupshared uint uMinDepth;
 groupshared uint uMaxDepth;
+groupshared uint uDepthMask;
 
 groupshared Frustum GroupFrustum;
+groupshared TileVolume TransparentVolume;   // near clip plane .. max depth
+groupshared TileVolume OpaqueVolume;        // min depth .. max depth
 
 // Opaque geometry light lists.
 groupshared uint o_LightCount;
 groupshared uint o_LightIndexStartOffset;
-groupshared uint o_LightList[MAX_LIGHTS];
+groupshared uint o_LightList[MAX_LIGHTS_PER_TILE];
  
 // Transparent geometry light lists.
-// groupshared uint t_LightCount;
-// groupshared uint t_LightIndexStartOffset;
-// groupshared uint t_LightList[1024];
+groupshared uint t_LightCount;
+groupshared uint t_LightIndexStartOffset;
+groupshared uint t_LightList[MAX_LIGHTS_PER_TILE];
+
+// Per tile light budget, for the list being cut
+groupshared float LightContribution[MAX_LIGHTS_PER_TILE];
+groupshared uint LightRank[MAX_LIGHTS_PER_TILE];
 
 //  =========================
 //        Functions
 //  =========================
 
-bool SphereInsidePlane( Sphere sphere, Plane plane )
+// 2.5D culling: cell of the tile depth mask containing depthVS
+uint GetDepthMaskCell( float depthVS, float minDepthVS, float maxDepthVS )
 {
-    return dot( plane.N, sphere.c ) - plane.d < -sphere.r;
+    float range = maxDepthVS - minDepthVS;
+    float cell = range > 0 ? ( depthVS - minDepthVS ) / range * 32.0f : 0.0f;
+    return (uint)clamp( cell, 0.0f, 31.0f );
 }
 
-// Check to see of a light is partially contained within the frustum.
-// Assumes a right-handed coordinate system with the camera looking towards the negative z axis
-bool SphereInsideFrustum( Sphere sphere, Frustum frustum, float zNear, float zFar )
+// Cells covered by the depth range [z0, z1]
+uint GetDepthRangeMask( float z0, float z1, float minDepthVS, float maxDepthVS )
 {
-    bool result = true;
- 
-    // TODO: check z axis should be reversed?
-    // if ( (sphere.c.z - sphere.r) > zFar || (sphere.c.z + sphere.r) < zNear )
+    uint first = GetDepthMaskCell( z0, minDepthVS, maxDepthVS );
+    uint last = GetDepthMaskCell( z1, minDepthVS, maxDepthVS );
+    return ( 0xffffffff >> ( 31 - last ) ) & ( 0xffffffff << first );
+}
+
+uint GetSphereDepthMask( Sphere sphere, float minDepthVS, float maxDepthVS )
+{
+    return GetDepthRangeMask( sphere.c.z - sphere.r, sphere.c.z + sphere.r, minDepthVS, maxDepthVS );
+}
+
+// Depth range of the tip and the bottom disk of the cone, clipped to the bounding sphere of the lit volume
+uint GetSpotDepthMask( SpotVolume spot, float minDepthVS, float maxDepthVS )
+{
+    Cone cone = spot.C;
+    float bottomZ = cone.T.z + cone.d.z * cone.h;
+    float bottomExtent = cone.r * sqrt( max( 1.0f - cone.d.z * cone.d.z, 0.0f ) );
+    float z0 = max( min( cone.T.z, bottomZ - bottomExtent ), spot.Bounds.c.z - spot.Bounds.r );
+    float z1 = min( max( cone.T.z, bottomZ + bottomExtent ), spot.Bounds.c.z + spot.Bounds.r );
+    return GetDepthRangeMask( z0, z1, minDepthVS, maxDepthVS );
+}
 
-    // First check depth, note the sphere is in view space
-    // Also, the view vector points in the -Z axis so the far depth value will be approaching -infinity.
-    if ( (sphere.c.z - sphere.r) > zNear || (sphere.c.z + sphere.r) < zFar )
+// Add the light to the visible light list for opaque geometry.
+void o_AppendLight( uint lightIndex )
+{
+    uint index; // Index into the visible lights array.
+    InterlockedAdd( o_LightCount, 1, index ); // atomic add
+    if ( index < MAX_LIGHTS_PER_TILE )
     {
-        result = false;
+        o_LightList[index] = lightIndex;
     }
+}
  
-    // Then check frustum planes
-    for ( int i = 0; i < 4 && result; i++ )
+// Add the light to the visible light list for transparent geometry.
+void t_AppendLight( uint lightIndex )
+{
+    uint index; // Index into the visible lights array.
+    InterlockedAdd( t_LightCount, 1, index );
+    if ( index < MAX_LIGHTS_PER_TILE )
     {
-        if ( SphereInsidePlane( sphere, frustum.planes[i] ) )
-        {
-            result = false;
-        }
+        t_LightList[index] = lightIndex;
     }
- 
-    return result;
 }
 
-// Check to see if a point is fully behind (inside the negative halfspace of) a plane.
-bool PointInsidePlane( float3 p, Plane plane )
+uint GetListedLight( bool transparent, uint k )
 {
-    return dot( plane.N, p ) - plane.d < 0;
+    return transparent ? t_LightList[k] : o_LightList[k];
 }
 
-// Check to see if a cone if fully behind (inside the negative halfspace of) a plane.
-bool ConeInsidePlane( Cone cone, Plane plane )
+void SetListedLight( bool transparent, uint k, uint lightIndex )
 {
-    // Compute the farthest point on the end of the cone to the positive space of the plane.
-    float3 m = cross( cross( plane.N, cone.d ), cone.d );
-    float3 Q = cone.T + cone.d * cone.h - m * cone.r;
- 
-    // The cone is in the negative halfspace of the plane if both
-    // the tip of the cone and the farthest point on the end of the cone to the 
-    // positive halfspace of the plane are both inside the negative halfspace 
-    // of the plane.
-    return PointInsidePlane( cone.T, plane ) && PointInsidePlane( Q, plane );
+    if ( transparent )
+    {
+        t_LightList[k] = lightIndex;
+    }
+    else
+    {
+        o_LightList[k] = lightIndex;
+    }
 }
 
-bool ConeInsideFrustum( Cone cone, Frustum frustum, float zNear, float zFar )
+// Per tile light budget: keep the MaxLightsPerTile entries of largest GetLightContribution() among the first `count`
+// entries of a list, in list order, ties keep the earlier entry. Every thread of the group must call it, returns the new count.
+uint ApplyLightBudget( uint groupIndex, bool transparent, uint count, AABB box )
 {
-    bool result = true;
- 
-    Plane nearPlane = { float3( 0, 0, -1 ), -zNear };
-    Plane farPlane = { float3( 0, 0, 1 ), zFar };
- 
-    // First check the near and far clipping planes.
-    if ( ConeInsidePlane( cone, nearPlane ) || ConeInsidePlane( cone, farPlane ) )
+    uint k;
+    for ( k = groupIndex; k < count; k += BLOCK_SIZE * BLOCK_SIZE )
     {
-        result = false;
+        LightContribution[k] = GetLightContribution( Lights[GetListedLight( transparent, k )], box );
     }
- 
-    // Then check frustum planes
-    for ( int i = 0; i < 4 && result; i++ )
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // Rank of every entry in the list, quadratic but only run with a budget
+    for ( k = groupIndex; k < count; k += BLOCK_SIZE * BLOCK_SIZE )
     {
-        if ( ConeInsidePlane( cone, frustum.planes[i] ) )
+        float contribution = LightContribution[k];
+        uint rank = 0;
+        for ( uint j = 0; j < count; ++j )
         {
-            result = false;
+            float other = LightContribution[j];
+            rank += ( other > contribution || ( other == contribution && j < k ) ) ? 1 : 0;
         }
+        LightRank[k] = rank;
     }
- 
-    return result;
-}
 
-// Add the light to the visible light list for opaque geometry.
-void o_AppendLight( uint lightIndex )
-{
-    uint index; // Index into the visible lights array.
-    InterlockedAdd( o_LightCount, 1, index ); // atomic add
-    if ( index < MAX_LIGHTS )
+    GroupMemoryBarrierWithGroupSync();
+
+    // Move the kept entries together in place. Whole batches over the whole list so every thread takes part in every scan;
+    // an entry only moves down, over entries of its batch that were read before the scan
+    uint kept = 0;
+    for ( uint batch = 0; batch < MAX_LIGHTS_PER_TILE; batch += BLOCK_SIZE * BLOCK_SIZE )
     {
-        o_LightList[index] = lightIndex;
+        k = batch + groupIndex;
+        bool keep = k < count && LightRank[k] < MaxLightsPerTile;
+        uint lightIndex = keep ? GetListedLight( transparent, k ) : 0;
+
+        uint total;
+        uint offset = ScanAppendFlags( groupIndex, keep ? 1 : 0, total );
+        if ( keep )
+        {
+            SetListedLight( transparent, kept + offset, lightIndex );
+        }
+        kept += total;
     }
+
+    GroupMemoryBarrierWithGroupSync();
+    return kept;
+}
+
+Plane FlipPlane( Plane plane )
+{
+    plane.N = -plane.N;
+    plane.d = -plane.d;
+    return plane;
+}
+
+// Frustum of a tile from the two vertical and two horizontal edge planes around it
+Frustum GetTileFrustum( uint2 tile )
+{
+    uint horizontalBegin = numThreadGroups.x + 1;
+
+    Frustum frustum;
+    frustum.planes[0] = in_FrustumPlanes[tile.x];                                         // left plane
+    frustum.planes[1] = FlipPlane( in_FrustumPlanes[tile.x + 1] );                        // right plane
+    frustum.planes[2] = in_FrustumPlanes[horizontalBegin + tile.y];                       // top plane
+    frustum.planes[3] = FlipPlane( in_FrustumPlanes[horizontalBegin + tile.y + 1] );      // bottom plane
+    return frustum;
 }
- 
-// // Add the light to the visible light list for transparent geometry.
-// void t_AppendLight( uint lightIndex )
-// {
-//     uint index; // Index into the visible lights array.
-//     InterlockedAdd( t_LightCount, 1, index );
-//     if ( index < MAX_LIGHTS )
-//     {
-//         t_LightList[index] = lightIndex;
-//     }
-// }
 
 // Convert clip space coordinates to view space
 float4 ClipToView( float4 clip )
@@ -181,13 +268,67 @@ float4 ClipToView( float4 clip )
     return view;
 }
 
-float GetRadius(LightProperties light)
+// Index of the k-th light tested by the tile: the k-th candidate of its super-tile, or light k
+uint GetTestedLight( uint k, uint superTileIndex, bool useCandidates )
+{
+#if USE_SUPER_TILES
+    return useCandidates ? in_SuperTileLightIndexList[superTileIndex * MAX_LIGHTS_PER_SUPER_TILE + k] : k;
+#else
+    return k;
+#endif
+}
+
+// Does light i touch the opaque geometry of the tile / the volume in front of it (for transparent geometry)
+void TestLight( uint i, float nearClipVS, float minDepthVS, float maxDepthVS, Plane minPlane, uint depthMask,
+    out bool opaque, out bool transparent )
 {
-    float lightMax = max(max(light.Color.x, light.Color.y), light.Color.z) * light.Strength;
+    opaque = false;
+    transparent = false;
+
+    if ( !Lights[i].Enabled )
+    {
+        return;
+    }
+
+    LightProperties light = Lights[i];
 
-    // Reference: https://learnopengl.com/Advanced-Lighting/Deferred-Shading, we use 10/256 as dark threshold
-    float darkThreshold = (256.0f / 2.5f);
-    return (-light.LinearAttenuation + sqrt(light.LinearAttenuation * light.LinearAttenuation - 4.0f * light.QuadraticAttenuation * (light.ConstantAttenuation - darkThreshold * lightMax))) / (2.0f * light.QuadraticAttenuation);
+    switch ( light.LightType )
+    {
+        case POINT_LIGHT:
+        {
+            Sphere sphere = { light.PositionVS.xyz, DerivedLights[i].Radius };
+            if ( SphereInsideFrustum( sphere, GroupFrustum, nearClipVS, maxDepthVS ) )
+            {
+                transparent = true;
+                opaque = !SphereInsidePlane( sphere, minPlane ) && ( GetSphereDepthMask( sphere, minDepthVS, maxDepthVS ) & depthMask );
+            }
+        }
+        break;
+
+        case SPOT_LIGHT:
+        {
+            // The planes reject cones outside the tile, the box tests the corners the planes let through
+            SpotVolume spot = GetSpotVolume( light, DerivedLights[i] );
+            if ( ConeInsideFrustum( spot.C, GroupFrustum, nearClipVS, maxDepthVS ) && SpotIntersectsTileVolume( spot, TransparentVolume ) )
+            {
+                transparent = true;
+                opaque = !ConeInsidePlane( spot.C, minPlane ) && SpotIntersectsTileVolume( spot, OpaqueVolume ) &&
+                    ( GetSpotDepthMask( spot, minDepthVS, maxDepthVS ) & depthMask );
+            }
+        }
+        break;
+
+        case DIRECTIONAL_LIGHT:
+        {
+#if !USE_GLOBAL_LIGHT_LIST
+            // Directional lights always get added to our light list.
+            // (Hopefully there are not too many directional lights!)
+            transparent = true;
+            opaque = true;
+#endif
+        }
+        break;
+    }
 }
 
 //  =========================
@@ -217,19 +358,33 @@ void main(ComputeShaderInput IN)
 
     if ( IN.groupIndex == 0 ) // Avoid contention by other threads in the group.
     {
-        uMinDepth = 0xffffffff;
-        uMaxDepth = 0;
+        if ( UseDepthPyramid )
+        {
+            // One fetch from the level whose texels are BLOCK_SIZE pixels wide
+            float2 depthBounds = in_DepthPyramid.Load( int3( IN.groupID.xy, firstbithigh( BLOCK_SIZE ) - 1 ) );
+            uMinDepth = asuint( depthBounds.x );
+            uMaxDepth = asuint( depthBounds.y );
+        }
+        else
+        {
+            uMinDepth = 0xffffffff;
+            uMaxDepth = 0;
+        }
+        uDepthMask = 0;
         o_LightCount = 0;
-        // t_LightCount = 0;
-        GroupFrustum = in_Frustums[IN.groupID.x + ( IN.groupID.y * numThreadGroups.x )];
+        t_LightCount = 0;
+        GroupFrustum = GetTileFrustum( IN.groupID.xy );
     }
  
     GroupMemoryBarrierWithGroupSync();
 
     // Step 2: set uMinDepth and uMaxDepth to proper value
 
-    InterlockedMin( uMinDepth, uDepth );
-    InterlockedMax( uMaxDepth, uDepth );
+    if ( !UseDepthPyramid )
+    {
+        InterlockedMin( uMinDepth, uDepth );
+        InterlockedMax( uMaxDepth, uDepth );
+    }
  
     GroupMemoryBarrierWithGroupSync();
 
@@ -245,63 +400,103 @@ void main(ComputeShaderInput IN)
  
     // Clipping plane for minimum depth value 
     // (used for testing lights within the bounds of opaque geometry).
-    Plane minPlane = { float3( 0, 0, -1 ), -minDepthVS };
+    Plane minPlane = { float3( 0, 0, 1 ), minDepthVS };
+
+#if USE_DEPTH_MASK
+    // Step 3: mark the depth cell of this pixel once the tile range is known
+    float depthVS = ClipToView( float4( 0, 0, fDepth, 1 ) ).z;
+    InterlockedOr( uDepthMask, 1u << GetDepthMaskCell( depthVS, minDepthVS, maxDepthVS ) );
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint depthMask = uDepthMask;
+#else
+    uint depthMask = 0xffffffff;
+#endif
+
+    if ( IN.groupIndex == 0 )
+    {
+        TransparentVolume = GetTileVolume( GroupFrustum, nearClipVS, maxDepthVS );
+        OpaqueVolume = GetTileVolume( GroupFrustum, minDepthVS, maxDepthVS );
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+#if USE_SUPER_TILES
+    uint2 superTile = IN.groupID.xy / ( SUPER_TILE_SIZE / BLOCK_SIZE );
+    uint superTileIndex = superTile.x + superTile.y * GetSuperTileCountX( ScreenDimensions );
+    uint candidateCount = in_SuperTileLightCount[superTileIndex];
+    bool useCandidates = candidateCount <= MAX_LIGHTS_PER_SUPER_TILE;
+    uint cullCount = useCandidates ? candidateCount : LightCount;
+#else
+    uint superTileIndex = 0;
+    bool useCandidates = false;
+    uint cullCount = LightCount;
+#endif
 
     // Cull lights
     // Each thread in a group will cull 1 light until all lights have been culled.
-    for ( uint i = IN.groupIndex; i < MAX_LIGHTS; i += BLOCK_SIZE * BLOCK_SIZE )
+    uint i;
+    if ( DeterministicLightLists )
     {
-        if ( Lights[i].Enabled )
+        // Whole batches so every thread takes part in the append scan,
+        // the lists come out in the order of the tested lights
+        for ( uint batch = 0; batch < cullCount; batch += BLOCK_SIZE * BLOCK_SIZE )
         {
-            LightProperties light = Lights[i];
+            uint k = batch + IN.groupIndex;
+            bool opaque = false;
+            bool transparent = false;
+            i = 0;
+            if ( k < cullCount )
+            {
+                i = GetTestedLight( k, superTileIndex, useCandidates );
+                TestLight( i, nearClipVS, minDepthVS, maxDepthVS, minPlane, depthMask, opaque, transparent );
+            }
 
-            switch ( light.LightType )
+            uint total;
+            uint offset = ScanAppendFlags( IN.groupIndex, ( opaque ? 1 : 0 ) | ( transparent ? 0x10000 : 0 ), total );
+
+            uint o_Index = o_LightCount + ( offset & 0xffff );
+            uint t_Index = t_LightCount + ( offset >> 16 );
+            if ( opaque && o_Index < MAX_LIGHTS_PER_TILE )
             {
-                case POINT_LIGHT:
-                {
-                    float range = GetRadius(light);
-                    Sphere sphere = { light.PositionVS.xyz, range };
-                    if ( SphereInsideFrustum( sphere, GroupFrustum, nearClipVS, maxDepthVS ) )
-                    {
-                        // Add light to light list for transparent geometry.
-                        // t_AppendLight( i );
-    
-                        if ( !SphereInsidePlane( sphere, minPlane ) )
-                        {
-                            // Add light to light list for opaque geometry.
-                            o_AppendLight( i );
-                        }
-                    }
-                }
-                break;
-
-                case SPOT_LIGHT:
-                {
-                    float range = GetRadius(light);
-                    float coneRadius = tan( radians( light.SpotAngle ) ) * range;
-                    Cone cone = { light.PositionVS.xyz, range, light.DirectionVS.xyz, coneRadius };
-                    if ( ConeInsideFrustum( cone, GroupFrustum, nearClipVS, maxDepthVS ) )
-                    {
-                        // Add light to light list for transparent geometry.
-                        // t_AppendLight( i );
-    
-                        if ( !ConeInsidePlane( cone, minPlane ) )
-                        {
-                            // Add light to light list for opaque geometry.
-                            o_AppendLight( i );
-                        }
-                    }
-                }
-                break;
-
-                case DIRECTIONAL_LIGHT:
-                {
-                    // Directional lights always get added to our light list.
-                    // (Hopefully there are not too many directional lights!)
-                    // t_AppendLight( i );
-                    o_AppendLight( i );
-                }
-                break;
+                o_LightList[o_Index] = i;
+            }
+            if ( transparent && t_Index < MAX_LIGHTS_PER_TILE )
+            {
+                t_LightList[t_Index] = i;
+            }
+
+            GroupMemoryBarrierWithGroupSync();
+
+            if ( IN.groupIndex == 0 )
+            {
+                o_LightCount += total & 0xffff;
+                t_LightCount += total >> 16;
+            }
+
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+    else
+    {
+        for ( uint j = IN.groupIndex; j < cullCount; j += BLOCK_SIZE * BLOCK_SIZE )
+        {
+            bool opaque;
+            bool transparent;
+            i = GetTestedLight( j, superTileIndex, useCandidates );
+            TestLight( i, nearClipVS, minDepthVS, maxDepthVS, minPlane, depthMask, opaque, transparent );
+
+            if ( transparent )
+            {
+                // Add light to light list for transparent geometry.
+                t_AppendLight( i );
+            }
+
+            if ( opaque )
+            {
+                // Add light to light list for opaque geometry.
+                o_AppendLight( i );
             }
         }
     }
@@ -309,17 +504,47 @@ void main(ComputeShaderInput IN)
     // Wait till all threads in group have caught up.
     GroupMemoryBarrierWithGroupSync();
 
+    // Lights past the group shared lists are lost, the budget picks among the listed ones
+    uint o_CulledCount = o_LightCount;
+    uint t_CulledCount = t_LightCount;
+    uint o_ListedCount = min( o_CulledCount, MAX_LIGHTS_PER_TILE );
+    uint t_ListedCount = min( t_CulledCount, MAX_LIGHTS_PER_TILE );
+
+    if ( MaxLightsPerTile > 0 )
+    {
+        o_ListedCount = ApplyLightBudget( IN.groupIndex, false, o_ListedCount, OpaqueVolume.Box );
+        t_ListedCount = ApplyLightBudget( IN.groupIndex, true, t_ListedCount, TransparentVolume.Box );
+    }
+
+    // Every thread has read the counts before thread 0 replaces them
+    GroupMemoryBarrierWithGroupSync();
+
     // Update global memory with visible light buffer.
     // First update the light grid (only thread 0 in group needs to do this)
     if ( IN.groupIndex == 0 )
     {
+        // The counters sum what the tiles ask for, a tile past the capacity of the index list keeps what still fits
+        InterlockedAdd( o_LightIndexCounter[0], o_ListedCount, o_LightIndexStartOffset );
+        o_LightCount = min( o_ListedCount, LightIndexListCapacity.x - min( o_LightIndexStartOffset, LightIndexListCapacity.x ) );
+        if ( o_LightCount < o_CulledCount )
+        {
+            InterlockedAdd( o_LightIndexCounter[1], 1 );
+            InterlockedAdd( o_LightIndexCounter[2], o_CulledCount - o_LightCount );
+        }
+
         // Update light grid for opaque geometry.
-        InterlockedAdd( o_LightIndexCounter[0], o_LightCount, o_LightIndexStartOffset );
         o_LightGrid[IN.groupID.xy] = uint2( o_LightIndexStartOffset, o_LightCount );
- 
+
+        InterlockedAdd( t_LightIndexCounter[0], t_ListedCount, t_LightIndexStartOffset );
+        t_LightCount = min( t_ListedCount, LightIndexListCapacity.y - min( t_LightIndexStartOffset, LightIndexListCapacity.y ) );
+        if ( t_LightCount < t_CulledCount )
+        {
+            InterlockedAdd( t_LightIndexCounter[1], 1 );
+            InterlockedAdd( t_LightIndexCounter[2], t_CulledCount - t_LightCount );
+        }
+
         // Update light grid for transparent geometry.
-        // InterlockedAdd( t_LightIndexCounter[0], t_LightCount, t_LightIndexStartOffset );
-        // t_LightGrid[IN.groupID.xy] = uint2( t_LightIndexStartOffset, t_LightCount );
+        t_LightGrid[IN.groupID.xy] = uint2( t_LightIndexStartOffset, t_LightCount );
     }
  
     GroupMemoryBarrierWithGroupSync();
@@ -332,8 +557,8 @@ void main(ComputeShaderInput IN)
     }
     
     // For transparent geometry.
-    // for ( i = IN.groupIndex; i < t_LightCount; i += BLOCK_SIZE * BLOCK_SIZE )
-    // {
-    //     t_LightIndexList[t_LightIndexStartOffset + i] = t_LightList[i];
-    // }
+    for ( i = IN.groupIndex; i < t_LightCount; i += BLOCK_SIZE * BLOCK_SIZE )
+    {
+        t_LightIndexList[t_LightIndexStartOffset + i] = t_LightList[i];
+    }
 }
\ No newline at end of file
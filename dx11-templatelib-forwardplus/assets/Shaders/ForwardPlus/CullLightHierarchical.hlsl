@@ -0,0 +1,3 @@
+// CullLight.hlsl testing only the candidate lights of each super-tile, run after CullSuperTile.hlsl
+#define USE_SUPER_TILES 1
+#include "CullLight.hlsl"
@@ -0,0 +1,243 @@
+#include "../Structures.hlsli"
+#include "Culling.hlsli"
+
+// Always compiled with the default BLOCK_SIZE of Culling.hlsli, the group size does not depend on the tile size
+
+// Every thread of a BLOCK_SIZE x BLOCK_SIZE group reads PIXELS_PER_THREAD x PIXELS_PER_THREAD pixels of the super-tile
+#define PIXELS_PER_THREAD ( SUPER_TILE_SIZE / BLOCK_SIZE )
+
+//  =========================
+//        Input  Buffers
+//  =========================
+cbuffer DispatchParams : register(b0)
+{
+    uint3 numThreadGroups;
+    uint UseDepthPyramid;
+    uint3 numThreads;
+    uint DeterministicLightLists;   // candidates in light order, see CullLight.hlsl
+}
+
+cbuffer ScreenToViewParams : register(b1)
+{
+    float4x4 InverseView;
+    float4x4 InverseProjection;
+    float2 ScreenDimensions;
+}
+
+cbuffer LightProperties : register(b2)
+{
+    float4 EyePosition;                 // 16 bytes
+    //----------------------------------- (16 byte boundary)
+    float4 GlobalAmbient;               // 16 bytes
+    //----------------------------------- (16 byte boundary)
+    uint LightCount;                    // 4 bytes
+    uint3 LightPadding;                 // 12 bytes
+    //----------------------------------- (16 byte boundary)
+};  // Total:                           // 48 bytes (3 * 16 byte boundary)
+
+// All scene lights, see LIGHT_BUFFER_SLOT
+StructuredBuffer<LightProperties> Lights : register( t8 );
+
+// Radius and spot volume of every light, derived once per dirty light on the cpu, see DERIVED_LIGHT_BUFFER_SLOT
+StructuredBuffer<DerivedLightProperties> DerivedLights : register( t12 );
+
+// The depth from the screen space texture.
+Texture2D DepthTextureVS : register( t0 );
+
+// Candidate lights of every super-tile, read by CullLightHierarchical.hlsl
+RWStructuredBuffer<uint> out_SuperTileLightCount : register( u0 );
+RWStructuredBuffer<uint> out_SuperTileLightIndexList : register( u1 );
+
+groupshared uint uMaxDepth;
+groupshared uint CandidateCount;
+
+//  =========================
+//        Functions
+//  =========================
+
+// Convert clip space coordinates to view space
+float4 ClipToView( float4 clip )
+{
+    float4 view = mul( InverseProjection, clip );
+    view = view / view.w;
+    return view;
+}
+
+// Convert screen space coordinates to view space.
+float4 ScreenToView( float4 screen )
+{
+    float2 texCoord = screen.xy / ScreenDimensions;
+    float4 clip = float4( float2( texCoord.x, 1.0f - texCoord.y ) * 2.0f - 1.0f, screen.z, screen.w );
+    return ClipToView( clip );
+}
+
+// Same as ComputeFrustum.hlsl
+Plane ComputePlane( float3 p0, float3 p1, float3 p2 )
+{
+    Plane plane;
+
+    float3 v1 = p1 - p0;
+    float3 v2 = p2 - p0;
+
+    plane.N = normalize( cross( v1, v2 ) );
+    plane.d = dot( plane.N, p0 );
+
+    return plane;
+}
+
+// Frustum of a super-tile, the union of the frustums of its tiles
+Frustum ComputeSuperTileFrustum( uint2 superTile )
+{
+    const float3 eyePos = float3( 0, 0, 0 );
+
+    float4 screenSpace[4];
+    int z = 1; // z = 1 for left-hand coodinate system
+    screenSpace[0] = float4( float2( superTile.x    , superTile.y     ) * SUPER_TILE_SIZE, z, 1.0f ); // top-left point
+    screenSpace[1] = float4( float2( superTile.x + 1, superTile.y     ) * SUPER_TILE_SIZE, z, 1.0f ); // top-right point
+    screenSpace[2] = float4( float2( superTile.x    , superTile.y + 1 ) * SUPER_TILE_SIZE, z, 1.0f ); // bottom-left point
+    screenSpace[3] = float4( float2( superTile.x + 1, superTile.y + 1 ) * SUPER_TILE_SIZE, z, 1.0f ); // bottom-right point
+
+    float3 viewSpace[4];
+    for ( int i = 0; i < 4; ++i )
+    {
+        viewSpace[i] = ScreenToView( screenSpace[i] ).xyz;
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = ComputePlane( eyePos, viewSpace[0], viewSpace[2] ); // left plane
+    frustum.planes[1] = ComputePlane( eyePos, viewSpace[3], viewSpace[1] ); // right plane
+    frustum.planes[2] = ComputePlane( eyePos, viewSpace[1], viewSpace[0] ); // top plane
+    frustum.planes[3] = ComputePlane( eyePos, viewSpace[2], viewSpace[3] ); // bottom plane
+    return frustum;
+}
+
+void AppendCandidate( uint superTileIndex, uint lightIndex )
+{
+    uint index;
+    InterlockedAdd( CandidateCount, 1, index );
+    if ( index < MAX_LIGHTS_PER_SUPER_TILE )
+    {
+        out_SuperTileLightIndexList[superTileIndex * MAX_LIGHTS_PER_SUPER_TILE + index] = lightIndex;
+    }
+}
+
+// May light i touch the super-tile between the near plane and maxDepthVS, `volume` is the box of that range
+bool IsCandidate( uint i, Frustum frustum, TileVolume volume, float nearClipVS, float maxDepthVS )
+{
+    if ( !Lights[i].Enabled )
+    {
+        return false;
+    }
+
+    LightProperties light = Lights[i];
+
+    switch ( light.LightType )
+    {
+        case POINT_LIGHT:
+        {
+            Sphere sphere = { light.PositionVS.xyz, DerivedLights[i].Radius };
+            return SphereInsideFrustum( sphere, frustum, nearClipVS, maxDepthVS );
+        }
+
+        case SPOT_LIGHT:
+        {
+            SpotVolume spot = GetSpotVolume( light, DerivedLights[i] );
+            return ConeInsideFrustum( spot.C, frustum, nearClipVS, maxDepthVS ) && SpotIntersectsTileVolume( spot, volume );
+        }
+
+        case DIRECTIONAL_LIGHT:
+            return !USE_GLOBAL_LIGHT_LIST;
+    }
+
+    return false;
+}
+
+//  =========================
+//      Main Functions
+//  =========================
+
+struct ComputeShaderInput
+{
+    uint3 groupID           : SV_GroupID;           // 3D index of the thread group in the dispatch.
+    uint3 groupThreadID     : SV_GroupThreadID;     // 3D index of local thread ID in a thread group.
+    uint3 dispatchThreadID  : SV_DispatchThreadID;  // 3D index of global thread ID in the dispatch.
+    uint  groupIndex        : SV_GroupIndex;        // Flattened local index of the thread within a thread g
+};
+
+// One group per super-tile. Only the max depth is needed: a light is a candidate if it may touch
+// the volume between the near plane and the deepest pixel of the super-tile, which contains the
+// opaque and transparent test volumes of all its tiles.
+[numthreads(BLOCK_SIZE, BLOCK_SIZE, 1)]
+void main(ComputeShaderInput IN)
+{
+    if ( IN.groupIndex == 0 )
+    {
+        uMaxDepth = 0;
+        CandidateCount = 0;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint uDepth = 0;
+    int2 pixel = IN.groupID.xy * SUPER_TILE_SIZE + IN.groupThreadID.xy * PIXELS_PER_THREAD;
+    for ( int y = 0; y < PIXELS_PER_THREAD; ++y )
+    {
+        for ( int x = 0; x < PIXELS_PER_THREAD; ++x )
+        {
+            // Out of bounds loads return 0, same as for the partial tiles of CullLight.hlsl
+            uDepth = max( uDepth, asuint( DepthTextureVS.Load( int3( pixel + int2( x, y ), 0 ) ).r ) );
+        }
+    }
+    InterlockedMax( uMaxDepth, uDepth );
+
+    GroupMemoryBarrierWithGroupSync();
+
+    float maxDepthVS = ClipToView( float4( 0, 0, asfloat( uMaxDepth ), 1 ) ).z;
+    float nearClipVS = ClipToView( float4( 0, 0, 0, 1 ) ).z;
+    Frustum frustum = ComputeSuperTileFrustum( IN.groupID.xy );
+    TileVolume volume = GetTileVolume( frustum, nearClipVS, maxDepthVS );
+    uint superTileIndex = IN.groupID.x + IN.groupID.y * GetSuperTileCountX( ScreenDimensions );
+
+    if ( DeterministicLightLists )
+    {
+        // Whole batches so every thread takes part in the append scan
+        for ( uint batch = 0; batch < LightCount; batch += BLOCK_SIZE * BLOCK_SIZE )
+        {
+            uint k = batch + IN.groupIndex;
+            bool candidate = k < LightCount && IsCandidate( k, frustum, volume, nearClipVS, maxDepthVS );
+
+            uint total;
+            uint index = CandidateCount + ScanAppendFlags( IN.groupIndex, candidate ? 1 : 0, total );
+            if ( candidate && index < MAX_LIGHTS_PER_SUPER_TILE )
+            {
+                out_SuperTileLightIndexList[superTileIndex * MAX_LIGHTS_PER_SUPER_TILE + index] = k;
+            }
+
+            GroupMemoryBarrierWithGroupSync();
+
+            if ( IN.groupIndex == 0 )
+            {
+                CandidateCount += total;
+            }
+
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+    else
+    {
+        for ( uint i = IN.groupIndex; i < LightCount; i += BLOCK_SIZE * BLOCK_SIZE )
+        {
+            if ( IsCandidate( i, frustum, volume, nearClipVS, maxDepthVS ) )
+            {
+                AppendCandidate( superTileIndex, i );
+            }
+        }
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if ( IN.groupIndex == 0 )
+    {
+        out_SuperTileLightCount[superTileIndex] = CandidateCount;
+    }
+}
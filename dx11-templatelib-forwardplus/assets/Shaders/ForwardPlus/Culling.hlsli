@@ -0,0 +1,280 @@
+// Light volume tests shared by the light culling shaders, include after Structures.hlsli
+#include "Common.hlsli"
+
+// Hierarchical culling: CullSuperTile.hlsl lists the candidate lights of every SUPER_TILE_SIZE pixels super-tile,
+// CullLightHierarchical.hlsl then only tests those in each tile. Keep in sync with SimpleObj.h
+#define SUPER_TILE_SIZE 64
+#define MAX_LIGHTS_PER_SUPER_TILE 4096
+
+// Directional lights touch every tile: list them once in the global light list SimpleObj uploads
+// (GLOBAL_LIGHT_LIST_SLOT), shaded by every pixel first, instead of appending them to every tile's lists.
+// Keep in sync with LightCullInput::UseGlobalLightList of the CPU culler
+#ifndef USE_GLOBAL_LIGHT_LIST
+#define USE_GLOBAL_LIGHT_LIST 1
+#endif
+
+// Threads per side of a culling group. For CullLight.hlsl this is the tile size in pixels, compiled once per
+// size SimpleObj supports (8, 16 or 32) with the BLOCK_SIZE macro, see SimpleObj::LoadShaderResources()
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 16
+#endif
+
+// Number of super-tiles in a row of the screen
+uint GetSuperTileCountX( float2 screenDimensions )
+{
+    return ( (uint)screenDimensions.x + SUPER_TILE_SIZE - 1 ) / SUPER_TILE_SIZE;
+}
+
+bool SphereInsidePlane( Sphere sphere, Plane plane )
+{
+    return dot( plane.N, sphere.c ) - plane.d < -sphere.r;
+}
+
+// Check to see of a light is partially contained within the frustum.
+// Assumes a left-handed coordinate system with the camera looking towards the positive z axis
+// Keep the functions below in sync with inc/Cpu/Culling.h, the CPU culler is the reference of this shader
+bool SphereInsideFrustum( Sphere sphere, Frustum frustum, float zNear, float zFar )
+{
+    bool result = true;
+
+    // First check depth, note the sphere is in view space
+    // Also, the view vector points in the +Z axis so zNear < zFar.
+    if ( (sphere.c.z - sphere.r) > zFar || (sphere.c.z + sphere.r) < zNear )
+    {
+        result = false;
+    }
+ 
+    // Then check frustum planes
+    for ( int i = 0; i < 4 && result; i++ )
+    {
+        if ( SphereInsidePlane( sphere, frustum.planes[i] ) )
+        {
+            result = false;
+        }
+    }
+ 
+    return result;
+}
+
+// Check to see if a point is fully behind (inside the negative halfspace of) a plane.
+bool PointInsidePlane( float3 p, Plane plane )
+{
+    return dot( plane.N, p ) - plane.d < 0;
+}
+
+// Check to see if a cone if fully behind (inside the negative halfspace of) a plane.
+bool ConeInsidePlane( Cone cone, Plane plane )
+{
+    // The farthest point on the end of the cone to the positive space of the plane is
+    // cone.r along the part of the plane normal perpendicular to the axis.
+    float3 bottom = cone.T + cone.d * cone.h;
+    float nd = dot( plane.N, cone.d );
+    float extent = cone.r * sqrt( max( 1.0f - nd * nd, 0.0f ) );
+ 
+    // The cone is in the negative halfspace of the plane if both
+    // the tip of the cone and the farthest point on the end of the cone to the 
+    // positive halfspace of the plane are both inside the negative halfspace 
+    // of the plane.
+    return PointInsidePlane( cone.T, plane ) && dot( plane.N, bottom ) + extent - plane.d < 0;
+}
+
+bool ConeInsideFrustum( Cone cone, Frustum frustum, float zNear, float zFar )
+{
+    bool result = true;
+ 
+    Plane nearPlane = { float3( 0, 0, 1 ), zNear };
+    Plane farPlane = { float3( 0, 0, -1 ), -zFar };
+ 
+    // First check the near and far clipping planes.
+    if ( ConeInsidePlane( cone, nearPlane ) || ConeInsidePlane( cone, farPlane ) )
+    {
+        result = false;
+    }
+ 
+    // Then check frustum planes
+    for ( int i = 0; i < 4 && result; i++ )
+    {
+        if ( ConeInsidePlane( cone, frustum.planes[i] ) )
+        {
+            result = false;
+        }
+    }
+ 
+    return result;
+}
+
+// Axis aligned box in view space
+struct AABB
+{
+    float3 Min;
+    float3 Max;
+};
+
+// Spot light: the cone bounding the lit volume, the half angle of the cone and the
+// smallest sphere around the lit volume
+struct SpotVolume
+{
+    Cone C;
+    Sphere Bounds;
+    float CosAngle;
+    float SinAngle;
+};
+
+// View space box of a tile between two depths and the sphere around the box
+struct TileVolume
+{
+    AABB Box;
+    Sphere BoxBounds;
+};
+
+// The side planes of the tile frustums go through the eye, so the corners of the tile between two depths
+// lie on the lines where neighbouring planes meet
+TileVolume GetTileVolume( Frustum frustum, float zNear, float zFar )
+{
+    const uint2 corners[4] = { uint2( 0, 2 ), uint2( 2, 1 ), uint2( 1, 3 ), uint2( 3, 0 ) }; // top-left, top-right, bottom-right, bottom-left
+
+    TileVolume volume;
+    volume.Box.Min = float3( 1e30f, 1e30f, zNear );
+    volume.Box.Max = float3( -1e30f, -1e30f, zFar );
+
+    [unroll]
+    for ( int c = 0; c < 4; ++c )
+    {
+        float3 edge = cross( frustum.planes[corners[c].x].N, frustum.planes[corners[c].y].N );
+        edge = edge / edge.z;   // point at depth 1
+
+        volume.Box.Min.xy = min( volume.Box.Min.xy, min( edge.xy * zNear, edge.xy * zFar ) );
+        volume.Box.Max.xy = max( volume.Box.Max.xy, max( edge.xy * zNear, edge.xy * zFar ) );
+    }
+
+    volume.BoxBounds.c = ( volume.Box.Min + volume.Box.Max ) * 0.5f;
+    volume.BoxBounds.r = length( volume.Box.Max - volume.BoxBounds.c );
+    return volume;
+}
+
+bool SphereIntersectsAABB( Sphere sphere, AABB box )
+{
+    float3 distance = max( box.Min - sphere.c, 0.0f ) + max( sphere.c - box.Max, 0.0f );
+    return dot( distance, distance ) <= sphere.r * sphere.r;
+}
+
+// Spot light volume against a sphere ("Cull that cone", Wronski 2017): the distance from the sphere center
+// to the side of the cone, and to the planes through the tip and the end of the range.
+bool SpotIntersectsSphere( SpotVolume spot, Sphere sphere )
+{
+    float3 V = sphere.c - spot.C.T;
+    float lengthSq = dot( V, V );
+    float axial = dot( V, spot.C.d );
+    float distanceToSide = spot.CosAngle * sqrt( max( lengthSq - axial * axial, 0.0f ) ) - axial * spot.SinAngle;
+
+    bool angleCull = distanceToSide > sphere.r;
+    bool frontCull = axial > sphere.r + spot.C.h;
+    bool backCull = axial < -sphere.r;
+    return !( angleCull || frontCull || backCull );
+}
+
+// Tight spot light test, only ever rejects: use after ConeInsideFrustum()
+bool SpotIntersectsTileVolume( SpotVolume spot, TileVolume volume )
+{
+    return SphereIntersectsAABB( spot.Bounds, volume.Box ) && SpotIntersectsSphere( spot, volume.BoxBounds );
+}
+
+float GetRadius(LightProperties light)
+{
+    float lightMax = max(max(light.Color.x, light.Color.y), light.Color.z) * light.Strength;
+
+    // Reference: https://learnopengl.com/Advanced-Lighting/Deferred-Shading, we use 10/256 as dark threshold
+    float darkThreshold = (256.0f / 2.5f);
+    return (-light.LinearAttenuation + sqrt(light.LinearAttenuation * light.LinearAttenuation - 4.0f * light.QuadraticAttenuation * (light.ConstantAttenuation - darkThreshold * lightMax))) / (2.0f * light.QuadraticAttenuation);
+}
+
+// Per tile light budget: estimated contribution of a light to the geometry in `box`, the brightest channel of the light
+// attenuated at the closest point of the box. Directional lights are not attenuated. Only used to rank the lights of a tile.
+float GetLightContribution( LightProperties light, AABB box )
+{
+    float lightMax = max( max( light.Color.x, light.Color.y ), light.Color.z ) * light.Strength;
+    if ( light.LightType == DIRECTIONAL_LIGHT )
+    {
+        return lightMax;
+    }
+
+    float3 distance = max( box.Min - light.PositionVS.xyz, 0.0f ) + max( light.PositionVS.xyz - box.Max, 0.0f );
+    float d = length( distance );
+    return lightMax / ( light.ConstantAttenuation + light.LinearAttenuation * d + light.QuadraticAttenuation * d * d );
+}
+
+// Deterministic light lists: a batch of APPEND_GROUP_SIZE threads appends its lights in thread order,
+// so a list holds its lights in the order they were tested instead of the order the threads reached
+// the atomic add. The culling shaders run BLOCK_SIZE x BLOCK_SIZE threads per group, 64 to 1024.
+#define APPEND_GROUP_SIZE ( BLOCK_SIZE * BLOCK_SIZE )
+
+groupshared uint AppendScan[APPEND_GROUP_SIZE];
+
+// Exclusive prefix sum of `flags` over the group, each flags value packs two 16-bit counters
+// (at most APPEND_GROUP_SIZE each). Every thread of the group must call it; `total` is the sum of the group.
+uint ScanAppendFlags( uint groupIndex, uint flags, out uint total )
+{
+    AppendScan[groupIndex] = flags;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for ( uint offset = 1; offset < APPEND_GROUP_SIZE; offset *= 2 )
+    {
+        uint value = groupIndex >= offset ? AppendScan[groupIndex - offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        AppendScan[groupIndex] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    total = AppendScan[APPEND_GROUP_SIZE - 1];
+    uint inclusive = AppendScan[groupIndex];
+
+    // AppendScan is overwritten by the next call
+    GroupMemoryBarrierWithGroupSync();
+    return inclusive - flags;
+}
+
+// LightProperties::SpotAngle is the half angle in radians, below 90 degrees
+SpotVolume GetSpotVolume( LightProperties light )
+{
+    float range = GetRadius( light );
+
+    SpotVolume spot;
+    spot.C.T = light.PositionVS.xyz;
+    spot.C.h = range;
+    spot.C.d = light.DirectionVS.xyz;
+    spot.C.r = tan( light.SpotAngle ) * range;
+
+    float slant = sqrt( spot.C.h * spot.C.h + spot.C.r * spot.C.r );
+    spot.CosAngle = spot.C.h / slant;
+    spot.SinAngle = spot.C.r / slant;
+
+    if ( spot.CosAngle < 0.70710678f )
+    {
+        // Wider than 45 degrees: the circle where the cap meets the cone
+        spot.Bounds.c = spot.C.T + spot.C.d * ( spot.C.h * spot.CosAngle );
+        spot.Bounds.r = spot.C.h * spot.SinAngle;
+    }
+    else
+    {
+        // The tip and that circle on the sphere
+        spot.Bounds.r = spot.C.h / ( 2.0f * spot.CosAngle );
+        spot.Bounds.c = spot.C.T + spot.C.d * spot.Bounds.r;
+    }
+    return spot;
+}
+
+// GetSpotVolume() from the constants derived on the cpu, see DerivedLight in Light.h
+SpotVolume GetSpotVolume( LightProperties light, DerivedLightProperties derived )
+{
+    SpotVolume spot;
+    spot.C.T = light.PositionVS.xyz;
+    spot.C.h = derived.Radius;
+    spot.C.d = light.DirectionVS.xyz;
+    spot.C.r = derived.ConeRadius;
+    spot.CosAngle = derived.ConeCos;
+    spot.SinAngle = derived.ConeSin;
+    spot.Bounds.c = derived.BoundsVS.xyz;
+    spot.Bounds.r = derived.BoundsVS.w;
+    return spot;
+}
@@ -0,0 +1,125 @@
+#define BLOCK_SIZE 16
+
+// Every group reduces a DEPTH_PYRAMID_TILE_SIZE x DEPTH_PYRAMID_TILE_SIZE block of pixels down to one texel,
+// writing all DEPTH_PYRAMID_LEVEL_COUNT levels on the way. Same as SimpleObj.h
+#define DEPTH_PYRAMID_LEVEL_COUNT 6
+#define DEPTH_PYRAMID_TILE_SIZE 64
+
+//  =========================
+//        Input  Buffers
+//  =========================
+
+// The depth from the screen space texture.
+Texture2D DepthTextureVS : register( t0 );
+
+// Min / max depth of 2^k x 2^k pixels in level k, mip k - 1 of the pyramid texture.
+// Pixels outside the screen read as 0, same as the tiles of CullLight.hlsl.
+RWTexture2D<float2> out_Level1 : register( u0 );
+RWTexture2D<float2> out_Level2 : register( u1 );
+RWTexture2D<float2> out_Level3 : register( u2 );
+RWTexture2D<float2> out_Level4 : register( u3 );
+RWTexture2D<float2> out_Level5 : register( u4 );
+RWTexture2D<float2> out_Level6 : register( u5 );
+
+// Level 2 texel of every thread, reduced in place for levels 3 to 6
+groupshared float2 Reduction[BLOCK_SIZE * BLOCK_SIZE];
+
+//  =========================
+//        Functions
+//  =========================
+
+float2 Combine( float2 a, float2 b )
+{
+    return float2( min( a.x, b.x ), max( a.y, b.y ) );
+}
+
+// Combine the 2 x 2 cells `offset` apart into the top-left one.
+// The other three cells are not written in this step, so there is no race.
+bool ReduceStep( uint2 threadID, uint offset, out float2 result )
+{
+    result = 0;
+    if ( any( threadID % ( 2 * offset ) ) )
+    {
+        return false;
+    }
+
+    uint index = threadID.x + threadID.y * BLOCK_SIZE;
+    result = Combine( Combine( Reduction[index], Reduction[index + offset] ),
+                      Combine( Reduction[index + offset * BLOCK_SIZE], Reduction[index + offset * BLOCK_SIZE + offset] ) );
+    Reduction[index] = result;
+    return true;
+}
+
+//  =========================
+//      Main Functions
+//  =========================
+
+struct ComputeShaderInput
+{
+    uint3 groupID           : SV_GroupID;           // 3D index of the thread group in the dispatch.
+    uint3 groupThreadID     : SV_GroupThreadID;     // 3D index of local thread ID in a thread group.
+    uint3 dispatchThreadID  : SV_DispatchThreadID;  // 3D index of global thread ID in the dispatch.
+    uint  groupIndex        : SV_GroupIndex;        // Flattened local index of the thread within a thread g
+};
+
+[numthreads(BLOCK_SIZE, BLOCK_SIZE, 1)]
+void main(ComputeShaderInput IN)
+{
+    // Levels 1 and 2 in registers: every thread reads 4 x 4 pixels
+    int2 pixel = IN.dispatchThreadID.xy * 4;
+    float2 level2 = 0;
+
+    [unroll]
+    for ( int y = 0; y < 2; ++y )
+    {
+        [unroll]
+        for ( int x = 0; x < 2; ++x )
+        {
+            int2 p = pixel + int2( x, y ) * 2;
+            float d00 = DepthTextureVS.Load( int3( p, 0 ) ).r;
+            float d10 = DepthTextureVS.Load( int3( p + int2( 1, 0 ), 0 ) ).r;
+            float d01 = DepthTextureVS.Load( int3( p + int2( 0, 1 ), 0 ) ).r;
+            float d11 = DepthTextureVS.Load( int3( p + int2( 1, 1 ), 0 ) ).r;
+
+            float2 level1 = float2( min( min( d00, d10 ), min( d01, d11 ) ), max( max( d00, d10 ), max( d01, d11 ) ) );
+            out_Level1[IN.dispatchThreadID.xy * 2 + int2( x, y )] = level1;
+
+            level2 = ( x == 0 && y == 0 ) ? level1 : Combine( level2, level1 );
+        }
+    }
+
+    out_Level2[IN.dispatchThreadID.xy] = level2;
+    Reduction[IN.groupIndex] = level2;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // Levels 3 to 6 in groupshared memory
+    uint2 threadID = IN.groupThreadID.xy;
+    float2 value;
+
+    if ( ReduceStep( threadID, 1, value ) )
+    {
+        out_Level3[IN.groupID.xy * ( BLOCK_SIZE / 2 ) + threadID / 2] = value;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if ( ReduceStep( threadID, 2, value ) )
+    {
+        out_Level4[IN.groupID.xy * ( BLOCK_SIZE / 4 ) + threadID / 4] = value;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if ( ReduceStep( threadID, 4, value ) )
+    {
+        out_Level5[IN.groupID.xy * ( BLOCK_SIZE / 8 ) + threadID / 8] = value;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if ( ReduceStep( threadID, 8, value ) )
+    {
+        out_Level6[IN.groupID.xy] = value;
+    }
+}
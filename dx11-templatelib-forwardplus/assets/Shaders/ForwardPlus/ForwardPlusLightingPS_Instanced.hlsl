@@ -0,0 +1,63 @@
+#include "../Structures.hlsli"
+#include "../Lighting.hlsli"
+#include "TiledLighting.hlsli"
+
+cbuffer LightProperties : register(b0)
+{
+    float4 EyePosition;                 // 16 bytes
+    //----------------------------------- (16 byte boundary)
+    float4 GlobalAmbient;               // 16 bytes
+    //----------------------------------- (16 byte boundary)
+    uint LightCount;                    // 4 bytes
+    uint GlobalLightCount;              // 4 bytes
+    uint2 LightPadding;                 // 8 bytes
+    //----------------------------------- (16 byte boundary)
+};  // Total:                           // 48 bytes (3 * 16 byte boundary)
+
+cbuffer LightingCalculationOptions : register(b1)
+{
+    int lightingSpace;        // 4 bytes
+    int lightCount;           // 4 bytes
+    int lightIndex;           // 4 bytes
+    float padding;            // 4 bytes
+                              //----------(16 byte boundary)
+}; // Total:                  // 16 bytes (1 * 16 byte boundary)
+Texture2D Texture : register(t0);
+sampler Sampler : register(s0);
+
+// ==============================================================
+//
+// Main Function
+//
+// ==============================================================
+
+struct PixelShaderInput
+{
+    float4 PositionCS : SV_POSITION;
+    float2 uv : TEXCOORD0;
+    float3 PositionWS : TEXCOORD1;
+    float3 PositionVS : TEXCOORD2;
+    float3 NormalWS : TEXCOORD3;
+    float3 NormalVS : TEXCOORD4;
+    struct MaterialProperties Material : MATERIAL;
+};
+
+float4 main(PixelShaderInput IN) : SV_TARGET
+{
+    LightingResult lit = ComputeLightingTiled(IN.PositionCS.xy, GlobalLightCount, LightCount, lightingSpace, IN.PositionWS, IN.PositionVS,
+        normalize(IN.NormalWS), normalize(IN.NormalVS), IN.Material.SpecularPower, EyePosition.xyz);
+
+    float3 emissive = IN.Material.Emissive;
+    float3 ambient = IN.Material.Ambient * GlobalAmbient;
+    float3 diffuse = IN.Material.Diffuse * lit.Diffuse;
+    float3 specular = IN.Material.Specular * lit.Specular;
+
+    float4 texColor = { 1, 1, 1, 1 };
+
+    if (IN.Material.UseTexture)
+    {
+        texColor = Texture.Sample(Sampler, IN.uv);
+    }
+
+    return float4((emissive + ambient + diffuse) * texColor.rgb + specular, 1.0);
+}
@@ -0,0 +1,89 @@
+// Second pass of the deterministic light lists (DispatchParams.DeterministicLightLists):
+// exclusive prefix sum of the per tile light counts in the light grids, in tile order (x + y * numThreadGroups.x).
+// A single group scans the whole grid, every thread sums a contiguous run of tiles first.
+#define SCAN_GROUP_SIZE 1024
+
+//  =========================
+//        Input  Buffers
+//  =========================
+cbuffer DispatchParams : register(b0)
+{
+    uint3 numThreadGroups;              // tile count of the culling pass
+    uint UseDepthPyramid;
+    uint3 numThreads;
+    uint DeterministicLightLists;
+}
+
+// (staging offset, count) of every tile, written by CullLight.hlsl
+RWTexture2D<uint2> o_LightGrid : register( u0 );
+RWTexture2D<uint2> t_LightGrid : register( u1 );
+
+// Offset of every tile in the final light index lists, read by ScatterLightLists.hlsl
+RWStructuredBuffer<uint> o_LightOffset : register( u2 );
+RWStructuredBuffer<uint> t_LightOffset : register( u3 );
+
+// opaque, transparent
+groupshared uint2 RunTotal[SCAN_GROUP_SIZE];
+
+//  =========================
+//        Functions
+//  =========================
+
+uint2 GetTile( uint tile )
+{
+    return uint2( tile % numThreadGroups.x, tile / numThreadGroups.x );
+}
+
+uint2 GetCounts( uint tile )
+{
+    uint2 tileID = GetTile( tile );
+    return uint2( o_LightGrid[tileID].y, t_LightGrid[tileID].y );
+}
+
+//  =========================
+//      Main Functions
+//  =========================
+
+struct ComputeShaderInput
+{
+    uint3 groupID           : SV_GroupID;           // 3D index of the thread group in the dispatch.
+    uint3 groupThreadID     : SV_GroupThreadID;     // 3D index of local thread ID in a thread group.
+    uint3 dispatchThreadID  : SV_DispatchThreadID;  // 3D index of global thread ID in the dispatch.
+    uint  groupIndex        : SV_GroupIndex;        // Flattened local index of the thread within a thread g
+};
+
+[numthreads(SCAN_GROUP_SIZE, 1, 1)]
+void main(ComputeShaderInput IN)
+{
+    uint tileCount = numThreadGroups.x * numThreadGroups.y;
+    uint runLength = ( tileCount + SCAN_GROUP_SIZE - 1 ) / SCAN_GROUP_SIZE;
+    uint begin = min( IN.groupIndex * runLength, tileCount );
+    uint end = min( begin + runLength, tileCount );
+
+    uint tile;
+    uint2 total = 0;
+    for ( tile = begin; tile < end; ++tile )
+    {
+        total += GetCounts( tile );
+    }
+    RunTotal[IN.groupIndex] = total;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // Inclusive scan of the run totals
+    for ( uint offset = 1; offset < SCAN_GROUP_SIZE; offset *= 2 )
+    {
+        uint2 value = IN.groupIndex >= offset ? RunTotal[IN.groupIndex - offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        RunTotal[IN.groupIndex] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint2 runOffset = RunTotal[IN.groupIndex] - total;
+    for ( tile = begin; tile < end; ++tile )
+    {
+        o_LightOffset[tile] = runOffset.x;
+        t_LightOffset[tile] = runOffset.y;
+        runOffset += GetCounts( tile );
+    }
+}
@@ -0,0 +1,71 @@
+// Last pass of the deterministic light lists (DispatchParams.DeterministicLightLists):
+// one group per tile copies the tile's lights from the staging list written by CullLight.hlsl
+// to the offset found by ScanLightGrid.hlsl, and points the light grid at the copy.
+// The final lists hold the tiles in tile order, same as Cpu::TiledLightCuller.
+#define BLOCK_SIZE 16
+
+//  =========================
+//        Input  Buffers
+//  =========================
+cbuffer DispatchParams : register(b0)
+{
+    uint3 numThreadGroups;
+    uint UseDepthPyramid;
+    uint3 numThreads;
+    uint DeterministicLightLists;
+}
+
+// "o_" prefix indicates light lists for opaque geometry while
+// "t_" prefix indicates light lists for transparent geometry.
+RWStructuredBuffer<uint> o_LightIndexStagingList : register( u0 );
+RWStructuredBuffer<uint> o_LightIndexList : register( u1 );
+RWTexture2D<uint2> o_LightGrid : register( u2 );
+RWStructuredBuffer<uint> o_LightOffset : register( u3 );
+
+RWStructuredBuffer<uint> t_LightIndexStagingList : register( u4 );
+RWStructuredBuffer<uint> t_LightIndexList : register( u5 );
+RWTexture2D<uint2> t_LightGrid : register( u6 );
+RWStructuredBuffer<uint> t_LightOffset : register( u7 );
+
+//  =========================
+//      Main Functions
+//  =========================
+
+struct ComputeShaderInput
+{
+    uint3 groupID           : SV_GroupID;           // 3D index of the thread group in the dispatch.
+    uint3 groupThreadID     : SV_GroupThreadID;     // 3D index of local thread ID in a thread group.
+    uint3 dispatchThreadID  : SV_DispatchThreadID;  // 3D index of global thread ID in the dispatch.
+    uint  groupIndex        : SV_GroupIndex;        // Flattened local index of the thread within a thread g
+};
+
+[numthreads(BLOCK_SIZE, BLOCK_SIZE, 1)]
+void main(ComputeShaderInput IN)
+{
+    uint tile = IN.groupID.x + IN.groupID.y * numThreadGroups.x;
+
+    uint2 o_Staging = o_LightGrid[IN.groupID.xy];
+    uint2 t_Staging = t_LightGrid[IN.groupID.xy];
+    uint o_Offset = o_LightOffset[tile];
+    uint t_Offset = t_LightOffset[tile];
+
+    uint i;
+    for ( i = IN.groupIndex; i < o_Staging.y; i += BLOCK_SIZE * BLOCK_SIZE )
+    {
+        o_LightIndexList[o_Offset + i] = o_LightIndexStagingList[o_Staging.x + i];
+    }
+
+    for ( i = IN.groupIndex; i < t_Staging.y; i += BLOCK_SIZE * BLOCK_SIZE )
+    {
+        t_LightIndexList[t_Offset + i] = t_LightIndexStagingList[t_Staging.x + i];
+    }
+
+    // Every thread has read the staging offsets before they are replaced
+    DeviceMemoryBarrierWithGroupSync();
+
+    if ( IN.groupIndex == 0 )
+    {
+        o_LightGrid[IN.groupID.xy] = uint2( o_Offset, o_Staging.y );
+        t_LightGrid[IN.groupID.xy] = uint2( t_Offset, t_Staging.y );
+    }
+}
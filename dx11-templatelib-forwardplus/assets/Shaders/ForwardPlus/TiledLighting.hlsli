@@ -0,0 +1,103 @@
+// Lighting of the Forward+ shading pass: every pixel only loops over the global light list and the opaque light list
+// of its tile, as CullLight.hlsl left them. Include after Structures.hlsli and Lighting.hlsli
+
+// BLOCK_SIZE, the tile size in pixels of the light grid, comes from the shader macros like for the culling shaders,
+// see SimpleObj::LoadShaderResources()
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 16
+#endif
+
+#define WORLD_SPACE 0
+#define VIEW_SPACE 1
+
+// Layout of the opaque light lists, Cpu::LightListEncoding. The culling shaders write LIGHT_LIST_UINT32, the others are
+// the words of Cpu::EncodeLightLists() the cpu culling uploads as LightIndexList, see
+// SimpleObj::GetShadingLightListEncoding()
+#define LIGHT_LIST_UINT32 0
+#define LIGHT_LIST_UINT16 1     // LightGrid in 16 bit indices, two per word, low half first
+#define LIGHT_LIST_BITMASK 2    // ceil(lightCount / 32) mask words per tile, LightGrid is only read for its size
+#ifndef LIGHT_LIST_ENCODING
+#define LIGHT_LIST_ENCODING LIGHT_LIST_UINT32
+#endif
+
+// All scene lights, see LIGHT_BUFFER_SLOT
+StructuredBuffer<LightProperties> Lights : register(t8);
+
+// Spot cone cosines of every light, derived once per dirty light on the cpu, see DERIVED_LIGHT_BUFFER_SLOT
+StructuredBuffer<DerivedLightProperties> DerivedLights : register(t12);
+
+// Directional lights shaded by every pixel, see GLOBAL_LIGHT_LIST_SLOT
+StructuredBuffer<uint> GlobalLightIndexList : register(t9);
+
+// Opaque light lists of the culling pass: offset and count of the lights of every tile in LightIndexList,
+// see LIGHT_GRID_SLOT / LIGHT_INDEX_LIST_SLOT
+Texture2D<uint2> LightGrid : register(t10);
+StructuredBuffer<uint> LightIndexList : register(t11);
+
+LightingResult ComputeLightingTiled(uint lightIndex, int lightingSpace, float3 positionWS, float3 positionVS, float3 normalWS, float3 normalVS, float specularPower, float3 eyePosition)
+{
+    if (lightingSpace == VIEW_SPACE)
+    {
+        return ComputeLightingVS_Single(Lights[lightIndex], DerivedLights[lightIndex], positionVS, normalVS, specularPower);
+    }
+    return ComputeLightingWS_Single(Lights[lightIndex], DerivedLights[lightIndex], positionWS, normalWS, specularPower, eyePosition);
+}
+
+// positionSS is SV_POSITION, normals are normalized, lightCount is the size of Lights
+LightingResult ComputeLightingTiled(float2 positionSS, uint globalLightCount, uint lightCount, int lightingSpace, float3 positionWS, float3 positionVS, float3 normalWS, float3 normalVS, float specularPower, float3 eyePosition)
+{
+    LightingResult totalResult = { {0, 0, 0}, {0, 0, 0} };
+
+    [loop]
+    for (uint i = 0; i < globalLightCount; ++i)
+    {
+        LightingResult result = ComputeLightingTiled(GlobalLightIndexList[i], lightingSpace, positionWS, positionVS, normalWS, normalVS, specularPower, eyePosition);
+        totalResult.Diffuse += result.Diffuse;
+        totalResult.Specular += result.Specular;
+    }
+
+    uint2 tile = uint2(floor(positionSS / BLOCK_SIZE));
+
+#if LIGHT_LIST_ENCODING == LIGHT_LIST_BITMASK
+    // LightIndexList is allocated with room to grow, the words per tile follow from the light count
+    uint tileCountX, tileCountY;
+    LightGrid.GetDimensions(tileCountX, tileCountY);
+    uint wordsPerTile = (lightCount + 31) / 32;
+    uint firstWord = (tile.x + tile.y * tileCountX) * wordsPerTile;
+
+    [loop]
+    for (uint word = 0; word < wordsPerTile; ++word)
+    {
+        uint bits = LightIndexList[firstWord + word];
+
+        [loop]
+        while (bits != 0)
+        {
+            uint bit = firstbitlow(bits);
+            bits &= bits - 1;
+
+            LightingResult result = ComputeLightingTiled(word * 32 + bit, lightingSpace, positionWS, positionVS, normalWS, normalVS, specularPower, eyePosition);
+            totalResult.Diffuse += result.Diffuse;
+            totalResult.Specular += result.Specular;
+        }
+    }
+#else
+    uint2 lightCell = LightGrid[tile];
+
+    [loop]
+    for (uint j = 0; j < lightCell.y; ++j)
+    {
+#if LIGHT_LIST_ENCODING == LIGHT_LIST_UINT16
+        uint index = lightCell.x + j;
+        uint lightIndex = (LightIndexList[index / 2] >> (index % 2 * 16)) & 0xFFFF;
+#else
+        uint lightIndex = LightIndexList[lightCell.x + j];
+#endif
+        LightingResult result = ComputeLightingTiled(lightIndex, lightingSpace, positionWS, positionVS, normalWS, normalVS, specularPower, eyePosition);
+        totalResult.Diffuse += result.Diffuse;
+        totalResult.Specular += result.Specular;
+    }
+#endif
+
+    return totalResult;
+}
@@ -22,20 +22,24 @@ float DoAttenuation(LightProperties light, float d)
     return 1.0f / (light.ConstantAttenuation + light.LinearAttenuation * d + light.QuadraticAttenuation * d * d);
 }
 
+float DoSpotCone(float3 direction, float3 L, float minCos, float maxCos)
+{
+    float cosAngle = dot(direction, -L);
+    return smoothstep(minCos, maxCos, cosAngle);
+}
+
 float DoSpotConeWS(LightProperties light, float3 L)
 {
     float minCos = cos(light.SpotAngle);
     float maxCos = (minCos + 1.0f) / 2.0f;
-    float cosAngle = dot(light.DirectionWS.xyz, -L);
-    return smoothstep(minCos, maxCos, cosAngle);
+    return DoSpotCone(light.DirectionWS.xyz, L, minCos, maxCos);
 }
 
 float DoSpotConeVS(LightProperties light, float3 L)
 {
     float minCos = cos(light.SpotAngle);
     float maxCos = (minCos + 1.0f) / 2.0f;
-    float cosAngle = dot(light.DirectionVS.xyz, -L);
-    return smoothstep(minCos, maxCos, cosAngle);
+    return DoSpotCone(light.DirectionVS.xyz, L, minCos, maxCos);
 }
 
 LightingResult _DoDirectionalLight(LightProperties light, float3 V, float3 N, float specularPower, float3 L)
@@ -114,7 +118,22 @@ LightingResult DoSpotLightVS(LightProperties light, float3 V, float3 P, float3 N
     return _DoSpotLight(light, V, P, N, specularPower, L, spotIntensity);
 }
 
-LightingResult ComputeLightingVS(LightProperties Lights[MAX_LIGHTS], int lightCount, float3 positionVS, float3 normalVS, float specularPower)
+// Spot lights with the cone cosines derived on the cpu instead of cos(SpotAngle) per pixel, see DerivedLightProperties
+LightingResult DoSpotLightWS(LightProperties light, DerivedLightProperties derived, float3 V, float3 P, float3 N, float specularPower)
+{
+    float3 L = (light.PositionWS - P).xyz;
+    float spotIntensity = DoSpotCone(light.DirectionWS.xyz, -normalize(L), derived.SpotCosOuter, derived.SpotCosInner);
+    return _DoSpotLight(light, V, P, N, specularPower, L, spotIntensity);
+}
+
+LightingResult DoSpotLightVS(LightProperties light, DerivedLightProperties derived, float3 V, float3 P, float3 N, float specularPower)
+{
+    float3 L = (light.PositionVS - P).xyz;
+    float spotIntensity = DoSpotCone(light.DirectionVS.xyz, -normalize(L), derived.SpotCosOuter, derived.SpotCosInner);
+    return _DoSpotLight(light, V, P, N, specularPower, L, spotIntensity);
+}
+
+LightingResult ComputeLightingVS(StructuredBuffer<LightProperties> Lights, int lightCount, float3 positionVS, float3 normalVS, float specularPower)
 {
     // view space calculation is still buggy!
 
@@ -122,7 +141,7 @@ LightingResult ComputeLightingVS(LightProperties Lights[MAX_LIGHTS], int lightCo
     
     LightingResult totalResult = { {0, 0, 0}, {0, 0, 0} };
     
-    [unroll]
+    [loop]
     for (int i = 0; i < lightCount; ++i)
     {
         if (!Lights[i].Enabled)
@@ -186,13 +205,13 @@ LightingResult ComputeLightingVS_Single(LightProperties light, float3 positionVS
     return totalResult;
 }
 
-LightingResult ComputeLightingWS(LightProperties Lights[MAX_LIGHTS], int lightCount, float3 positionWS, float3 normalWS, float specularPower, float3 eyePosition)
+LightingResult ComputeLightingWS(StructuredBuffer<LightProperties> Lights, int lightCount, float3 positionWS, float3 normalWS, float specularPower, float3 eyePosition)
 {
     float3 view = normalize(eyePosition - positionWS);
     
     LightingResult totalResult = { {0, 0, 0}, {0, 0, 0} };
     
-    [unroll]
+    [loop]
     for (int i = 0; i < lightCount; ++i)
     {
         if (!Lights[i].Enabled)
@@ -251,5 +270,71 @@ LightingResult ComputeLightingWS_Single(LightProperties light, float3 positionWS
     totalResult.Diffuse += result.Diffuse * light.Strength;
     totalResult.Specular += result.Specular * light.Strength;
 
+    return totalResult;
+}
+
+LightingResult ComputeLightingVS_Single(LightProperties light, DerivedLightProperties derived, float3 positionVS, float3 normalVS, float specularPower)
+{
+    // view space calculation is still buggy!
+
+    float3 view = normalize(positionVS);
+
+    LightingResult totalResult = { {0, 0, 0}, {0, 0, 0} };
+
+    if (!light.Enabled)
+    {
+        return totalResult;
+    }
+
+    LightingResult result = { {0, 0, 0}, {0, 0, 0} };
+
+    switch ((int)light.LightType)
+    {
+    case DIRECTIONAL_LIGHT:
+        result = DoDirectionalLightVS(light, view, normalVS, specularPower);
+        break;
+    case POINT_LIGHT:
+        result = DoPointLightVS(light, view, positionVS, normalVS, specularPower);
+        break;
+    case SPOT_LIGHT:
+        result = DoSpotLightVS(light, derived, view, positionVS, normalVS, specularPower);
+        break;
+    }
+
+    totalResult.Diffuse += result.Diffuse * light.Strength;
+    totalResult.Specular += result.Specular * light.Strength;
+
+    return totalResult;
+}
+
+LightingResult ComputeLightingWS_Single(LightProperties light, DerivedLightProperties derived, float3 positionWS, float3 normalWS, float specularPower, float3 eyePosition)
+{
+    float3 view = normalize(eyePosition - positionWS);
+
+    LightingResult totalResult = { {0, 0, 0}, {0, 0, 0} };
+
+    if (!light.Enabled)
+    {
+        return totalResult;
+    }
+
+    LightingResult result = { {0, 0, 0}, {0, 0, 0} };
+
+    switch ((int)light.LightType)
+    {
+    case DIRECTIONAL_LIGHT:
+        result = DoDirectionalLightWS(light, view, normalWS, specularPower);
+        break;
+    case POINT_LIGHT:
+        result = DoPointLightWS(light, view, positionWS, normalWS, specularPower);
+        break;
+    case SPOT_LIGHT:
+        result = DoSpotLightWS(light, derived, view, positionWS, normalWS, specularPower);
+        break;
+    }
+
+    totalResult.Diffuse += result.Diffuse * light.Strength;
+    totalResult.Specular += result.Specular * light.Strength;
+
     return totalResult;
 }
\ No newline at end of file
@@ -1,5 +1,3 @@
-#define MAX_LIGHTS 8
-
 // Light types.
 #define DIRECTIONAL_LIGHT 0
 #define POINT_LIGHT 1
@@ -30,7 +28,24 @@ struct LightProperties
     float       Strength;               // 4 bytes
     int         Padding;                // 4 bytes
     //----------------------------------- (16 byte boundary)
-};  // Total:                           // 80 bytes (5 * 16)
+};  // Total:                           // 112 bytes (7 * 16), stride of the structured light buffer
+
+// Constants of a light derived once per dirty light on the cpu, see DerivedLight in Light.h
+struct DerivedLightProperties
+{
+    float4      BoundsVS;               // 16 bytes, xyz center, w radius of the bounding sphere of the lit volume
+    //----------------------------------- (16 byte boundary)
+    float       Radius;                 // 4 bytes, GetRadius()
+    float       InverseRadiusSq;        // 4 bytes
+    float       SpotCosOuter;           // 4 bytes, cos(SpotAngle)
+    float       SpotCosInner;           // 4 bytes, (SpotCosOuter + 1) / 2
+    //----------------------------------- (16 byte boundary)
+    float       ConeRadius;             // 4 bytes, tan(SpotAngle) * Radius
+    float       ConeCos;                // 4 bytes, SpotVolume::CosAngle
+    float       ConeSin;                // 4 bytes, SpotVolume::SinAngle
+    int         Padding;                // 4 bytes
+    //----------------------------------- (16 byte boundary)
+};  // Total:                           // 48 bytes (3 * 16), stride of the structured derived light buffer
 
 struct MaterialProperties
 {
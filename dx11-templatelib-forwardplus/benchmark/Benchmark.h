@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Yr
+{
+namespace Benchmark
+{
+    /// <summary>
+    /// Command line options shared by every benchmark:
+    ///   --threads N       worker threads including the main thread (0 = all cores)
+    ///   --iterations N    timed runs per measurement, the median is reported
+    ///   --quick           smaller problem sizes, for smoke testing
+    /// </summary>
+    struct Options
+    {
+        unsigned int Threads = 0;
+        int Iterations = 5;
+        bool Quick = false;
+    };
+
+    inline Options ParseOptions(int argc, char** argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            {
+                options.Threads = static_cast<unsigned int>(std::atoi(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            {
+                options.Iterations = std::max(1, std::atoi(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--quick") == 0)
+            {
+                options.Quick = true;
+                options.Iterations = 1;
+            }
+        }
+        return options;
+    }
+
+    // Returns true if `flag` was passed on the command line
+    inline bool HasFlag(int argc, char** argv, const char* flag)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], flag) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns the value after `name` on the command line, or `defaultValue` if it was not passed
+    inline const char* GetOption(int argc, char** argv, const char* name, const char* defaultValue = nullptr)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+        {
+            if (std::strcmp(argv[i], name) == 0)
+            {
+                return argv[i + 1];
+            }
+        }
+        return defaultValue;
+    }
+
+    /// <summary>
+    /// Run `func` once to warm up, then `iterations` times and return the median in milliseconds
+    /// </summary>
+    template<class Func>
+    inline double MeasureMilliseconds(int iterations, Func&& func)
+    {
+        func();
+
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            func();
+            auto end = std::chrono::high_resolution_clock::now();
+            samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    struct Resolution
+    {
+        const char* Name;
+        int Width;
+        int Height;
+    };
+
+    const Resolution Resolution1080p = { "1080p", 1920, 1080 };
+    const Resolution Resolution1440p = { "1440p", 2560, 1440 };
+    const Resolution Resolution4K = { "4K", 3840, 2160 };
+}
+}
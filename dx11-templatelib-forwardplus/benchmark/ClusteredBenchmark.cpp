@@ -0,0 +1,129 @@
+// Compares the 2D tile grid (TiledLightCuller) with clustered light assignment (ClusteredLightCuller)
+// on the default scene at 1080p: build time, grid + index list size, and the average number of lights
+// a shaded pixel loops over. Pixels at the clear depth are not shaded and not counted.
+
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/ClusteredLightCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    double LightsPerShadedPixel(const SyntheticScene& scene, int blockSize, const LightCullResult& result)
+    {
+        double lights = 0.0;
+        size_t pixels = 0;
+        for (int y = 0; y < scene.Height; ++y)
+        {
+            for (int x = 0; x < scene.Width; ++x)
+            {
+                if (scene.Depth[x + static_cast<size_t>(y) * scene.Width] < 1.0f)
+                {
+                    lights += result.LightGrid[x / blockSize + (y / blockSize) * result.TileCountX].y;
+                    ++pixels;
+                }
+            }
+        }
+        return pixels ? lights / pixels : 0.0;
+    }
+
+    double LightsPerShadedPixel(const SyntheticScene& scene, int blockSize, const ClusterCullResult& result)
+    {
+        double lights = 0.0;
+        size_t pixels = 0;
+        for (int y = 0; y < scene.Height; ++y)
+        {
+            for (int x = 0; x < scene.Width; ++x)
+            {
+                float depth = scene.Depth[x + static_cast<size_t>(y) * scene.Width];
+                if (depth < 1.0f)
+                {
+                    int slice = result.GetSlice(ClipToView(Float4(0, 0, depth, 1), scene.InverseProjection).z);
+                    lights += result.ClusterGrid[result.GetClusterIndex(x / blockSize, y / blockSize, slice)].y;
+                    ++pixels;
+                }
+            }
+        }
+        return pixels ? lights / pixels : 0.0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller tiledCuller(threadPool);
+    ClusteredLightCuller clusteredCuller(threadPool);
+
+    const Benchmark::Resolution resolution = Benchmark::Resolution1080p;
+    const size_t lightCounts[] = { 256, 1024, 4096 };
+    const int sliceCounts[] = { 16, 24, 32, 64 };
+    const int blockSize = 16;
+
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    std::vector<Frustum> frustums;
+    ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+    std::printf("Clustered benchmark, %s, %u thread(s), %d iteration(s), block size %d\n", resolution.Name, threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%7s %-13s %10s %12s %12s %16s\n", "lights", "grid", "ms", "cells", "KiB", "lights/pixel");
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 1024)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = blockSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.Frustums = frustums.data();
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+
+        LightCullResult tiled;
+        double tiledMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { tiledCuller.Cull(input, tiled); });
+        double tiledKiB = (tiled.LightGrid.size() * sizeof(uint2) + tiled.LightIndexList.size() * sizeof(uint32_t)) / 1024.0;
+
+        std::printf("%7zu %-13s %10.3f %12zu %12.1f %16.2f\n", lightCount, "tiled", tiledMs, tiled.TileCount(), tiledKiB,
+            LightsPerShadedPixel(scene, blockSize, tiled));
+
+        for (int sliceCount : sliceCounts)
+        {
+            if (options.Quick && sliceCount != 16 && sliceCount != 32)
+            {
+                continue;
+            }
+
+            ClusterCullSettings settings;
+            settings.SliceCount = sliceCount;
+
+            ClusterCullResult clustered;
+            double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { clusteredCuller.Cull(input, settings, clustered); });
+            double kiB = (clustered.ClusterGrid.size() * sizeof(uint2) + clustered.LightIndexList.size() * sizeof(uint32_t)) / 1024.0;
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "clustered %d", sliceCount);
+            std::printf("%7zu %-13s %10.3f %12zu %12.1f %16.2f\n", lightCount, name, ms, clustered.ClusterCount(), kiB,
+                LightsPerShadedPixel(scene, blockSize, clustered));
+        }
+    }
+
+    return 0;
+}
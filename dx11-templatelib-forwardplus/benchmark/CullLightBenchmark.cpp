@@ -0,0 +1,67 @@
+// Measures the CPU tiled light culler (Cpu::TiledLightCuller) on the default scene
+// at 1080p and 4K with 8, 256 and 4096 lights, and reports tiles culled per second.
+
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 8, 256, 4096 };
+    const int blockSize = 16;
+
+    std::printf("CullLight benchmark, %u thread(s), %d iteration(s), block size %d\n", threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-6s %7s %7s %10s %14s %12s %14s\n", "res", "lights", "tiles", "ms", "tiles/sec", "indices", "lights/tile");
+
+    for (auto& resolution : resolutions)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+        std::vector<Frustum> frustums;
+        ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 256)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.Frustums = frustums.data();
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+
+            LightCullResult result;
+            double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+
+            double tilesPerSecond = result.TileCount() / (ms / 1000.0);
+            std::printf("%-6s %7zu %7zu %10.3f %14.0f %12zu %14.2f\n",
+                resolution.Name, lightCount, result.TileCount(), ms, tilesPerSecond,
+                result.LightIndexList.size(), result.LightIndexList.size() / (double)result.TileCount());
+        }
+    }
+
+    return 0;
+}
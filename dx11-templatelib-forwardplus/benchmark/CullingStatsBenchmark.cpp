@@ -0,0 +1,136 @@
+// Culling quality of the tiled culler on the default scene at 1080p and 4K with 1024 and 4096 lights:
+// lights per tile (max, mean, median, 95th percentile) and the false positive rate against the brute force
+// per pixel test, for the depth range test, the 2.5D depth mask and hierarchical culling.
+//   --export DIR       also write per configuration a light count and a false positive heatmap (PPM),
+//                      the per tile counts and the histogram (CSV), and DIR/summary.csv with one row per configuration
+//   --heatmap-max N    light count shown as red in the heatmaps, fixed so images of different builds compare (default 64)
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Benchmark.h"
+
+#include "Cpu/CullingAnalysis.h"
+#include "Cpu/CullingReport.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    struct Config
+    {
+        const char* Name;
+        bool UseDepthMask;
+        int SuperTileSize;
+    };
+
+    bool Export(const std::string& prefix, const TileLightStats& stats, uint32_t heatmapMax)
+    {
+        return WriteHeatmapPpm((prefix + "_lights.ppm").c_str(), stats.LightCounts.data(), stats.TileCountX, stats.TileCountY, heatmapMax, 4) &&
+            WriteHeatmapPpm((prefix + "_false_positives.ppm").c_str(), stats.FalsePositiveCounts.data(), stats.TileCountX, stats.TileCountY, heatmapMax, 4) &&
+            WriteTileLightStatsCsv((prefix + "_tiles.csv").c_str(), stats) &&
+            WriteLightCountHistogramCsv((prefix + "_histogram.csv").c_str(), stats);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    const char* exportDirectory = Benchmark::GetOption(argc, argv, "--export");
+    uint32_t heatmapMax = static_cast<uint32_t>(std::atoi(Benchmark::GetOption(argc, argv, "--heatmap-max", "64")));
+
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 1024, 4096 };
+    const Config configs[] = { { "range", false, 0 }, { "2.5D", true, 0 }, { "hier", true, 64 } };
+    const int blockSize = 16;
+
+    FILE* summary = nullptr;
+    if (exportDirectory)
+    {
+        summary = std::fopen((std::string(exportDirectory) + "/summary.csv").c_str(), "w");
+        if (!summary)
+        {
+            std::fprintf(stderr, "Unable to write to %s\n", exportDirectory);
+            return 1;
+        }
+        std::fprintf(summary, "resolution,lights,config,max,mean,p50,p95,listed,false_positives,false_positive_rate\n");
+    }
+
+    std::printf("Culling stats benchmark, %u thread(s), %d iteration(s), block size %d\n", threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-6s %7s %-6s %10s %10s %6s %8s %6s %6s %12s %8s\n", "res", "lights", "test", "cull ms", "stats ms",
+        "max", "mean", "p50", "p95", "false pos", "fp%");
+
+    for (auto& resolution : resolutions)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+        FrustumPlaneGrid grid;
+        ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && (lightCount > 1024 || resolution.Width > Benchmark::Resolution1080p.Width))
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            for (const Config& config : configs)
+            {
+                LightCullInput input;
+                input.Depth = scene.Depth.data();
+                input.Width = scene.Width;
+                input.Height = scene.Height;
+                input.BlockSize = blockSize;
+                input.InverseProjection = scene.InverseProjection;
+                input.FrustumPlanes = &grid;
+                input.Lights = scene.Lights.data();
+                input.LightCount = scene.Lights.size();
+                input.UseDepthMask = config.UseDepthMask;
+                input.SuperTileSize = config.SuperTileSize;
+
+                LightCullResult result;
+                double cullMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+
+                TileLightStats stats;
+                double statsMs = Benchmark::MeasureMilliseconds(1, [&]() { ComputeTileLightStats(input, result, true, threadPool, stats); });
+
+                std::printf("%-6s %7zu %-6s %10.3f %10.1f %6u %8.2f %6u %6u %12zu %8.2f\n", resolution.Name, lightCount, config.Name, cullMs, statsMs,
+                    stats.MaxLights, stats.MeanLights, stats.Percentile(0.5), stats.Percentile(0.95), stats.FalsePositives.FalsePositives,
+                    stats.FalsePositives.Rate() * 100.0);
+
+                if (summary)
+                {
+                    std::fprintf(summary, "%s,%zu,%s,%u,%.4f,%u,%u,%zu,%zu,%.6f\n", resolution.Name, lightCount, config.Name, stats.MaxLights,
+                        stats.MeanLights, stats.Percentile(0.5), stats.Percentile(0.95), stats.FalsePositives.ListedLights,
+                        stats.FalsePositives.FalsePositives, stats.FalsePositives.Rate());
+
+                    std::string prefix = std::string(exportDirectory) + "/" + resolution.Name + "_" + std::to_string(lightCount) + "_" + config.Name;
+                    if (!Export(prefix, stats, heatmapMax))
+                    {
+                        std::fprintf(stderr, "Unable to write %s_*\n", prefix.c_str());
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (summary)
+    {
+        std::fclose(summary);
+    }
+
+    return 0;
+}
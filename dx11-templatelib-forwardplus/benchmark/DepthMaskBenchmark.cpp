@@ -0,0 +1,89 @@
+// Measures 2.5D depth-mask culling (LightCullInput::UseDepthMask) against the plain min / max depth range
+// on the default scene and on the sphere-filled stress scene at 1080p. For every light list the lights that do
+// not touch any shaded pixel of their tile are counted by brute force, and the reduction of these false
+// positives is reported together with the culling time.
+
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/CullingAnalysis.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolution = Benchmark::Resolution1080p;
+    const size_t lightCounts[] = { 256, 1024, 4096 };
+    const int blockSize = 16;
+
+    SyntheticScene scenes[2];
+    const char* sceneNames[2] = { "default", "stress" };
+    BuildDefaultScene(resolution.Width, resolution.Height, scenes[0]);
+    BuildStressScene(resolution.Width, resolution.Height, scenes[1], 42);
+
+    std::vector<Frustum> frustums;
+    ComputeFrustums(scenes[0].InverseProjection, resolution.Width, resolution.Height, blockSize, frustums);
+
+    std::printf("Depth mask benchmark, %s, %u thread(s), %d iteration(s), block size %d\n", resolution.Name, threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-8s %7s %-6s %10s %10s %10s %9s %11s\n", "scene", "lights", "mode", "ms", "listed", "false+", "false+%", "reduction%");
+
+    for (int s = 0; s < 2; ++s)
+    {
+        SyntheticScene& scene = scenes[s];
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 1024)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.Frustums = frustums.data();
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+
+            size_t rangeFalsePositives = 0;
+            for (int useDepthMask = 0; useDepthMask < 2; ++useDepthMask)
+            {
+                input.UseDepthMask = useDepthMask != 0;
+
+                LightCullResult result;
+                double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+                FalsePositiveStats stats = CountFalsePositives(input, result, threadPool);
+
+                if (!useDepthMask)
+                {
+                    rangeFalsePositives = stats.FalsePositives;
+                    std::printf("%-8s %7zu %-6s %10.3f %10zu %10zu %9.2f %11s\n", sceneNames[s], lightCount, "range", ms,
+                        stats.ListedLights, stats.FalsePositives, stats.Rate() * 100.0, "-");
+                }
+                else
+                {
+                    double reduction = rangeFalsePositives ? 100.0 * (1.0 - stats.FalsePositives / (double)rangeFalsePositives) : 0.0;
+                    std::printf("%-8s %7zu %-6s %10.3f %10zu %10zu %9.2f %11.2f\n", sceneNames[s], lightCount, "2.5D", ms,
+                        stats.ListedLights, stats.FalsePositives, stats.Rate() * 100.0, reduction);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Measures the min / max depth pyramid (Cpu::DepthPyramid) at 1080p, 1440p and 4K on the sphere-filled stress scene.
+// First the build time of every kernel, checked bit for bit against the scalar build. Then, for tile sizes 8 to 64,
+// the time to get the depth bounds of every tile by scanning its pixels versus one fetch from the pyramid,
+// and the number of tiles whose bounds differ between the two (must be 0).
+// The exit code is 1 if any mismatches are found.
+
+#include <cstdio>
+#include <cstring>
+
+#include "Benchmark.h"
+
+#include "Cpu/DepthPyramid.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    size_t CountLevelMismatches(const DepthPyramid& a, const DepthPyramid& b)
+    {
+        size_t mismatches = 0;
+        for (int level = 1; level <= a.LevelCount(); ++level)
+        {
+            size_t texelCount = static_cast<size_t>(a.LevelWidth(level)) * a.LevelHeight(level);
+            for (size_t i = 0; i < texelCount; ++i)
+            {
+                if (std::memcmp(&a.MinLevel(level)[i], &b.MinLevel(level)[i], sizeof(float)) != 0 ||
+                    std::memcmp(&a.MaxLevel(level)[i], &b.MaxLevel(level)[i], sizeof(float)) != 0)
+                {
+                    ++mismatches;
+                }
+            }
+        }
+        return mismatches;
+    }
+
+    void ComputeAllTileBounds(ThreadPool& threadPool, const LightCullInput& input, std::vector<TileDepthBounds>& bounds)
+    {
+        int tileCountX = GetTileCount(input.Width, input.BlockSize);
+        int tileCountY = GetTileCount(input.Height, input.BlockSize);
+        bounds.resize(static_cast<size_t>(tileCountX) * tileCountY);
+
+        threadPool.ParallelFor(tileCountY, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < tileCountX; ++x)
+                {
+                    bounds[x + y * tileCountX] = TiledLightCuller::ComputeTileDepthBounds(input, x, static_cast<int>(y));
+                }
+            }
+        });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution1440p, Benchmark::Resolution4K };
+    const int blockSizes[] = { 8, 16, 32, 64 };
+
+    std::printf("Depth pyramid benchmark, %u thread(s), %d iteration(s), %d levels\n", threadPool.ThreadCount(), options.Iterations, DepthPyramid::MaxLevelCount);
+
+    size_t failedRows = 0;
+
+    for (auto& resolution : resolutions)
+    {
+        if (options.Quick && resolution.Width > 1920)
+        {
+            continue;
+        }
+
+        SyntheticScene scene;
+        BuildStressScene(resolution.Width, resolution.Height, scene, 42);
+
+        std::printf("\n%-6s %-8s %10s %9s %10s %11s\n", "res", "kernel", "build ms", "speedup", "MB/s", "mismatches");
+
+        DepthPyramid reference(threadPool);
+        reference.Build(scene.Depth.data(), scene.Width, scene.Height, CullKernel::Scalar);
+
+        double scalarMs = 0.0;
+        for (int k = 0; k < (int)CullKernel::NumCullKernel; ++k)
+        {
+            CullKernel kernel = (CullKernel)k;
+            if (!IsCullKernelSupported(kernel))
+            {
+                continue;
+            }
+
+            DepthPyramid pyramid(threadPool);
+            double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]()
+            {
+                pyramid.Build(scene.Depth.data(), scene.Width, scene.Height, kernel);
+            });
+
+            if (kernel == CullKernel::Scalar)
+            {
+                scalarMs = ms;
+            }
+
+            double megabytes = scene.Depth.size() * sizeof(float) / (1024.0 * 1024.0);
+            size_t mismatches = CountLevelMismatches(reference, pyramid);
+            failedRows += mismatches > 0 ? 1 : 0;
+            std::printf("%-6s %-8s %10.3f %9.2f %10.0f %11zu\n", resolution.Name, GetCullKernelName(kernel), ms, scalarMs / ms,
+                megabytes / (ms / 1000.0), mismatches);
+        }
+
+        DepthPyramid pyramid(threadPool);
+        pyramid.Build(scene.Depth.data(), scene.Width, scene.Height, GetBestCullKernel());
+
+        std::printf("%-6s %6s %8s %10s %10s %9s %11s\n", "res", "block", "tiles", "scan ms", "fetch ms", "speedup", "mismatches");
+
+        for (int blockSize : blockSizes)
+        {
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+
+            std::vector<TileDepthBounds> scanned;
+            double scanMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { ComputeAllTileBounds(threadPool, input, scanned); });
+
+            input.Pyramid = &pyramid;
+            std::vector<TileDepthBounds> fetched;
+            double fetchMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { ComputeAllTileBounds(threadPool, input, fetched); });
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < scanned.size(); ++i)
+            {
+                if (std::memcmp(&scanned[i].MinDepthVS, &fetched[i].MinDepthVS, sizeof(float)) != 0 ||
+                    std::memcmp(&scanned[i].MaxDepthVS, &fetched[i].MaxDepthVS, sizeof(float)) != 0)
+                {
+                    ++mismatches;
+                }
+            }
+
+            failedRows += mismatches > 0 ? 1 : 0;
+            std::printf("%-6s %6d %8zu %10.3f %10.3f %9.2f %11zu\n", resolution.Name, blockSize, scanned.size(), scanMs, fetchMs,
+                scanMs / fetchMs, mismatches);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+// Replays a frame capture (Cpu/FrameCapture.h) through the CPU culling and shading reference, for perf and correctness
+// regression runs without a GPU. `--capture FILE` replays a capture of the application ("Record Capture" in the Forward+
+// settings); without it a synthetic sequence of the default scene at 1080p with 1024 moving lights is written to
+// `--record FILE` (synthetic.fpcap by default) first and that is replayed; every other synthetic frame is recorded with
+// super-tiles and a light budget of 32.
+// Every frame is culled with its captured tile size, the depth mask, the transparent lists, the global light list and its
+// depth pyramid. "KB" is the size of the frame in the file, "read ms" reading and decoding it. "flat ms" / "hier ms" are
+// TiledLightCuller without and with super-tiles of 4x4 tiles and no budget, "scatter ms" ScatterLightCuller, "shade ms"
+// ShadeLightLists() of the flat lists. "mismatch" counts the tiles whose hierarchical or scatter lists differ from the flat
+// ones and must be 0. "super" / "budget" are the super-tile size and light budget the frame was captured with, "hash" is
+// HashLightLists() of the lists culled with them, "check" compares it with the hash stored in the capture (- if none).
+// The exit code is 1 if a frame cannot be read, mismatches or fails its check.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/DepthPyramid.h"
+#include "Cpu/FrameCapture.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+#include "Cpu/TileSizeTuner.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    bool ListsEqual(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list, size_t tile)
+    {
+        auto referenceBegin = referenceList.begin() + referenceGrid[tile].x;
+        auto begin = list.begin() + grid[tile].x;
+        return referenceGrid[tile].y == grid[tile].y && std::equal(referenceBegin, referenceBegin + referenceGrid[tile].y, begin);
+    }
+
+    size_t CountMismatches(const LightCullResult& reference, const LightCullResult& result)
+    {
+        size_t mismatches = 0;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            bool equal = ListsEqual(reference.LightGrid, reference.LightIndexList, result.LightGrid, result.LightIndexList, tile) &&
+                ListsEqual(reference.TransparentLightGrid, reference.TransparentLightIndexList,
+                    result.TransparentLightGrid, result.TransparentLightIndexList, tile);
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+
+    // The input the frame was culled with when it was captured, `pyramid` is built if the frame used one
+    LightCullInput MakeCullInput(const CapturedFrame& frame, const FrustumPlaneGrid& grid, DepthPyramid& pyramid)
+    {
+        LightCullInput input;
+        input.Depth = frame.Depth.data();
+        input.Width = frame.Width;
+        input.Height = frame.Height;
+        input.BlockSize = frame.TileSize;
+        input.InverseProjection = frame.InverseProjection;
+        input.FrustumPlanes = &grid;
+        input.Lights = frame.Lights.data();
+        input.LightCount = frame.Lights.size();
+        input.UseDepthMask = true;
+        input.BuildTransparentLists = true;
+        input.UseGlobalLightList = true;
+        input.SuperTileSize = frame.SuperTileSize;
+        input.MaxLightsPerTile = frame.MaxLightsPerTile;
+
+        if (frame.DepthPyramidLevelCount > 0)
+        {
+            pyramid.Build(frame.Depth.data(), frame.Width, frame.Height, GetBestCullKernel(), frame.DepthPyramidLevelCount);
+            input.Pyramid = &pyramid;
+        }
+        return input;
+    }
+
+    // The default scene with `lightCount` lights drifting on small circles, each frame stored with the hash of its lists.
+    // Odd frames are culled like the application with hierarchical culling, the depth pyramid and a light budget.
+    bool RecordSyntheticCapture(const char* path, int frameCount, size_t lightCount, ThreadPool& threadPool)
+    {
+        const Benchmark::Resolution& resolution = Benchmark::Resolution1080p;
+        const int tileSize = 16;
+
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+        GenerateLights(scene, lightCount, 1234);
+        std::vector<Light> startLights = scene.Lights;
+
+        CapturedFrame frame;
+        frame.Width = scene.Width;
+        frame.Height = scene.Height;
+        frame.TileSize = tileSize;
+        frame.View = scene.View;
+        frame.Projection = scene.Projection;
+        frame.InverseProjection = scene.InverseProjection;
+        frame.Depth = scene.Depth;
+        QuantizeDepth24(frame.Depth.data(), frame.Depth.size());
+
+        FrustumPlaneGrid grid;
+        ComputeFrustumPlanes(frame.InverseProjection, frame.Width, frame.Height, tileSize, grid);
+        TiledLightCuller culler(threadPool);
+        DepthPyramid pyramid(threadPool);
+        LightCullResult result;
+
+        FrameCaptureWriter writer;
+        if (!writer.Open(path))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < frameCount; ++i)
+        {
+            frame.Lights = startLights;
+            for (size_t light = 0; light < frame.Lights.size(); ++light)
+            {
+                float angle = 0.3f * i + light;
+                frame.Lights[light].PositionWS.x += 0.5f * std::cos(angle);
+                frame.Lights[light].PositionWS.z += 0.5f * std::sin(angle);
+            }
+            UpdateLightsViewSpace(frame.Lights.data(), frame.Lights.size(), frame.View);
+
+            bool appSettings = (i & 1) != 0;
+            frame.SuperTileSize = appSettings ? 4 * tileSize : 0;
+            frame.MaxLightsPerTile = appSettings ? 32 : 0;
+            frame.DepthPyramidLevelCount = appSettings ? DepthPyramid::MaxLevelCount : 0;
+
+            culler.Cull(MakeCullInput(frame, grid, pyramid), result);
+            frame.LightListHash = HashLightLists(result);
+
+            if (!writer.Write(frame))
+            {
+                return false;
+            }
+        }
+
+        return writer.Close();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller gatherCuller(threadPool);
+    ScatterLightCuller scatterCuller(threadPool);
+
+    const char* path = Benchmark::GetOption(argc, argv, "--capture");
+    if (!path)
+    {
+        path = Benchmark::GetOption(argc, argv, "--record", "synthetic.fpcap");
+        if (!RecordSyntheticCapture(path, options.Quick ? 2 : 8, 1024, threadPool))
+        {
+            std::fprintf(stderr, "Unable to write %s\n", path);
+            return 1;
+        }
+    }
+
+    FrameCaptureReader reader;
+    if (!reader.Open(path))
+    {
+        std::fprintf(stderr, "Unable to read %s, not a frame capture of this version\n", path);
+        return 1;
+    }
+
+    std::printf("Frame replay of %s, %u thread(s), %d iteration(s)\n", path, threadPool.ThreadCount(), options.Iterations);
+    std::printf("%5s %11s %7s %5s %8s %8s %9s %9s %11s %9s %9s %6s %7s %16s %6s\n", "frame", "res", "lights", "tile", "KB",
+        "read ms", "flat ms", "hier ms", "scatter ms", "shade ms", "mismatch", "super", "budget", "hash", "check");
+
+    CapturedFrame frame;
+    FrustumPlaneGrid grid;
+    DepthPyramid pyramid(threadPool);
+    LightCullResult captured;
+    LightCullResult flat;
+    LightCullResult hierarchical;
+    LightCullResult scatter;
+
+    int frameIndex = 0;
+    int failedFrames = 0;
+    for (;;)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!reader.Read(frame))
+        {
+            break;
+        }
+        double readMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        ComputeFrustumPlanes(frame.InverseProjection, frame.Width, frame.Height, frame.TileSize, grid);
+        LightCullInput input = MakeCullInput(frame, grid, pyramid);
+
+        // the lists as the application culled them, the flat lists below if it did not use super-tiles or a budget
+        bool capturedIsFlat = input.SuperTileSize == 0 && input.MaxLightsPerTile == 0;
+        if (!capturedIsFlat)
+        {
+            gatherCuller.Cull(input, captured);
+        }
+        input.SuperTileSize = 0;
+        input.MaxLightsPerTile = 0;
+
+        double flatMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, flat); });
+
+        input.SuperTileSize = 4 * frame.TileSize;
+        double hierarchicalMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, hierarchical); });
+        input.SuperTileSize = 0;
+
+        double scatterMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { scatterCuller.Cull(input, scatter); });
+        double shadeMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { ShadeLightLists(threadPool, input, flat); });
+
+        size_t mismatches = CountMismatches(flat, hierarchical) + CountMismatches(flat, scatter);
+        uint64_t hash = HashLightLists(capturedIsFlat ? flat : captured);
+        const char* check = frame.LightListHash == 0 ? "-" : (frame.LightListHash == hash ? "ok" : "FAIL");
+        failedFrames += (mismatches > 0 || (frame.LightListHash != 0 && frame.LightListHash != hash)) ? 1 : 0;
+
+        char res[24];
+        std::snprintf(res, sizeof(res), "%dx%d", frame.Width, frame.Height);
+        std::printf("%5d %11s %7zu %5d %8.1f %8.3f %9.3f %9.3f %11.3f %9.3f %9zu %6d %7d %016llx %6s\n", frameIndex, res,
+            frame.Lights.size(), frame.TileSize, reader.LastFrameByteCount() / 1024.0, readMs, flatMs, hierarchicalMs, scatterMs,
+            shadeMs, mismatches, frame.SuperTileSize, frame.MaxLightsPerTile, (unsigned long long)hash, check);
+        ++frameIndex;
+    }
+
+    if (reader.Failed())
+    {
+        std::fprintf(stderr, "Frame %d of %s is truncated or corrupt\n", frameIndex, path);
+        return 1;
+    }
+
+    std::printf("%d frame(s), %d failed\n", frameIndex, failedFrames);
+    return failedFrames > 0 ? 1 : 0;
+}
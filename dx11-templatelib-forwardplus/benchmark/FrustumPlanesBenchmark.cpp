@@ -0,0 +1,149 @@
+// Compares the per tile frustum grid (ComputeFrustums, 4 planes per tile) with the shared edge planes
+// (ComputeFrustumPlanes, TileCountX + 1 + TileCountY + 1 planes) at 1080p, 1440p and 4K with 8, 16 and 32 pixel tiles:
+// memory, build time, and equivalence. "max dN" / "max dd" are the largest differences between the planes of
+// ComputeTileFrustum() and FrustumPlaneGrid::GetTileFrustum() over all tiles, "tiles diff" counts the tiles
+// whose light lists differ when the culler reads the shared planes, with 1024 lights and the depth mask on.
+// Each edge plane is computed from the full grid span instead of the tile corners, so the planes may differ by up to
+// MaxNormalError and a light exactly on a tile edge may fall on the other side of it: with 8 pixel tiles one tile at
+// 1080p and one at 4K differ. The exit code is 1 if "max dN" / "max dd" exceed MaxNormalError or "tiles diff" exceeds
+// MaxDifferentTiles.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    const float MaxNormalError = 1e-5f;
+    const size_t MaxDifferentTiles = 1;
+
+    struct PlaneError
+    {
+        float Normal = 0.0f;
+        float Distance = 0.0f;
+    };
+
+    PlaneError ComparePlanes(const std::vector<Frustum>& frustums, const FrustumPlaneGrid& grid)
+    {
+        PlaneError error;
+        for (int y = 0; y < grid.TileCountY; ++y)
+        {
+            for (int x = 0; x < grid.TileCountX; ++x)
+            {
+                const Frustum& reference = frustums[x + y * grid.TileCountX];
+                Frustum frustum = grid.GetTileFrustum(x, y);
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        error.Normal = std::max(error.Normal, std::fabs(reference.plane[i].N[k] - frustum.plane[i].N[k]));
+                    }
+                    error.Distance = std::max(error.Distance, std::fabs(reference.plane[i].d - frustum.plane[i].d));
+                }
+            }
+        }
+        return error;
+    }
+
+    size_t CountDifferentTiles(const LightCullResult& reference, const LightCullResult& result)
+    {
+        size_t count = 0;
+        for (size_t tile = 0; tile < reference.LightGrid.size(); ++tile)
+        {
+            auto referenceBegin = reference.LightIndexList.begin() + reference.LightGrid[tile].x;
+            auto begin = result.LightIndexList.begin() + result.LightGrid[tile].x;
+
+            if (reference.LightGrid[tile].y != result.LightGrid[tile].y ||
+                !std::equal(referenceBegin, referenceBegin + reference.LightGrid[tile].y, begin))
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution1440p, Benchmark::Resolution4K };
+    const int blockSizes[] = { 8, 16, 32 };
+    const size_t lightCount = 1024;
+
+    std::printf("Frustum planes benchmark, %u thread(s), %d iteration(s), %zu lights\n", threadPool.ThreadCount(), options.Iterations, lightCount);
+    std::printf("%-6s %5s %7s %12s %10s %8s %10s %10s %10s %10s %11s\n", "res", "block", "tiles", "tile bytes", "edge bytes",
+        "ratio", "tile ms", "edge ms", "max dN", "max dd", "tiles diff");
+
+    size_t failedRows = 0;
+
+    for (auto& resolution : resolutions)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+        GenerateLights(scene, lightCount, 1234);
+
+        for (int blockSize : blockSizes)
+        {
+            if (options.Quick && blockSize != 16)
+            {
+                continue;
+            }
+
+            std::vector<Frustum> frustums;
+            FrustumPlaneGrid grid;
+            double tileMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]()
+            {
+                ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+            });
+            double edgeMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]()
+            {
+                ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+            });
+
+            PlaneError error = ComparePlanes(frustums, grid);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.Frustums = frustums.data();
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+
+            LightCullResult reference;
+            culler.Cull(input, reference);
+
+            input.FrustumPlanes = &grid;
+            LightCullResult result;
+            culler.Cull(input, result);
+
+            size_t differentTiles = CountDifferentTiles(reference, result);
+            bool failed = error.Normal > MaxNormalError || error.Distance > MaxNormalError || differentTiles > MaxDifferentTiles;
+            failedRows += failed ? 1 : 0;
+
+            size_t tileBytes = frustums.size() * sizeof(Frustum);
+            size_t edgeBytes = grid.Planes.size() * sizeof(Plane);
+            std::printf("%-6s %5d %7zu %12zu %10zu %8.0f %10.3f %10.4f %10.2e %10.2e %11zu\n", resolution.Name, blockSize, frustums.size(),
+                tileBytes, edgeBytes, tileBytes / (double)edgeBytes, tileMs, edgeMs, error.Normal, error.Distance, differentTiles);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
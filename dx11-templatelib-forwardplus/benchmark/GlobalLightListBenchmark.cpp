@@ -0,0 +1,175 @@
+// Directional lights appended to every tile's lists vs kept once in LightCullResult::GlobalLightIndexList, on the default
+// scene at 1080p and 4K with 1024 point / spot lights and 1, 4 or 16 directional lights, 16 pixel tiles, the depth mask
+// and the transparent lists.
+// "indices" are the opaque plus transparent index list entries with directional lights in the tiles and with the global
+// list (its entries included), "saved" the difference. "flat" / "hier" are TiledLightCuller without and with 64 pixel
+// super-tiles, "shade" ShadeLightLists(), each in ms with the lights in the tiles / with the global list.
+// "mismatch" counts the tiles whose lists differ from the per tile lists without the directional lights, plus 1 if the
+// global list is not the directional lights, and must be 0. The exit code is 1 if any mismatch is not 0.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+#include "Cpu/TileSizeTuner.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Is the list of the tile the reference list of the tile without the lights in `removed`
+    bool ListEqualsWithout(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list, size_t tile, const std::vector<uint8_t>& removed)
+    {
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < referenceGrid[tile].y; ++i)
+        {
+            uint32_t light = referenceList[referenceGrid[tile].x + i];
+            if (!removed[light])
+            {
+                expected.push_back(light);
+            }
+        }
+
+        auto begin = list.begin() + grid[tile].x;
+        return expected.size() == grid[tile].y && std::equal(expected.begin(), expected.end(), begin);
+    }
+
+    size_t CountMismatches(const LightCullResult& reference, const LightCullResult& result, const std::vector<uint32_t>& directionalLights,
+        size_t lightCount)
+    {
+        std::vector<uint8_t> removed(lightCount, 0);
+        for (uint32_t light : directionalLights)
+        {
+            removed[light] = 1;
+        }
+
+        size_t mismatches = result.GlobalLightIndexList == directionalLights ? 0 : 1;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            bool equal = ListEqualsWithout(reference.LightGrid, reference.LightIndexList, result.LightGrid, result.LightIndexList, tile, removed) &&
+                ListEqualsWithout(reference.TransparentLightGrid, reference.TransparentLightIndexList,
+                    result.TransparentLightGrid, result.TransparentLightIndexList, tile, removed);
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+
+    size_t CountIndices(const LightCullResult& result)
+    {
+        return result.LightIndexList.size() + result.TransparentLightIndexList.size() + result.GlobalLightIndexList.size();
+    }
+
+    Light MakeDirectionalLight(float angle)
+    {
+        Light light;
+        light.LightType = (int)LightType::Directional;
+        light.DirectionWS = Vector4(std::cos(angle) * 0.6f, -0.8f, std::sin(angle) * 0.6f, 1.0f);
+        light.Strength = 0.2f;
+        light.Enabled = true;
+        return light;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution* resolutions[] = { &Benchmark::Resolution1080p, &Benchmark::Resolution4K };
+    const size_t directionalCounts[] = { 1, 4, 16 };
+    const size_t boundedLightCount = 1024;
+    const int blockSize = 16;
+
+    std::printf("Global light list benchmark, %u thread(s), %d iteration(s), %zu point / spot lights, block size %d\n",
+        threadPool.ThreadCount(), options.Iterations, boundedLightCount, blockSize);
+    std::printf("%-6s %4s %19s %8s %17s %17s %17s %9s\n", "", "", "indices", "", "flat ms", "hier ms", "shade ms", "");
+    std::printf("%-6s %4s %9s %9s %8s %8s %8s %8s %8s %8s %8s %9s\n", "res", "dir", "tiles", "global", "saved",
+        "tiles", "global", "tiles", "global", "tiles", "global", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (const Benchmark::Resolution* resolution : resolutions)
+    {
+        if (options.Quick && resolution != &Benchmark::Resolution1080p)
+        {
+            continue;
+        }
+
+        SyntheticScene scene;
+        BuildDefaultScene(resolution->Width, resolution->Height, scene);
+        GenerateLights(scene, boundedLightCount, 1234);
+        std::vector<Light> boundedLights = scene.Lights;
+
+        FrustumPlaneGrid grid;
+        ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+        for (size_t directionalCount : directionalCounts)
+        {
+            // Directional lights spread over the light array, as they would be added between the others
+            scene.Lights.clear();
+            std::vector<uint32_t> directionalLights;
+            size_t stride = boundedLights.size() / directionalCount;
+            for (size_t i = 0; i < boundedLights.size(); ++i)
+            {
+                if (i % stride == 0 && directionalLights.size() < directionalCount)
+                {
+                    directionalLights.push_back(static_cast<uint32_t>(scene.Lights.size()));
+                    scene.Lights.push_back(MakeDirectionalLight(directionalLights.size() * 0.7f));
+                }
+                scene.Lights.push_back(boundedLights[i]);
+            }
+            UpdateLightsViewSpace(scene.Lights.data(), scene.Lights.size(), scene.View);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.FrustumPlanes = &grid;
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+            input.BuildTransparentLists = true;
+
+            double flatMs[2];
+            double hierarchicalMs[2];
+            double shadeMs[2];
+            LightCullResult results[2];
+
+            for (int global = 0; global < 2; ++global)
+            {
+                input.UseGlobalLightList = global != 0;
+                LightCullResult& result = results[global];
+
+                input.SuperTileSize = 64;
+                hierarchicalMs[global] = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+                input.SuperTileSize = 0;
+
+                flatMs[global] = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+                shadeMs[global] = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { ShadeLightLists(threadPool, input, result); });
+            }
+
+            size_t tileIndices = CountIndices(results[0]);
+            size_t globalIndices = CountIndices(results[1]);
+            size_t mismatches = CountMismatches(results[0], results[1], directionalLights, scene.Lights.size());
+            failedRows += mismatches > 0 ? 1 : 0;
+
+            std::printf("%-6s %4zu %9zu %9zu %7.1f%% %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %9zu\n", resolution->Name, directionalCount,
+                tileIndices, globalIndices, 100.0 * (tileIndices - globalIndices) / tileIndices, flatMs[0], flatMs[1],
+                hierarchicalMs[0], hierarchicalMs[1], shadeMs[0], shadeMs[1], mismatches);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
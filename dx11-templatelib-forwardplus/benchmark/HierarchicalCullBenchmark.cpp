@@ -0,0 +1,128 @@
+// Measures hierarchical culling (LightCullInput::SuperTileSize) against the flat tiled culler at 1080p and 4K
+// with 1024, 4096 and 16384 lights on the default scene: culling time and the number of light tests.
+// The flat result is the reference: a hierarchical list may only miss lights whose super-tile volume they do not touch,
+// so "extra" (lights listed by the hierarchical culler only) must be 0, and "dropped" counts the rejected false positives.
+// "t extra" is "extra" of the transparent lists. The exit code is 1 if either is not 0.
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    struct ListDifference
+    {
+        size_t Extra = 0;       // in `result` but not in `reference`
+        size_t Dropped = 0;     // in `reference` but not in `result`
+    };
+
+    ListDifference Compare(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list)
+    {
+        ListDifference difference;
+        std::vector<uint32_t> scratch;
+        for (size_t tile = 0; tile < grid.size(); ++tile)
+        {
+            auto referenceBegin = referenceList.begin() + referenceGrid[tile].x;
+            auto referenceEnd = referenceBegin + referenceGrid[tile].y;
+            auto begin = list.begin() + grid[tile].x;
+            auto end = begin + grid[tile].y;
+
+            // Both lists are in ascending light order
+            scratch.clear();
+            std::set_difference(begin, end, referenceBegin, referenceEnd, std::back_inserter(scratch));
+            difference.Extra += scratch.size();
+
+            scratch.clear();
+            std::set_difference(referenceBegin, referenceEnd, begin, end, std::back_inserter(scratch));
+            difference.Dropped += scratch.size();
+        }
+        return difference;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 1024, 4096, 16384 };
+    const int superTileSizes[] = { 0, 32, 64, 128 };
+    const int blockSize = 16;
+
+    std::printf("Hierarchical culling benchmark, %u thread(s), %d iteration(s), block size %d\n", threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-6s %7s %6s %10s %9s %14s %8s %7s %9s %10s\n", "res", "lights", "super", "ms", "speedup", "light tests", "tests%", "extra", "dropped", "t extra");
+
+    size_t failedRows = 0;
+
+    for (auto& resolution : resolutions)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+        std::vector<Frustum> frustums;
+        ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 4096)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.Frustums = frustums.data();
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+            input.BuildTransparentLists = true;
+
+            LightCullResult flat;
+            double flatMs = 0.0;
+
+            for (int superTileSize : superTileSizes)
+            {
+                input.SuperTileSize = superTileSize;
+
+                LightCullResult result;
+                double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+
+                if (superTileSize == 0)
+                {
+                    flat = result;
+                    flatMs = ms;
+                }
+
+                ListDifference opaque = Compare(flat.LightGrid, flat.LightIndexList, result.LightGrid, result.LightIndexList);
+                ListDifference transparent = Compare(flat.TransparentLightGrid, flat.TransparentLightIndexList,
+                    result.TransparentLightGrid, result.TransparentLightIndexList);
+                failedRows += opaque.Extra > 0 || transparent.Extra > 0 ? 1 : 0;
+
+                std::printf("%-6s %7zu %6d %10.3f %9.2f %14llu %8.2f %7zu %9zu %10zu\n", resolution.Name, lightCount, superTileSize, ms,
+                    flatMs / ms, (unsigned long long)result.LightTestCount, 100.0 * result.LightTestCount / (double)flat.LightTestCount,
+                    opaque.Extra, opaque.Dropped, transparent.Extra);
+            }
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
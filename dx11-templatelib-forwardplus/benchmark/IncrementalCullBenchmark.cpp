@@ -0,0 +1,186 @@
+// Measures incremental light grid updates (IncrementalLightCuller) on the default scene at 1080p with 4096 lights,
+// 16 pixel tiles, the depth mask and the transparent lists, over 32 frames where 0, 1, 16 or 256 lights move along small
+// circles with a static camera, a frame where the camera turns (a full rebuild), and 16 moving lights with a budget of 16.
+// "frame ms" is the median time of IncrementalLightCuller::Cull(), "full ms" that of a full ScatterLightCuller /
+// hierarchical TiledLightCuller rebuild of the same frame. "tiles" / "tests" are the mean updated tiles and light tests
+// per frame, "rebuilds" the frames that fell back to a full rebuild. "budget" is the MaxLightsPerTile of the scenario.
+// "mismatch" counts the tiles, summed over all frames, whose lists differ from a full (budgeted) rebuild,
+// plus the frames whose LightTestCount or cut list counts differ from the stats / the rebuild, and must be 0.
+// The exit code is 1 if any scenario mismatches.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/IncrementalLightCuller.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    struct Scenario
+    {
+        const char* Name;
+        size_t MovingLights;
+        bool MoveCamera;
+        int MaxLightsPerTile;
+    };
+
+    bool ListsEqual(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list, size_t tile)
+    {
+        auto referenceBegin = referenceList.begin() + referenceGrid[tile].x;
+        auto begin = list.begin() + grid[tile].x;
+        return referenceGrid[tile].y == grid[tile].y && std::equal(referenceBegin, referenceBegin + referenceGrid[tile].y, begin);
+    }
+
+    size_t CountMismatches(const LightCullResult& reference, const LightCullResult& result)
+    {
+        size_t mismatches = 0;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            bool equal = ListsEqual(reference.LightGrid, reference.LightIndexList, result.LightGrid, result.LightIndexList, tile) &&
+                ListsEqual(reference.TransparentLightGrid, reference.TransparentLightIndexList,
+                    result.TransparentLightGrid, result.TransparentLightIndexList, tile);
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+
+    double Median(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return samples.empty() ? 0.0 : samples[samples.size() / 2];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller gatherCuller(threadPool);
+    ScatterLightCuller scatterCuller(threadPool);
+
+    const Benchmark::Resolution& resolution = Benchmark::Resolution1080p;
+    const size_t lightCount = 4096;
+    const int blockSize = 16;
+    const int frameCount = options.Quick ? 8 : 32;
+    const Scenario scenarios[] = {
+        { "static", 0, false, 0 },
+        { "moving", 1, false, 0 },
+        { "moving", 16, false, 0 },
+        { "moving", 256, false, 0 },
+        { "camera", 0, true, 0 },
+        { "moving", 16, false, 16 },
+    };
+
+    std::printf("Incremental culling benchmark, %s, %u thread(s), %zu lights, block size %d, %d frames\n", resolution.Name,
+        threadPool.ThreadCount(), lightCount, blockSize, frameCount);
+    std::printf("%-8s %7s %7s %10s %12s %10s %10s %12s %9s %9s\n", "scenario", "moving", "budget", "frame ms", "scatter ms",
+        "hier ms", "tiles", "tests", "rebuilds", "mismatch");
+
+    size_t failedScenarios = 0;
+
+    for (const Scenario& scenario : scenarios)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+        GenerateLights(scene, lightCount, 1234);
+
+        FrustumPlaneGrid grid;
+        ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = blockSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.FrustumPlanes = &grid;
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+        input.UseDepthMask = true;
+        input.BuildTransparentLists = true;
+        input.MaxLightsPerTile = scenario.MaxLightsPerTile;
+
+        IncrementalLightCuller culler(threadPool);
+        IncrementalCullSettings settings;
+        culler.Cull(input, settings);
+
+        std::vector<Light> startLights = scene.Lights;
+        Float4x4 startView = scene.View;
+
+        std::vector<double> frameMs;
+        double tiles = 0.0;
+        double tests = 0.0;
+        size_t rebuilds = 0;
+        size_t mismatches = 0;
+        LightCullResult reference;
+
+        for (int frame = 1; frame <= frameCount; ++frame)
+        {
+            float angle = 0.2f * frame;
+
+            for (size_t k = 0; k < scenario.MovingLights; ++k)
+            {
+                // Spread over the light array
+                size_t index = k * (lightCount / scenario.MovingLights);
+                Light& light = scene.Lights[index];
+                light.PositionWS.x = startLights[index].PositionWS.x + 0.5f * std::cos(angle);
+                light.PositionWS.z = startLights[index].PositionWS.z + 0.5f * std::sin(angle);
+                UpdateLightsViewSpace(&light, 1, scene.View);
+            }
+
+            settings.DepthChanged = false;
+            if (scenario.MoveCamera)
+            {
+                // Turn around the y axis, the depth buffer would change with it
+                float c = std::cos(0.01f * frame);
+                float s = std::sin(0.01f * frame);
+                Float4x4 rotation;
+                rotation.m[0][0] = c;
+                rotation.m[0][2] = -s;
+                rotation.m[2][0] = s;
+                rotation.m[2][2] = c;
+                scene.View = Multiply(startView, rotation);
+                UpdateLightsViewSpace(scene.Lights.data(), scene.Lights.size(), scene.View);
+                settings.DepthChanged = true;
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            const LightCullResult& result = culler.Cull(input, settings);
+            auto end = std::chrono::high_resolution_clock::now();
+            frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+            const IncrementalCullStats& stats = culler.GetStats();
+            tiles += stats.UpdatedTiles;
+            tests += static_cast<double>(stats.LightTestCount);
+            rebuilds += stats.FullRebuild ? 1 : 0;
+
+            scatterCuller.Cull(input, reference);
+            mismatches += CountMismatches(reference, result);
+            mismatches += (result.LightTestCount != stats.LightTestCount || result.TruncatedListCount != reference.TruncatedListCount ||
+                result.DroppedLightCount != reference.DroppedLightCount) ? 1 : 0;
+        }
+
+        double scatterMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { scatterCuller.Cull(input, reference); });
+        input.SuperTileSize = 64;
+        double hierarchicalMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, reference); });
+
+        std::printf("%-8s %7zu %7d %10.3f %12.3f %10.3f %10.1f %12.1f %9zu %9zu\n", scenario.Name, scenario.MovingLights,
+            scenario.MaxLightsPerTile, Median(frameMs), scatterMs, hierarchicalMs, tiles / frameCount, tests / frameCount, rebuilds, mismatches);
+        failedScenarios += mismatches > 0 ? 1 : 0;
+    }
+
+    return failedScenarios > 0 ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+// Per tile light budget (LightCullInput::MaxLightsPerTile) on the default scene at 1080p and 4K with 1024 and 4096 lights,
+// 16 pixel tiles, the depth mask and the transparent lists, for no budget and budgets of 64, 32 and 16 lights.
+// "max" is the longest opaque list, "indices" the opaque plus transparent index list entries, "cut" the lists the budget
+// cut and "dropped" the lights cut from them. "flat ms" / "scatter ms" are TiledLightCuller and ScatterLightCuller with
+// the budget, "shade ms" ShadeLightLists() of the flat lists.
+// "mismatch" counts the lists that are not the budget lights of largest contribution of the unbudgeted list in list order,
+// plus the tiles whose scatter lists differ from the flat ones, and must be 0. The exit code is 1 if any mismatch is not 0.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+#include "Cpu/TileSizeTuner.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    bool ListsEqual(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list, size_t tile)
+    {
+        auto referenceBegin = referenceList.begin() + referenceGrid[tile].x;
+        auto begin = list.begin() + grid[tile].x;
+        return referenceGrid[tile].y == grid[tile].y && std::equal(referenceBegin, referenceBegin + referenceGrid[tile].y, begin);
+    }
+
+    // Is the list of the tile the `budget` lights of the full list with the largest contribution, in list order
+    bool IsBudgetList(const LightCullInput& input, const AABB& box, const uint32_t* fullList, uint32_t fullCount,
+        const uint32_t* list, uint32_t count, uint32_t budget)
+    {
+        if (count != std::min(fullCount, budget))
+        {
+            return false;
+        }
+
+        // A subsequence of the full list, every dropped light contributing no more than the kept ones
+        float minKept = 1e30f;
+        float maxDropped = -1.0f;
+        uint32_t k = 0;
+        for (uint32_t i = 0; i < fullCount; ++i)
+        {
+            float contribution = GetLightContribution(input.Lights[fullList[i]], box);
+            if (k < count && list[k] == fullList[i])
+            {
+                minKept = std::min(minKept, contribution);
+                ++k;
+            }
+            else
+            {
+                maxDropped = std::max(maxDropped, contribution);
+            }
+        }
+        return k == count && maxDropped <= minKept;
+    }
+
+    size_t CountMismatches(const LightCullInput& input, const LightCullResult& full, const LightCullResult& flat,
+        const LightCullResult& scatter, uint32_t budget)
+    {
+        size_t mismatches = 0;
+        for (int y = 0; y < flat.TileCountY; ++y)
+        {
+            for (int x = 0; x < flat.TileCountX; ++x)
+            {
+                size_t tile = x + static_cast<size_t>(y) * flat.TileCountX;
+                TileCullContext context = TiledLightCuller::GetTileCullContext(input, TiledLightCuller::GetTileFrustum(input, x, y),
+                    TiledLightCuller::ComputeTileDepthBounds(input, x, y));
+
+                bool equal =
+                    IsBudgetList(input, context.OpaqueVolume.Box, full.LightIndexList.data() + full.LightGrid[tile].x, full.LightGrid[tile].y,
+                        flat.LightIndexList.data() + flat.LightGrid[tile].x, flat.LightGrid[tile].y, budget) &&
+                    IsBudgetList(input, context.TransparentVolume.Box,
+                        full.TransparentLightIndexList.data() + full.TransparentLightGrid[tile].x, full.TransparentLightGrid[tile].y,
+                        flat.TransparentLightIndexList.data() + flat.TransparentLightGrid[tile].x, flat.TransparentLightGrid[tile].y, budget) &&
+                    ListsEqual(flat.LightGrid, flat.LightIndexList, scatter.LightGrid, scatter.LightIndexList, tile) &&
+                    ListsEqual(flat.TransparentLightGrid, flat.TransparentLightIndexList, scatter.TransparentLightGrid,
+                        scatter.TransparentLightIndexList, tile);
+                mismatches += equal ? 0 : 1;
+            }
+        }
+        return mismatches;
+    }
+
+    uint32_t MaxListLength(const LightCullResult& result)
+    {
+        uint32_t length = 0;
+        for (const uint2& tile : result.LightGrid)
+        {
+            length = std::max(length, tile.y);
+        }
+        return length;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+    ScatterLightCuller scatterCuller(threadPool);
+
+    const Benchmark::Resolution* resolutions[] = { &Benchmark::Resolution1080p, &Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 1024, 4096 };
+    const int budgets[] = { 0, 64, 32, 16 };
+    const int blockSize = 16;
+
+    std::printf("Light budget benchmark, %u thread(s), %d iteration(s), block size %d\n", threadPool.ThreadCount(),
+        options.Iterations, blockSize);
+    std::printf("%-6s %7s %6s %5s %9s %8s %9s %9s %11s %9s %9s\n", "res", "lights", "budget", "max", "indices", "cut", "dropped",
+        "flat ms", "scatter ms", "shade ms", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (const Benchmark::Resolution* resolution : resolutions)
+    {
+        if (options.Quick && resolution != &Benchmark::Resolution1080p)
+        {
+            continue;
+        }
+
+        SyntheticScene scene;
+        BuildDefaultScene(resolution->Width, resolution->Height, scene);
+
+        FrustumPlaneGrid grid;
+        ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 1024)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.FrustumPlanes = &grid;
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+            input.BuildTransparentLists = true;
+
+            LightCullResult full;
+            culler.Cull(input, full);
+
+            for (int budget : budgets)
+            {
+                input.MaxLightsPerTile = budget;
+
+                LightCullResult flat;
+                LightCullResult scatter;
+                double flatMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, flat); });
+                double scatterMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { scatterCuller.Cull(input, scatter); });
+                double shadeMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { ShadeLightLists(threadPool, input, flat); });
+
+                uint32_t listBudget = budget > 0 ? static_cast<uint32_t>(budget) : 0xffffffffu;
+                size_t mismatches = CountMismatches(input, full, flat, scatter, listBudget);
+                failedRows += mismatches > 0 ? 1 : 0;
+                size_t indices = flat.LightIndexList.size() + flat.TransparentLightIndexList.size();
+
+                std::printf("%-6s %7zu %6d %5u %9zu %8llu %9llu %9.3f %11.3f %9.3f %9zu\n", resolution->Name, lightCount, budget,
+                    MaxListLength(flat), indices, (unsigned long long)flat.TruncatedListCount,
+                    (unsigned long long)flat.DroppedLightCount, flatMs, scatterMs, shadeMs, mismatches);
+            }
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
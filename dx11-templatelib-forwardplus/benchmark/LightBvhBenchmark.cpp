@@ -0,0 +1,166 @@
+// Measures LightBvh light queries against brute force culling on the default scene at 1080p, 16 pixel tiles, the depth
+// mask and the transparent lists, from 1K to 100K lights. The radius of the lights of GenerateLights() is scaled by
+// (1024 / lights)^(1/3), so the lights per tile stay about the same as the light count grows.
+// "build ms" is LightBvh::Build() (bounds, Morton codes, radix sort, nodes, boxes), "refit ms" LightBvh::Refit().
+// "query ms" is BvhLightCuller::Cull() with the built tree, "refit q ms" the same after every light moved by up to half
+// a radius and the tree was refitted instead of rebuilt.
+// "flat ms" / "hier ms" are TiledLightCuller without and with 64 pixel super-tiles (flat only up to 16K lights, it tests
+// every light in every tile), "scatter ms" ScatterLightCuller. "tests/tile" are the box and light tests of a BVH tile.
+// "mismatch" counts the tiles, of both BVH results, whose lists differ from ScatterLightCuller and must be 0.
+// The exit code is 1 if any mismatch is not 0.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightBvh.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    bool ListsEqual(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list, size_t tile)
+    {
+        auto referenceBegin = referenceList.begin() + referenceGrid[tile].x;
+        auto begin = list.begin() + grid[tile].x;
+        return referenceGrid[tile].y == grid[tile].y && std::equal(referenceBegin, referenceBegin + referenceGrid[tile].y, begin);
+    }
+
+    size_t CountMismatches(const LightCullResult& reference, const LightCullResult& result)
+    {
+        size_t mismatches = 0;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            bool equal = ListsEqual(reference.LightGrid, reference.LightIndexList, result.LightGrid, result.LightIndexList, tile) &&
+                ListsEqual(reference.TransparentLightGrid, reference.TransparentLightIndexList,
+                    result.TransparentLightGrid, result.TransparentLightIndexList, tile);
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller gatherCuller(threadPool);
+    ScatterLightCuller scatterCuller(threadPool);
+    BvhLightCuller bvhCuller(threadPool);
+    LightBvh bvh(threadPool);
+
+    const Benchmark::Resolution& resolution = Benchmark::Resolution1080p;
+    const size_t lightCounts[] = { 1024, 4096, 16384, 32768, 100000 };
+    const size_t maxFlatLightCount = 16384;
+    const int blockSize = 16;
+
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    FrustumPlaneGrid grid;
+    ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+    std::printf("Light BVH benchmark, %s, %u thread(s), %d iteration(s), block size %d\n", resolution.Name,
+        threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%7s %9s %9s %9s %11s %10s %10s %11s %11s %9s\n", "lights", "build ms", "refit ms", "query ms", "refit q ms",
+        "flat ms", "hier ms", "scatter ms", "tests/tile", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 4096)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+
+        // Light::GetRadius() scales by s when the linear and quadratic terms are divided by s and s^2
+        float radiusScale = std::cbrt(1024.0f / lightCount);
+        for (Light& light : scene.Lights)
+        {
+            light.LinearAttenuation /= radiusScale;
+            light.QuadraticAttenuation /= radiusScale * radiusScale;
+        }
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = blockSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.FrustumPlanes = &grid;
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+        input.UseDepthMask = true;
+        input.BuildTransparentLists = true;
+
+        double buildMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { bvh.Build(input.Lights, input.LightCount); });
+        double refitMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { bvh.Refit(input.Lights, input.LightCount); });
+
+        bvh.Build(input.Lights, input.LightCount);
+        LightCullResult bvhResult;
+        double queryMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { bvhCuller.Cull(input, bvh, bvhResult); });
+
+        LightCullResult scatter;
+        double scatterMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { scatterCuller.Cull(input, scatter); });
+        size_t mismatches = CountMismatches(scatter, bvhResult);
+        double testsPerTile = bvhResult.LightTestCount / (double)bvhResult.TileCount();
+
+        double flatMs = 0.0;
+        LightCullResult gather;
+        if (lightCount <= maxFlatLightCount)
+        {
+            flatMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, gather); });
+        }
+
+        input.SuperTileSize = 64;
+        double hierarchicalMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, gather); });
+        input.SuperTileSize = 0;
+
+        // Move every light, then query the refitted tree
+        std::mt19937 random(5678);
+        std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+        for (Light& light : scene.Lights)
+        {
+            float radius = Light::GetRadius(&light);
+            light.PositionWS.x += offset(random) * radius;
+            light.PositionWS.y += offset(random) * radius;
+            light.PositionWS.z += offset(random) * radius;
+        }
+        UpdateLightsViewSpace(scene.Lights.data(), scene.Lights.size(), scene.View);
+
+        bvh.Refit(input.Lights, input.LightCount);
+        double refitQueryMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { bvhCuller.Cull(input, bvh, bvhResult); });
+        scatterCuller.Cull(input, scatter);
+        mismatches += CountMismatches(scatter, bvhResult);
+        failedRows += mismatches > 0 ? 1 : 0;
+
+        char flat[16];
+        if (lightCount <= maxFlatLightCount)
+        {
+            std::snprintf(flat, sizeof(flat), "%.3f", flatMs);
+        }
+        else
+        {
+            std::snprintf(flat, sizeof(flat), "-");
+        }
+
+        std::printf("%7zu %9.3f %9.3f %9.3f %11.3f %10s %10.3f %11.3f %11.1f %9zu\n", lightCount, buildMs, refitMs, queryMs,
+            refitQueryMs, flat, hierarchicalMs, scatterMs, testsPerTile, mismatches);
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
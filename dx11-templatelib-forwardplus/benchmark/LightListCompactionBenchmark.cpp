@@ -0,0 +1,188 @@
+// Measures the compaction of per-tile light lists into one index list at 1080p and 4K with 1024, 4096 and 16384
+// lights on the default scene. "atomic" is what CullLight.hlsl does: every tile reserves its range with an atomic add,
+// so the layout depends on the order the tiles finish in. "scan" is CompactRowLists(): count, exclusive scan, scatter.
+// Every mode is run 16 times; "layouts" is the number of distinct outputs (1 = byte-identical run to run)
+// and "equal" tells if the output is byte-identical to TiledLightCuller::Cull().
+// The exit code is 1 if a scan row has more than 1 layout or is not equal; the atomic rows differ by design.
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/LightListCompaction.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    enum class Mode
+    {
+        Atomic,
+        Scan,
+        NumMode
+    };
+
+    const char* ModeNames[] = { "atomic", "scan" };
+
+    // Per-tile lists as the cull pass leaves them: one list per row, grid offsets local to the row
+    void SplitRows(const LightCullResult& result, std::vector<std::vector<uint32_t>>& rowLists, std::vector<uint2>& rowGrid)
+    {
+        rowLists.assign(result.TileCountY, {});
+        rowGrid = result.LightGrid;
+        for (int y = 0; y < result.TileCountY; ++y)
+        {
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                uint2& tile = rowGrid[x + y * result.TileCountX];
+                auto begin = result.LightIndexList.begin() + tile.x;
+                tile.x = static_cast<uint32_t>(rowLists[y].size());
+                rowLists[y].insert(rowLists[y].end(), begin, begin + tile.y);
+            }
+        }
+    }
+
+    void CompactAtomic(ThreadPool& threadPool, const std::vector<std::vector<uint32_t>>& rowLists, int tileCountX,
+        std::vector<uint2>& grid, std::vector<uint32_t>& indexList)
+    {
+        size_t total = 0;
+        for (auto& rowList : rowLists)
+        {
+            total += rowList.size();
+        }
+        indexList.resize(total);
+
+        std::atomic<uint32_t> counter { 0 };
+        threadPool.ParallelFor(rowLists.size(), 1, [&](size_t begin, size_t end)
+        {
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < tileCountX; ++x)
+                {
+                    uint2& tile = grid[x + y * tileCountX];
+                    uint32_t offset = counter.fetch_add(tile.y);
+                    std::copy_n(rowLists[y].begin() + tile.x, tile.y, indexList.begin() + offset);
+                    tile.x = offset;
+                }
+            }
+        });
+    }
+
+    uint64_t Hash(const std::vector<uint2>& grid, const std::vector<uint32_t>& indexList)
+    {
+        // FNV-1a over the bytes of both buffers
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&](const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        add(grid.data(), grid.size() * sizeof(uint2));
+        add(indexList.data(), indexList.size() * sizeof(uint32_t));
+        return hash;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 1024, 4096, 16384 };
+    const int blockSize = 16;
+    const int runs = 16;
+
+    std::printf("Light list compaction benchmark, %u thread(s), %d iteration(s), block size %d\n", threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-6s %7s %7s %10s %-7s %10s %8s %6s\n", "res", "lights", "tiles", "indices", "mode", "ms", "layouts", "equal");
+
+    size_t failedRows = 0;
+
+    for (auto& resolution : resolutions)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+        std::vector<Frustum> frustums;
+        ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 4096)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.Frustums = frustums.data();
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+
+            LightCullResult reference;
+            culler.Cull(input, reference);
+            uint64_t referenceHash = Hash(reference.LightGrid, reference.LightIndexList);
+
+            std::vector<std::vector<uint32_t>> rowLists;
+            std::vector<uint2> rowGrid;
+            SplitRows(reference, rowLists, rowGrid);
+
+            for (int m = 0; m < (int)Mode::NumMode; ++m)
+            {
+                Mode mode = (Mode)m;
+                std::vector<uint2> grid;
+                std::vector<uint32_t> indexList;
+                std::vector<uint32_t> offsets;
+
+                auto compact = [&]()
+                {
+                    grid = rowGrid;
+                    if (mode == Mode::Atomic)
+                    {
+                        CompactAtomic(threadPool, rowLists, reference.TileCountX, grid, indexList);
+                    }
+                    else
+                    {
+                        CompactRowLists(threadPool, rowLists, reference.TileCountX, grid, indexList, offsets);
+                    }
+                };
+
+                double ms = Benchmark::MeasureMilliseconds(options.Iterations, compact);
+
+                std::set<uint64_t> layouts;
+                bool equal = true;
+                for (int run = 0; run < runs; ++run)
+                {
+                    compact();
+                    uint64_t hash = Hash(grid, indexList);
+                    layouts.insert(hash);
+                    equal = equal && hash == referenceHash;
+                }
+
+                failedRows += (mode == Mode::Scan && (layouts.size() != 1 || !equal)) ? 1 : 0;
+                std::printf("%-6s %7zu %7zu %10zu %-7s %10.3f %8zu %6s\n", resolution.Name, lightCount, reference.TileCount(),
+                    reference.LightIndexList.size(), ModeNames[m], ms, layouts.size(), equal ? "yes" : "no");
+            }
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+// Compares the light list encodings (uint32 index list, packed uint16 index list, one bit per light and tile) on the
+// default scene at 1080p with 1024, 4096 and 16384 lights and 8, 16 and 32 pixel tiles. The lists come from the
+// hierarchical culler with the depth mask.
+// "written KiB" is the size of the encoded lists, "read MiB" the bytes the shading of every shaded pixel reads
+// (grid entry and index words, or the whole tile mask), "decode ms" / "ns/light" the CPU cost of decoding every tile once.
+// "mismatch" counts the tiles whose decoded list differs from the uint32 list and must be 0.
+// The exit code is 1 if any mismatch is not 0.
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/LightListEncoding.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Shaded (depth < 1) pixels of every tile
+    std::vector<uint32_t> CountShadedPixels(const SyntheticScene& scene, int blockSize, int tileCountX, int tileCountY)
+    {
+        std::vector<uint32_t> pixels(static_cast<size_t>(tileCountX) * tileCountY, 0);
+        for (int y = 0; y < scene.Height; ++y)
+        {
+            for (int x = 0; x < scene.Width; ++x)
+            {
+                if (scene.Depth[x + static_cast<size_t>(y) * scene.Width] < 1.0f)
+                {
+                    ++pixels[x / blockSize + (y / blockSize) * tileCountX];
+                }
+            }
+        }
+        return pixels;
+    }
+
+    size_t CountMismatches(const LightCullResult& reference, const EncodedLightLists& lists)
+    {
+        size_t mismatches = 0;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            const uint2& list = reference.LightGrid[tile];
+            uint32_t i = 0;
+            bool equal = true;
+            lists.ForEachLight(tile, [&](uint32_t lightIndex)
+            {
+                equal = equal && i < list.y && reference.LightIndexList[list.x + i] == lightIndex;
+                ++i;
+            });
+            mismatches += equal && i == list.y ? 0 : 1;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution& resolution = Benchmark::Resolution1080p;
+    const size_t lightCounts[] = { 1024, 4096, 16384 };
+    const int blockSizes[] = { 8, 16, 32 };
+
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    std::printf("Light list encoding benchmark, %s, %u thread(s), %d iteration(s)\n", resolution.Name, threadPool.ThreadCount(), options.Iterations);
+    std::printf("%7s %5s %-8s %10s %12s %10s %10s %10s %9s\n", "lights", "tile", "encoding", "encode ms", "written KiB", "read MiB",
+        "decode ms", "ns/light", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 4096)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+
+        for (int blockSize : blockSizes)
+        {
+            FrustumPlaneGrid grid;
+            ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.FrustumPlanes = &grid;
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+            input.SuperTileSize = 64;
+
+            LightCullResult reference;
+            culler.Cull(input, reference);
+
+            std::vector<uint32_t> shadedPixels = CountShadedPixels(scene, blockSize, reference.TileCountX, reference.TileCountY);
+
+            size_t decodedLights = 0;
+            for (const uint2& list : reference.LightGrid)
+            {
+                decodedLights += list.y;
+            }
+
+            for (int e = 0; e < (int)LightListEncoding::Count; ++e)
+            {
+                LightListEncoding encoding = static_cast<LightListEncoding>(e);
+
+                EncodedLightLists lists;
+                bool encoded = true;
+                double encodeMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]()
+                {
+                    encoded = EncodeLightLists(threadPool, reference, scene.Lights.size(), encoding, lists);
+                });
+
+                if (!encoded)
+                {
+                    std::printf("%7zu %5d %-8s %10s\n", lightCount, blockSize, GetLightListEncodingName(encoding), "n/a");
+                    continue;
+                }
+
+                size_t readBytes = 0;
+                for (size_t tile = 0; tile < lists.TileCount(); ++tile)
+                {
+                    readBytes += shadedPixels[tile] * lists.TileReadBytes(tile);
+                }
+
+                // The checksum keeps the decode loop from being optimized away
+                std::atomic<uint64_t> checksum { 0 };
+                double decodeMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]()
+                {
+                    threadPool.ParallelFor(lists.TileCountY, 1, [&](size_t begin, size_t end)
+                    {
+                        uint64_t sum = 0;
+                        for (size_t tile = begin * lists.TileCountX; tile < end * lists.TileCountX; ++tile)
+                        {
+                            lists.ForEachLight(tile, [&](uint32_t lightIndex) { sum += lightIndex; });
+                        }
+                        checksum += sum;
+                    });
+                });
+
+                size_t mismatches = CountMismatches(reference, lists);
+                failedRows += mismatches > 0 ? 1 : 0;
+                std::printf("%7zu %5d %-8s %10.3f %12.1f %10.2f %10.3f %10.3f %9zu\n", lightCount, blockSize, GetLightListEncodingName(encoding),
+                    encodeMs, lists.MemoryBytes() / 1024.0, readBytes / (1024.0 * 1024.0), decodeMs,
+                    decodedLights ? decodeMs * 1e6 / decodedLights : 0.0, mismatches);
+            }
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
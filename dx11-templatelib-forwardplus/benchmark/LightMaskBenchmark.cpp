@@ -0,0 +1,116 @@
+// Compares the light-vs-tile test implementations at 1080p on the default scene with up to 64K lights:
+//   aos      TiledLightCuller, one Light record and one plane at a time (the port of CullLight.hlsl)
+//   scalar   LightMaskCuller on the SoA LightCullView, one light at a time
+//   sse      LightMaskCuller, 4 lights per instruction
+//   avx2     LightMaskCuller, 8 lights per instruction
+// Every bitmask result is checked against the aos light lists, "mismatches" counts the tiles that differ and must be 0.
+// The exit code is 1 if any mismatches is not 0.
+
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/LightCullView.h"
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Number of tiles whose bitmask does not expand to the reference light list
+    size_t CountMismatchedTiles(const LightCullResult& reference, const LightMaskResult& masks)
+    {
+        size_t mismatched = 0;
+        std::vector<uint32_t> lightList;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            lightList.clear();
+            AppendLightMask(masks.TileMask(tile), masks.WordsPerTile, lightList);
+
+            const uint2& cell = reference.LightGrid[tile];
+            bool equal = lightList.size() == cell.y &&
+                std::equal(lightList.begin(), lightList.end(), reference.LightIndexList.begin() + cell.x);
+            mismatched += equal ? 0 : 1;
+        }
+        return mismatched;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller listCuller(threadPool);
+    LightMaskCuller maskCuller(threadPool);
+
+    const Benchmark::Resolution resolution = Benchmark::Resolution1080p;
+    const size_t lightCounts[] = { 1024, 4096, 16384, 65536 };
+    const int blockSize = 16;
+
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    std::vector<Frustum> frustums;
+    ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+    std::printf("Light mask benchmark, %s, %u thread(s), %d iteration(s), block size %d\n", resolution.Name, threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%7s %-7s %10s %14s %9s %11s\n", "lights", "kernel", "ms", "Mtests/sec", "speedup", "mismatches");
+
+    size_t failedRows = 0;
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 4096)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = blockSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.Frustums = frustums.data();
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+
+        LightCullResult reference;
+        double referenceMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { listCuller.Cull(input, reference); });
+        double tests = static_cast<double>(reference.TileCount()) * lightCount;
+
+        std::printf("%7zu %-7s %10.3f %14.1f %9.2f %11s\n", lightCount, "aos", referenceMs, tests / (referenceMs * 1000.0), 1.0, "-");
+
+        LightCullView view;
+        double viewMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { view.Build(scene.Lights.data(), scene.Lights.size()); });
+
+        for (int k = 0; k < (int)CullKernel::NumCullKernel; ++k)
+        {
+            CullKernel kernel = (CullKernel)k;
+            if (!IsCullKernelSupported(kernel))
+            {
+                std::printf("%7zu %-7s %10s\n", lightCount, GetCullKernelName(kernel), "n/a");
+                continue;
+            }
+
+            LightMaskResult masks;
+            double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { maskCuller.Cull(input, view, kernel, masks); });
+
+            size_t mismatches = CountMismatchedTiles(reference, masks);
+            failedRows += mismatches > 0 ? 1 : 0;
+            std::printf("%7zu %-7s %10.3f %14.1f %9.2f %11zu\n", lightCount, GetCullKernelName(kernel), ms,
+                tests / (ms * 1000.0), referenceMs / ms, mismatches);
+        }
+
+        std::printf("%7zu %-7s %10.3f   (LightCullView::Build)\n", lightCount, "soa", viewMs);
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
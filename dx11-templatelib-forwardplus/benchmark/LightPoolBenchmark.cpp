@@ -0,0 +1,196 @@
+// Measures the per frame CPU cost and upload size of the structured light buffer fed from a LightPool,
+// with 1K, 10K and 50K lights on the default scene. Every frame applies one animation scenario,
+// updates the view space values of the dirty lights (all lights if the camera moved) and copies
+// the dirty ranges into a mirror of the GPU buffer, the stand-in for one UpdateSubresource per range.
+// "ranges" is the average number of those copies per frame.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "Benchmark.h"
+
+#include "Cpu/LightPool.h"
+#include "Cpu/SyntheticScene.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    enum class Scenario
+    {
+        Static,         // nothing changes
+        MoveBlock,      // 1% of the lights move, all in one contiguous block of slots
+        MoveRandom,     // 1% of the lights move, scattered over the pool
+        Churn,          // 1% of the lights are removed and as many added
+        MoveAll,        // every light moves
+        Camera,         // the camera moves, every view space value changes
+        NumScenario
+    };
+
+    const char* ScenarioNames[] = { "static", "move 1% block", "move 1% random", "churn 1%", "move all", "camera" };
+
+    struct GpuLightBuffer
+    {
+        std::vector<Light> Lights;
+        std::vector<LightPool::DirtyRange> Ranges;
+        size_t UploadedBytes = 0;
+        size_t UploadCount = 0;
+
+        // Same growth and dirty range upload as SimpleObj::UpdateLightBuffer
+        void Upload(LightPool& pool)
+        {
+            if (pool.Count() > Lights.size())
+            {
+                Lights.resize(std::max({ pool.Count(), Lights.size() * 2, (size_t)64 }));
+                pool.MarkAllDirty();
+            }
+
+            pool.GetDirtyRanges(Ranges);
+            for (const LightPool::DirtyRange& range : Ranges)
+            {
+                std::memcpy(&Lights[range.Begin], pool.Data() + range.Begin, (range.End - range.Begin) * sizeof(Light));
+            }
+            UploadedBytes += LightPool::GetDirtyBytes(Ranges);
+            UploadCount += Ranges.size();
+            pool.ClearDirty();
+        }
+    };
+
+    void Move(Light& light, float offset)
+    {
+        light.PositionWS.x += offset;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    const size_t lightCounts[] = { 1000, 10000, 50000 };
+    const int framesPerRun = 16;
+
+    std::printf("Light pool benchmark, %d iteration(s) of %d frames\n", options.Iterations, framesPerRun);
+    std::printf("%7s %-15s %10s %12s %12s %9s %7s\n", "lights", "scenario", "ms/frame", "upload KB", "full KB", "upload%", "ranges");
+
+    SyntheticScene scene;
+    BuildDefaultScene(1920, 1080, scene);
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 10000)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+        size_t movingCount = std::max<size_t>(1, lightCount / 100);
+
+        for (int s = 0; s < (int)Scenario::NumScenario; ++s)
+        {
+            Scenario scenario = (Scenario)s;
+
+            LightPool pool;
+            std::vector<LightPool::Handle> handles;
+            for (const Light& light : scene.Lights)
+            {
+                handles.push_back(pool.Add(light));
+            }
+
+            GpuLightBuffer gpu;
+            gpu.Upload(pool);
+            gpu.UploadedBytes = 0;
+            gpu.UploadCount = 0;
+            std::vector<LightPool::DirtyRange> dirtyRanges;
+
+            std::mt19937 random(42);
+            Float4x4 view = scene.View;
+            Float4x4 lastView = view;
+            size_t frameCount = 0;
+            float time = 0.0f;
+
+            auto frame = [&]()
+            {
+                time += 0.01f;
+                float offset = 0.001f * std::sin(time);
+
+                switch (scenario)
+                {
+                case Scenario::MoveBlock:
+                    for (size_t i = 0; i < movingCount; ++i)
+                    {
+                        Move(pool.Edit(i), offset);
+                    }
+                    break;
+
+                case Scenario::MoveRandom:
+                    for (size_t i = 0; i < movingCount; ++i)
+                    {
+                        Move(pool.Edit(random() % pool.Count()), offset);
+                    }
+                    break;
+
+                case Scenario::Churn:
+                    for (size_t i = 0; i < movingCount; ++i)
+                    {
+                        size_t index = random() % handles.size();
+                        Light light = pool[pool.GetSlot(handles[index])];
+                        pool.Remove(handles[index]);
+                        Move(light, offset);
+                        handles[index] = pool.Add(light);
+                    }
+                    break;
+
+                case Scenario::MoveAll:
+                {
+                    Light* lights = pool.Edit(0, pool.Count());
+                    for (size_t i = 0; i < pool.Count(); ++i)
+                    {
+                        Move(lights[i], offset);
+                    }
+                }
+                break;
+
+                case Scenario::Camera:
+                    view.m[3][0] += offset;
+                    break;
+
+                default:
+                    break;
+                }
+
+                // same as SimpleObj::OnUpdate: only dirty lights, unless the camera moved
+                pool.GetDirtyRanges(dirtyRanges);
+                if (std::memcmp(&view, &lastView, sizeof(view)) != 0)
+                {
+                    dirtyRanges.assign(1, { 0, pool.Count() });
+                    lastView = view;
+                }
+                for (const LightPool::DirtyRange& range : dirtyRanges)
+                {
+                    UpdateLightsViewSpace(pool.Edit(range.Begin, range.End), range.End - range.Begin, view);
+                }
+
+                gpu.Upload(pool);
+                ++frameCount;
+            };
+
+            double ms = Benchmark::MeasureMilliseconds(options.Iterations, [&]()
+            {
+                for (int i = 0; i < framesPerRun; ++i)
+                {
+                    frame();
+                }
+            });
+
+            double uploadKB = gpu.UploadedBytes / (double)frameCount / 1024.0;
+            double fullKB = lightCount * sizeof(Light) / 1024.0;
+            std::printf("%7zu %-15s %10.4f %12.2f %12.2f %9.2f %7.1f\n", lightCount, ScenarioNames[s], ms / framesPerRun,
+                uploadKB, fullKB, 100.0 * uploadKB / fullKB, gpu.UploadCount / (double)frameCount);
+        }
+    }
+
+    return 0;
+}
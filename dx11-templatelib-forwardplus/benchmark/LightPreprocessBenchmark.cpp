@@ -0,0 +1,149 @@
+// Per frame light preprocessing (DeriveLight(), SimpleObj::OnUpdate()) on the default scene at 1080p with 1K to 16K random
+// lights, 16 pixel tiles with the depth mask and the global light list as in the demo.
+// "derive ms" is DeriveLight() of every light (a camera move, edited lights only derive their own), "cull ms" / "derived ms"
+// TiledLightCuller solving Light::GetRadius() and the spot volume in every light test / reading LightCullInput::DerivedLights.
+// The GPU culls and shades with the same tests, so the columns after "speedup" count its work per frame left to the
+// preprocessing: "Mradius" the radius solves (one per tested point / spot light and tile, CullLight.hlsl and
+// CullSuperTile.hlsl) replaced by one per light, "Mspot cos" the cos(SpotAngle) of the spot lights in the tile lists for every
+// pixel with geometry (DoSpotConeWS() in the Forward+ shading pass), "upload KB" the derived light buffer of a camera move.
+// "mismatch" counts the tiles whose light lists differ with and without the derived lights and must be 0.
+// The exit code is 1 if any mismatch is not 0.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    const int TileSize = 16;
+
+    void DeriveLights(const std::vector<Light>& lights, std::vector<DerivedLight>& derivedLights)
+    {
+        derivedLights.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+            derivedLights[i] = DeriveLight(lights[i]);
+        }
+    }
+
+    size_t CountListMismatches(const LightCullResult& reference, const LightCullResult& result)
+    {
+        size_t mismatches = 0;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            const uint2& a = reference.LightGrid[tile];
+            const uint2& b = result.LightGrid[tile];
+            bool equal = a.y == b.y;
+            for (uint32_t k = 0; equal && k < a.y; ++k)
+            {
+                equal = reference.LightIndexList[a.x + k] == result.LightIndexList[b.x + k];
+            }
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+
+    // cos(SpotAngle) the Forward+ shading pass evaluates: the spot lights of every tile list for each pixel with geometry
+    uint64_t CountSpotCosines(const SyntheticScene& scene, const LightCullResult& result)
+    {
+        uint64_t count = 0;
+        for (int tileY = 0; tileY < result.TileCountY; ++tileY)
+        {
+            for (int tileX = 0; tileX < result.TileCountX; ++tileX)
+            {
+                const uint2& cell = result.LightGrid[tileX + tileY * result.TileCountX];
+                uint64_t spotCount = 0;
+                for (uint32_t k = 0; k < cell.y; ++k)
+                {
+                    spotCount += scene.Lights[result.LightIndexList[cell.x + k]].LightType == (int)LightType::Spotlight ? 1 : 0;
+                }
+
+                uint64_t pixelCount = 0;
+                for (int y = tileY * TileSize; y < std::min((tileY + 1) * TileSize, scene.Height); ++y)
+                {
+                    for (int x = tileX * TileSize; x < std::min((tileX + 1) * TileSize, scene.Width); ++x)
+                    {
+                        pixelCount += scene.Depth[x + static_cast<size_t>(y) * scene.Width] < 1.0f ? 1 : 0;
+                    }
+                }
+                count += spotCount * pixelCount;
+            }
+        }
+        return count;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution& resolution = Benchmark::Resolution1080p;
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    FrustumPlaneGrid frustumPlanes;
+    ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, TileSize, frustumPlanes);
+
+    const size_t lightCounts[] = { 1024, 4096, 16384 };
+
+    std::printf("Light preprocess benchmark, %s, %u thread(s), %d iteration(s), %d pixel tiles\n", resolution.Name,
+        threadPool.ThreadCount(), options.Iterations, TileSize);
+    std::printf("%7s %10s %9s %10s %8s %9s %10s %10s %9s\n", "lights", "derive ms", "cull ms", "derived ms", "speedup",
+        "Mradius", "Mspot cos", "upload KB", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 4096)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+
+        std::vector<DerivedLight> derivedLights;
+        double deriveMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { DeriveLights(scene.Lights, derivedLights); });
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = TileSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.FrustumPlanes = &frustumPlanes;
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+        input.UseDepthMask = true;
+        input.UseGlobalLightList = true;
+
+        LightCullResult solved;
+        double cullMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, solved); });
+
+        input.DerivedLights = derivedLights.data();
+        LightCullResult derived;
+        double derivedMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, derived); });
+
+        uint64_t radiusSolves = solved.LightTestCount > lightCount ? solved.LightTestCount - lightCount : 0;
+        size_t mismatches = CountListMismatches(solved, derived);
+        failedRows += mismatches > 0 ? 1 : 0;
+        std::printf("%7zu %10.3f %9.3f %10.3f %7.2fx %9.2f %10.2f %10.1f %9zu\n", lightCount, deriveMs, cullMs, derivedMs,
+            cullMs / (derivedMs + deriveMs), radiusSolves / 1e6, CountSpotCosines(scene, derived) / 1e6,
+            lightCount * sizeof(DerivedLight) / 1024.0, mismatches);
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
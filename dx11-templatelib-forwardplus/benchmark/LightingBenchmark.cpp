@@ -0,0 +1,253 @@
+// Cpu/Lighting.h on the surfaces of the default scene at 1080p and 4K, every 4th pixel of every 4th row with geometry,
+// normals from the depth buffer and specular powers of 8, 32 and 128, in world and view space, against 16, 64 and 256
+// lights (one directional, the others random point / spot lights).
+// "hlsl ms" is ComputeLightingWS() / ComputeLightingVS() one surface at a time, "scalar" / "sse" / "avx2 ms" the batched
+// ComputeLighting() kernels on the SoA surfaces (- if not supported), "Mlights/s" light evaluations per second of the
+// fastest kernel. "max err" is the largest difference of any kernel to the hlsl functions, relative to max(1, |hlsl|),
+// "mismatch" the surfaces where it exceeds 1e-3 and must be 0. The exit code is 1 if any mismatch is not 0.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/Culling.h"
+#include "Cpu/Lighting.h"
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // SoA surfaces in world and view space
+    struct SurfaceArrays
+    {
+        std::vector<float> Position[3];
+        std::vector<float> Normal[3];
+        std::vector<float> SpecularPower;
+
+        size_t Count() const { return SpecularPower.size(); }
+
+        ShadingSurfaces View(size_t begin, size_t end) const
+        {
+            return { end - begin, Position[0].data() + begin, Position[1].data() + begin, Position[2].data() + begin,
+                Normal[0].data() + begin, Normal[1].data() + begin, Normal[2].data() + begin, SpecularPower.data() + begin };
+        }
+
+        void Add(const Float3& p, const Float3& n, float specularPower)
+        {
+            Position[0].push_back(p.x);
+            Position[1].push_back(p.y);
+            Position[2].push_back(p.z);
+            Normal[0].push_back(n.x);
+            Normal[1].push_back(n.y);
+            Normal[2].push_back(n.z);
+            SpecularPower.push_back(specularPower);
+        }
+    };
+
+    struct OutputArrays
+    {
+        std::vector<float> Channels[6];
+
+        void Resize(size_t count)
+        {
+            for (std::vector<float>& channel : Channels)
+            {
+                channel.assign(count, 0.0f);
+            }
+        }
+
+        ShadingOutput View(size_t begin)
+        {
+            return { Channels[0].data() + begin, Channels[1].data() + begin, Channels[2].data() + begin,
+                Channels[3].data() + begin, Channels[4].data() + begin, Channels[5].data() + begin };
+        }
+    };
+
+    Float3 GetViewPosition(const SyntheticScene& scene, int x, int y)
+    {
+        Float2 screenDimensions((float)scene.Width, (float)scene.Height);
+        float depth = scene.Depth[x + static_cast<size_t>(y) * scene.Width];
+        return ScreenToView(Float4(x + 0.5f, y + 0.5f, depth, 1.0f), screenDimensions, scene.InverseProjection).xyz();
+    }
+
+    // Every `step`th pixel of every `step`th row with geometry on both sides, the normal from the position differences
+    // to the right and lower neighbour, facing the camera
+    void BuildSurfaces(const SyntheticScene& scene, int step, SurfaceArrays& viewSurfaces, SurfaceArrays& worldSurfaces)
+    {
+        const float specularPowers[] = { 8.0f, 32.0f, 128.0f };
+        Float4x4 inverseView = Inverse(scene.View);
+
+        for (int y = 0; y + 1 < scene.Height; y += step)
+        {
+            for (int x = 0; x + 1 < scene.Width; x += step)
+            {
+                size_t pixel = x + static_cast<size_t>(y) * scene.Width;
+                if (scene.Depth[pixel] >= 1.0f || scene.Depth[pixel + 1] >= 1.0f || scene.Depth[pixel + scene.Width] >= 1.0f)
+                {
+                    continue;
+                }
+
+                Float3 p = GetViewPosition(scene, x, y);
+                Float3 n = Normalize(Cross(GetViewPosition(scene, x, y + 1) - p, GetViewPosition(scene, x + 1, y) - p));
+                if (Dot(n, p) > 0.0f)
+                {
+                    n = -n;
+                }
+
+                float specularPower = specularPowers[viewSurfaces.Count() % 3];
+                viewSurfaces.Add(p, n, specularPower);
+                worldSurfaces.Add(TransformPoint(p, inverseView), Normalize(TransformNormal(n, inverseView)), specularPower);
+            }
+        }
+    }
+
+    void ShadeHlsl(ThreadPool& threadPool, const std::vector<Light>& lights, ShadingSpace space, const Float3& eyePosition,
+        const SurfaceArrays& surfaces, OutputArrays& output)
+    {
+        threadPool.ParallelFor(surfaces.Count(), 1024, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                Float3 p(surfaces.Position[0][i], surfaces.Position[1][i], surfaces.Position[2][i]);
+                Float3 n(surfaces.Normal[0][i], surfaces.Normal[1][i], surfaces.Normal[2][i]);
+                LightingResult result = space == ShadingSpace::View ?
+                    ComputeLightingVS(lights.data(), nullptr, lights.size(), p, n, surfaces.SpecularPower[i]) :
+                    ComputeLightingWS(lights.data(), nullptr, lights.size(), p, n, surfaces.SpecularPower[i], eyePosition);
+
+                const float channels[6] = { result.Diffuse.x, result.Diffuse.y, result.Diffuse.z,
+                    result.Specular.x, result.Specular.y, result.Specular.z };
+                for (int c = 0; c < 6; ++c)
+                {
+                    output.Channels[c][i] = channels[c];
+                }
+            }
+        });
+    }
+
+    void ShadeBatched(ThreadPool& threadPool, CullKernel kernel, const std::vector<ShadingLight>& lights, ShadingSpace space,
+        const Float3& eyePosition, const SurfaceArrays& surfaces, OutputArrays& output)
+    {
+        threadPool.ParallelFor(surfaces.Count(), 1024, [&](size_t begin, size_t end)
+        {
+            ComputeLighting(kernel, lights.data(), lights.size(), space, eyePosition, surfaces.View(begin, end), output.View(begin));
+        });
+    }
+
+    // Largest error relative to max(1, |reference|), and the surfaces where it is above `tolerance`
+    void CompareOutputs(const OutputArrays& reference, const OutputArrays& output, float tolerance, float& maxError, size_t& mismatches)
+    {
+        size_t count = reference.Channels[0].size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            float error = 0.0f;
+            for (int c = 0; c < 6; ++c)
+            {
+                float expected = reference.Channels[c][i];
+                float difference = std::fabs(output.Channels[c][i] - expected) / std::max(1.0f, std::fabs(expected));
+                error = difference == difference ? std::max(error, difference) : 1e30f;
+            }
+            maxError = std::max(maxError, error);
+            mismatches += error > tolerance ? 1 : 0;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+
+    const Benchmark::Resolution* resolutions[] = { &Benchmark::Resolution1080p, &Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 16, 64, 256 };
+    const ShadingSpace spaces[] = { ShadingSpace::World, ShadingSpace::View };
+    const CullKernel kernels[] = { CullKernel::Scalar, CullKernel::Sse, CullKernel::Avx2 };
+    const int step = 4;
+
+    std::printf("Lighting benchmark, %u thread(s), %d iteration(s), every %dth pixel\n", threadPool.ThreadCount(), options.Iterations, step);
+    std::printf("%-6s %6s %7s %9s %9s %9s %9s %9s %10s %10s %9s\n", "res", "space", "lights", "surfaces",
+        "hlsl ms", "scalar ms", "sse ms", "avx2 ms", "Mlights/s", "max err", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (const Benchmark::Resolution* resolution : resolutions)
+    {
+        if (options.Quick && resolution != &Benchmark::Resolution1080p)
+        {
+            continue;
+        }
+
+        SyntheticScene scene;
+        BuildDefaultScene(resolution->Width, resolution->Height, scene);
+
+        SurfaceArrays viewSurfaces;
+        SurfaceArrays worldSurfaces;
+        BuildSurfaces(scene, step, viewSurfaces, worldSurfaces);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 64)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount - 1, 1234);
+            Light directional;
+            directional.LightType = (int)LightType::Directional;
+            directional.DirectionWS = Vector4(0.3f, -0.8f, 0.5f, 0.0f);
+            directional.Strength = 0.2f;
+            directional.Enabled = true;
+            scene.Lights.insert(scene.Lights.begin(), directional);
+            UpdateLightsViewSpace(scene.Lights.data(), scene.Lights.size(), scene.View);
+
+            for (ShadingSpace space : spaces)
+            {
+                const SurfaceArrays& surfaces = space == ShadingSpace::View ? viewSurfaces : worldSurfaces;
+
+                std::vector<ShadingLight> shadingLights;
+                PrepareShadingLights(scene.Lights.data(), nullptr, scene.Lights.size(), space, shadingLights);
+
+                OutputArrays reference;
+                reference.Resize(surfaces.Count());
+                double hlslMs = Benchmark::MeasureMilliseconds(options.Iterations,
+                    [&]() { ShadeHlsl(threadPool, scene.Lights, space, scene.EyePosition, surfaces, reference); });
+
+                char kernelMs[3][16];
+                double bestMs = hlslMs;
+                float maxError = 0.0f;
+                size_t mismatches = 0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (!IsCullKernelSupported(kernels[k]))
+                    {
+                        std::snprintf(kernelMs[k], sizeof(kernelMs[k]), "-");
+                        continue;
+                    }
+
+                    OutputArrays output;
+                    output.Resize(surfaces.Count());
+                    double ms = Benchmark::MeasureMilliseconds(options.Iterations,
+                        [&]() { ShadeBatched(threadPool, kernels[k], shadingLights, space, scene.EyePosition, surfaces, output); });
+                    std::snprintf(kernelMs[k], sizeof(kernelMs[k]), "%.3f", ms);
+                    bestMs = std::min(bestMs, ms);
+
+                    CompareOutputs(reference, output, 1e-3f, maxError, mismatches);
+                }
+
+                failedRows += mismatches > 0 ? 1 : 0;
+                double lightEvaluations = static_cast<double>(surfaces.Count()) * scene.Lights.size();
+                std::printf("%-6s %6s %7zu %9zu %9.3f %9s %9s %9s %10.1f %10.2e %9zu\n", resolution->Name,
+                    space == ShadingSpace::View ? "view" : "world", scene.Lights.size(), surfaces.Count(), hlslMs,
+                    kernelMs[0], kernelMs[1], kernelMs[2], lightEvaluations / (bestMs * 1000.0), maxError, mismatches);
+            }
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
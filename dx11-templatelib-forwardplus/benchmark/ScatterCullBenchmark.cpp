@@ -0,0 +1,129 @@
+// Finds the crossover between gather culling (TiledLightCuller, every tile tests every light, flat and hierarchical with
+// 64 pixel super-tiles) and scatter culling (ScatterLightCuller, every light tests the tiles under its screen rectangle)
+// at 1080p with 16 pixel tiles, the depth mask and the transparent lists, from 16 to 4096 lights of three sizes:
+// the lights of GenerateLights() with their radius scaled by 0.25 (small), 1 (default) and 2 (large).
+// "tiles/light" is the number of tiles a scattered light tests, "tests" the light-vs-tile tests of each culler.
+// "mismatch" counts the tiles whose opaque or transparent list differs from the flat gather result and must be 0.
+// The exit code is 1 if any mismatch is not 0.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    struct LightSize
+    {
+        const char* Name;
+        float RadiusScale;
+    };
+
+    bool ListsEqual(const std::vector<uint2>& referenceGrid, const std::vector<uint32_t>& referenceList,
+        const std::vector<uint2>& grid, const std::vector<uint32_t>& list, size_t tile)
+    {
+        auto referenceBegin = referenceList.begin() + referenceGrid[tile].x;
+        auto begin = list.begin() + grid[tile].x;
+        return referenceGrid[tile].y == grid[tile].y && std::equal(referenceBegin, referenceBegin + referenceGrid[tile].y, begin);
+    }
+
+    size_t CountMismatches(const LightCullResult& reference, const LightCullResult& result)
+    {
+        size_t mismatches = 0;
+        for (size_t tile = 0; tile < reference.TileCount(); ++tile)
+        {
+            bool equal = ListsEqual(reference.LightGrid, reference.LightIndexList, result.LightGrid, result.LightIndexList, tile) &&
+                ListsEqual(reference.TransparentLightGrid, reference.TransparentLightIndexList,
+                    result.TransparentLightGrid, result.TransparentLightIndexList, tile);
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller gatherCuller(threadPool);
+    ScatterLightCuller scatterCuller(threadPool);
+
+    const Benchmark::Resolution& resolution = Benchmark::Resolution1080p;
+    const LightSize sizes[] = { { "small", 0.25f }, { "default", 1.0f }, { "large", 2.0f } };
+    const size_t lightCounts[] = { 16, 64, 256, 1024, 4096 };
+    const int blockSize = 16;
+
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    FrustumPlaneGrid grid;
+    ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+    std::printf("Scatter culling benchmark, %s, %u thread(s), %d iteration(s), block size %d\n", resolution.Name,
+        threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-8s %7s %12s %10s %10s %10s %8s %12s %12s %9s\n", "size", "lights", "tiles/light", "gather ms", "hier ms",
+        "scatter ms", "speedup", "gather tests", "scatter tests", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (const LightSize& size : sizes)
+    {
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 1024)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            // Light::GetRadius() scales by s when the linear and quadratic terms are divided by s and s^2
+            for (Light& light : scene.Lights)
+            {
+                light.LinearAttenuation /= size.RadiusScale;
+                light.QuadraticAttenuation /= size.RadiusScale * size.RadiusScale;
+            }
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.FrustumPlanes = &grid;
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+            input.BuildTransparentLists = true;
+
+            LightCullResult gather;
+            double gatherMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, gather); });
+
+            input.SuperTileSize = 64;
+            LightCullResult hierarchical;
+            double hierarchicalMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { gatherCuller.Cull(input, hierarchical); });
+            input.SuperTileSize = 0;
+
+            LightCullResult scatter;
+            double scatterMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { scatterCuller.Cull(input, scatter); });
+
+            size_t mismatches = CountMismatches(gather, scatter);
+            failedRows += mismatches > 0 ? 1 : 0;
+            std::printf("%-8s %7zu %12.1f %10.3f %10.3f %10.3f %8.2f %12llu %12llu %9zu\n", size.Name, lightCount,
+                scatter.LightTestCount / (double)lightCount, gatherMs, hierarchicalMs, scatterMs,
+                std::min(gatherMs, hierarchicalMs) / scatterMs, (unsigned long long)gather.LightTestCount,
+                (unsigned long long)scatter.LightTestCount, mismatches);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
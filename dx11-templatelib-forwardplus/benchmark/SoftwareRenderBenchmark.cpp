@@ -0,0 +1,196 @@
+// Full frames of the demo scene rendered by SoftwareRenderer with Forward, Deferred and Forward+ (16 pixel tiles) at 1080p
+// and 4K with 32 and 128 random lights: assets/Models/cornelBox.obj, and UnitSphere.obj scaled in place of the bunnies.
+// `--models DIR` is the directory of the .obj files (assets/Models), `--image PREFIX` writes the frames of the first
+// configuration to PREFIX_<technique>.ppm.
+// "frame ms" is the median of the whole frame, "setup" / "depth" / "cull" / "shade ms" its passes in the last run (depth is
+// the pre-pass of Forward+ and the G-buffer pass of Deferred), "Mfrag" the shaded fragments in millions, "lights/frag" the
+// average lights evaluated per fragment.
+// "max diff" is the largest color difference to Forward; Forward+ leaves out the lights beyond their culling radius, so it
+// is small but not 0. "mismatch" counts the pixels whose Deferred color or Forward+ depth differs from Forward and must be 0.
+// The exit code is 1 if the models cannot be read or any mismatch is not 0.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/ObjMesh.h"
+#include "Cpu/SoftwareRenderer.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    Float4x4 MakeScaleTranslation(float scale, const Float3& translation)
+    {
+        Float4x4 result;
+        result.m[0][0] = scale;
+        result.m[1][1] = scale;
+        result.m[2][2] = scale;
+        result.m[3][0] = translation.x;
+        result.m[3][1] = translation.y;
+        result.m[3][2] = translation.z;
+        return result;
+    }
+
+    float MaxColorDifference(const std::vector<Float3>& reference, const std::vector<Float3>& color)
+    {
+        float difference = 0.0f;
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            difference = std::max(difference, std::fabs(reference[i].x - color[i].x));
+            difference = std::max(difference, std::fabs(reference[i].y - color[i].y));
+            difference = std::max(difference, std::fabs(reference[i].z - color[i].z));
+        }
+        return difference;
+    }
+
+    size_t CountColorMismatches(const std::vector<Float3>& reference, const std::vector<Float3>& color)
+    {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            bool equal = reference[i].x == color[i].x && reference[i].y == color[i].y && reference[i].z == color[i].z;
+            mismatches += equal ? 0 : 1;
+        }
+        return mismatches;
+    }
+
+    size_t CountDepthMismatches(const std::vector<float>& reference, const std::vector<float>& depth)
+    {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            mismatches += reference[i] == depth[i] ? 0 : 1;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    SoftwareRenderer renderer(threadPool);
+
+    std::string models = Benchmark::GetOption(argc, argv, "--models", "assets/Models");
+    const char* imagePrefix = Benchmark::GetOption(argc, argv, "--image");
+
+    std::vector<MeshVertex> box;
+    std::vector<MeshVertex> sphere;
+    if (!LoadObjMesh((models + "/cornelBox.obj").c_str(), box) || !LoadObjMesh((models + "/UnitSphere.obj").c_str(), sphere))
+    {
+        std::fprintf(stderr, "Unable to read cornelBox.obj / UnitSphere.obj in %s, see --models\n", models.c_str());
+        return 1;
+    }
+
+    // boxMaterial, bunny1Material and bunny2Material of SimpleObj
+    std::vector<SurfaceMaterial> materials(3);
+    materials[0].Specular = Float3(0.0f, 0.0f, 0.0f);
+    materials[1].Diffuse = Float3(115 / 255.0f, 165 / 255.0f, 245 / 255.0f);
+    materials[2].Diffuse = Float3(245 / 255.0f, 197 / 255.0f, 115 / 255.0f);
+
+    std::vector<RasterDraw> draws(3);
+    draws[0].Vertices = box.data();
+    draws[0].VertexCount = box.size();
+    draws[0].MaterialIndex = 0;
+    draws[1].Vertices = sphere.data();
+    draws[1].VertexCount = sphere.size();
+    draws[1].World = MakeScaleTranslation(1.8f, Float3(4.5f, 1.8f, -4.5f));
+    draws[1].MaterialIndex = 1;
+    draws[2] = draws[1];
+    draws[2].World = MakeScaleTranslation(1.8f, Float3(-4.5f, 1.8f, 1.0f));
+    draws[2].MaterialIndex = 2;
+
+    const Benchmark::Resolution* resolutions[] = { &Benchmark::Resolution1080p, &Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 32, 128 };
+    const SoftwareTechnique techniques[] = { SoftwareTechnique::Forward, SoftwareTechnique::Deferred, SoftwareTechnique::ForwardPlus };
+    bool imageWritten = false;
+
+    std::printf("Software render benchmark, %u thread(s), %d iteration(s), %s lighting kernel, %zu triangles\n",
+        threadPool.ThreadCount(), options.Iterations, GetCullKernelName(renderer.GetKernel()), (box.size() + 2 * sphere.size()) / 3);
+    std::printf("%-6s %7s %-9s %9s %8s %8s %8s %8s %8s %12s %9s %9s\n", "res", "lights", "technique", "frame ms", "setup",
+        "depth", "cull", "shade", "Mfrag", "lights/frag", "max diff", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (const Benchmark::Resolution* resolution : resolutions)
+    {
+        if (options.Quick && resolution != &Benchmark::Resolution1080p)
+        {
+            continue;
+        }
+
+        SyntheticScene camera;
+        BuildDefaultScene(resolution->Width, resolution->Height, camera);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 32)
+            {
+                continue;
+            }
+
+            GenerateLights(camera, lightCount, 1234);
+
+            SoftwareScene scene;
+            scene.Width = camera.Width;
+            scene.Height = camera.Height;
+            scene.EyePosition = camera.EyePosition;
+            scene.View = camera.View;
+            scene.Projection = camera.Projection;
+            scene.Draws = draws.data();
+            scene.DrawCount = draws.size();
+            scene.Materials = materials.data();
+            scene.MaterialCount = materials.size();
+            scene.Lights = camera.Lights.data();
+            scene.LightCount = camera.Lights.size();
+
+            std::vector<Float3> forwardColor;
+            std::vector<float> forwardDepth;
+            for (SoftwareTechnique technique : techniques)
+            {
+                double frameMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { renderer.Render(scene, technique); });
+                const SoftwareFrameStats& stats = renderer.GetStats();
+
+                float maxDifference = 0.0f;
+                size_t mismatches = 0;
+                if (technique == SoftwareTechnique::Forward)
+                {
+                    forwardColor = renderer.GetColor();
+                    forwardDepth = renderer.GetTarget().Depth;
+                }
+                else
+                {
+                    maxDifference = MaxColorDifference(forwardColor, renderer.GetColor());
+                    mismatches = technique == SoftwareTechnique::Deferred ?
+                        CountColorMismatches(forwardColor, renderer.GetColor()) : CountDepthMismatches(forwardDepth, renderer.GetTarget().Depth);
+                    failedRows += mismatches > 0 ? 1 : 0;
+                }
+
+                if (imagePrefix && !imageWritten)
+                {
+                    std::string path = std::string(imagePrefix) + "_" + GetSoftwareTechniqueName(technique) + ".ppm";
+                    if (!renderer.WritePpm(path.c_str()))
+                    {
+                        std::fprintf(stderr, "Unable to write %s\n", path.c_str());
+                    }
+                }
+
+                double lightsPerFragment = stats.ShadedFragmentCount ? (double)stats.ShadedLightCount / stats.ShadedFragmentCount : 0.0;
+                std::printf("%-6s %7zu %-9s %9.3f %8.3f %8.3f %8.3f %8.3f %8.3f %12.1f %9.2e %9zu\n", resolution->Name, lightCount,
+                    GetSoftwareTechniqueName(technique), frameMs, stats.SetupMs, stats.DepthMs, stats.CullMs, stats.ShadeMs,
+                    stats.ShadedFragmentCount / 1e6, lightsPerFragment, maxDifference, mismatches);
+            }
+            imageWritten = imageWritten || imagePrefix;
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
@@ -0,0 +1,227 @@
+// Measures how tightly the opaque tile lists bound the spot lights at 1080p and 4K on the default scene with 1024 lights.
+// Every spot light is tested against every 16 x 16 tile with three versions of the spot test:
+//   legacy  the cone of the old shaders, tan(radians(SpotAngle)) of an angle that already is in radians
+//   planes  the cone with the correct radius against the tile planes (ConeInsideFrustum / ConeInsidePlane)
+//   tight   planes, then the bounding sphere of the lit volume against the tile box and the cone against
+//           the sphere of the box (SpotIntersectsTileVolume), the test of TiledLightCuller
+// and the result is compared with the exact tiles: those with a shaded pixel inside the lit volume (LightTouchesPoint).
+// "fp/spot" / "max fp" are the tiles listed without being lit, "missed" the lit tiles that are not listed and must be 0.
+// The legacy test misses tiles by design, the exit code is 1 if planes or tight miss any.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/Culling.h"
+#include "Cpu/CullingAnalysis.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    enum Variant
+    {
+        Legacy,
+        Planes,
+        Tight,
+        VariantCount
+    };
+
+    const char* VariantNames[VariantCount] = { "legacy", "planes", "tight" };
+
+    // Tiles of one spot light
+    struct SpotTiles
+    {
+        size_t Exact = 0;
+        size_t Listed[VariantCount] = {};
+        size_t FalsePositives[VariantCount] = {};
+        size_t Missed[VariantCount] = {};
+    };
+
+    bool ConeTouchesTile(const Cone& cone, const Frustum& frustum, float nearClipVS, const TileDepthBounds& bounds)
+    {
+        Plane minPlane = MakePlane(Float3(0, 0, 1), bounds.MinDepthVS);
+        return ConeInsideFrustum(cone, frustum, nearClipVS, bounds.MaxDepthVS) && !ConeInsidePlane(cone, minPlane);
+    }
+
+    std::vector<SpotTiles> CountSpotTiles(const LightCullInput& input, const std::vector<uint32_t>& spots, ThreadPool& threadPool)
+    {
+        int tileCountX = (input.Width + input.BlockSize - 1) / input.BlockSize;
+        int tileCountY = (input.Height + input.BlockSize - 1) / input.BlockSize;
+        float nearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+        Float2 screenDimensions((float)input.Width, (float)input.Height);
+
+        std::vector<Cone> legacyCones;
+        std::vector<SpotVolume> volumes;
+        for (uint32_t index : spots)
+        {
+            const Light& light = input.Lights[index];
+            Cone cone = GetLightCone(light);
+            cone.r = std::tan(Radians(light.SpotAngle)) * cone.h;
+            legacyCones.push_back(cone);
+            volumes.push_back(GetLightSpotVolume(light));
+        }
+
+        std::vector<SpotTiles> tiles(spots.size());
+        std::mutex mutex;
+
+        threadPool.ParallelFor(tileCountY, 1, [&](size_t begin, size_t end)
+        {
+            std::vector<SpotTiles> local(spots.size());
+            std::vector<Float3> pixels;
+
+            for (size_t tileY = begin; tileY < end; ++tileY)
+            {
+                for (int tileX = 0; tileX < tileCountX; ++tileX)
+                {
+                    int x0 = tileX * input.BlockSize;
+                    int y0 = static_cast<int>(tileY) * input.BlockSize;
+                    int x1 = std::min(x0 + input.BlockSize, input.Width);
+                    int y1 = std::min(y0 + input.BlockSize, input.Height);
+
+                    pixels.clear();
+                    for (int y = y0; y < y1; ++y)
+                    {
+                        for (int x = x0; x < x1; ++x)
+                        {
+                            float depth = input.Depth[x + static_cast<size_t>(y) * input.Width];
+                            if (depth < 1.0f)
+                            {
+                                pixels.push_back(ScreenToView(Float4(x + 0.5f, y + 0.5f, depth, 1.0f), screenDimensions, input.InverseProjection).xyz());
+                            }
+                        }
+                    }
+
+                    Frustum frustum = TiledLightCuller::GetTileFrustum(input, tileX, static_cast<int>(tileY));
+                    TileDepthBounds bounds = TiledLightCuller::ComputeTileDepthBounds(input, tileX, static_cast<int>(tileY));
+                    TileVolume transparentVolume = GetTileVolume(frustum, nearClipVS, bounds.MaxDepthVS);
+                    TileVolume opaqueVolume = GetTileVolume(frustum, bounds.MinDepthVS, bounds.MaxDepthVS);
+
+                    for (size_t s = 0; s < spots.size(); ++s)
+                    {
+                        const Light& light = input.Lights[spots[s]];
+                        const SpotVolume& spot = volumes[s];
+
+                        bool listed[VariantCount];
+                        listed[Legacy] = ConeTouchesTile(legacyCones[s], frustum, nearClipVS, bounds);
+                        listed[Planes] = ConeTouchesTile(spot.C, frustum, nearClipVS, bounds);
+                        listed[Tight] = listed[Planes] && SpotIntersectsTileVolume(spot, transparentVolume) && SpotIntersectsTileVolume(spot, opaqueVolume);
+
+                        bool exact = std::any_of(pixels.begin(), pixels.end(), [&](const Float3& p) { return LightTouchesPoint(light, p); });
+
+                        SpotTiles& counts = local[s];
+                        counts.Exact += exact ? 1 : 0;
+                        for (int v = 0; v < VariantCount; ++v)
+                        {
+                            counts.Listed[v] += listed[v] ? 1 : 0;
+                            counts.FalsePositives[v] += listed[v] && !exact ? 1 : 0;
+                            counts.Missed[v] += !listed[v] && exact ? 1 : 0;
+                        }
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t s = 0; s < spots.size(); ++s)
+            {
+                tiles[s].Exact += local[s].Exact;
+                for (int v = 0; v < VariantCount; ++v)
+                {
+                    tiles[s].Listed[v] += local[s].Listed[v];
+                    tiles[s].FalsePositives[v] += local[s].FalsePositives[v];
+                    tiles[s].Missed[v] += local[s].Missed[v];
+                }
+            }
+        });
+
+        return tiles;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution4K };
+    const size_t lightCount = 1024;
+    const int blockSize = 16;
+
+    std::printf("Spot light culling benchmark, %u thread(s), %zu lights, block size %d\n", threadPool.ThreadCount(), lightCount, blockSize);
+    std::printf("%-6s %6s %8s %12s %12s %10s %8s %8s %8s\n", "res", "spots", "test", "listed", "exact", "fp/spot", "max fp", "fp%", "missed");
+
+    size_t failedRows = 0;
+
+    for (auto& resolution : resolutions)
+    {
+        if (options.Quick && resolution.Width > Benchmark::Resolution1080p.Width)
+        {
+            continue;
+        }
+
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+        GenerateLights(scene, lightCount, 1234);
+
+        std::vector<Frustum> frustums;
+        ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = blockSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.Frustums = frustums.data();
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+
+        std::vector<uint32_t> spots;
+        for (size_t i = 0; i < scene.Lights.size(); ++i)
+        {
+            if (scene.Lights[i].Enabled && scene.Lights[i].LightType == (int)LightType::Spotlight)
+            {
+                spots.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        std::vector<SpotTiles> tiles = CountSpotTiles(input, spots, threadPool);
+
+        size_t exact = 0;
+        for (const SpotTiles& t : tiles)
+        {
+            exact += t.Exact;
+        }
+
+        for (int v = 0; v < VariantCount; ++v)
+        {
+            size_t listed = 0;
+            size_t falsePositives = 0;
+            size_t maxFalsePositives = 0;
+            size_t missed = 0;
+            for (const SpotTiles& t : tiles)
+            {
+                listed += t.Listed[v];
+                falsePositives += t.FalsePositives[v];
+                maxFalsePositives = std::max(maxFalsePositives, t.FalsePositives[v]);
+                missed += t.Missed[v];
+            }
+            failedRows += v != Legacy && missed > 0 ? 1 : 0;
+
+            std::printf("%-6s %6zu %8s %12zu %12zu %10.1f %8zu %8.2f %8zu\n", resolution.Name, spots.size(), VariantNames[v], listed, exact,
+                falsePositives / (double)std::max<size_t>(spots.size(), 1), maxFalsePositives,
+                listed ? 100.0 * falsePositives / listed : 0.0, missed);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// Runs TileSizeTuner on the default scene at 1080p, 1440p and 4K with 256, 1024 and 4096 lights: culling
+// (TiledLightCuller with the depth mask) plus shading (ShadeLightLists()) for every supported tile size.
+// "cull ms" / "shade ms" are the medians of both passes, "lights/px" the mean number of lights shaded per pixel with
+// geometry, "indices" the size of the opaque light index list. "best" marks the size the tuner picks.
+
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+#include "Cpu/TileSizeTuner.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    size_t CountGeometryPixels(const SyntheticScene& scene)
+    {
+        size_t count = 0;
+        for (float depth : scene.Depth)
+        {
+            count += depth < 1.0f ? 1 : 0;
+        }
+        return count;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TileSizeTuner tuner(threadPool);
+
+    const Benchmark::Resolution* resolutions[] = { &Benchmark::Resolution1080p, &Benchmark::Resolution1440p, &Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 256, 1024, 4096 };
+
+    std::printf("Tile size autotune benchmark, %u thread(s), %d iteration(s)\n", threadPool.ThreadCount(), options.Iterations);
+    std::printf("%-6s %7s %5s %9s %9s %9s %10s %10s %5s\n", "res", "lights", "tile", "cull ms", "shade ms", "total ms",
+        "lights/px", "indices", "best");
+
+    for (const Benchmark::Resolution* resolution : resolutions)
+    {
+        if (options.Quick && resolution != &Benchmark::Resolution1080p)
+        {
+            continue;
+        }
+
+        SyntheticScene scene;
+        BuildDefaultScene(resolution->Width, resolution->Height, scene);
+        size_t geometryPixels = CountGeometryPixels(scene);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 1024)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.InverseProjection = scene.InverseProjection;
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+            input.UseDepthMask = true;
+
+            int best = tuner.Tune(input, options.Iterations);
+
+            for (const TileSizeTiming& timing : tuner.GetTimings())
+            {
+                std::printf("%-6s %7zu %5d %9.3f %9.3f %9.3f %10.2f %10zu %5s\n", resolution->Name, lightCount, timing.TileSize,
+                    timing.CullMs, timing.ShadeMs, timing.TotalMs(), timing.ShadedLightCount / (double)geometryPixels,
+                    timing.IndexCount, timing.TileSize == best ? "*" : "");
+            }
+        }
+    }
+
+    return 0;
+}
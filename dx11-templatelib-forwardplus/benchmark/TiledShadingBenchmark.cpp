@@ -0,0 +1,273 @@
+// The shading pass of Forward+ against the Forward LoopLight path as lights scale: TiledShader on the G-buffer of the demo
+// scene (assets/Models/cornelBox.obj, and UnitSphere.obj scaled in place of the bunnies) at 1080p and 4K with 64 to 4096
+// random lights. `--models DIR` is the directory of the .obj files (assets/Models).
+// "cull ms" is TiledLightCuller with 16 pixel tiles and the global light list, "loop ms" every pixel shaded with every
+// light (ForwardLighting_LoopLightPS.hlsl without its overdraw), "tiled ms" every pixel shaded with the lights of its tile,
+// "speedup" loop / (cull + tiled), "lights/px" the average lights evaluated per shaded pixel. "uint16 ms" / "bitmask ms"
+// are "tiled ms" reading the lists through TiledShadingInput::EncodedLists in those LightListEncoding layouts.
+// "max diff" is the largest difference of tiled to loop; the lists leave out the lights beyond their culling radius, so it
+// is small but not 0. "mismatch" counts every 7th pixel whose tiled result differs by more than 1e-3 from
+// ComputeLightingWS() over the global list and its tile's list, plus the pixels whose result from the encoded lists is not
+// bit for bit the one of the uint32 lists, and must be 0.
+// The exit code is 1 if the models cannot be read or any mismatch is not 0.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Lighting.h"
+#include "Cpu/LightListEncoding.h"
+#include "Cpu/ObjMesh.h"
+#include "Cpu/SoftwareRasterizer.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+#include "Cpu/TiledShading.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    const int TileSize = 16;
+    const size_t ValidationStride = 7;
+
+    Float4x4 MakeScaleTranslation(float scale, const Float3& translation)
+    {
+        Float4x4 result;
+        result.m[0][0] = scale;
+        result.m[1][1] = scale;
+        result.m[2][2] = scale;
+        result.m[3][0] = translation.x;
+        result.m[3][1] = translation.y;
+        result.m[3][2] = translation.z;
+        return result;
+    }
+
+    struct OutputArrays
+    {
+        std::vector<float> Channels[6];
+
+        void Resize(size_t count)
+        {
+            for (std::vector<float>& channel : Channels)
+            {
+                channel.assign(count, 0.0f);
+            }
+        }
+
+        ShadingOutput View()
+        {
+            return { Channels[0].data(), Channels[1].data(), Channels[2].data(),
+                Channels[3].data(), Channels[4].data(), Channels[5].data() };
+        }
+    };
+
+    float MaxDifference(const OutputArrays& reference, const OutputArrays& output)
+    {
+        float difference = 0.0f;
+        for (int c = 0; c < 6; ++c)
+        {
+            for (size_t i = 0; i < reference.Channels[c].size(); ++i)
+            {
+                difference = std::max(difference, std::fabs(reference.Channels[c][i] - output.Channels[c][i]));
+            }
+        }
+        return difference;
+    }
+
+    size_t CountDifferentPixels(const OutputArrays& reference, const OutputArrays& output)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < reference.Channels[0].size(); ++i)
+        {
+            bool equal = true;
+            for (int c = 0; c < 6; ++c)
+            {
+                equal = equal && reference.Channels[c][i] == output.Channels[c][i];
+            }
+            count += equal ? 0 : 1;
+        }
+        return count;
+    }
+
+    size_t CountMismatches(const RasterTarget& target, const std::vector<float>& specularPowers, const Float3& eyePosition,
+        const std::vector<Light>& lights, const LightCullResult& lists, const OutputArrays& output)
+    {
+        size_t mismatches = 0;
+        for (size_t pixel = 0; pixel < target.Depth.size(); pixel += ValidationStride)
+        {
+            if (target.Depth[pixel] >= 1.0f)
+            {
+                continue;
+            }
+
+            int tileX = static_cast<int>(pixel % target.Width) / TileSize;
+            int tileY = static_cast<int>(pixel / target.Width) / TileSize;
+            const uint2& cell = lists.LightGrid[tileX + tileY * lists.TileCountX];
+
+            Float3 p(target.PositionX[pixel], target.PositionY[pixel], target.PositionZ[pixel]);
+            Float3 n(target.NormalX[pixel], target.NormalY[pixel], target.NormalZ[pixel]);
+            LightingResult global = ComputeLightingWS(lights.data(), lists.GlobalLightIndexList.data(),
+                lists.GlobalLightIndexList.size(), p, n, specularPowers[pixel], eyePosition);
+            LightingResult tile = ComputeLightingWS(lights.data(), lists.LightIndexList.data() + cell.x, cell.y, p, n,
+                specularPowers[pixel], eyePosition);
+
+            const float expected[6] = { global.Diffuse.x + tile.Diffuse.x, global.Diffuse.y + tile.Diffuse.y,
+                global.Diffuse.z + tile.Diffuse.z, global.Specular.x + tile.Specular.x, global.Specular.y + tile.Specular.y,
+                global.Specular.z + tile.Specular.z };
+            bool mismatch = false;
+            for (int c = 0; c < 6; ++c)
+            {
+                float tolerance = 1e-3f * std::max(1.0f, std::fabs(expected[c]));
+                mismatch = mismatch || std::fabs(output.Channels[c][pixel] - expected[c]) > tolerance;
+            }
+            mismatches += mismatch ? 1 : 0;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    SoftwareRasterizer rasterizer(threadPool);
+    TiledLightCuller culler(threadPool);
+    TiledShader shader(threadPool);
+
+    std::string models = Benchmark::GetOption(argc, argv, "--models", "assets/Models");
+
+    std::vector<MeshVertex> box;
+    std::vector<MeshVertex> sphere;
+    if (!LoadObjMesh((models + "/cornelBox.obj").c_str(), box) || !LoadObjMesh((models + "/UnitSphere.obj").c_str(), sphere))
+    {
+        std::fprintf(stderr, "Unable to read cornelBox.obj / UnitSphere.obj in %s, see --models\n", models.c_str());
+        return 1;
+    }
+
+    std::vector<RasterDraw> draws(3);
+    draws[0].Vertices = box.data();
+    draws[0].VertexCount = box.size();
+    draws[1].Vertices = sphere.data();
+    draws[1].VertexCount = sphere.size();
+    draws[1].World = MakeScaleTranslation(1.8f, Float3(4.5f, 1.8f, -4.5f));
+    draws[2] = draws[1];
+    draws[2].World = MakeScaleTranslation(1.8f, Float3(-4.5f, 1.8f, 1.0f));
+
+    const Benchmark::Resolution* resolutions[] = { &Benchmark::Resolution1080p, &Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 64, 256, 1024, 4096 };
+
+    std::printf("Tiled shading benchmark, %u thread(s), %d iteration(s), %s lighting kernel, %d pixel tiles\n",
+        threadPool.ThreadCount(), options.Iterations, GetCullKernelName(shader.GetKernel()), TileSize);
+    std::printf("%-6s %7s %9s %9s %9s %10s %11s %8s %10s %9s %9s\n", "res", "lights", "cull ms", "loop ms", "tiled ms",
+        "uint16 ms", "bitmask ms", "speedup", "lights/px", "max diff", "mismatch");
+
+    size_t failedRows = 0;
+
+    for (const Benchmark::Resolution* resolution : resolutions)
+    {
+        if (options.Quick && resolution != &Benchmark::Resolution1080p)
+        {
+            continue;
+        }
+
+        SyntheticScene camera;
+        BuildDefaultScene(resolution->Width, resolution->Height, camera);
+
+        // the G-buffer of the depth pre-pass, shared by every light count
+        RasterInput rasterInput;
+        rasterInput.Width = camera.Width;
+        rasterInput.Height = camera.Height;
+        rasterInput.View = camera.View;
+        rasterInput.Projection = camera.Projection;
+        rasterInput.Draws = draws.data();
+        rasterInput.DrawCount = draws.size();
+
+        RasterTarget target;
+        target.Clear(camera.Width, camera.Height, true);
+        rasterizer.Setup(rasterInput);
+        rasterizer.RasterizeGBuffer(DepthTest::Less, target);
+
+        std::vector<float> specularPowers(target.Depth.size(), 128.0f);
+
+        FrustumPlaneGrid frustumPlanes;
+        ComputeFrustumPlanes(camera.InverseProjection, camera.Width, camera.Height, TileSize, frustumPlanes);
+
+        size_t pixelCount = target.Depth.size();
+        OutputArrays loopOutput;
+        OutputArrays tiledOutput;
+        OutputArrays encodedOutput;
+        loopOutput.Resize(pixelCount);
+        tiledOutput.Resize(pixelCount);
+        encodedOutput.Resize(pixelCount);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 256)
+            {
+                continue;
+            }
+
+            GenerateLights(camera, lightCount, 1234);
+
+            LightCullInput cullInput;
+            cullInput.Depth = target.Depth.data();
+            cullInput.Width = camera.Width;
+            cullInput.Height = camera.Height;
+            cullInput.BlockSize = TileSize;
+            cullInput.InverseProjection = camera.InverseProjection;
+            cullInput.FrustumPlanes = &frustumPlanes;
+            cullInput.Lights = camera.Lights.data();
+            cullInput.LightCount = camera.Lights.size();
+            cullInput.UseGlobalLightList = true;
+
+            LightCullResult lists;
+            double cullMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(cullInput, lists); });
+
+            TiledShadingInput shadingInput;
+            shadingInput.Width = camera.Width;
+            shadingInput.Height = camera.Height;
+            shadingInput.Depth = target.Depth.data();
+            shadingInput.Surfaces = { pixelCount, target.PositionX.data(), target.PositionY.data(), target.PositionZ.data(),
+                target.NormalX.data(), target.NormalY.data(), target.NormalZ.data(), specularPowers.data() };
+            shadingInput.EyePosition = camera.EyePosition;
+            shadingInput.Lights = camera.Lights.data();
+            shadingInput.LightCount = camera.Lights.size();
+            shadingInput.TileSize = TileSize;
+
+            double loopMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { shader.Shade(shadingInput, loopOutput.View()); });
+
+            shadingInput.LightLists = &lists;
+            double tiledMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { shader.Shade(shadingInput, tiledOutput.View()); });
+            TiledShadingStats stats = shader.GetStats();
+            size_t mismatches = CountMismatches(target, specularPowers, camera.EyePosition, camera.Lights, lists, tiledOutput);
+
+            const LightListEncoding encodings[] = { LightListEncoding::Uint16, LightListEncoding::Bitmask };
+            double encodedMs[2] = {};
+            for (int e = 0; e < 2; ++e)
+            {
+                EncodedLightLists encoded;
+                EncodeLightLists(threadPool, lists, lightCount, encodings[e], encoded);
+
+                shadingInput.EncodedLists = &encoded;
+                encodedMs[e] = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { shader.Shade(shadingInput, encodedOutput.View()); });
+                shadingInput.EncodedLists = nullptr;
+                mismatches += CountDifferentPixels(tiledOutput, encodedOutput);
+            }
+            failedRows += mismatches > 0 ? 1 : 0;
+
+            double lightsPerPixel = stats.ShadedPixelCount ? (double)stats.ShadedLightCount / stats.ShadedPixelCount : 0.0;
+            std::printf("%-6s %7zu %9.3f %9.3f %9.3f %10.3f %11.3f %7.2fx %10.1f %9.2e %9zu\n", resolution->Name, lightCount, cullMs,
+                loopMs, tiledMs, encodedMs[0], encodedMs[1], loopMs / (cullMs + tiledMs), lightsPerPixel,
+                MaxDifference(loopOutput, tiledOutput), mismatches);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
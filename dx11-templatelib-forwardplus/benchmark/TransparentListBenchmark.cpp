@@ -0,0 +1,99 @@
+// Measures the extra cost of building the transparent (t_) light lists next to the opaque (o_) ones
+// with TiledLightCuller, at 1080p and 4K with 256, 1024 and 4096 lights on the default scene.
+// Also checks that every opaque list is contained in the transparent list of its tile, "not contained" must be 0.
+// The exit code is 1 if any not contained is not 0.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "Benchmark.h"
+
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    size_t CountNotContainedTiles(const LightCullResult& result)
+    {
+        size_t count = 0;
+        for (size_t tile = 0; tile < result.TileCount(); ++tile)
+        {
+            const uint2& opaque = result.LightGrid[tile];
+            const uint2& transparent = result.TransparentLightGrid[tile];
+            auto opaqueBegin = result.LightIndexList.begin() + opaque.x;
+            auto transparentBegin = result.TransparentLightIndexList.begin() + transparent.x;
+
+            // Both lists are in ascending light order
+            if (!std::includes(transparentBegin, transparentBegin + transparent.y, opaqueBegin, opaqueBegin + opaque.y))
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller culler(threadPool);
+
+    const Benchmark::Resolution resolutions[] = { Benchmark::Resolution1080p, Benchmark::Resolution4K };
+    const size_t lightCounts[] = { 256, 1024, 4096 };
+    const int blockSize = 16;
+
+    std::printf("Transparent light list benchmark, %u thread(s), %d iteration(s), block size %d\n", threadPool.ThreadCount(), options.Iterations, blockSize);
+    std::printf("%-6s %7s %12s %12s %10s %12s %12s %13s\n", "res", "lights", "opaque ms", "o+t ms", "extra%", "o indices", "t indices", "not contained");
+
+    size_t failedRows = 0;
+
+    for (auto& resolution : resolutions)
+    {
+        SyntheticScene scene;
+        BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+        std::vector<Frustum> frustums;
+        ComputeFrustums(scene.InverseProjection, scene.Width, scene.Height, blockSize, frustums);
+
+        for (size_t lightCount : lightCounts)
+        {
+            if (options.Quick && lightCount > 1024)
+            {
+                continue;
+            }
+
+            GenerateLights(scene, lightCount, 1234);
+
+            LightCullInput input;
+            input.Depth = scene.Depth.data();
+            input.Width = scene.Width;
+            input.Height = scene.Height;
+            input.BlockSize = blockSize;
+            input.InverseProjection = scene.InverseProjection;
+            input.Frustums = frustums.data();
+            input.Lights = scene.Lights.data();
+            input.LightCount = scene.Lights.size();
+
+            LightCullResult result;
+            input.BuildTransparentLists = false;
+            double opaqueMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+
+            input.BuildTransparentLists = true;
+            double bothMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { culler.Cull(input, result); });
+
+            size_t notContained = CountNotContainedTiles(result);
+            failedRows += notContained > 0 ? 1 : 0;
+            std::printf("%-6s %7zu %12.3f %12.3f %10.2f %12zu %12zu %13zu\n", resolution.Name, lightCount, opaqueMs, bothMs,
+                100.0 * (bothMs / opaqueMs - 1.0), result.LightIndexList.size(), result.TransparentLightIndexList.size(),
+                notContained);
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
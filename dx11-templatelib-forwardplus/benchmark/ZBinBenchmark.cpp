@@ -0,0 +1,176 @@
+// Compares the tile grid + light index list layout (TiledLightCuller, hierarchical with 64 pixel super-tiles and the depth mask,
+// its fastest configuration) with Z-binned lists (ZBinLightCuller, 1024 depth bins) on the default scene at 1080p
+// with 1K to 50K lights: build time, memory, and the average number of lights a shaded pixel visits.
+// The tile masks take tiles * lights / 8 bytes, so Z-binning is also run with 32 and 64 pixel tiles:
+// the depth bins do the depth culling the small tiles of the index list layout are needed for.
+// "missed" counts the lights touching a sampled shaded pixel (LightTouchesPoint) that the pixel does not visit and must be 0.
+// The exit code is 1 if any layout misses a light.
+
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+
+#include "Cpu/Culling.h"
+#include "Cpu/CullingAnalysis.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/SyntheticScene.h"
+#include "Cpu/ThreadPool.h"
+#include "Cpu/ZBinLightCuller.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Every SampleStride-th pixel is checked against all lights
+    const size_t SampleStride = 1021;
+
+    struct PixelStats
+    {
+        double LightsPerPixel = 0.0;
+        size_t Missed = 0;
+    };
+
+    // `visit(tileIndex, depthVS, func)` calls func(lightIndex) for every light the pixel loops over
+    template<class Visit>
+    PixelStats MeasurePixels(const SyntheticScene& scene, int blockSize, int tileCountX, Visit&& visit)
+    {
+        PixelStats stats;
+        size_t pixels = 0;
+        std::vector<uint8_t> visited(scene.Lights.size(), 0);
+        Float2 screenDimensions((float)scene.Width, (float)scene.Height);
+
+        for (int y = 0; y < scene.Height; ++y)
+        {
+            for (int x = 0; x < scene.Width; ++x)
+            {
+                size_t pixel = x + static_cast<size_t>(y) * scene.Width;
+                float depth = scene.Depth[pixel];
+                if (depth >= 1.0f)
+                {
+                    continue;
+                }
+
+                size_t tileIndex = x / blockSize + (y / blockSize) * tileCountX;
+                float depthVS = ClipToView(Float4(0, 0, depth, 1), scene.InverseProjection).z;
+                size_t lights = 0;
+                visit(tileIndex, depthVS, [&](uint32_t) { ++lights; });
+                stats.LightsPerPixel += lights;
+                ++pixels;
+
+                if (pixel % SampleStride == 0)
+                {
+                    visit(tileIndex, depthVS, [&](uint32_t light) { visited[light] = 1; });
+
+                    Float3 pointVS = ScreenToView(Float4(x + 0.5f, y + 0.5f, depth, 1.0f), screenDimensions, scene.InverseProjection).xyz();
+                    for (size_t i = 0; i < scene.Lights.size(); ++i)
+                    {
+                        if (!visited[i] && LightTouchesPoint(scene.Lights[i], pointVS))
+                        {
+                            ++stats.Missed;
+                        }
+                    }
+
+                    visit(tileIndex, depthVS, [&](uint32_t light) { visited[light] = 0; });
+                }
+            }
+        }
+
+        stats.LightsPerPixel = pixels ? stats.LightsPerPixel / pixels : 0.0;
+        return stats;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Benchmark::ParseOptions(argc, argv);
+    ThreadPool threadPool(options.Threads);
+    TiledLightCuller tiledCuller(threadPool);
+    ZBinLightCuller zbinCuller(threadPool);
+
+    const Benchmark::Resolution resolution = Benchmark::Resolution1080p;
+    const size_t lightCounts[] = { 1024, 4096, 16384, 50000 };
+    const int blockSize = 16;
+    const int zbinBlockSizes[] = { 16, 32, 64 };
+
+    SyntheticScene scene;
+    BuildDefaultScene(resolution.Width, resolution.Height, scene);
+
+    FrustumPlaneGrid grid;
+    ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, blockSize, grid);
+
+    FrustumPlaneGrid zbinGrids[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        ComputeFrustumPlanes(scene.InverseProjection, scene.Width, scene.Height, zbinBlockSizes[i], zbinGrids[i]);
+    }
+
+    ZBinSettings settings;
+
+    std::printf("Z-binning benchmark, %s, %u thread(s), %d iteration(s), %d bins\n", resolution.Name, threadPool.ThreadCount(),
+        options.Iterations, settings.BinCount);
+    std::printf("%7s %-6s %5s %10s %12s %14s %8s\n", "lights", "layout", "tile", "ms", "KiB", "lights/pixel", "missed");
+
+    size_t failedRows = 0;
+
+    for (size_t lightCount : lightCounts)
+    {
+        if (options.Quick && lightCount > 4096)
+        {
+            continue;
+        }
+
+        GenerateLights(scene, lightCount, 1234);
+
+        LightCullInput input;
+        input.Depth = scene.Depth.data();
+        input.Width = scene.Width;
+        input.Height = scene.Height;
+        input.BlockSize = blockSize;
+        input.InverseProjection = scene.InverseProjection;
+        input.FrustumPlanes = &grid;
+        input.Lights = scene.Lights.data();
+        input.LightCount = scene.Lights.size();
+        input.UseDepthMask = true;
+        input.SuperTileSize = 64;
+
+        LightCullResult tiled;
+        double tiledMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { tiledCuller.Cull(input, tiled); });
+        size_t tiledBytes = tiled.LightGrid.size() * sizeof(uint2) + tiled.LightIndexList.size() * sizeof(uint32_t);
+
+        PixelStats tiledPixels = MeasurePixels(scene, blockSize, tiled.TileCountX, [&](size_t tileIndex, float, auto&& func)
+        {
+            const uint2& cell = tiled.LightGrid[tileIndex];
+            for (uint32_t i = 0; i < cell.y; ++i)
+            {
+                func(tiled.LightIndexList[cell.x + i]);
+            }
+        });
+
+        std::printf("%7zu %-6s %5d %10.3f %12.1f %14.2f %8zu\n", lightCount, "tiled", blockSize, tiledMs, tiledBytes / 1024.0,
+            tiledPixels.LightsPerPixel, tiledPixels.Missed);
+        failedRows += tiledPixels.Missed > 0 ? 1 : 0;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            input.BlockSize = zbinBlockSizes[i];
+            input.FrustumPlanes = &zbinGrids[i];
+
+            ZBinResult zbin;
+            double zbinMs = Benchmark::MeasureMilliseconds(options.Iterations, [&]() { zbinCuller.Cull(input, settings, zbin); });
+
+            PixelStats zbinPixels = MeasurePixels(scene, input.BlockSize, zbin.TileCountX, [&](size_t tileIndex, float depthVS, auto&& func)
+            {
+                zbin.ForEachLight(tileIndex, depthVS, func);
+            });
+
+            std::printf("%7zu %-6s %5d %10.3f %12.1f %14.2f %8zu\n", lightCount, "zbin", input.BlockSize, zbinMs, zbin.MemoryBytes() / 1024.0,
+                zbinPixels.LightsPerPixel, zbinPixels.Missed);
+            failedRows += zbinPixels.Missed > 0 ? 1 : 0;
+        }
+    }
+
+    return failedRows > 0 ? 1 : 0;
+}
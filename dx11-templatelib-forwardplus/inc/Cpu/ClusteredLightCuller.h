@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Depth slicing of the cluster grid.
+    /// Slice k covers [NearVS * (FarVS / NearVS)^(k / SliceCount), NearVS * (FarVS / NearVS)^((k + 1) / SliceCount)],
+    /// so every cluster has about the same aspect ratio.
+    /// </summary>
+    struct ClusterCullSettings
+    {
+        static const int MaxSliceCount = 64;
+
+        int SliceCount = 24;                // clamped to [1, MaxSliceCount]
+        float NearVS = 0.0f;                // 0 = near plane of the projection
+        float FarVS = 0.0f;                 // 0 = far plane of the projection
+
+        // Leave clusters without opaque geometry empty and shrink the others to the depth range
+        // of their pixels. Turn off when the grid is also used for transparent geometry,
+        // which does not write the depth buffer.
+        bool SkipEmptyClusters = true;
+    };
+
+    /// <summary>
+    /// 3D version of LightCullResult: one (offset, count) per cluster,
+    /// stored at tileX + tileY * TileCountX + slice * TileCountX * TileCountY
+    /// </summary>
+    struct ClusterCullResult
+    {
+        int TileCountX = 0;
+        int TileCountY = 0;
+        int SliceCount = 0;
+        std::vector<float> SliceDepths;     // SliceCount + 1 view space slice boundaries
+        std::vector<uint2> ClusterGrid;
+        std::vector<uint32_t> LightIndexList;
+
+        size_t ClusterCount() const
+        {
+            return ClusterGrid.size();
+        }
+
+        size_t GetClusterIndex(int tileX, int tileY, int slice) const
+        {
+            return tileX + static_cast<size_t>(tileY) * TileCountX + static_cast<size_t>(slice) * TileCountX * TileCountY;
+        }
+
+        /// <summary>
+        /// Slice containing a view space depth, clamped to the grid
+        /// </summary>
+        int GetSlice(float depthVS) const;
+    };
+
+    /// <summary>
+    /// Clustered light assignment: every tile of the frustum grid is split into exponential depth slices,
+    /// so a tile spanning a depth discontinuity no longer collects every light between its min and max depth.
+    /// Like TiledLightCuller the result is deterministic and independent of the number of threads.
+    /// </summary>
+    class ClusteredLightCuller
+    {
+    public:
+        explicit ClusteredLightCuller(ThreadPool& threadPool);
+
+        void Cull(const LightCullInput& input, const ClusterCullSettings& settings, ClusterCullResult& result);
+
+    private:
+        ThreadPool& m_ThreadPool;
+
+        // One list per tile row, concatenated in row order once all rows are culled
+        std::vector<std::vector<uint32_t>> m_RowLightLists;
+    };
+}
+}
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "Light.h"
+#include "CullingTypes.h"
+#include "Cpu/Math.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    // C++ versions of the helpers in assets/Shaders/ForwardPlus/*.hlsl.
+    // Keep both sides in sync: the CPU culler is used as the reference for the compute shaders.
+    //
+    // The camera is left-handed (XMMatrixPerspectiveFovLH), so view space looks down +Z
+    // and zNear < zFar for every depth range used below.
+
+    struct Sphere
+    {
+        Float3 c;   // Center point.
+        float  r;   // Radius.
+    };
+
+    struct Cone
+    {
+        Float3 T;   // Cone tip.
+        float  h;   // Height of the cone.
+        Float3 d;   // Direction of the cone.
+        float  r;   // bottom radius of the cone.
+    };
+
+    struct AABB
+    {
+        Float3 Min;
+        Float3 Max;
+    };
+
+    // The lit volume of a spot light: the part of the cone within C.h of the tip (a cone with a spherical cap),
+    // with its minimal bounding sphere and the cos / sin of the half angle
+    struct SpotVolume
+    {
+        Cone C;
+        Sphere Bounds;
+        float CosAngle;
+        float SinAngle;
+    };
+
+    // View space box of the part of a tile frustum between two depths, and the bounding sphere of the box
+    struct TileVolume
+    {
+        AABB Box;
+        Sphere BoxBounds;
+    };
+
+    inline Float3 PlaneNormal(const Plane& plane)
+    {
+        return Float3(plane.N[0], plane.N[1], plane.N[2]);
+    }
+
+    inline Plane MakePlane(const Float3& N, float d)
+    {
+        Plane plane;
+        plane.N[0] = N.x;
+        plane.N[1] = N.y;
+        plane.N[2] = N.z;
+        plane.d = d;
+        return plane;
+    }
+
+    // Convert clip space coordinates to view space
+    inline Float4 ClipToView(const Float4& clip, const Float4x4& inverseProjection)
+    {
+        Float4 view = Transform(clip, inverseProjection);
+        return view / view.w;
+    }
+
+    // Convert screen space coordinates to view space.
+    inline Float4 ScreenToView(const Float4& screen, const Float2& screenDimensions, const Float4x4& inverseProjection)
+    {
+        Float2 texCoord(screen.x / screenDimensions.x, screen.y / screenDimensions.y);
+        Float4 clip(texCoord.x * 2.0f - 1.0f, (1.0f - texCoord.y) * 2.0f - 1.0f, screen.z, screen.w);
+        return ClipToView(clip, inverseProjection);
+    }
+
+    // Normal points to the inside of the frustum when p0, p1, p2 are clockwise seen from the inside
+    inline Plane ComputePlane(const Float3& p0, const Float3& p1, const Float3& p2)
+    {
+        Float3 v1 = p1 - p0;
+        Float3 v2 = p2 - p0;
+
+        Float3 N = Normalize(Cross(v1, v2));
+        return MakePlane(N, Dot(N, p0));
+    }
+
+    inline bool SphereInsidePlane(const Sphere& sphere, const Plane& plane)
+    {
+        return Dot(PlaneNormal(plane), sphere.c) - plane.d < -sphere.r;
+    }
+
+    // Check to see of a light is partially contained within the frustum.
+    inline bool SphereInsideFrustum(const Sphere& sphere, const Frustum& frustum, float zNear, float zFar)
+    {
+        // First check depth, note the sphere is in view space
+        if ((sphere.c.z - sphere.r) > zFar || (sphere.c.z + sphere.r) < zNear)
+        {
+            return false;
+        }
+
+        // Then check frustum planes
+        for (int i = 0; i < 4; ++i)
+        {
+            if (SphereInsidePlane(sphere, frustum.plane[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Check to see if an AABB is fully behind (inside the negative halfspace of) a plane:
+    // the corner furthest along the plane normal is behind it. CPU only (LightBvh).
+    inline bool AABBInsidePlane(const AABB& box, const Plane& plane)
+    {
+        Float3 N = PlaneNormal(plane);
+        Float3 p(N.x >= 0.0f ? box.Max.x : box.Min.x, N.y >= 0.0f ? box.Max.y : box.Min.y, N.z >= 0.0f ? box.Max.z : box.Min.z);
+        return Dot(N, p) - plane.d < 0;
+    }
+
+    // Check to see if an AABB is partially contained within the frustum. Conservative: boxes outside the
+    // frustum near its edges may pass.
+    inline bool AABBInsideFrustum(const AABB& box, const Frustum& frustum, float zNear, float zFar)
+    {
+        if (box.Min.z > zFar || box.Max.z < zNear)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (AABBInsidePlane(box, frustum.plane[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Check to see if a point is fully behind (inside the negative halfspace of) a plane.
+    inline bool PointInsidePlane(const Float3& p, const Plane& plane)
+    {
+        return Dot(PlaneNormal(plane), p) - plane.d < 0;
+    }
+
+    // Check to see if a cone if fully behind (inside the negative halfspace of) a plane.
+    inline bool ConeInsidePlane(const Cone& cone, const Plane& plane)
+    {
+        // The farthest point on the end of the cone to the positive space of the plane is
+        // cone.r along the part of the plane normal perpendicular to the axis. The former
+        // cross(cross(N, d), d) offset is not normalized and fell short of the rim for oblique planes.
+        Float3 bottom = cone.T + cone.d * cone.h;
+        float nd = Dot(PlaneNormal(plane), cone.d);
+        float extent = cone.r * std::sqrt(std::fmax(1.0f - nd * nd, 0.0f));
+
+        // The cone is in the negative halfspace of the plane if both
+        // the tip of the cone and the farthest point on the end of the cone to the
+        // positive halfspace of the plane are both inside the negative halfspace
+        // of the plane.
+        return PointInsidePlane(cone.T, plane) && (Dot(PlaneNormal(plane), bottom) + extent) - plane.d < 0.0f;
+    }
+
+    inline bool ConeInsideFrustum(const Cone& cone, const Frustum& frustum, float zNear, float zFar)
+    {
+        Plane nearPlane = MakePlane(Float3(0, 0, 1), zNear);
+        Plane farPlane = MakePlane(Float3(0, 0, -1), -zFar);
+
+        // First check the near and far clipping planes.
+        if (ConeInsidePlane(cone, nearPlane) || ConeInsidePlane(cone, farPlane))
+        {
+            return false;
+        }
+
+        // Then check frustum planes
+        for (int i = 0; i < 4; ++i)
+        {
+            if (ConeInsidePlane(cone, frustum.plane[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // The side planes of the tile frustums go through the eye, so the corners of the tile between two depths
+    // lie on the lines where neighbouring planes meet
+    inline TileVolume GetTileVolume(const Frustum& frustum, float zNear, float zFar)
+    {
+        static const int Corners[4][2] = { { 0, 2 }, { 2, 1 }, { 1, 3 }, { 3, 0 } }; // top-left, top-right, bottom-right, bottom-left
+
+        TileVolume volume;
+        for (int i = 0; i < 4; ++i)
+        {
+            Float3 edge = Cross(PlaneNormal(frustum.plane[Corners[i][0]]), PlaneNormal(frustum.plane[Corners[i][1]]));
+            edge = edge / edge.z;   // point at depth 1
+
+            Float3 nearCorner = edge * zNear;
+            Float3 farCorner = edge * zFar;
+            if (i == 0)
+            {
+                volume.Box.Min = nearCorner;
+                volume.Box.Max = nearCorner;
+            }
+            volume.Box.Min = Float3(std::fmin(volume.Box.Min.x, std::fmin(nearCorner.x, farCorner.x)),
+                std::fmin(volume.Box.Min.y, std::fmin(nearCorner.y, farCorner.y)), zNear);
+            volume.Box.Max = Float3(std::fmax(volume.Box.Max.x, std::fmax(nearCorner.x, farCorner.x)),
+                std::fmax(volume.Box.Max.y, std::fmax(nearCorner.y, farCorner.y)), zFar);
+        }
+
+        volume.BoxBounds.c = (volume.Box.Min + volume.Box.Max) * 0.5f;
+        volume.BoxBounds.r = Length(volume.Box.Max - volume.BoxBounds.c);
+        return volume;
+    }
+
+    inline bool SphereIntersectsAABB(const Sphere& sphere, const AABB& box)
+    {
+        float dx = std::fmax(box.Min.x - sphere.c.x, 0.0f) + std::fmax(sphere.c.x - box.Max.x, 0.0f);
+        float dy = std::fmax(box.Min.y - sphere.c.y, 0.0f) + std::fmax(sphere.c.y - box.Max.y, 0.0f);
+        float dz = std::fmax(box.Min.z - sphere.c.z, 0.0f) + std::fmax(sphere.c.z - box.Max.z, 0.0f);
+        return dx * dx + dy * dy + dz * dz <= sphere.r * sphere.r;
+    }
+
+    // Spot light volume against a sphere ("Cull that cone", Wronski 2017): the distance from the sphere center
+    // to the side of the cone, and to the planes through the tip and the end of the range.
+    // Conservative behind the tip, where the tip itself is the closest point.
+    inline bool SpotIntersectsSphere(const SpotVolume& spot, const Sphere& sphere)
+    {
+        Float3 V = sphere.c - spot.C.T;
+        float lengthSq = Dot(V, V);
+        float axial = Dot(V, spot.C.d);
+        float distanceToSide = spot.CosAngle * std::sqrt(std::fmax(lengthSq - axial * axial, 0.0f)) - axial * spot.SinAngle;
+
+        bool angleCull = distanceToSide > sphere.r;
+        bool frontCull = axial > sphere.r + spot.C.h;
+        bool backCull = axial < -sphere.r;
+        return !(angleCull || frontCull || backCull);
+    }
+
+    // Tight spot light test against the box of a tile volume: the bounding sphere of the light against the box,
+    // then the cone against the bounding sphere of the box. Both only ever reject, use after ConeInsideFrustum().
+    inline bool SpotIntersectsTileVolume(const SpotVolume& spot, const TileVolume& volume)
+    {
+        return SphereIntersectsAABB(spot.Bounds, volume.Box) && SpotIntersectsSphere(spot, volume.BoxBounds);
+    }
+
+    // 2.5D culling: the [minDepthVS, maxDepthVS] range of a tile is split into 32 cells,
+    // bit i of the tile's depth mask is set if a pixel of the tile falls into cell i.
+    inline uint32_t GetDepthMaskCell(float depthVS, float minDepthVS, float maxDepthVS)
+    {
+        float range = maxDepthVS - minDepthVS;
+        float cell = range > 0.0f ? (depthVS - minDepthVS) / range * 32.0f : 0.0f;
+        return static_cast<uint32_t>(std::fmin(std::fmax(cell, 0.0f), 31.0f));
+    }
+
+    // Cells covered by the depth range [z0, z1]
+    inline uint32_t GetDepthRangeMask(float z0, float z1, float minDepthVS, float maxDepthVS)
+    {
+        uint32_t first = GetDepthMaskCell(z0, minDepthVS, maxDepthVS);
+        uint32_t last = GetDepthMaskCell(z1, minDepthVS, maxDepthVS);
+        return (0xffffffffu >> (31 - last)) & (0xffffffffu << first);
+    }
+
+    inline uint32_t GetDepthRangeMask(const Sphere& sphere, float minDepthVS, float maxDepthVS)
+    {
+        return GetDepthRangeMask(sphere.c.z - sphere.r, sphere.c.z + sphere.r, minDepthVS, maxDepthVS);
+    }
+
+    // Depth range of the tip and the bottom disk of the cone
+    inline uint32_t GetDepthRangeMask(const Cone& cone, float minDepthVS, float maxDepthVS)
+    {
+        float bottomZ = cone.T.z + cone.d.z * cone.h;
+        float bottomExtent = cone.r * std::sqrt(std::fmax(1.0f - cone.d.z * cone.d.z, 0.0f));
+        float z0 = std::fmin(cone.T.z, bottomZ - bottomExtent);
+        float z1 = std::fmax(cone.T.z, bottomZ + bottomExtent);
+        return GetDepthRangeMask(z0, z1, minDepthVS, maxDepthVS);
+    }
+
+    // Depth range of the cone clipped to the depth range of the bounding sphere of the lit volume
+    inline void GetSpotDepthRange(const SpotVolume& spot, float& z0, float& z1)
+    {
+        const Cone& cone = spot.C;
+        float bottomZ = cone.T.z + cone.d.z * cone.h;
+        float bottomExtent = cone.r * std::sqrt(std::fmax(1.0f - cone.d.z * cone.d.z, 0.0f));
+        z0 = std::fmax(std::fmin(cone.T.z, bottomZ - bottomExtent), spot.Bounds.c.z - spot.Bounds.r);
+        z1 = std::fmin(std::fmax(cone.T.z, bottomZ + bottomExtent), spot.Bounds.c.z + spot.Bounds.r);
+    }
+
+    inline uint32_t GetDepthRangeMask(const SpotVolume& spot, float minDepthVS, float maxDepthVS)
+    {
+        float z0, z1;
+        GetSpotDepthRange(spot, z0, z1);
+        return GetDepthRangeMask(z0, z1, minDepthVS, maxDepthVS);
+    }
+
+    inline Sphere GetLightSphere(const Light& light)
+    {
+        return { Float3(light.PositionVS.x, light.PositionVS.y, light.PositionVS.z), Light::GetRadius(&light) };
+    }
+
+    // Light::SpotAngle is the half angle in radians, below 90 degrees
+    inline Cone GetLightCone(const Light& light)
+    {
+        float range = Light::GetRadius(&light);
+        float coneRadius = std::tan(light.SpotAngle) * range;
+        return {
+            Float3(light.PositionVS.x, light.PositionVS.y, light.PositionVS.z),
+            range,
+            Float3(light.DirectionVS.x, light.DirectionVS.y, light.DirectionVS.z),
+            coneRadius
+        };
+    }
+
+    inline SpotVolume GetSpotVolume(const Cone& cone)
+    {
+        SpotVolume spot;
+        spot.C = cone;
+
+        float slant = std::sqrt(cone.h * cone.h + cone.r * cone.r);
+        spot.CosAngle = cone.h / slant;
+        spot.SinAngle = cone.r / slant;
+
+        if (spot.CosAngle < 0.70710678f)
+        {
+            // Wider than 45 degrees: the circle where the cap meets the cone
+            spot.Bounds.c = cone.T + cone.d * (cone.h * spot.CosAngle);
+            spot.Bounds.r = cone.h * spot.SinAngle;
+        }
+        else
+        {
+            // The tip and that circle on the sphere
+            spot.Bounds.r = cone.h / (2.0f * spot.CosAngle);
+            spot.Bounds.c = cone.T + cone.d * spot.Bounds.r;
+        }
+        return spot;
+    }
+
+    inline SpotVolume GetLightSpotVolume(const Light& light)
+    {
+        return GetSpotVolume(GetLightCone(light));
+    }
+
+    // Per frame light preprocessing: the constants of DerivedLight for a light with PositionVS / DirectionVS already
+    // updated. Directional lights keep the defaults, they have no bounds
+    inline DerivedLight DeriveLight(const Light& light)
+    {
+        DerivedLight derived;
+        switch ((LightType)light.LightType)
+        {
+        case LightType::Point:
+            derived.Radius = Light::GetRadius(&light);
+            derived.BoundsVS = Vector4(light.PositionVS.x, light.PositionVS.y, light.PositionVS.z, derived.Radius);
+            break;
+
+        case LightType::Spotlight:
+        {
+            SpotVolume spot = GetLightSpotVolume(light);
+            derived.Radius = spot.C.h;
+            derived.BoundsVS = Vector4(spot.Bounds.c.x, spot.Bounds.c.y, spot.Bounds.c.z, spot.Bounds.r);
+            derived.SpotCosOuter = std::cos(light.SpotAngle);
+            derived.SpotCosInner = (derived.SpotCosOuter + 1.0f) / 2.0f;
+            derived.ConeRadius = spot.C.r;
+            derived.ConeCos = spot.CosAngle;
+            derived.ConeSin = spot.SinAngle;
+        }
+        break;
+
+        default:
+            return derived;
+        }
+
+        derived.InverseRadiusSq = 1.0f / (derived.Radius * derived.Radius);
+        return derived;
+    }
+
+    // GetLightSphere() / GetLightSpotVolume() from the derived constants of the light, equal to solving them again
+    inline Sphere GetLightSphere(const Light& light, const DerivedLight& derived)
+    {
+        return { Float3(light.PositionVS.x, light.PositionVS.y, light.PositionVS.z), derived.Radius };
+    }
+
+    inline SpotVolume GetLightSpotVolume(const Light& light, const DerivedLight& derived)
+    {
+        SpotVolume spot;
+        spot.C = {
+            Float3(light.PositionVS.x, light.PositionVS.y, light.PositionVS.z),
+            derived.Radius,
+            Float3(light.DirectionVS.x, light.DirectionVS.y, light.DirectionVS.z),
+            derived.ConeRadius
+        };
+        spot.Bounds = { Float3(derived.BoundsVS.x, derived.BoundsVS.y, derived.BoundsVS.z), derived.BoundsVS.w };
+        spot.CosAngle = derived.ConeCos;
+        spot.SinAngle = derived.ConeSin;
+        return spot;
+    }
+
+    // Smallest sphere around a cone with a flat base. SpotVolume::Bounds only bounds the lit sector, but the plane tests
+    // of the culler use the flat cone, whose rim reaches further out. CPU only (scatter culling, LightBvh).
+    inline Sphere GetConeBoundingSphere(const Cone& cone)
+    {
+        float slant = std::sqrt(cone.h * cone.h + cone.r * cone.r);
+        float cosAngle = cone.h / slant;
+
+        Sphere sphere;
+        if (cosAngle < 0.70710678f)
+        {
+            // Wider than 45 degrees: the base disc
+            sphere.c = cone.T + cone.d * cone.h;
+            sphere.r = cone.r;
+        }
+        else
+        {
+            // Through the tip and the rim of the base
+            sphere.r = slant / (2.0f * cosAngle);
+            sphere.c = cone.T + cone.d * sphere.r;
+        }
+        return sphere;
+    }
+
+    // Bounding sphere of everything a light may be accepted for, false for lights without one (directional)
+    inline bool GetLightBoundingSphere(const Light& light, Sphere& sphere)
+    {
+        switch ((LightType)light.LightType)
+        {
+        case LightType::Point:
+            sphere = GetLightSphere(light);
+            return true;
+        case LightType::Spotlight:
+            sphere = GetConeBoundingSphere(GetLightCone(light));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Per tile light budget: estimated contribution of a light to the geometry in `box`, the brightest channel of the light
+    // attenuated at the closest point of the box. Directional lights are not attenuated. Only used to rank the lights of a tile.
+    inline float GetLightContribution(const Light& light, const AABB& box)
+    {
+        float lightMax = std::fmax(std::fmax(light.Color.x, light.Color.y), light.Color.z) * light.Strength;
+        if ((LightType)light.LightType == LightType::Directional)
+        {
+            return lightMax;
+        }
+
+        float dx = std::fmax(box.Min.x - light.PositionVS.x, 0.0f) + std::fmax(light.PositionVS.x - box.Max.x, 0.0f);
+        float dy = std::fmax(box.Min.y - light.PositionVS.y, 0.0f) + std::fmax(light.PositionVS.y - box.Max.y, 0.0f);
+        float dz = std::fmax(box.Min.z - light.PositionVS.z, 0.0f) + std::fmax(light.PositionVS.z - box.Max.z, 0.0f);
+        float d = std::sqrt(dx * dx + dy * dy + dz * dz);
+        return lightMax / (light.ConstantAttenuation + light.LinearAttenuation * d + light.QuadraticAttenuation * d * d);
+    }
+}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Math.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// True if a view space point receives light from `light`: inside the sphere of a point light,
+    /// within the range and the spot angle of a spot light, always for a directional light
+    /// </summary>
+    bool LightTouchesPoint(const Light& light, const Float3& pointVS);
+
+    /// <summary>
+    /// Lights listed for a tile that do not touch any of its shaded pixels
+    /// </summary>
+    struct FalsePositiveStats
+    {
+        size_t ListedLights = 0;
+        size_t FalsePositives = 0;
+
+        double Rate() const
+        {
+            return ListedLights ? FalsePositives / (double)ListedLights : 0.0;
+        }
+    };
+
+    /// <summary>
+    /// Brute force check of a culling result: every listed light is tested against the view space
+    /// position of every pixel in its tile. Pixels at the clear depth (1.0) are not shaded and ignored.
+    /// </summary>
+    FalsePositiveStats CountFalsePositives(const LightCullInput& input, const LightCullResult& result, ThreadPool& threadPool);
+
+    /// <summary>
+    /// Culling quality of the opaque lists of a LightCullResult, tile by tile
+    /// </summary>
+    struct TileLightStats
+    {
+        int TileCountX = 0;
+        int TileCountY = 0;
+        std::vector<uint32_t> LightCounts;          // lights listed per tile, at tileX + tileY * TileCountX
+        std::vector<uint32_t> FalsePositiveCounts;  // listed lights touching none of the tile's shaded pixels, empty if not measured
+        std::vector<size_t> Histogram;              // Histogram[n] = number of tiles listing n lights, n in [0, MaxLights]
+
+        uint32_t MaxLights = 0;
+        double MeanLights = 0.0;
+        FalsePositiveStats FalsePositives;          // zero if not measured
+
+        /// <summary>
+        /// Smallest n such that at least `fraction` of the tiles list n lights or fewer
+        /// </summary>
+        uint32_t Percentile(double fraction) const;
+    };
+
+    /// <summary>
+    /// Per tile light counts, their histogram, max and mean, and if `measureFalsePositives` is set
+    /// the false positives of every tile with the brute force test of CountFalsePositives().
+    /// `result` only needs TileCountX / TileCountY, LightGrid and LightIndexList, so lists read back
+    /// from the GPU can be checked the same way.
+    /// </summary>
+    void ComputeTileLightStats(const LightCullInput& input, const LightCullResult& result, bool measureFalsePositives,
+        ThreadPool& threadPool, TileLightStats& stats);
+}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Cpu/CullingAnalysis.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Heatmap of `values` (width * height, one per tile) as a binary PPM, `scale` x `scale` pixels per tile.
+    /// Values go from black through blue, green and yellow to red at `maxValue` and above, 0 = black,
+    /// so images of different builds compare at the same `maxValue`. Returns false if the file cannot be written.
+    /// </summary>
+    bool WriteHeatmapPpm(const char* path, const uint32_t* values, int width, int height, uint32_t maxValue, int scale = 1);
+
+    /// <summary>
+    /// One row per tile: tile_x, tile_y, lights, false_positives (empty if not measured)
+    /// </summary>
+    bool WriteTileLightStatsCsv(const char* path, const TileLightStats& stats);
+
+    /// <summary>
+    /// One row per light count: lights, tiles
+    /// </summary>
+    bool WriteLightCountHistogramCsv(const char* path, const TileLightStats& stats);
+}
+}
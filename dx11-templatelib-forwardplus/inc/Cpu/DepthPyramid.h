@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Min / max depth mip chain of a depth buffer, the CPU version of DepthPyramid.hlsl.
+    ///
+    /// A texel of level k holds the min and max post-projection depth of a 2^k x 2^k pixel block,
+    /// so the depth bounds of a BlockSize tile are a single fetch from level log2(BlockSize).
+    /// Level 0 is the depth buffer itself and is not stored.
+    /// Pixels outside the screen count as depth 0, same as Texture2D::Load() out of bounds,
+    /// which makes every level match TiledLightCuller::ComputeTileDepthBounds() for partial tiles.
+    /// </summary>
+    class DepthPyramid
+    {
+    public:
+        // Level 6 covers 64 x 64 pixels, the largest tile / super-tile size
+        static const int MaxLevelCount = 6;
+
+        explicit DepthPyramid(ThreadPool& threadPool);
+
+        /// <summary>
+        /// Build levels 1 .. levelCount of the `width` x `height` depth buffer.
+        /// Min and max of all levels are built in one sweep over the depth buffer: the screen is split
+        /// into bands of 2^levelCount pixel rows and each band is reduced down to the last level while it is in cache.
+        /// `kernel` selects the instruction set of the 2 x 2 reduction, unsupported kernels fall back to Scalar.
+        /// </summary>
+        void Build(const float* depth, int width, int height, CullKernel kernel, int levelCount = MaxLevelCount);
+
+        int Width() const { return m_Width; }
+        int Height() const { return m_Height; }
+        int LevelCount() const { return static_cast<int>(m_Levels.size()); }
+
+        int LevelWidth(int level) const { return GetLevel(level).Width; }
+        int LevelHeight(int level) const { return GetLevel(level).Height; }
+        const float* MinLevel(int level) const { return GetLevel(level).Min.data(); }
+        const float* MaxLevel(int level) const { return GetLevel(level).Max.data(); }
+
+        float MinDepth(int level, int x, int y) const
+        {
+            const Level& l = GetLevel(level);
+            return l.Min[x + static_cast<size_t>(y) * l.Width];
+        }
+
+        float MaxDepth(int level, int x, int y) const
+        {
+            const Level& l = GetLevel(level);
+            return l.Max[x + static_cast<size_t>(y) * l.Width];
+        }
+
+        /// <summary>
+        /// The level whose texels are `blockSize` pixels wide, or -1 if blockSize is not a power of two
+        /// in [2, 2^LevelCount()]
+        /// </summary>
+        int GetLevelForBlockSize(int blockSize) const;
+
+    private:
+        struct Level
+        {
+            int Width = 0;
+            int Height = 0;
+            std::vector<float> Min;
+            std::vector<float> Max;
+        };
+
+        const Level& GetLevel(int level) const { return m_Levels[level - 1]; }
+
+        ThreadPool& m_ThreadPool;
+        int m_Width = 0;
+        int m_Height = 0;
+        std::vector<Level> m_Levels;    // m_Levels[k - 1] is level k
+        std::vector<float> m_ZeroRow;   // source row below the last row of a level
+    };
+}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Light.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Math.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// The inputs of one Forward+ frame as the application saw them, enough to replay its culling and shading headless
+    /// </summary>
+    struct CapturedFrame
+    {
+        int Width = 0;
+        int Height = 0;
+        int TileSize = 16;                      // BLOCK_SIZE the frame was culled with
+
+        // The LightCullInput settings the frame was culled with, a replay applies them to reproduce LightListHash
+        int SuperTileSize = 0;                  // LightCullInput::SuperTileSize, 0 = flat
+        int MaxLightsPerTile = 0;               // LightCullInput::MaxLightsPerTile, 0 = no budget
+        int DepthPyramidLevelCount = 0;         // levels of the DepthPyramid of Depth in LightCullInput::Pyramid, 0 = none
+
+        Float4x4 View;
+        Float4x4 Projection;
+        Float4x4 InverseProjection;
+
+        std::vector<Light> Lights;              // PositionVS / DirectionVS as uploaded that frame
+        std::vector<float> Depth;               // Width * Height post-projection depth, 1.0 where nothing is hit
+
+        // HashLightLists() of the lists culled that frame with the depth mask, transparent and global lists and the settings
+        // above, 0 if unknown. A replay culling the same depth and lights with them must reproduce it.
+        uint64_t LightListHash = 0;
+    };
+
+    /// <summary>
+    /// Writes CapturedFrames to a binary file, one after another:
+    ///   file:  "FPCP", uint32 version
+    ///   frame: fixed size header (screen and tile size, light count, list hash, depth byte count, culling settings, view /
+    ///          projection / inverse projection), the Light array as in the structured buffer, the encoded depth buffer
+    ///
+    /// Depth is stored as the 24 bit unorm of the D24 depth buffer: every pixel is predicted from the two before it on its
+    /// row (planes are linear in post-projection depth along a row), and the residuals written as varints, runs of zero
+    /// residuals as one varint. The cleared background and flat walls take a few bytes per row, curved surfaces about one
+    /// byte per pixel. Depth read back from the application is already 24 bit and round trips exactly, other depth is rounded
+    /// to 24 bit, see QuantizeDepth24().
+    ///
+    /// The file is little endian and the Light layout is the one of Light.h, captures are not portable to other layouts.
+    /// </summary>
+    class FrameCaptureWriter
+    {
+    public:
+        FrameCaptureWriter() = default;
+        FrameCaptureWriter(const FrameCaptureWriter&) = delete;
+        FrameCaptureWriter& operator=(const FrameCaptureWriter&) = delete;
+        ~FrameCaptureWriter();
+
+        /// <summary>
+        /// Create `path` and write the file header. Returns false if the file cannot be written.
+        /// </summary>
+        bool Open(const char* path);
+
+        /// <summary>
+        /// Append one frame. Returns false if the file is not open or cannot be written.
+        /// </summary>
+        bool Write(const CapturedFrame& frame);
+
+        /// <summary>
+        /// Flush and close the file, returns false if any write failed
+        /// </summary>
+        bool Close();
+
+        bool IsOpen() const { return m_File != nullptr; }
+        size_t FrameCount() const { return m_FrameCount; }
+        uint64_t ByteCount() const { return m_ByteCount; }
+
+    private:
+        FILE* m_File = nullptr;
+        bool m_Failed = false;
+        size_t m_FrameCount = 0;
+        uint64_t m_ByteCount = 0;
+        std::vector<uint8_t> m_EncodedDepth;
+    };
+
+    /// <summary>
+    /// Reads the frames of a FrameCaptureWriter file in order
+    /// </summary>
+    class FrameCaptureReader
+    {
+    public:
+        FrameCaptureReader() = default;
+        FrameCaptureReader(const FrameCaptureReader&) = delete;
+        FrameCaptureReader& operator=(const FrameCaptureReader&) = delete;
+        ~FrameCaptureReader();
+
+        /// <summary>
+        /// Open `path` and check its header. Returns false if it cannot be read or is not a capture of this version.
+        /// </summary>
+        bool Open(const char* path);
+
+        /// <summary>
+        /// Read the next frame into `frame`, reusing its storage. Returns false at the end of the file or if the frame is
+        /// truncated or corrupt, Failed() tells them apart.
+        /// </summary>
+        bool Read(CapturedFrame& frame);
+
+        void Close();
+
+        bool Failed() const { return m_Failed; }
+
+        // Size of the last frame read in the file, header, lights and encoded depth
+        size_t LastFrameByteCount() const { return m_LastFrameByteCount; }
+
+    private:
+        FILE* m_File = nullptr;
+        bool m_Failed = false;
+        size_t m_LastFrameByteCount = 0;
+        std::vector<uint8_t> m_EncodedDepth;
+    };
+
+    /// <summary>
+    /// Round `depth` to the 24 bit unorm values of a D24 depth buffer, what a capture stores
+    /// </summary>
+    void QuantizeDepth24(float* depth, size_t count);
+
+    /// <summary>
+    /// FNV-1a over the per tile opaque and transparent light lists and the global list, equal for equal lists wherever they
+    /// sit in the index lists
+    /// </summary>
+    uint64_t HashLightLists(const LightCullResult& result);
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/Math.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    // Number of tiles needed to cover `pixels` with tiles of `blockSize` pixels
+    inline int GetTileCount(int pixels, int blockSize)
+    {
+        return (pixels + blockSize - 1) / blockSize;
+    }
+
+    /// <summary>
+    /// CPU version of ComputeFrustum.hlsl: one view space frustum per tile,
+    /// stored at tileX + tileY * tileCountX
+    /// </summary>
+    /// <param name="inverseProjection"></param>
+    /// <param name="width">screen width in pixels</param>
+    /// <param name="height">screen height in pixels</param>
+    /// <param name="blockSize">tile size in pixels</param>
+    /// <param name="frustums">resized to tileCountX * tileCountY</param>
+    void ComputeFrustums(const Float4x4& inverseProjection, int width, int height, int blockSize, std::vector<Frustum>& frustums);
+
+    /// <summary>
+    /// Frustum of a single tile, see ComputeFrustums()
+    /// </summary>
+    Frustum ComputeTileFrustum(const Float4x4& inverseProjection, const Float2& screenDimensions, int tileX, int tileY, int blockSize);
+
+    /// <summary>
+    /// Shared edge version of the frustum grid, the layout of ComputeFrustum.hlsl.
+    /// Neighbouring tiles share their side planes, so the grid is stored as the TileCountX + 1 planes
+    /// through the vertical tile edges followed by the TileCountY + 1 planes through the horizontal ones.
+    /// Vertical planes face +x (the left plane of the tile to their right), horizontal planes face down
+    /// the screen (the top plane of the tile below them); the right and bottom planes of a tile are the
+    /// next edge planes flipped. All planes go through the eye, d is 0.
+    /// </summary>
+    struct FrustumPlaneGrid
+    {
+        int TileCountX = 0;
+        int TileCountY = 0;
+        std::vector<Plane> Planes;
+
+        const Plane& VerticalPlane(int x) const { return Planes[x]; }
+        const Plane& HorizontalPlane(int y) const { return Planes[TileCountX + 1 + y]; }
+
+        // Same planes as ComputeTileFrustum() up to rounding
+        Frustum GetTileFrustum(int tileX, int tileY) const
+        {
+            Frustum frustum;
+            frustum.plane[0] = VerticalPlane(tileX);                    // left plane
+            frustum.plane[1] = FlipPlane(VerticalPlane(tileX + 1));     // right plane
+            frustum.plane[2] = HorizontalPlane(tileY);                  // top plane
+            frustum.plane[3] = FlipPlane(HorizontalPlane(tileY + 1));   // bottom plane
+            return frustum;
+        }
+
+        static Plane FlipPlane(const Plane& plane)
+        {
+            return Plane{ { -plane.N[0], -plane.N[1], -plane.N[2] }, -plane.d };
+        }
+    };
+
+    /// <summary>
+    /// Build the shared edge planes of the `blockSize` tile grid, see FrustumPlaneGrid
+    /// </summary>
+    void ComputeFrustumPlanes(const Float4x4& inverseProjection, int width, int height, int blockSize, FrustumPlaneGrid& grid);
+}
+}
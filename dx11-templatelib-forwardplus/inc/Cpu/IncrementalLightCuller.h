@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "CullingTypes.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Math.h"
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    // What changed about a light since the last frame, see IncrementalLightCuller::GetLightDirtyFlags()
+    enum LightDirtyFlags : uint32_t
+    {
+        LightDirtyPosition = 1,             // PositionVS, DirectionVS, SpotAngle or LightType
+        LightDirtyRange = 2,                // attenuation, Strength or Color, i.e. Light::GetRadius()
+        LightDirtyEnabled = 4,
+    };
+
+    /// <summary>
+    /// Per frame options of IncrementalLightCuller
+    /// </summary>
+    struct IncrementalCullSettings
+    {
+        bool DepthChanged = false;          // the depth buffer is not the one of the last frame: rebuild everything
+        float MaxDirtyLightFraction = 0.25f;    // rebuild everything if more lights than this changed
+    };
+
+    /// <summary>
+    /// What the last IncrementalLightCuller::Cull() did
+    /// </summary>
+    struct IncrementalCullStats
+    {
+        bool FullRebuild = false;
+        const char* Reason = "";            // why everything was rebuilt, empty for incremental frames
+        size_t DirtyLights = 0;
+        size_t UpdatedTiles = 0;            // tiles whose lists were re-culled
+        uint64_t LightTestCount = 0;
+    };
+
+    /// <summary>
+    /// Light lists that are only updated where they change, for views where the camera and most lights stand still.
+    ///
+    /// Every frame the lights are compared with a copy of the last frame's lights. If the camera (projection, screen,
+    /// tile size, view space of the lights), the depth buffer or more than MaxDirtyLightFraction of the lights changed,
+    /// the lists are rebuilt with ScatterLightCuller. Otherwise only the tiles under the old or the new rectangle of a
+    /// changed light are re-culled: their changed lights are removed and tested again against the tile volumes kept
+    /// from the last rebuild. The lists are the same as a full rebuild, in ascending light order.
+    /// A moving camera changes the view space position of every light, so it always ends up as a full rebuild.
+    /// The whole lists are kept for the updates, a light budget (input.MaxLightsPerTile) cuts a copy of them every frame.
+    /// </summary>
+    class IncrementalLightCuller
+    {
+    public:
+        explicit IncrementalLightCuller(ThreadPool& threadPool);
+        IncrementalLightCuller(const IncrementalLightCuller&) = delete;
+        IncrementalLightCuller& operator=(const IncrementalLightCuller&) = delete;
+
+        /// <summary>
+        /// Update and return the light lists of `input`, cut to input.MaxLightsPerTile by ApplyLightBudget().
+        /// LightTestCount is the tests of this frame, as in GetStats(). input.SuperTileSize is ignored.
+        /// </summary>
+        const LightCullResult& Cull(const LightCullInput& input, const IncrementalCullSettings& settings);
+
+        /// <summary>
+        /// Forget the last frame, the next Cull() rebuilds everything
+        /// </summary>
+        void Invalidate();
+
+        const LightCullResult& GetResult() const { return *m_Output; }
+        const IncrementalCullStats& GetStats() const { return m_Stats; }
+
+        /// <summary>
+        /// LightDirtyFlags between two states of a light, 0 if the light culls the same
+        /// </summary>
+        static uint32_t GetLightDirtyFlags(const Light& previous, const Light& light);
+
+    private:
+        ThreadPool& m_ThreadPool;
+        ScatterLightCuller m_Culler;
+        LightCullResult m_Result;               // whole lists, without the budget
+        LightCullResult m_BudgetResult;         // m_Result cut to the budget of the last frame
+        const LightCullResult* m_Output = &m_Result;
+        IncrementalCullStats m_Stats;
+
+        // State of the last frame
+        bool m_Valid = false;
+        LightCullInput m_Input;
+        std::vector<Light> m_Lights;
+        Float4x4 m_Projection;
+        float m_NearClipVS = 0.0f;
+
+        std::vector<uint32_t> m_DirtyLights;
+        std::vector<TileRect> m_DirtyRects;     // old and new rectangle of every dirty light
+        std::vector<uint32_t> m_UpdatedTiles;
+        std::vector<uint8_t> m_TileUpdated;
+        std::vector<std::vector<uint2>> m_TileAdds;     // (light, TileLightFlags) of the dirty lights accepted by every updated tile
+        std::vector<uint2> m_Grid;              // lists under construction, swapped with the result
+        std::vector<uint32_t> m_IndexList;
+
+        const char* GetRebuildReason(const LightCullInput& input, const IncrementalCullSettings& settings) const;
+        void Rebuild(const LightCullInput& input, const char* reason);
+        const LightCullResult& Finish(const LightCullInput& input);
+        void UpdateTiles(const LightCullInput& input);
+        void UpdateLists(uint32_t flag, std::vector<uint2>& grid, std::vector<uint32_t>& indexList);
+    };
+}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Light.h"
+#include "CullingTypes.h"
+#include "Cpu/Culling.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Linear BVH (Karras 2012) over the view space bounding boxes of the lights, for frustum queries that do not
+    /// test every light.
+    ///
+    /// Build(): every light with a bounding sphere (GetLightBoundingSphere()) becomes a leaf, boxed around its sphere;
+    /// directional lights have none and are returned by every query. The leaves are sorted by the 30 bit Morton code
+    /// of their center with a parallel LSD radix sort, the internal nodes are then built independently of each other
+    /// from the sorted codes, and their boxes are merged bottom-up. Every step runs on the thread pool and the tree
+    /// does not depend on the number of threads.
+    /// Refit(): only the boxes are recomputed, for lights that moved but did not change type. Cheaper than a rebuild,
+    /// but the tree gets looser the further the lights move from where they were sorted.
+    /// Disabled lights keep their leaf with an empty box, so they can be enabled again with a refit.
+    /// </summary>
+    class LightBvh
+    {
+    public:
+        explicit LightBvh(ThreadPool& threadPool);
+
+        void Build(const Light* lights, size_t lightCount);
+
+        /// <summary>
+        /// Recompute the boxes of a tree built from the same lights. Returns false and leaves the tree as it was
+        /// if the light count or the set of directional lights changed, which needs a Build().
+        /// </summary>
+        bool Refit(const Light* lights, size_t lightCount);
+
+        size_t LightCount() const { return m_LightCount; }
+        size_t NodeCount() const { return m_Nodes.size(); }
+
+        /// <summary>
+        /// Call func(lightIndex) for every light whose box touches a frustum between zNear and zFar, and for every
+        /// directional light, in tree order. Returns the number of boxes tested.
+        /// Conservative: the light tests of the tile still decide which of them are kept.
+        /// </summary>
+        template<class Func>
+        uint32_t Query(const Frustum& frustum, float zNear, float zFar, Func&& func) const
+        {
+            for (uint32_t light : m_UnboundedLights)
+            {
+                func(light);
+            }
+
+            if (m_Nodes.empty())
+            {
+                return 0;
+            }
+
+            // The tree is at most as deep as the 64 bit keys it was split on
+            uint32_t stack[128];
+            int stackSize = 0;
+            uint32_t testCount = 0;
+            stack[stackSize++] = 0;
+
+            while (stackSize > 0)
+            {
+                uint32_t index = stack[--stackSize];
+                const Node& node = m_Nodes[index];
+                ++testCount;
+
+                if (!AABBInsideFrustum(node.Box, frustum, zNear, zFar))
+                {
+                    continue;
+                }
+
+                if (index >= m_FirstLeaf)
+                {
+                    func(m_LeafLights[index - m_FirstLeaf]);
+                }
+                else
+                {
+                    stack[stackSize++] = node.Right;
+                    stack[stackSize++] = node.Left;
+                }
+            }
+
+            return testCount;
+        }
+
+    private:
+        // Internal nodes come first, [0, m_FirstLeaf), then one leaf per bounded light; the root is node 0
+        struct Node
+        {
+            AABB Box;
+            uint32_t Left;
+            uint32_t Right;
+            uint32_t Parent;
+        };
+
+        ThreadPool& m_ThreadPool;
+
+        size_t m_LightCount = 0;
+        std::vector<Node> m_Nodes;
+        uint32_t m_FirstLeaf = 0;
+        std::vector<uint32_t> m_LeafLights;         // light index of every leaf, in Morton order
+        std::vector<uint32_t> m_UnboundedLights;    // directional lights, in ascending order
+        std::vector<uint8_t> m_Bounded;             // per light, 1 if it has a leaf
+
+        // Build scratch: Morton codes and leaf indices, sorted in place with their scratch copies
+        std::vector<uint32_t> m_Keys;
+        std::vector<uint32_t> m_Values;
+        std::vector<uint32_t> m_KeyScratch;
+        std::vector<uint32_t> m_ValueScratch;
+        std::vector<uint32_t> m_Histograms;
+        std::vector<AABB> m_BlockBounds;
+
+        // Children merged into every internal node, the second child to arrive merges the node
+        std::unique_ptr<std::atomic<uint32_t>[]> m_Visits;
+        size_t m_VisitCapacity = 0;
+
+        void SortKeys();
+        void BuildInternalNodes();
+        void ComputeLeafBoxes(const Light* lights);
+        void MergeBoxes();
+    };
+
+    /// <summary>
+    /// TiledLightCuller with the per tile light loop replaced by a LightBvh query: every tile queries its frustum
+    /// between the near plane and its max depth, and runs the light tests of the gather culler on the lights returned.
+    /// The result is the same LightCullResult, list for list, as TiledLightCuller. input.SuperTileSize is ignored.
+    /// LightTestCount counts the box tests of the queries and the light tests of the tiles.
+    /// </summary>
+    class BvhLightCuller
+    {
+    public:
+        explicit BvhLightCuller(ThreadPool& threadPool);
+
+        /// <summary>
+        /// Cull with a tree built or refitted from input.Lights
+        /// </summary>
+        void Cull(const LightCullInput& input, const LightBvh& bvh, LightCullResult& result);
+
+    private:
+        ThreadPool& m_ThreadPool;
+
+        std::vector<std::vector<uint32_t>> m_RowLightLists;
+        std::vector<std::vector<uint32_t>> m_RowTransparentLightLists;
+        std::vector<uint64_t> m_RowLightTestCounts;
+        std::vector<uint32_t> m_TileOffsets;
+    };
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Structure-of-arrays copy of the culling relevant fields of a Light array.
+    /// The 112 byte Light record is read once per frame; the culling kernels then stream
+    /// 4 / 8 lights per load from these arrays.
+    ///
+    /// Every array is padded to a multiple of `Alignment` lights, padding lanes have Kind == Disabled.
+    /// Lane i is light i of the source array, so bit i of a light mask is light index i.
+    /// </summary>
+    struct LightCullView
+    {
+        static const size_t Alignment = 8;
+
+        enum Kind : int32_t
+        {
+            Disabled = -1,
+            Directional = (int32_t)LightType::Directional,
+            Point = (int32_t)LightType::Point,
+            Spotlight = (int32_t)LightType::Spotlight,
+        };
+
+        size_t Count = 0;                   // number of source lights
+        size_t PaddedCount = 0;             // Count rounded up to Alignment
+
+        std::vector<float> PositionX;       // PositionVS, sphere center / cone tip
+        std::vector<float> PositionY;
+        std::vector<float> PositionZ;
+        std::vector<float> Radius;          // sphere radius / cone height
+        std::vector<float> DirectionX;      // DirectionVS, cone direction
+        std::vector<float> DirectionY;
+        std::vector<float> DirectionZ;
+        std::vector<float> ConeRadius;      // bottom radius of the cone
+        std::vector<float> SpotCos;         // SpotVolume::CosAngle / SinAngle
+        std::vector<float> SpotSin;
+        std::vector<float> BoundsX;         // SpotVolume::Bounds, bounding sphere of the lit volume of a spot light
+        std::vector<float> BoundsY;
+        std::vector<float> BoundsZ;
+        std::vector<float> BoundsRadius;
+        std::vector<int32_t> Type;          // Kind
+
+        /// <summary>
+        /// Gather from lights with PositionVS / DirectionVS already updated
+        /// </summary>
+        void Build(const Light* lights, size_t count);
+    };
+}
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "CullingTypes.h"
+#include "Cpu/Culling.h"
+#include "Cpu/Math.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    class DepthPyramid;
+    struct FrustumPlaneGrid;
+
+    /// <summary>
+    /// Everything CullLight.hlsl reads: the depth buffer, the frustum grid and the light array
+    /// </summary>
+    struct LightCullInput
+    {
+        const float* Depth = nullptr;           // Width * Height post-projection depth in [0, 1], top row first
+        int Width = 0;
+        int Height = 0;
+        int BlockSize = 16;                     // tile size in pixels, BLOCK_SIZE in the shaders
+
+        Float4x4 InverseProjection;
+        const Frustum* Frustums = nullptr;      // TileCountX * TileCountY frustums from ComputeFrustums()
+        const FrustumPlaneGrid* FrustumPlanes = nullptr;    // shared edge planes from ComputeFrustumPlanes(), used instead of Frustums if set
+
+        const Light* Lights = nullptr;          // lights with PositionVS / DirectionVS already updated
+        size_t LightCount = 0;
+
+        // LightCount entries from DeriveLight(), read instead of solving Light::GetRadius() and the spot volume again for
+        // every tile and light. Null derives them in every test
+        const DerivedLight* DerivedLights = nullptr;
+
+        bool UseDepthMask = false;              // 2.5D culling, USE_DEPTH_MASK in CullLight.hlsl
+        bool BuildTransparentLists = false;     // also fill the t_ lists of LightCullResult
+
+        // Unbounded (directional) lights go to LightCullResult::GlobalLightIndexList once instead of into every tile's
+        // lists, USE_GLOBAL_LIGHT_LIST in Culling.hlsli
+        bool UseGlobalLightList = false;
+
+        // Per tile light budget, MaxLightsPerTile in CullLight.hlsl: a tile list longer than this only keeps its lights of
+        // largest GetLightContribution(), see ApplyLightBudget(). 0 = keep every light.
+        int MaxLightsPerTile = 0;
+
+        // Hierarchical culling: super-tile size in pixels, a multiple of BlockSize (e.g. 64), 0 = off.
+        // Lights are first culled against every super-tile, its tiles then only test the surviving candidates.
+        int SuperTileSize = 0;
+
+        // Optional min / max pyramid of Depth: tile bounds become one fetch from its BlockSize level.
+        // Ignored if it has no such level. The depth mask still reads every pixel of the tile.
+        const DepthPyramid* Pyramid = nullptr;
+    };
+
+    /// <summary>
+    /// Same layout as o_LightGrid / o_LightIndexList and t_LightGrid / t_LightIndexList
+    /// </summary>
+    struct LightCullResult
+    {
+        int TileCountX = 0;
+        int TileCountY = 0;
+        std::vector<uint2> LightGrid;           // (offset, count) into LightIndexList, stored at tileX + tileY * TileCountX
+        std::vector<uint32_t> LightIndexList;
+
+        // Lights between the near plane and the max depth of the tile, for transparent geometry.
+        // Only filled when LightCullInput::BuildTransparentLists is set.
+        std::vector<uint2> TransparentLightGrid;
+        std::vector<uint32_t> TransparentLightIndexList;
+
+        // Enabled directional lights in ascending order, shaded by every pixel before the lights of its tile.
+        // Only filled when LightCullInput::UseGlobalLightList is set, the tile lists then hold bounded lights only.
+        std::vector<uint32_t> GlobalLightIndexList;
+
+        // Number of light-vs-volume tests, super-tiles and tiles together
+        uint64_t LightTestCount = 0;
+
+        // Opaque and transparent tile lists cut by LightCullInput::MaxLightsPerTile, and the lights cut from them
+        uint64_t TruncatedListCount = 0;
+        uint64_t DroppedLightCount = 0;
+
+        size_t TileCount() const
+        {
+            return LightGrid.size();
+        }
+    };
+
+    /// <summary>
+    /// View space depth range of a tile, the groupshared uMinDepth / uMaxDepth of CullLight.hlsl
+    /// </summary>
+    struct TileDepthBounds
+    {
+        float MinDepthVS;
+        float MaxDepthVS;
+        uint32_t DepthMask;                     // 32 cells between MinDepthVS and MaxDepthVS holding geometry
+    };
+
+    /// <summary>
+    /// Everything the light tests of one tile need, computed once per tile
+    /// </summary>
+    struct TileCullContext
+    {
+        Frustum TileFrustum;
+        TileDepthBounds Bounds;
+        float NearClipVS;
+        Plane MinPlane;                         // at Bounds.MinDepthVS, facing the camera
+        TileVolume TransparentVolume;           // near plane to Bounds.MaxDepthVS
+        TileVolume OpaqueVolume;                // Bounds.MinDepthVS to Bounds.MaxDepthVS
+        bool GlobalLightList;                   // LightCullInput::UseGlobalLightList, directional lights are not listed
+    };
+
+    // Result flags of TiledLightCuller::TestLight()
+    enum TileLightFlags : uint32_t
+    {
+        TileLightOpaque = 1,                    // the light belongs to the opaque list of the tile
+        TileLightTransparent = 2,               // the light belongs to the transparent list of the tile
+    };
+
+    /// <summary>
+    /// The lights of LightCullResult::GlobalLightIndexList: the enabled directional lights if input.UseGlobalLightList
+    /// is set, none otherwise
+    /// </summary>
+    void GatherGlobalLights(const LightCullInput& input, std::vector<uint32_t>& globalLightList);
+
+    /// <summary>
+    /// Per tile light budget of the culled lists: cut every opaque / transparent list longer than input.MaxLightsPerTile
+    /// to its input.MaxLightsPerTile lights of largest GetLightContribution() for the tile's opaque / transparent volume,
+    /// ties keep the earlier light. Kept lights stay in list order and the index lists are compacted again.
+    /// Sets result.TruncatedListCount / DroppedLightCount, both 0 if the budget is off.
+    /// </summary>
+    void ApplyLightBudget(ThreadPool& threadPool, const LightCullInput& input, LightCullResult& result);
+
+    /// <summary>
+    /// Multithreaded CPU version of CullLight.hlsl.
+    /// Tiles are spread over the thread pool one row at a time; each tile's light list is written
+    /// in ascending light index and the tiles are laid out in tile order by a count / scan / scatter pass,
+    /// so the result does not depend on the number of threads.
+    /// </summary>
+    class TiledLightCuller
+    {
+    public:
+        explicit TiledLightCuller(ThreadPool& threadPool);
+
+        void Cull(const LightCullInput& input, LightCullResult& result);
+
+        /// <summary>
+        /// Min / max depth of one tile converted to view space, and the depth mask if input.UseDepthMask is set
+        /// (all cells set otherwise). Min / max are read from input.Pyramid if it has a level for the block size. Pixels outside the screen read as depth 0, same as Texture2D::Load() out of bounds.
+        /// </summary>
+        static TileDepthBounds ComputeTileDepthBounds(const LightCullInput& input, int tileX, int tileY);
+
+        /// <summary>
+        /// Frustum of a tile from input.FrustumPlanes if set, input.Frustums otherwise
+        /// </summary>
+        static Frustum GetTileFrustum(const LightCullInput& input, int tileX, int tileY);
+
+        static TileCullContext GetTileCullContext(const LightCullInput& input, const Frustum& frustum, const TileDepthBounds& bounds);
+
+        /// <summary>
+        /// The light tests of CullLight.hlsl for one light and tile, a combination of TileLightFlags.
+        /// `derived` is DeriveLight() of the light, derived in place if null
+        /// </summary>
+        static uint32_t TestLight(const TileCullContext& context, const Light& light, const DerivedLight* derived = nullptr);
+
+        /// <summary>
+        /// Append the lights touching the opaque geometry of a tile to `lightList`, and the lights
+        /// in front of it to `transparentLightList` if given. Both share the near-to-max-depth frustum test.
+        /// </summary>
+        static void CullTile(const LightCullInput& input, int tileX, int tileY, std::vector<uint32_t>& lightList,
+            std::vector<uint32_t>* transparentLightList = nullptr);
+
+        /// <summary>
+        /// CullTile() restricted to `candidates`, given in ascending light order, with the depth bounds already known
+        /// </summary>
+        static void CullTile(const LightCullInput& input, int tileX, int tileY, const TileDepthBounds& bounds,
+            const uint32_t* candidates, size_t candidateCount, std::vector<uint32_t>& lightList,
+            std::vector<uint32_t>* transparentLightList = nullptr);
+
+        /// <summary>
+        /// Coarse pass of hierarchical culling: the lights that may touch any tile of a super-tile,
+        /// i.e. the lights inside its frustum between the near plane and `maxDepthVS`, the max depth of its tiles.
+        /// The fine pass can only drop lights the coarse pass rejects, since the tile volumes lie inside the super-tile volume.
+        /// </summary>
+        static void CullSuperTile(const LightCullInput& input, int superTileX, int superTileY, float maxDepthVS,
+            std::vector<uint32_t>& candidates);
+
+    private:
+        ThreadPool& m_ThreadPool;
+
+        // One list per tile row, compacted in tile order by CompactRowLists() once all rows are culled
+        std::vector<std::vector<uint32_t>> m_RowLightLists;
+        std::vector<std::vector<uint32_t>> m_RowTransparentLightLists;
+        std::vector<uint64_t> m_RowLightTestCounts;
+        std::vector<uint32_t> m_TileOffsets;
+
+        void CullRows(const LightCullInput& input, LightCullResult& result);
+        void CullSuperTileRows(const LightCullInput& input, LightCullResult& result);
+    };
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// offsets[i] = values[0] + ... + values[i - 1], returns the sum of all values.
+    /// Blocks of the input are summed in parallel, the block sums scanned serially and the blocks
+    /// then scanned in parallel from their offset, so the result does not depend on the number of threads.
+    /// `offsets` may alias `values`.
+    /// </summary>
+    uint32_t ExclusiveScan(ThreadPool& threadPool, const uint32_t* values, size_t count, uint32_t* offsets);
+
+    /// <summary>
+    /// Deterministic compaction of per-row light lists into one index list, the CPU version of
+    /// ScanLightGrid.hlsl + ScatterLightLists.hlsl:
+    ///   1. count:   the light count of every tile, grid[tile].y
+    ///   2. scan:    exclusive scan of the counts gives the offset of every tile
+    ///   3. scatter: every row copies its tiles to their offsets, in parallel
+    /// On input grid[tile].x is the offset of the tile in rowLists[tileY], on output the offset in indexList.
+    /// Tiles are laid out in tile order whatever the number of threads. `offsets` is scratch memory.
+    /// </summary>
+    void CompactRowLists(ThreadPool& threadPool, const std::vector<std::vector<uint32_t>>& rowLists, int tileCountX,
+        std::vector<uint2>& grid, std::vector<uint32_t>& indexList, std::vector<uint32_t>& offsets);
+}
+}
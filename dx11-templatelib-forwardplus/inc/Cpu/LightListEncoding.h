@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Math.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Storage of the light list of every tile
+    /// </summary>
+    enum class LightListEncoding
+    {
+        Uint32,     // one 32 bit index per light, the layout of o_LightIndexList
+        Uint16,     // two 16 bit indices per word, for up to 65536 lights
+        Bitmask,    // one bit per scene light in every tile, no light grid
+        Count
+    };
+
+    const char* GetLightListEncodingName(LightListEncoding encoding);
+
+    /// <summary>
+    /// Can `encoding` store the indices of `lightCount` lights
+    /// </summary>
+    bool CanEncodeLightCount(LightListEncoding encoding, size_t lightCount);
+
+    /// <summary>
+    /// Light lists of all tiles in one of the LightListEncoding layouts, as 32 bit words so the same data
+    /// can be bound as a StructuredBuffer<uint>.
+    ///   Uint32:  LightGrid[tile] = (offset, count) in indices, index i of the tile is Words[offset + i]
+    ///   Uint16:  LightGrid[tile] = (offset, count) in 16 bit indices, index i is the low (even) or high (odd) half of
+    ///            Words[(offset + i) / 2]. Tiles are packed back to back and may start in the middle of a word,
+    ///            tile rows start on a word so rows are written in parallel.
+    ///   Bitmask: no LightGrid, bit l of Words[tile * WordsPerTile + l / 32] is set if light l touches the tile.
+    ///            Lights are visited in ascending index, same as the lists of TiledLightCuller.
+    /// </summary>
+    struct EncodedLightLists
+    {
+        LightListEncoding Encoding = LightListEncoding::Uint32;
+        int TileCountX = 0;
+        int TileCountY = 0;
+        size_t LightCount = 0;
+        size_t WordsPerTile = 0;                // Bitmask only
+        std::vector<uint2> LightGrid;
+        std::vector<uint32_t> Words;
+
+        size_t TileCount() const
+        {
+            return static_cast<size_t>(TileCountX) * TileCountY;
+        }
+
+        size_t MemoryBytes() const
+        {
+            return LightGrid.size() * sizeof(uint2) + Words.size() * sizeof(uint32_t);
+        }
+
+        /// <summary>
+        /// Bytes the shading of one pixel of a tile reads: its grid entry and the words holding its indices,
+        /// or the whole mask of the tile
+        /// </summary>
+        size_t TileReadBytes(size_t tileIndex) const;
+
+        /// <summary>
+        /// Call func(lightIndex) for every light of a tile, in ascending light index
+        /// </summary>
+        template<class Func>
+        void ForEachLight(size_t tileIndex, Func&& func) const
+        {
+            switch (Encoding)
+            {
+            case LightListEncoding::Uint32:
+            {
+                const uint2& tile = LightGrid[tileIndex];
+                const uint32_t* indices = Words.data() + tile.x;
+                for (uint32_t i = 0; i < tile.y; ++i)
+                {
+                    func(indices[i]);
+                }
+                break;
+            }
+
+            case LightListEncoding::Uint16:
+            {
+                const uint2& tile = LightGrid[tileIndex];
+                for (uint32_t i = tile.x; i < tile.x + tile.y; ++i)
+                {
+                    func((Words[i / 2] >> (i % 2 * 16)) & 0xFFFF);
+                }
+                break;
+            }
+
+            case LightListEncoding::Bitmask:
+            {
+                const uint32_t* mask = Words.data() + tileIndex * WordsPerTile;
+                for (size_t word = 0; word < WordsPerTile; ++word)
+                {
+                    uint32_t bits = mask[word];
+                    while (bits)
+                    {
+                        uint32_t bit = FirstBitLow(bits);
+                        bits &= bits - 1;
+                        func(static_cast<uint32_t>(word * 32 + bit));
+                    }
+                }
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+    };
+
+    /// <summary>
+    /// Encode the (grid, index list) pair of LightCullResult, one tile row per task.
+    /// Returns false and leaves `result` empty if `encoding` cannot store `lightCount` lights.
+    /// </summary>
+    bool EncodeLightLists(ThreadPool& threadPool, const std::vector<uint2>& grid, const std::vector<uint32_t>& indexList,
+        int tileCountX, int tileCountY, size_t lightCount, LightListEncoding encoding, EncodedLightLists& result);
+
+    /// <summary>
+    /// Encode the opaque light lists of a culling result
+    /// </summary>
+    bool EncodeLightLists(ThreadPool& threadPool, const LightCullResult& lists, size_t lightCount, LightListEncoding encoding,
+        EncodedLightLists& result);
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/Culling.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/LightCullView.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Implementations of the light-vs-tile test.
+    /// Sse / Avx2 test 4 / 8 lights of a LightCullView per instruction and are only available on x86.
+    /// </summary>
+    enum class CullKernel
+    {
+        Scalar,
+        Sse,
+        Avx2,
+        NumCullKernel
+    };
+
+    const char* GetCullKernelName(CullKernel kernel);
+
+    /// <summary>
+    /// True if the kernel is compiled in and the running CPU supports it
+    /// </summary>
+    bool IsCullKernelSupported(CullKernel kernel);
+
+    /// <summary>
+    /// The widest supported kernel
+    /// </summary>
+    CullKernel GetBestCullKernel();
+
+    /// <summary>
+    /// Everything a kernel needs to know about one tile
+    /// </summary>
+    struct TileCullBounds
+    {
+        Frustum TileFrustum;        // left, right, top, bottom planes
+        float NearVS;               // near clip plane
+        float MinDepthVS;           // min depth of the opaque geometry in the tile
+        float MaxDepthVS;           // max depth of the opaque geometry in the tile
+
+        TileVolume TransparentVolume;   // NearVS .. MaxDepthVS, for the spot lights
+        TileVolume OpaqueVolume;        // MinDepthVS .. MaxDepthVS
+    };
+
+    inline size_t GetLightMaskWordCount(size_t lightCount)
+    {
+        return (lightCount + 63) / 64;
+    }
+
+    /// <summary>
+    /// Set bit i of `mask` if light i of `view` touches the tile, same test as TiledLightCuller::CullTile().
+    /// `mask` holds GetLightMaskWordCount(view.Count) words and is overwritten.
+    /// </summary>
+    void CullTileLightMask(CullKernel kernel, const LightCullView& view, const TileCullBounds& bounds, uint64_t* mask);
+
+    /// <summary>
+    /// Append the indices of the set bits of `mask`, in ascending order
+    /// </summary>
+    void AppendLightMask(const uint64_t* mask, size_t wordCount, std::vector<uint32_t>& lightList);
+
+    /// <summary>
+    /// One light bitmask per tile, stored at tileX + tileY * TileCountX
+    /// </summary>
+    struct LightMaskResult
+    {
+        int TileCountX = 0;
+        int TileCountY = 0;
+        size_t WordsPerTile = 0;
+        std::vector<uint64_t> Masks;
+
+        size_t TileCount() const
+        {
+            return static_cast<size_t>(TileCountX) * TileCountY;
+        }
+
+        const uint64_t* TileMask(size_t tileIndex) const
+        {
+            return Masks.data() + tileIndex * WordsPerTile;
+        }
+    };
+
+    /// <summary>
+    /// Multithreaded tiled light culling writing a light bitmask per tile instead of a light index list.
+    /// Uses the same frustum grid and tile depth bounds as TiledLightCuller.
+    /// </summary>
+    class LightMaskCuller
+    {
+    public:
+        explicit LightMaskCuller(ThreadPool& threadPool);
+
+        /// <summary>
+        /// `input.Lights` is ignored, the lights are read from `view`
+        /// </summary>
+        void Cull(const LightCullInput& input, const LightCullView& view, CullKernel kernel, LightMaskResult& result);
+
+    private:
+        ThreadPool& m_ThreadPool;
+    };
+}
+}
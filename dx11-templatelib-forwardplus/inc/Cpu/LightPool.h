@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Growable CPU copy of the scene lights, mirrored by a structured buffer on the GPU.
+    ///
+    /// Lights are stored densely so the GPU buffer is a plain array of LightCount records.
+    /// A handle returned by Add stays valid until Remove; the slot of a light may change when another
+    /// light is removed (the last light is moved into the hole).
+    ///
+    /// Every write marks the page of DirtyPageSize slots holding it dirty. GetDirtyRanges() coalesces the dirty pages
+    /// into a few ranges of slots, which is what the renderer uploads (one box each) before clearing them with ClearDirty.
+    /// </summary>
+    class LightPool
+    {
+    public:
+        typedef uint32_t Handle;
+        static const Handle InvalidHandle = 0xffffffffu;
+
+        // Slots per dirty page, 16 * 112 bytes
+        static const size_t DirtyPageSize = 16;
+
+        // Most ranges GetDirtyRanges() returns by default, i.e. UpdateSubresource calls per frame
+        static const size_t DefaultMaxDirtyRanges = 256;
+
+        /// <summary>
+        /// Dirty slots [Begin, End)
+        /// </summary>
+        struct DirtyRange
+        {
+            size_t Begin;
+            size_t End;
+        };
+
+        Handle Add(const Light& light);
+        void Remove(Handle handle);
+        void Update(Handle handle, const Light& light);
+        void Clear();
+        void Reserve(size_t capacity);
+
+        bool Contains(Handle handle) const;
+        size_t GetSlot(Handle handle) const;
+        Handle GetHandle(size_t slot) const;
+
+        size_t Count() const { return m_Lights.size(); }
+        bool Empty() const { return m_Lights.empty(); }
+        const Light* Data() const { return m_Lights.data(); }
+        const Light& operator[](size_t slot) const { return m_Lights[slot]; }
+        std::vector<Light>::const_iterator begin() const { return m_Lights.begin(); }
+        std::vector<Light>::const_iterator end() const { return m_Lights.end(); }
+
+        /// <summary>
+        /// Writable access to a slot, marks it dirty
+        /// </summary>
+        Light& Edit(size_t slot);
+
+        /// <summary>
+        /// Writable access to the slots [begin, end), marks them dirty
+        /// </summary>
+        Light* Edit(size_t begin, size_t end);
+
+        void MarkDirty(size_t begin, size_t end);
+        void MarkAllDirty() { MarkDirty(0, m_Lights.size()); }
+        void ClearDirty();
+
+        bool IsDirty() const { return m_DirtyPageCount > 0; }
+
+        /// <summary>
+        /// The dirty pages as ascending, disjoint ranges of slots, clipped to Count(). Runs of dirty pages become one range;
+        /// if there are more than `maxRangeCount` runs, the runs separated by the fewest clean slots are merged until they fit.
+        /// `ranges` is overwritten.
+        /// </summary>
+        void GetDirtyRanges(std::vector<DirtyRange>& ranges, size_t maxRangeCount = DefaultMaxDirtyRanges) const;
+
+        /// <summary>
+        /// Bytes covered by `ranges`
+        /// </summary>
+        static size_t GetDirtyBytes(const std::vector<DirtyRange>& ranges);
+
+    private:
+        std::vector<Light> m_Lights;
+        std::vector<Handle> m_SlotHandles;      // slot -> handle
+        std::vector<uint32_t> m_HandleSlots;    // handle -> slot, InvalidHandle if free
+        std::vector<Handle> m_FreeHandles;
+
+        std::vector<uint64_t> m_DirtyPages;     // one bit per page
+        size_t m_DirtyPageCount = 0;
+
+        void ClearPagesFrom(size_t firstPage);
+    };
+}
+}
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/Math.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    // C++ versions of assets/Shaders/Lighting.hlsli, the Phong lighting of the Forward, Deferred and Forward+ shaders.
+    // Keep both sides in sync: these are the golden reference for the pixel shaders and the vector kernels below.
+    //
+    // The functions are written statement for statement like the HLSL, including its quirks: the spot cone is
+    // evaluated with -normalize(L) as in DoSpotLightWS(), and the view space variants use normalize(P) as the view vector.
+
+    struct LightingResult
+    {
+        Float3 Diffuse;
+        Float3 Specular;
+    };
+
+    inline Float3 Reflect(const Float3& i, const Float3& n)
+    {
+        return i - n * (2.0f * Dot(i, n));
+    }
+
+    inline float Saturate(float x)
+    {
+        return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+    }
+
+    inline float SmoothStep(float minValue, float maxValue, float x)
+    {
+        float t = Saturate((x - minValue) / (maxValue - minValue));
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    inline Float3 DoDiffuse(const Light& light, const Float3& L, const Float3& N)
+    {
+        float NdotL = std::fmax(0.0f, Dot(N, L));
+        return light.Color.xyz() * NdotL;
+    }
+
+    inline Float3 DoSpecular(const Light& light, const Float3& V, const Float3& L, const Float3& N, float specularPower)
+    {
+        // Phong lighting.
+        Float3 R = Normalize(Reflect(-L, N));
+        float RdotV = std::fmax(0.0f, Dot(R, V));
+
+        return light.Color.xyz() * std::pow(RdotV, specularPower);
+    }
+
+    inline float DoAttenuation(const Light& light, float d)
+    {
+        return 1.0f / (light.ConstantAttenuation + light.LinearAttenuation * d + light.QuadraticAttenuation * d * d);
+    }
+
+    inline float DoSpotCone(const Light& light, const Float3& direction, const Float3& L)
+    {
+        float minCos = std::cos(light.SpotAngle);
+        float maxCos = (minCos + 1.0f) / 2.0f;
+        float cosAngle = Dot(direction, -L);
+        return SmoothStep(minCos, maxCos, cosAngle);
+    }
+
+    inline float DoSpotConeWS(const Light& light, const Float3& L)
+    {
+        return DoSpotCone(light, light.DirectionWS.xyz(), L);
+    }
+
+    inline float DoSpotConeVS(const Light& light, const Float3& L)
+    {
+        return DoSpotCone(light, light.DirectionVS.xyz(), L);
+    }
+
+    inline LightingResult DoDirectionalLight(const Light& light, const Float3& V, const Float3& N, float specularPower, const Float3& L)
+    {
+        LightingResult result;
+        result.Diffuse = DoDiffuse(light, L, N);
+        result.Specular = DoSpecular(light, V, L, N, specularPower);
+        return result;
+    }
+
+    inline LightingResult DoPointLight(const Light& light, const Float3& V, const Float3& N, float specularPower, Float3 L)
+    {
+        float distance = Length(L);
+        L = L / distance;
+
+        float attenuation = DoAttenuation(light, distance);
+
+        LightingResult result;
+        result.Diffuse = DoDiffuse(light, L, N) * attenuation;
+        result.Specular = DoSpecular(light, V, L, N, specularPower) * attenuation;
+        return result;
+    }
+
+    inline LightingResult DoSpotLight(const Light& light, const Float3& V, const Float3& N, float specularPower, Float3 L, float spotIntensity)
+    {
+        float distance = Length(L);
+        L = L / distance;
+
+        float attenuation = DoAttenuation(light, distance);
+
+        LightingResult result;
+        result.Diffuse = DoDiffuse(light, L, N) * attenuation * spotIntensity;
+        result.Specular = DoSpecular(light, V, L, N, specularPower) * attenuation * spotIntensity;
+        return result;
+    }
+
+    /// <summary>
+    /// One light in world space (PositionWS / DirectionWS) or view space (PositionVS / DirectionVS), scaled by its strength,
+    /// the body of the light loop of ComputeLightingWS() / ComputeLightingVS()
+    /// </summary>
+    inline LightingResult ComputeLight(const Light& light, bool viewSpace, const Float3& V, const Float3& P, const Float3& N, float specularPower)
+    {
+        LightingResult result;
+        if (!light.Enabled)
+        {
+            return result;
+        }
+
+        const Vector4& position = viewSpace ? light.PositionVS : light.PositionWS;
+        const Vector4& direction = viewSpace ? light.DirectionVS : light.DirectionWS;
+
+        switch (static_cast<LightType>(light.LightType))
+        {
+        case LightType::Directional:
+            result = DoDirectionalLight(light, V, N, specularPower, Normalize(direction.xyz()));
+            break;
+        case LightType::Point:
+            result = DoPointLight(light, V, N, specularPower, position.xyz() - P);
+            break;
+        case LightType::Spotlight:
+        {
+            Float3 L = position.xyz() - P;
+            float spotIntensity = DoSpotCone(light, direction.xyz(), -Normalize(L));
+            result = DoSpotLight(light, V, N, specularPower, L, spotIntensity);
+        }
+        break;
+        default:
+            break;
+        }
+
+        result.Diffuse = result.Diffuse * light.Strength;
+        result.Specular = result.Specular * light.Strength;
+        return result;
+    }
+
+    /// <summary>
+    /// ComputeLightingWS() over `lightCount` lights, or over the lights at `indices` if it is not null
+    /// </summary>
+    inline LightingResult ComputeLightingWS(const Light* lights, const uint32_t* indices, size_t lightCount,
+        const Float3& positionWS, const Float3& normalWS, float specularPower, const Float3& eyePosition)
+    {
+        Float3 view = Normalize(eyePosition - positionWS);
+
+        LightingResult totalResult;
+        for (size_t i = 0; i < lightCount; ++i)
+        {
+            LightingResult result = ComputeLight(lights[indices ? indices[i] : i], false, view, positionWS, normalWS, specularPower);
+            totalResult.Diffuse = totalResult.Diffuse + result.Diffuse;
+            totalResult.Specular = totalResult.Specular + result.Specular;
+        }
+        return totalResult;
+    }
+
+    /// <summary>
+    /// ComputeLightingVS() over `lightCount` lights, or over the lights at `indices` if it is not null
+    /// </summary>
+    inline LightingResult ComputeLightingVS(const Light* lights, const uint32_t* indices, size_t lightCount,
+        const Float3& positionVS, const Float3& normalVS, float specularPower)
+    {
+        Float3 view = Normalize(positionVS);
+
+        LightingResult totalResult;
+        for (size_t i = 0; i < lightCount; ++i)
+        {
+            LightingResult result = ComputeLight(lights[indices ? indices[i] : i], true, view, positionVS, normalVS, specularPower);
+            totalResult.Diffuse = totalResult.Diffuse + result.Diffuse;
+            totalResult.Specular = totalResult.Specular + result.Specular;
+        }
+        return totalResult;
+    }
+
+    // Batched shading: many pixels against one light list, SoA in and out, with the Scalar / Sse / Avx2 kernels of
+    // LightMaskCuller.h. Sse shades 8 pixels per step (two registers of 4), Avx2 16 (two of 8).
+    // The vector kernels use their own pow() (exp2 / log2 polynomials, about 1e-6 relative error) and fold the light
+    // strength into its color up front, so they match the functions above within float rounding, not bit for bit.
+
+    enum class ShadingSpace
+    {
+        World,      // PositionWS / DirectionWS, V = normalize(eye - P)
+        View        // PositionVS / DirectionVS, V = normalize(P) as ComputeLightingVS()
+    };
+
+    /// <summary>
+    /// A light as the batched kernels read it, see PrepareShadingLights()
+    /// </summary>
+    struct ShadingLight
+    {
+        Float3 Position;
+        Float3 Direction;           // normalized for directional lights, as stored for spot lights (DoSpotCone() does not normalize)
+        Float3 Color;               // Color * Strength
+        float ConstantAttenuation;
+        float LinearAttenuation;
+        float QuadraticAttenuation;
+        float MinCos;               // cos(SpotAngle)
+        float MaxCos;               // (MinCos + 1) / 2
+        int LightType;
+    };
+
+    /// <summary>
+    /// The enabled lights of `lights` (or of the lights at `indices` if it is not null) in `space`, in order.
+    /// The spot cosines are read from `derivedLights`, indexed like `lights`, if it is not null.
+    /// `result` is overwritten.
+    /// </summary>
+    void PrepareShadingLights(const Light* lights, const uint32_t* indices, size_t lightCount, ShadingSpace space,
+        std::vector<ShadingLight>& result, const DerivedLight* derivedLights = nullptr);
+
+    /// <summary>
+    /// G-buffer like input of the batched kernels, one array per component, `Count` entries each
+    /// </summary>
+    struct ShadingSurfaces
+    {
+        size_t Count = 0;
+        const float* PositionX = nullptr;
+        const float* PositionY = nullptr;
+        const float* PositionZ = nullptr;
+        const float* NormalX = nullptr;     // normalized
+        const float* NormalY = nullptr;
+        const float* NormalZ = nullptr;
+        const float* SpecularPower = nullptr;
+    };
+
+    /// <summary>
+    /// Output of the batched kernels, LightingResult as one array per channel, `Count` entries each
+    /// </summary>
+    struct ShadingOutput
+    {
+        float* DiffuseR = nullptr;
+        float* DiffuseG = nullptr;
+        float* DiffuseB = nullptr;
+        float* SpecularR = nullptr;
+        float* SpecularG = nullptr;
+        float* SpecularB = nullptr;
+    };
+
+    /// <summary>
+    /// ComputeLightingWS() / ComputeLightingVS() of every surface against all `lightCount` lights.
+    /// `eyePosition` is only read in world space. Unsupported kernels fall back to Scalar.
+    /// </summary>
+    void ComputeLighting(CullKernel kernel, const ShadingLight* lights, size_t lightCount, ShadingSpace space,
+        const Float3& eyePosition, const ShadingSurfaces& surfaces, const ShadingOutput& output);
+}
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Yr
+{
+namespace Cpu
+{
+    // Minimal vector / matrix types for the platform-independent code path.
+    // Matrices follow the DirectXMath convention: row-major storage and row vectors (v' = v * M),
+    // so a DirectX::SimpleMath::Matrix can be copied in with memcpy.
+
+    struct Float2
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+
+        Float2() = default;
+        constexpr Float2(float _x, float _y) : x(_x), y(_y) {}
+    };
+
+    struct Float3
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+
+        Float3() = default;
+        constexpr Float3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+
+        Float3 operator+(const Float3& v) const { return Float3(x + v.x, y + v.y, z + v.z); }
+        Float3 operator-(const Float3& v) const { return Float3(x - v.x, y - v.y, z - v.z); }
+        Float3 operator-() const { return Float3(-x, -y, -z); }
+        Float3 operator*(float s) const { return Float3(x * s, y * s, z * s); }
+        Float3 operator/(float s) const { return Float3(x / s, y / s, z / s); }
+    };
+
+    struct Float4
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float w = 0.0f;
+
+        Float4() = default;
+        constexpr Float4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+        constexpr Float4(const Float3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
+
+        Float3 xyz() const { return Float3(x, y, z); }
+
+        Float4 operator+(const Float4& v) const { return Float4(x + v.x, y + v.y, z + v.z, w + v.w); }
+        Float4 operator-(const Float4& v) const { return Float4(x - v.x, y - v.y, z - v.z, w - v.w); }
+        Float4 operator*(float s) const { return Float4(x * s, y * s, z * s, w * s); }
+        Float4 operator/(float s) const { return Float4(x / s, y / s, z / s, w / s); }
+    };
+
+    struct Float4x4
+    {
+        float m[4][4] = {
+            { 1, 0, 0, 0 },
+            { 0, 1, 0, 0 },
+            { 0, 0, 1, 0 },
+            { 0, 0, 0, 1 },
+        };
+
+        /// <summary>
+        /// Copy from 16 row-major floats, e.g. a DirectX::SimpleMath::Matrix
+        /// </summary>
+        static Float4x4 FromRowMajor(const float* data)
+        {
+            Float4x4 result;
+            std::memcpy(result.m, data, sizeof(result.m));
+            return result;
+        }
+    };
+
+    constexpr float Pi = 3.14159265358979323846f;
+
+    inline float Radians(float degrees)
+    {
+        return degrees * (Pi / 180.0f);
+    }
+
+    // Index of the lowest set bit, firstbitlow() in HLSL. `bits` must not be 0.
+    inline uint32_t FirstBitLow(uint32_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, bits);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+    }
+
+    inline uint32_t FirstBitLow(uint64_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+    }
+
+    // Index of the highest set bit, firstbithigh() in HLSL. `bits` must not be 0.
+    inline uint32_t FirstBitHigh(uint32_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, bits);
+        return index;
+#else
+        return 31 - static_cast<uint32_t>(__builtin_clz(bits));
+#endif
+    }
+
+    inline uint32_t FirstBitHigh(uint64_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, bits);
+        return index;
+#else
+        return 63 - static_cast<uint32_t>(__builtin_clzll(bits));
+#endif
+    }
+
+    inline float Dot(const Float3& a, const Float3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    inline Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return Float3(
+            a.y * b.z - a.z * b.y,
+            a.z * b.x - a.x * b.z,
+            a.x * b.y - a.y * b.x
+        );
+    }
+
+    inline float Length(const Float3& v)
+    {
+        return std::sqrt(Dot(v, v));
+    }
+
+    inline Float3 Normalize(const Float3& v)
+    {
+        return v / Length(v);
+    }
+
+    /// <summary>
+    /// Row vector times matrix, same as XMVector4Transform / HLSL mul(M, v) on a non-transposed upload
+    /// </summary>
+    inline Float4 Transform(const Float4& v, const Float4x4& M)
+    {
+        return Float4(
+            v.x * M.m[0][0] + v.y * M.m[1][0] + v.z * M.m[2][0] + v.w * M.m[3][0],
+            v.x * M.m[0][1] + v.y * M.m[1][1] + v.z * M.m[2][1] + v.w * M.m[3][1],
+            v.x * M.m[0][2] + v.y * M.m[1][2] + v.z * M.m[2][2] + v.w * M.m[3][2],
+            v.x * M.m[0][3] + v.y * M.m[1][3] + v.z * M.m[2][3] + v.w * M.m[3][3]
+        );
+    }
+
+    inline Float3 TransformPoint(const Float3& p, const Float4x4& M)
+    {
+        return Transform(Float4(p, 1.0f), M).xyz();
+    }
+
+    inline Float3 TransformNormal(const Float3& n, const Float4x4& M)
+    {
+        return Transform(Float4(n, 0.0f), M).xyz();
+    }
+
+    inline Float4x4 Multiply(const Float4x4& a, const Float4x4& b)
+    {
+        Float4x4 result;
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+            }
+        }
+        return result;
+    }
+
+    inline Float4x4 Transpose(const Float4x4& M)
+    {
+        Float4x4 result;
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                result.m[r][c] = M.m[c][r];
+            }
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// General 4x4 inverse (cofactor expansion), returns identity for singular matrices
+    /// </summary>
+    inline Float4x4 Inverse(const Float4x4& M)
+    {
+        const float* a = &M.m[0][0];
+        float inv[16];
+
+        inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+        inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+        inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+        inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+        inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+        inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+        inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+        inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+        inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+        inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+        inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+        inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+        inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+        inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+        inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+        inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+        float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+        if (det == 0.0f)
+        {
+            return Float4x4();
+        }
+
+        Float4x4 result;
+        float invDet = 1.0f / det;
+        for (int i = 0; i < 16; ++i)
+        {
+            (&result.m[0][0])[i] = inv[i] * invDet;
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// Same as XMMatrixPerspectiveFovLH
+    /// </summary>
+    inline Float4x4 PerspectiveFovLH(float fovY, float aspectRatio, float zNear, float zFar)
+    {
+        float height = 1.0f / std::tan(fovY * 0.5f);
+        float width = height / aspectRatio;
+        float range = zFar / (zFar - zNear);
+
+        Float4x4 result;
+        result.m[0][0] = width;
+        result.m[1][1] = height;
+        result.m[2][2] = range;
+        result.m[2][3] = 1.0f;
+        result.m[3][2] = -range * zNear;
+        result.m[3][3] = 0.0f;
+        return result;
+    }
+
+    /// <summary>
+    /// Same as XMMatrixLookAtLH
+    /// </summary>
+    inline Float4x4 LookAtLH(const Float3& eye, const Float3& focus, const Float3& up)
+    {
+        Float3 zAxis = Normalize(focus - eye);
+        Float3 xAxis = Normalize(Cross(up, zAxis));
+        Float3 yAxis = Cross(zAxis, xAxis);
+
+        Float4x4 result;
+        result.m[0][0] = xAxis.x; result.m[0][1] = yAxis.x; result.m[0][2] = zAxis.x; result.m[0][3] = 0.0f;
+        result.m[1][0] = xAxis.y; result.m[1][1] = yAxis.y; result.m[1][2] = zAxis.y; result.m[1][3] = 0.0f;
+        result.m[2][0] = xAxis.z; result.m[2][1] = yAxis.z; result.m[2][2] = zAxis.z; result.m[2][3] = 0.0f;
+        result.m[3][0] = -Dot(xAxis, eye);
+        result.m[3][1] = -Dot(yAxis, eye);
+        result.m[3][2] = -Dot(zAxis, eye);
+        result.m[3][3] = 1.0f;
+        return result;
+    }
+}
+}
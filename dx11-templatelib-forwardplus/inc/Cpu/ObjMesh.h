@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "Cpu/SoftwareRasterizer.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Read the faces of a Wavefront OBJ file (v, vn, vt and f records, the rest is skipped) into a triangle list the way
+    /// Model::Load() does with tinyobjloader, so the assets can be drawn without it: polygons are fan triangulated,
+    /// vertices are not shared and missing normals / texture coordinates are zero.
+    /// Returns false if the file cannot be read or references a missing vertex; `vertices` is overwritten.
+    /// </summary>
+    bool LoadObjMesh(const char* path, std::vector<MeshVertex>& vertices);
+}
+}
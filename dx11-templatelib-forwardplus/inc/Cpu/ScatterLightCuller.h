@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Math.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Inclusive range of tiles, empty if MinX > MaxX or MinY > MaxY
+    /// </summary>
+    struct TileRect
+    {
+        int MinX = 0;
+        int MinY = 0;
+        int MaxX = -1;
+        int MaxY = -1;
+
+        bool Empty() const
+        {
+            return MinX > MaxX || MinY > MaxY;
+        }
+
+        size_t TileCount() const
+        {
+            return Empty() ? 0 : static_cast<size_t>(MaxX - MinX + 1) * (MaxY - MinY + 1);
+        }
+    };
+
+    /// <summary>
+    /// Scatter version of TiledLightCuller: instead of every tile testing every light, every light is projected to a
+    /// conservative screen rectangle and only tests the tiles under it, O(lights * covered tiles) instead of O(tiles * lights).
+    ///
+    /// The tiles under the rectangle run the light tests of the gather culler (TiledLightCuller::TestLight()), so
+    /// the result is the same LightCullResult, list for list, with every list in ascending light index.
+    /// Lights are culled in parallel, in fixed chunks; the (tile, light) pairs are then counted, scanned, scattered
+    /// to their tiles and every tile list sorted, so the result does not depend on the number of threads.
+    /// input.SuperTileSize is ignored, the rectangles already skip the tiles hierarchical culling would.
+    /// </summary>
+    class ScatterLightCuller
+    {
+    public:
+        explicit ScatterLightCuller(ThreadPool& threadPool);
+
+        void Cull(const LightCullInput& input, LightCullResult& result);
+
+        /// <summary>
+        /// Tiles covered by the screen projection of a sphere in view space, from the two tangent planes through the eye
+        /// along x and y. The whole screen if the sphere reaches in front of `nearClipVS`.
+        /// `projection` is the inverse of input.InverseProjection, a perspective projection with w = z.
+        /// </summary>
+        static TileRect GetSphereTileRect(const LightCullInput& input, const Float4x4& projection, float nearClipVS, const Sphere& sphere);
+
+        /// <summary>
+        /// Tiles that may list a light: the rectangle of a sphere around everything the light tests accept, the whole
+        /// screen for directional lights (none with input.UseGlobalLightList), none if the light is off or entirely outside
+        /// [nearClipVS, farDepthVS]
+        /// </summary>
+        static TileRect GetLightTileRect(const LightCullInput& input, const Float4x4& projection, float nearClipVS, float farDepthVS,
+            const Light& light);
+
+        /// <summary>
+        /// Test volumes of every tile and the deepest tile of the last Cull()
+        /// </summary>
+        const std::vector<TileCullContext>& GetTileContexts() const { return m_Tiles; }
+        float GetFarDepthVS() const { return m_FarDepthVS; }
+
+    private:
+        // A light accepted by a tile, TileLightFlags tell which of its lists
+        struct TileLight
+        {
+            uint32_t Tile;
+            uint32_t Light;
+            uint32_t Flags;
+        };
+
+        ThreadPool& m_ThreadPool;
+
+        std::vector<TileCullContext> m_Tiles;
+        std::vector<float> m_RowMaxDepths;
+        float m_FarDepthVS = 0.0f;
+        std::vector<std::vector<TileLight>> m_ChunkPairs;   // pairs of every chunk of ChunkSize lights
+        std::vector<uint64_t> m_ChunkTestCounts;
+
+        // Per tile counters, the opaque lists then the transparent lists; counts, then scatter cursors
+        std::unique_ptr<std::atomic<uint32_t>[]> m_Counters;
+        size_t m_CounterCapacity = 0;
+        std::vector<uint32_t> m_Offsets;
+
+        void BuildLists(size_t tileCount, int listIndex, std::vector<uint2>& grid, std::vector<uint32_t>& indexList);
+    };
+}
+}
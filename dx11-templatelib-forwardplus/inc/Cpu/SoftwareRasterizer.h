@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Cpu/Lighting.h"
+#include "Cpu/Math.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Same layout as VertexData in Model.h, so Model::Head() can be drawn as is
+    /// </summary>
+    struct MeshVertex
+    {
+        float Position[3];
+        float Normal[3];
+        float TexCoord[2];
+    };
+
+    /// <summary>
+    /// One entity: a non indexed triangle list in object space, as Model stores it
+    /// </summary>
+    struct RasterDraw
+    {
+        const MeshVertex* Vertices = nullptr;
+        size_t VertexCount = 0;
+        Float4x4 World;
+        uint32_t MaterialIndex = 0;
+    };
+
+    enum class RasterCullMode
+    {
+        None,
+        Back,       // D3D11_CULL_BACK with FrontCounterClockwise = FALSE: triangles clockwise on screen are drawn
+    };
+
+    enum class DepthTest
+    {
+        Less,       // D3D11_COMPARISON_LESS, the depth pre-pass and the passes without one
+        LessEqual   // D3D11_COMPARISON_LESS_EQUAL, shading on top of a depth pre-pass
+    };
+
+    struct RasterInput
+    {
+        int Width = 0;
+        int Height = 0;
+        Float4x4 View;
+        Float4x4 Projection;
+        const RasterDraw* Draws = nullptr;
+        size_t DrawCount = 0;
+        RasterCullMode CullMode = RasterCullMode::Back;
+    };
+
+    /// <summary>
+    /// Depth and the G-buffer of a deferred geometry pass, one array per component, Width * Height entries each.
+    /// Positions and normals are in world space, normals normalized.
+    /// </summary>
+    struct RasterTarget
+    {
+        static const uint32_t NoMaterial = 0xffffffffu;
+
+        int Width = 0;
+        int Height = 0;
+        std::vector<float> Depth;               // post-projection depth, 1.0 where nothing is drawn
+        std::vector<float> PositionX;
+        std::vector<float> PositionY;
+        std::vector<float> PositionZ;
+        std::vector<float> NormalX;
+        std::vector<float> NormalY;
+        std::vector<float> NormalZ;
+        std::vector<uint32_t> MaterialIndex;    // NoMaterial where nothing is drawn
+
+        /// <summary>
+        /// Resize to width * height and clear depth to 1.0, the attributes only if `withAttributes`
+        /// </summary>
+        void Clear(int width, int height, bool withAttributes);
+    };
+
+    /// <summary>
+    /// The fragments of one triangle within one block of the screen that passed the depth test, handed to a
+    /// FragmentShader. Surfaces are the interpolated world space positions and normalized normals; all fragments
+    /// have the same material, so Surfaces.SpecularPower is left to the shader (null).
+    /// </summary>
+    struct FragmentBatch
+    {
+        int BlockX = 0;                 // block coordinates, pixel / blockSize
+        int BlockY = 0;
+        uint32_t MaterialIndex = 0;
+        const uint32_t* Pixels = nullptr; // x + y * Width of every fragment
+        ShadingSurfaces Surfaces;
+    };
+
+    /// <summary>
+    /// Called from the worker threads, never twice at once for the same block
+    /// </summary>
+    typedef std::function<void(const FragmentBatch& batch)> FragmentShader;
+
+    /// <summary>
+    /// Counters of the last Setup()
+    /// </summary>
+    struct RasterStats
+    {
+        size_t TriangleCount = 0;       // triangles of all draws
+        size_t VisibleTriangleCount = 0; // after clipping and culling, a clipped triangle may count twice
+        size_t BinnedTriangleCount = 0; // bin entries, visible triangles times the bins they overlap
+    };
+
+    /// <summary>
+    /// Headless triangle rasterizer with the D3D11 rules the application relies on: clip space z in [0, w], pixel centers
+    /// at .5, the top-left fill rule on an 8 bit sub-pixel grid, screen space linear depth and perspective correct attributes.
+    ///
+    /// Setup() transforms, clips and bins the triangles of every draw into BinSize x BinSize screen bins, in parallel over
+    /// chunks of triangles; the Rasterize passes then run in parallel over the bins, each bin drawing its triangles in
+    /// submission order, so the result does not depend on the thread count. One Setup() can feed several passes, e.g. the
+    /// depth pre-pass and the shading pass of Forward+.
+    /// </summary>
+    class SoftwareRasterizer
+    {
+    public:
+        static const int BinSize = 64;
+
+        explicit SoftwareRasterizer(ThreadPool& threadPool);
+
+        void Setup(const RasterInput& input);
+
+        /// <summary>
+        /// Depth only, into target.Depth
+        /// </summary>
+        void RasterizeDepth(DepthTest test, RasterTarget& target);
+
+        /// <summary>
+        /// Depth and G-buffer attributes of the closest fragments
+        /// </summary>
+        void RasterizeGBuffer(DepthTest test, RasterTarget& target);
+
+        /// <summary>
+        /// Depth, and every fragment that passes the depth test at the time it is drawn handed to `shader`, per triangle
+        /// and `blockSize` x `blockSize` block (a divisor of BinSize). Overdrawn fragments are shaded too, as on a GPU.
+        /// </summary>
+        void RasterizeFragments(DepthTest test, int blockSize, RasterTarget& target, const FragmentShader& shader);
+
+        const RasterStats& GetStats() const { return m_Stats; }
+
+    private:
+        /// <summary>
+        /// A clipped triangle in screen space, clockwise on screen
+        /// </summary>
+        struct Triangle
+        {
+            int32_t X[3];               // 24.8 fixed point pixels
+            int32_t Y[3];
+            int MinX, MinY, MaxX, MaxY; // pixel bounds within the screen, inclusive
+            float Z[3];                 // post-projection depth
+            float InvW[3];              // 1 / w
+            float Position[3][3];       // world space position / w
+            float Normal[3][3];         // world space normal / w
+            uint32_t MaterialIndex;
+        };
+
+        enum class Pass
+        {
+            Depth,
+            GBuffer,
+            Fragments
+        };
+
+        void Rasterize(Pass pass, DepthTest test, int blockSize, RasterTarget& target, const FragmentShader* shader);
+
+        ThreadPool& m_ThreadPool;
+        RasterInput m_Input;
+        RasterStats m_Stats;
+
+        int m_BinCountX = 0;
+        int m_BinCountY = 0;
+
+        // Triangles and per bin triangle lists of every chunk of input triangles, in submission order
+        struct Chunk
+        {
+            size_t Draw;
+            size_t FirstTriangle;
+            size_t TriangleCount;
+            std::vector<Triangle> Triangles;
+            std::vector<std::vector<uint32_t>> Bins;
+            size_t BinnedTriangleCount;
+        };
+        std::vector<Chunk> m_Chunks;
+    };
+}
+}
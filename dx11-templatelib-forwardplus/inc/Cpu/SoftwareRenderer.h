@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/Lighting.h"
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/Math.h"
+#include "Cpu/SoftwareRasterizer.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Material.h without the texture, which the software renderer does not sample
+    /// </summary>
+    struct SurfaceMaterial
+    {
+        Float3 Emissive = Float3(0.0f, 0.0f, 0.0f);
+        Float3 Ambient = Float3(1.0f, 1.0f, 1.0f);
+        Float3 Diffuse = Float3(1.0f, 1.0f, 1.0f);
+        Float3 Specular = Float3(1.0f, 1.0f, 1.0f);
+        float SpecularPower = 128.0f;
+    };
+
+    /// <summary>
+    /// The render modes of SimpleObj, in world space with every light evaluated in one pass (LightCalculationMode::Loop)
+    /// </summary>
+    enum class SoftwareTechnique
+    {
+        Forward,        // every fragment that passes the depth test is shaded with every light, overdraw included
+        Deferred,       // G-buffer pass, then every pixel shaded once with every light
+        ForwardPlus,    // depth pre-pass, TiledLightCuller, then the fragments shaded with the lights of their tile
+        NumSoftwareTechnique
+    };
+
+    const char* GetSoftwareTechniqueName(SoftwareTechnique technique);
+
+    /// <summary>
+    /// What Scene and the camera of SimpleObj hold, without D3D: draws reference their material by index
+    /// </summary>
+    struct SoftwareScene
+    {
+        int Width = 0;
+        int Height = 0;
+        Float3 EyePosition;
+        Float4x4 View;
+        Float4x4 Projection;
+        Float3 GlobalAmbient = Float3(0.05f, 0.05f, 0.05f);
+
+        const RasterDraw* Draws = nullptr;
+        size_t DrawCount = 0;
+        const SurfaceMaterial* Materials = nullptr;
+        size_t MaterialCount = 0;
+        const Light* Lights = nullptr;          // PositionWS / DirectionWS, the view space values are derived from View
+        size_t LightCount = 0;
+
+        RasterCullMode CullMode = RasterCullMode::Back;
+    };
+
+    /// <summary>
+    /// Cost of the last Render()
+    /// </summary>
+    struct SoftwareFrameStats
+    {
+        double SetupMs = 0.0;                   // transform, clip and bin
+        double DepthMs = 0.0;                   // depth pre-pass (Forward+) or G-buffer pass (Deferred)
+        double CullMs = 0.0;                    // light culling and the per tile light lists (Forward+)
+        double ShadeMs = 0.0;                   // shading pass, with its rasterization for Forward and Forward+
+        uint64_t ShadedFragmentCount = 0;
+        uint64_t ShadedLightCount = 0;          // light evaluations, fragments times their lights
+
+        double TotalMs() const
+        {
+            return SetupMs + DepthMs + CullMs + ShadeMs;
+        }
+    };
+
+    /// <summary>
+    /// Renders full frames on the CPU: SoftwareRasterizer for the geometry, the batched kernels of Cpu/Lighting.h for the
+    /// lighting and TiledLightCuller for Forward+, so frames can be rendered and profiled without a GPU.
+    /// The color is the one of the Loop pixel shaders, (emissive + ambient * GlobalAmbient + diffuse * lit.Diffuse)
+    /// + specular * lit.Specular, without textures and without tone mapping.
+    /// </summary>
+    class SoftwareRenderer
+    {
+    public:
+        explicit SoftwareRenderer(ThreadPool& threadPool);
+
+        void Render(const SoftwareScene& scene, SoftwareTechnique technique);
+
+        // Forward+ tile size, BLOCK_SIZE of the culling shaders
+        void SetTileSize(int tileSize) { m_TileSize = tileSize; }
+        int GetTileSize() const { return m_TileSize; }
+
+        // Kernel of the lighting, GetBestCullKernel() by default
+        void SetKernel(CullKernel kernel) { m_Kernel = kernel; }
+        CullKernel GetKernel() const { return m_Kernel; }
+
+        // Width * Height linear RGB of the last frame, black where nothing is drawn
+        const std::vector<Float3>& GetColor() const { return m_Color; }
+
+        // Depth of the last frame, and the G-buffer after a Deferred frame
+        const RasterTarget& GetTarget() const { return m_Target; }
+
+        // Light lists of the last Forward+ frame, with the global light list
+        const LightCullResult& GetLightLists() const { return m_LightLists; }
+
+        const SoftwareFrameStats& GetStats() const { return m_Stats; }
+        const RasterStats& GetRasterStats() const { return m_Rasterizer.GetStats(); }
+
+        /// <summary>
+        /// Write the color of the last frame as a binary PPM, clamped to [0, 1]. Returns false if the file cannot be written.
+        /// </summary>
+        bool WritePpm(const char* path) const;
+
+    private:
+        void RenderForward();
+        void RenderDeferred();
+        void RenderForwardPlus();
+
+        // Lighting of a batch of surfaces of one material, written to m_Color at `pixels`
+        void ShadeSurfaces(const ShadingLight* lights, size_t lightCount, uint32_t materialIndex, const ShadingSurfaces& surfaces,
+            const uint32_t* pixels, size_t firstPixel);
+
+        ThreadPool& m_ThreadPool;
+        SoftwareRasterizer m_Rasterizer;
+        TiledLightCuller m_Culler;
+        int m_TileSize = 16;
+        CullKernel m_Kernel;
+
+        SoftwareScene m_Scene;
+        std::vector<Light> m_Lights;            // the scene lights with their view space values
+        std::vector<ShadingLight> m_ShadingLights;
+
+        RasterTarget m_Target;
+        std::vector<Float3> m_Color;
+
+        FrustumPlaneGrid m_FrustumPlanes;
+        LightCullResult m_LightLists;
+        std::vector<std::vector<ShadingLight>> m_TileLights;  // global lights, then the opaque list of the tile
+
+        SoftwareFrameStats m_Stats;
+    };
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "Cpu/Math.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// A camera, a depth buffer and a light array, i.e. the inputs of one Forward+ frame,
+    /// generated without a GPU so the CPU code path can be run and measured headless.
+    /// </summary>
+    struct SyntheticScene
+    {
+        int Width = 0;
+        int Height = 0;
+
+        Float3 EyePosition;
+        Float4x4 View;
+        Float4x4 Projection;
+        Float4x4 InverseProjection;
+
+        std::vector<float> Depth;       // Width * Height post-projection depth, 1.0 where nothing is hit
+        std::vector<Light> Lights;
+    };
+
+    /// <summary>
+    /// The demo scene of SimpleObj: the default camera looking into the cornelBox.
+    /// The bunnies are stood in for by spheres, and the lights are the ones from SimpleObj::LoadLight().
+    /// </summary>
+    void BuildDefaultScene(int width, int height, SyntheticScene& scene);
+
+    /// <summary>
+    /// The default camera looking into the cornelBox filled with 64 random spheres,
+    /// a scene with depth discontinuities in most tiles. Has no lights, use GenerateLights().
+    /// </summary>
+    void BuildStressScene(int width, int height, SyntheticScene& scene, uint32_t seed);
+
+    /// <summary>
+    /// Replace the lights of the scene with `count` random point (75%) and spot (25%) lights inside the cornelBox
+    /// </summary>
+    void GenerateLights(SyntheticScene& scene, size_t count, uint32_t seed);
+
+    /// <summary>
+    /// Update PositionVS / DirectionVS from the world space values
+    /// </summary>
+    void UpdateLightsViewSpace(Light* lights, size_t count, const Float4x4& view);
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Fixed set of worker threads that run ParallelFor jobs.
+    /// The calling thread takes part in every job, so a pool of 1 thread runs everything inline.
+    /// </summary>
+    class ThreadPool
+    {
+    public:
+        // threadCount = 0 uses std::thread::hardware_concurrency()
+        explicit ThreadPool(unsigned int threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Number of threads taking part in a job, including the caller
+        unsigned int ThreadCount() const
+        {
+            return static_cast<unsigned int>(m_Workers.size()) + 1;
+        }
+
+        /// <summary>
+        /// Call func(begin, end) over [0, count) in chunks of grainSize and block until all chunks are done.
+        /// Calls made from inside a running job execute serially on the calling thread.
+        /// </summary>
+        void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& func);
+
+    private:
+        void WorkerLoop();
+        void RunChunks();
+
+        std::vector<std::thread> m_Workers;
+
+        std::mutex m_JobMutex;      // serializes ParallelFor callers
+        std::mutex m_StateMutex;
+        std::condition_variable m_WakeCondition;
+        std::condition_variable m_DoneCondition;
+
+        const std::function<void(size_t, size_t)>* m_Job = nullptr;
+        size_t m_JobCount = 0;
+        size_t m_JobGrainSize = 1;
+        std::atomic<size_t> m_NextIndex { 0 };
+        unsigned int m_Generation = 0;
+        unsigned int m_ActiveWorkers = 0;
+        bool m_Quit = false;
+    };
+}
+}
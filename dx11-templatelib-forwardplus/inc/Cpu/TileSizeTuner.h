@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    // Tile sizes the culling shaders are compiled for, BLOCK_SIZE of CullLight.hlsl / ComputeFrustum.hlsl
+    const int SupportedTileSizes[] = { 8, 16, 32 };
+    const int SupportedTileSizeCount = sizeof(SupportedTileSizes) / sizeof(SupportedTileSizes[0]);
+
+    inline bool IsSupportedTileSize(int tileSize)
+    {
+        for (int size : SupportedTileSizes)
+        {
+            if (size == tileSize)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// Cost of one tile size, medians over TileSizeTuner::Tune()'s iterations
+    /// </summary>
+    struct TileSizeTiming
+    {
+        int TileSize = 0;
+        double CullMs = 0.0;
+        double ShadeMs = 0.0;
+        uint64_t ShadedLightCount = 0;      // light evaluations of the shading pass, pixels times lights of their tile
+        size_t IndexCount = 0;              // entries of the opaque light index list
+
+        double TotalMs() const
+        {
+            return CullMs + ShadeMs;
+        }
+    };
+
+    /// <summary>
+    /// Picks the tile size with the lowest culling plus shading time for one frame.
+    ///
+    /// Smaller tiles fit the lights tighter, so fewer lights are shaded per pixel, but cost more culling work
+    /// (every tile tests its lights) and bigger lists; larger tiles the other way around. Where the balance lies
+    /// depends on the light count and sizes, the depth complexity and the resolution, so every supported size is
+    /// culled with TiledLightCuller and shaded with ShadeLightLists(), and the fastest kept.
+    /// </summary>
+    class TileSizeTuner
+    {
+    public:
+        explicit TileSizeTuner(ThreadPool& threadPool);
+
+        /// <summary>
+        /// Time every supported tile size on the frame of `input` and return the fastest.
+        /// input.BlockSize, Frustums and FrustumPlanes are replaced for every size.
+        /// </summary>
+        int Tune(const LightCullInput& input, int iterations = 3);
+
+        const std::vector<TileSizeTiming>& GetTimings() const { return m_Timings; }
+
+    private:
+        ThreadPool& m_ThreadPool;
+        TiledLightCuller m_Culler;
+        FrustumPlaneGrid m_FrustumPlanes;
+        LightCullResult m_Result;
+        std::vector<TileSizeTiming> m_Timings;
+    };
+
+    /// <summary>
+    /// Stand-in for the tiled lighting pass: every pixel with geometry evaluates the attenuation of every light of its
+    /// tile's opaque list, after the lights of the global list, so the cost follows the list lengths like the pixel shader.
+    /// Returns the number of light evaluations. `input` and `result` must use the same tile size.
+    /// </summary>
+    uint64_t ShadeLightLists(ThreadPool& threadPool, const LightCullInput& input, const LightCullResult& result);
+}
+}
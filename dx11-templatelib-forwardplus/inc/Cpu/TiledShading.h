@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/LightListEncoding.h"
+#include "Cpu/Lighting.h"
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/Math.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// The screen of surfaces of one frame and the light lists culled for it, e.g. the G-buffer of
+    /// SoftwareRasterizer::RasterizeGBuffer() and TiledLightCuller's result for its depth.
+    /// </summary>
+    struct TiledShadingInput
+    {
+        int Width = 0;
+        int Height = 0;
+        const float* Depth = nullptr;           // pixels at depth 1.0 have no surface and are not shaded
+        ShadingSurfaces Surfaces;               // Width * Height world space surfaces, Surfaces.Count is ignored
+        Float3 EyePosition;
+
+        const Light* Lights = nullptr;
+        size_t LightCount = 0;
+        const DerivedLight* DerivedLights = nullptr;    // LightCount entries from DeriveLight(), spot cosines per tile if null
+
+        // Lists of the opaque geometry and the global light list, culled with TileSize. Null shades every pixel with
+        // every light, the work of ForwardLighting_LoopLightPS.hlsl without its overdraw
+        const LightCullResult* LightLists = nullptr;
+        int TileSize = 16;
+
+        // The opaque lists of LightLists in one of the LightListEncoding layouts, read in place of its grid and index list
+        // when set. The global light list is still read from LightLists
+        const EncodedLightLists* EncodedLists = nullptr;
+    };
+
+    /// <summary>
+    /// Counters of the last Shade()
+    /// </summary>
+    struct TiledShadingStats
+    {
+        uint64_t ShadedPixelCount = 0;
+        uint64_t ShadedLightCount = 0;          // light evaluations, pixels times the lights of their tile
+    };
+
+    /// <summary>
+    /// The shading pass of Forward+ on the CPU, ForwardPlusLightingPS.hlsl over a G-buffer: the tiles are shaded in
+    /// parallel, each with the global lights followed by its own opaque list, by the batched kernels of Cpu/Lighting.h.
+    /// The lists are decoded with EncodedLightLists::ForEachLight() when TiledShadingInput::EncodedLists is set.
+    /// </summary>
+    class TiledShader
+    {
+    public:
+        explicit TiledShader(ThreadPool& threadPool);
+
+        // Kernel of the lighting, GetBestCullKernel() by default
+        void SetKernel(CullKernel kernel) { m_Kernel = kernel; }
+        CullKernel GetKernel() const { return m_Kernel; }
+
+        /// <summary>
+        /// Light every pixel, Width * Height entries per channel of `output`, 0 where there is no surface
+        /// </summary>
+        void Shade(const TiledShadingInput& input, const ShadingOutput& output);
+
+        const TiledShadingStats& GetStats() const { return m_Stats; }
+
+    private:
+        ThreadPool& m_ThreadPool;
+        CullKernel m_Kernel;
+        std::vector<ShadingLight> m_AllLights;  // every light, when there are no light lists
+        TiledShadingStats m_Stats;
+    };
+}
+}
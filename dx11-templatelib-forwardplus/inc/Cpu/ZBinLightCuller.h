@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CullingTypes.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/ThreadPool.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+    /// <summary>
+    /// Depth binning of ZBinLightCuller: BinCount bins of equal view space depth between NearVS and FarVS
+    /// </summary>
+    struct ZBinSettings
+    {
+        int BinCount = 1024;
+        float NearVS = 0.0f;                // 0 = near plane of the projection
+        float FarVS = 0.0f;                 // 0 = far plane of the projection
+    };
+
+    /// <summary>
+    /// Z-binned light lists: the lights sorted by their nearest view depth, one range of sorted lights per
+    /// depth bin, and one bitmask over the sorted lights per tile. The size is BinCount + tiles * lights / 8
+    /// bytes instead of one index per light and tile.
+    /// </summary>
+    struct ZBinResult
+    {
+        int TileCountX = 0;
+        int TileCountY = 0;
+        int BinCount = 0;
+        float NearVS = 0.0f;
+        float FarVS = 0.0f;
+
+        std::vector<uint32_t> SortedLights; // light indices in ascending order of their nearest depth, lights outside the bins are left out
+        std::vector<uint2> Bins;            // [x, y) range of SortedLights overlapping every bin, x == y if empty
+        size_t WordsPerTile = 0;
+        std::vector<uint64_t> TileMasks;    // bit i of tile tileX + tileY * TileCountX is set if SortedLights[i] may touch its 2D frustum
+
+        const uint64_t* TileMask(size_t tileIndex) const
+        {
+            return TileMasks.data() + tileIndex * WordsPerTile;
+        }
+
+        /// <summary>
+        /// Bin containing a view space depth, clamped to the bins
+        /// </summary>
+        int GetBin(float depthVS) const;
+
+        size_t MemoryBytes() const
+        {
+            return SortedLights.size() * sizeof(uint32_t) + Bins.size() * sizeof(uint2) + TileMasks.size() * sizeof(uint64_t);
+        }
+
+        /// <summary>
+        /// Call func(lightIndex) for every light of a pixel: the bits of the tile mask within the range of its depth bin
+        /// </summary>
+        template<class Func>
+        void ForEachLight(size_t tileIndex, float depthVS, Func&& func) const
+        {
+            const uint2& bin = Bins[GetBin(depthVS)];
+            if (bin.x >= bin.y)
+            {
+                return;
+            }
+
+            const uint64_t* mask = TileMask(tileIndex);
+            uint32_t lastWord = (bin.y - 1) / 64;
+            for (uint32_t word = bin.x / 64; word <= lastWord; ++word)
+            {
+                uint64_t bits = mask[word];
+                if (word == bin.x / 64)
+                {
+                    bits &= ~uint64_t(0) << (bin.x % 64);
+                }
+                if (word == lastWord && bin.y % 64)
+                {
+                    bits &= ~uint64_t(0) >> (64 - bin.y % 64);
+                }
+
+                while (bits)
+                {
+                    uint32_t bit = FirstBitLow(bits);
+                    bits &= bits - 1;
+                    func(SortedLights[word * 64 + bit]);
+                }
+            }
+        }
+    };
+
+    /// <summary>
+    /// Z-binning for very large light counts: every frame the lights are sorted by view depth,
+    /// the depth bins store the range of sorted lights they overlap, and every tile a bitmask of the lights
+    /// touching its 2D frustum. A pixel then visits the bits of its tile mask within the range of its bin.
+    ///
+    /// The 2D test is separable: a light touches tile (x, y) if it is inside the left / right planes of
+    /// column x and the top / bottom planes of row y, so only TileCountX + TileCountY masks are culled and
+    /// the tile masks are their AND. Needs input.FrustumPlanes or builds the shared edge planes itself.
+    /// </summary>
+    class ZBinLightCuller
+    {
+    public:
+        explicit ZBinLightCuller(ThreadPool& threadPool);
+
+        void Cull(const LightCullInput& input, const ZBinSettings& settings, ZBinResult& result);
+
+    private:
+        ThreadPool& m_ThreadPool;
+
+        FrustumPlaneGrid m_FrustumPlanes;       // if input.FrustumPlanes is not set
+        std::vector<float> m_MinDepths;         // nearest depth of every light, the sort key
+        std::vector<float> m_MaxDepths;
+        std::vector<uint64_t> m_ColumnMasks;    // TileCountX masks, then TileCountY masks
+    };
+}
+}
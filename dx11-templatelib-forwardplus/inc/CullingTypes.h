@@ -0,0 +1,23 @@
+#pragma once
+
+namespace Yr
+{
+    // Matches struct Plane / struct Frustum in assets/Shaders/ForwardPlus/Common.hlsli
+
+    struct Plane
+    {
+        float N[3];
+        float d;
+    };
+
+    struct Frustum
+    {
+        struct Plane plane[4]; // left, right, top, bottom
+    };
+
+    struct uint2
+    {
+        unsigned int x;
+        unsigned int y;
+    };
+}
@@ -1,10 +1,9 @@
 #pragma once
 
-#include "SimpleMath.h"
+#include <cmath>
+#include <cstdint>
 
-using namespace DirectX::SimpleMath;
-
-#define MAX_LIGHTS 8
+#include "MathTypes.h"
 
 enum class LightType
 {
@@ -35,21 +34,40 @@ struct Light
     int         Padding = 0;                            // 4 bytes
     //--------------------------------------------------------- (16 byte boundary)
 
-    static float GetRadius(Light* light)
+    static float GetRadius(const Light* light)
     {
         auto constant = light->ConstantAttenuation;
         auto linear = light->LinearAttenuation;
         auto quadratic = light->QuadraticAttenuation;
         auto strength = light->Strength;
-        auto lightMax = std::fmaxf(std::fmaxf(light->Color.x, light->Color.y), light->Color.z) * strength;
+        auto lightMax = std::fmax(std::fmax(light->Color.x, light->Color.y), light->Color.z) * strength;
 
         // Reference: https://learnopengl.com/Advanced-Lighting/Deferred-Shading, we use 10/256 as dark threshold
         float darkThreshold = (256.0f / 2.5f);
-        return (-linear + std::sqrtf(linear * linear - 4.0f * quadratic * (constant - darkThreshold * lightMax))) / (2.0f * quadratic);
+        return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * (constant - darkThreshold * lightMax))) / (2.0f * quadratic);
     }
 
 };  // Total:                                       // 112 bytes (7 * 16)
 
+// Constants of a light that only change with the light or the camera, derived once per dirty light in
+// SimpleObj::OnUpdate() (Cpu::DeriveLight()) and read by the culling and shading shaders instead of solving them again
+// per tile and per pixel. Mirrors DerivedLightProperties in Structures.hlsli
+struct DerivedLight
+{
+    Vector4     BoundsVS;                           // 16 bytes. xyz center, w radius: view space bounding sphere of the lit volume
+    //--------------------------------------------------------- (16 byte boundary)
+    float       Radius = 0.0f;                      // 4 bytes. Light::GetRadius(), range of a point light / height of a spot cone
+    float       InverseRadiusSq = 0.0f;             // 4 bytes. 1 / Radius^2
+    float       SpotCosOuter = 1.0f;                // 4 bytes. cos(SpotAngle), where DoSpotCone() starts
+    float       SpotCosInner = 1.0f;                // 4 bytes. (SpotCosOuter + 1) / 2, where DoSpotCone() reaches 1
+    //--------------------------------------------------------- (16 byte boundary)
+    float       ConeRadius = 0.0f;                  // 4 bytes. tan(SpotAngle) * Radius, bottom radius of the culling cone
+    float       ConeCos = 1.0f;                     // 4 bytes. SpotVolume::CosAngle / SinAngle of the culling cone
+    float       ConeSin = 0.0f;                     // 4 bytes
+    int         Padding = 0;                        // 4 bytes
+    //--------------------------------------------------------- (16 byte boundary)
+};  // Total:                                       // 48 bytes (3 * 16)
+
 struct LightProperties
 {
     LightProperties()
@@ -61,5 +79,8 @@ struct LightProperties
     //----------------------------------- (16 byte boundary)
     Vector4   GlobalAmbient;
     //----------------------------------- (16 byte boundary)
-    Light     Lights[MAX_LIGHTS]; // 80 * 8 bytes
-};  // Total:                                  672 bytes (42 * 16)
\ No newline at end of file
+    uint32_t  LightCount = 0;   // number of lights in the structured light buffer
+    uint32_t  GlobalLightCount = 0; // number of lights in the global light list, shaded by every pixel
+    uint32_t  Padding[2] = {};
+    //----------------------------------- (16 byte boundary)
+};  // Total:                                  48 bytes (3 * 16)
\ No newline at end of file
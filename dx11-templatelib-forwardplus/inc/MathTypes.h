@@ -0,0 +1,21 @@
+#pragma once
+
+// The D3D11 application uses DirectXTK's SimpleMath, while the headless CPU library
+// (built with YR_NO_DIRECTXTK) falls back to the layout-compatible types in Cpu/Math.h,
+// so shared structures such as Light keep the exact same memory layout on both sides.
+
+#ifdef YR_NO_DIRECTXTK
+
+#include "Cpu/Math.h"
+
+typedef Yr::Cpu::Float2 Vector2;
+typedef Yr::Cpu::Float3 Vector3;
+typedef Yr::Cpu::Float4 Vector4;
+
+#else
+
+#include "SimpleMath.h"
+
+using namespace DirectX::SimpleMath;
+
+#endif
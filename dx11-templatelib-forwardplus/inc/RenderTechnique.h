@@ -4,5 +4,8 @@
 
 class RenderTechnique
 {
+public:
+    virtual ~RenderTechnique() = default;
+
     virtual void Render(Scene & scene) = 0;
 };
\ No newline at end of file
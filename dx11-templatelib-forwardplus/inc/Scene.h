@@ -7,6 +7,7 @@
 #include "Entity.h"
 #include "Type.h"
 #include "Common.h"
+#include "Cpu/LightPool.h"
 
 class Scene
 {
@@ -35,7 +36,7 @@ public:
     }
 
     Vector4 GlobalAmbient = Vector4(0.05, 0.05, 0.05, 1.0);
-    Light Lights[MAX_LIGHTS];
+    Yr::Cpu::LightPool Lights; // uploaded to a structured buffer, see SimpleObj::UpdateLightBuffer
     std::vector<Entity*> Entities; // contains all entity of the scene regardless it is instanced or not
     std::map<std::string, std::vector<Entity*>> InstancedEntity;
 };
\ No newline at end of file
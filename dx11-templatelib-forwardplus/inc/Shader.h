@@ -241,9 +241,11 @@ void CreateShader<ID3D11ComputeShader>(
 /// <param name="fileName"></param>
 /// <param name="entryPoint"></param>
 /// <param name="_profile"></param>
+/// <param name="defines">optional null terminated array of shader macros, for permutations of the same file</param>
 /// <returns>pointer to ID3DBlob instance</returns>
 template<class ShaderClass>
-ComPtr<ID3DBlob> LoadShader(ComPtr<ID3D11Device> d3dDevice, const std::wstring& fileName, const std::string& entryPoint, const std::string& _profile)
+ComPtr<ID3DBlob> LoadShader(ComPtr<ID3D11Device> d3dDevice, const std::wstring& fileName, const std::string& entryPoint, const std::string& _profile,
+    const D3D_SHADER_MACRO* defines = nullptr)
 {
     ComPtr<ID3DBlob> pShaderBlob = nullptr;
     ComPtr<ID3DBlob> pErrorBlob = nullptr;
@@ -261,7 +263,7 @@ ComPtr<ID3DBlob> LoadShader(ComPtr<ID3D11Device> d3dDevice, const std::wstring&
 
     HRESULT hr = D3DCompileFromFile(
         fileName.c_str(),                       // name of the shader file
-        nullptr,                                // optional array of shader macros
+        defines,                                // optional array of shader macros
         D3D_COMPILE_STANDARD_FILE_INCLUDE,      // optional pointer to include files, D3D_COMPILE_STANDARD_FILE_INCLUDE implies it include files that are relative to the current directory
         entryPoint.c_str(),                     // entry point of the shader
         profile.c_str(),                        // shader target
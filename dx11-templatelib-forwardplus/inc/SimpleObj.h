@@ -29,11 +29,95 @@
 #include "Scene.h"
 #include "Entity.h"
 #include "Type.h"
+#include "SoftwareRendering.h"
 
-#define BLOCK_SIZE 16
+// cpu light culling
+#include "Cpu/ThreadPool.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightCuller.h"
+#include "Cpu/LightListEncoding.h"
+#include "Cpu/DepthPyramid.h"
+#include "Cpu/CullingAnalysis.h"
+#include "Cpu/TileSizeTuner.h"
+#include "Cpu/FrameCapture.h"
+
+// tile size in pixels at startup, BLOCK_SIZE of the culling shaders. Changed at runtime with
+// SimpleObj::SetTileSize() to one of Cpu::SupportedTileSizes
+#define DEFAULT_TILE_SIZE 16
+
+// threads per group of ComputeFrustum.hlsl, one thread per tile edge plane
+#define FRUSTUM_PLANE_GROUP_SIZE 64
+
+// hierarchical culling, same as Culling.hlsli
+#define SUPER_TILE_SIZE 64
+#define MAX_LIGHTS_PER_SUPER_TILE 4096
+
+// min / max depth pyramid, same as DepthPyramid.hlsl
+#define DEPTH_PYRAMID_LEVEL_COUNT 6
+#define DEPTH_PYRAMID_TILE_SIZE 64
+
+// shader resource slot of StructuredBuffer<LightProperties> Lights in every lighting / culling shader
+#define LIGHT_BUFFER_SLOT 8
+
+// shader resource slot of the global light list, the directional lights every Forward+ pixel shades, see USE_GLOBAL_LIGHT_LIST
+#define GLOBAL_LIGHT_LIST_SLOT 9
+
+// shader resource slots of the opaque light grid and light index list read by the Forward+ shading pass, see TiledLighting.hlsli
+#define LIGHT_GRID_SLOT 10
+#define LIGHT_INDEX_LIST_SLOT 11
+
+// shader resource slot of StructuredBuffer<DerivedLightProperties> DerivedLights, the constants derived from every light in
+// SimpleObj::OnUpdate(), read by the culling shaders and the Forward+ shading pass
+#define DERIVED_LIGHT_BUFFER_SLOT 12
+
+// light index lists, MAX_LIGHTS_PER_TILE as in CullLight.hlsl. The lists start at INITIAL_LIGHTS_PER_TILE entries per tile
+// and grow when the gpu asks for more, see SimpleObj::ReserveLightIndexLists()
+#define MAX_LIGHTS_PER_TILE 1024
+#define INITIAL_LIGHTS_PER_TILE 32
+
+// frames between writing the light index counters and reading them back, so reading them does not wait for the gpu
+#define LIGHT_INDEX_COUNTER_LATENCY 3
+
+// gpu tile size autotuning: frames between issuing the timestamp queries of the Forward+ passes and reading them back,
+// and frames timed per tile size, see SimpleObj::AutotuneTileSize()
+#define GPU_TIMESTAMP_LATENCY 3
+#define GPU_AUTOTUNE_FRAME_COUNT 16
 
 namespace Yr
 {
+    // Timestamps taken around the Forward+ passes, see SimpleObj::RenderScene_FowardPlus()
+    enum GpuTimestamp
+    {
+        GpuTimestamp_Begin,
+        GpuTimestamp_DepthPrePass,
+        GpuTimestamp_CullLight,
+        GpuTimestamp_Shading,
+        NumGpuTimestamps
+    };
+
+    // Timestamp queries of the Forward+ passes of one frame
+    struct GpuPassQueries
+    {
+        Microsoft::WRL::ComPtr<ID3D11Query> Disjoint;
+        Microsoft::WRL::ComPtr<ID3D11Query> Timestamps[NumGpuTimestamps];
+        int TileSize = 0;           // tile size the frame was rendered with
+        bool Pending = false;       // issued and not read back yet
+    };
+
+    // Gpu time of the Forward+ passes at one tile size, of one frame or the medians over GPU_AUTOTUNE_FRAME_COUNT frames
+    struct GpuTileSizeTiming
+    {
+        int TileSize = 0;
+        double DepthPrePassMs = 0.0;
+        double CullMs = 0.0;
+        double ShadeMs = 0.0;
+
+        double TotalMs() const
+        {
+            return DepthPrePassMs + CullMs + ShadeMs;
+        }
+    };
+
     class SimpleObj final : public Game
     {
         // aliases
@@ -84,17 +168,53 @@ namespace Yr
         void RenderScene_Forward(RenderEventArgs& e);
         void RenderScene_Deferred(RenderEventArgs& e);
         void RenderScene_FowardPlus(RenderEventArgs& e);
+        void RenderScene_Software(RenderEventArgs& e);
 
         void RenderScene_Deferred_GeometryPass();
         void RenderScene_Deferred_DebugPass();
         void RenderScene_Deferred_LightingPass_Loop();
         void RenderScene_Deferred_LightingPass_Single();
         void RenderScene_Deferred_LightingPass_Stencil();
-        void DrawLightVolume(Light* type);
+        void DrawLightVolume(const Light* type);
+
+        void RenderScene_FowardPlus_DepthPrePass();
+        void RenderScene_FowardPlus_ShadingPass();
+        void RenderScene_FowardPlus_DrawEntities(ID3D11PixelShader* pixelShader, ID3D11PixelShader* instancedPixelShader);
 
         void ComputeFrustum(int width, int height, int blockSize);
+        void SetTileSize(int tileSize);
+        void AutotuneTileSize();
+        GpuPassQueries* BeginGpuPassQueries();
+        void EndGpuPassQuery(GpuPassQueries* queries, GpuTimestamp timestamp);
+        void UpdateGpuAutotune();
         void RenderScene_FowardPlus_CullLightPass(int width, int height, int blockSize);
-
+        void RenderScene_FowardPlus_CullSuperTilePass();
+        void RenderScene_FowardPlus_DepthPyramidPass();
+        void RenderScene_FowardPlus_CompactLightListsPass(int threadGroupCountX, int threadGroupCountY);
+        void RenderScene_FowardPlus_CullLightPass_Cpu(int threadGroupCountX, int threadGroupCountY);
+        void ReadDepthBuffer(std::vector<float>& depth);
+        Cpu::LightListEncoding GetShadingLightListEncoding() const;
+        void UploadCpuLightLists(const std::vector<struct uint2>& lightGrid, const std::vector<uint32_t>& lightIndexList, int tileCountX,
+            ID3D11Texture2D* lightGridTexture, ID3D11Buffer* lightIndexListBuffer, ID3D11Buffer* lightIndexCounterBuffer,
+            const struct LightIndexCounter& lightIndexCounter);
+        void ReserveLightIndexLists(UINT opaqueCount, UINT transparentCount);
+        void ReserveLightIndexList(UINT count, Microsoft::WRL::ComPtr<ID3D11Buffer>& lightIndexListBuffer,
+            Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>& lightIndexListUAV, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& lightIndexListSRV,
+            Microsoft::WRL::ComPtr<ID3D11Buffer>& stagingListBuffer,
+            Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>& stagingListUAV, UINT& capacity);
+        void RenderScene_FowardPlus_ReadLightIndexCounters();
+        void ReadLightLists(ID3D11Texture2D* lightGridTexture, ID3D11Texture2D* lightGridReadbackTexture, ID3D11Buffer* lightIndexListBuffer,
+            Microsoft::WRL::ComPtr<ID3D11Buffer>& lightIndexListReadbackBuffer, int tileCountX, int tileCountY, Cpu::LightCullResult& result);
+        void RenderScene_FowardPlus_CullingStats(int threadGroupCountX, int threadGroupCountY);
+        bool ExportCullingStats(const char* prefix);
+        void StartFrameCapture(const char* path);
+        void StopFrameCapture();
+        void RenderScene_FowardPlus_CaptureFrame();
+
+
+        void UpdateLightBuffer();
+        void UpdateGlobalLightList();
+        int GetLightCalculationCount() const { return (std::min)(m_LightCalculationCount, (int)m_Scene.Lights.Count()); }
 
         bool ResizeSwapChain(int width, int height);
 
@@ -183,6 +303,27 @@ namespace Yr
         __int64 m_d3dFowrardPlus_CullLightShaderSize = 0;
         Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_d3dFowrardPlus_CullLightShader = nullptr;
 
+        __int64 m_d3dFowrardPlus_CullSuperTileShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_d3dFowrardPlus_CullSuperTileShader = nullptr;
+
+        __int64 m_d3dFowrardPlus_CullLightHierarchicalShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_d3dFowrardPlus_CullLightHierarchicalShader = nullptr;
+
+        __int64 m_d3dFowrardPlus_DepthPyramidShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_d3dFowrardPlus_DepthPyramidShader = nullptr;
+
+        __int64 m_d3dFowrardPlus_ScanLightGridShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_d3dFowrardPlus_ScanLightGridShader = nullptr;
+
+        __int64 m_d3dFowrardPlus_ScatterLightListsShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_d3dFowrardPlus_ScatterLightListsShader = nullptr;
+
+        __int64 m_d3dForwardPlus_Lighting_PixelShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11PixelShader> m_d3dForwardPlus_Lighting_PixelShader = nullptr;
+
+        __int64 m_d3dForwardPlus_Lighting_InstancedPixelShaderSize = 0;
+        Microsoft::WRL::ComPtr<ID3D11PixelShader> m_d3dForwardPlus_Lighting_InstancedPixelShader = nullptr;
+
         // Primitive Batch
         std::unique_ptr<DirectX::CommonStates> m_d3dStates = nullptr;
         std::unique_ptr<DirectX::BasicEffect> m_d3dEffect;
@@ -214,6 +355,7 @@ namespace Yr
         Microsoft::WRL::ComPtr<ID3D11DepthStencilView> m_d3dDepthStencilView_depth;
         Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dDepthStencilView_depth_SRV;
         Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dDepthStencilView_depth_tex;
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dDepthStencilView_depth_readback_tex;     // staging copy for ReadDepthBuffer()
 
         Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_d3dRenderTargetView_diffuse;
         Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dRenderTargetView_diffuse_SRV;
@@ -238,23 +380,147 @@ namespace Yr
         Microsoft::WRL::ComPtr<ID3D11RasterizerState> m_d3dCullFrontRasterizerState;
 
         // Compute shader
-        std::vector<struct Frustum> m_frustums;
+        // Tile size of the light grid; ComputeFrustum.hlsl / CullLight.hlsl are compiled for it
+        int m_TileSize = DEFAULT_TILE_SIZE;
+        int m_ShaderTileSize = 0;       // tile size the culling shaders were last compiled for
+
+        // Shared edge planes of the tile grid, see Cpu::FrustumPlaneGrid
+        Cpu::FrustumPlaneGrid m_FrustumPlanes;
         Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dFrustumBuffers;
         Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dFrustumBuffers_UAV;
         Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dFrustumBuffers_SRV;
 
-        std::vector<int> m_opaqueLightIndexCounter;
         Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dOpaqueLightIndexCounterBuffers;
         Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dOpaqueLightIndexCounterBuffers_UAV;
 
-        std::vector<int> m_opaqueLightIndexList;
         Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dOpaqueLightIndexListBuffers;
         Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dOpaqueLightIndexListBuffers_UAV;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dOpaqueLightIndexListBuffers_SRV;
 
         Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dOpaqueLightGridBuffers;
         Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dOpaqueLightGrid_UAV;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dOpaqueLightGrid_SRV;
+
+        // staging copies for ReadLightLists()
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dOpaqueLightGridReadback_tex;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dOpaqueLightIndexListReadbackBuffer;
+
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dTransparentLightIndexCounterBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dTransparentLightIndexCounterBuffers_UAV;
+
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dTransparentLightIndexListBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dTransparentLightIndexListBuffers_UAV;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dTransparentLightIndexListBuffers_SRV;
+
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dTransparentLightGridBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dTransparentLightGrid_UAV;
+
+        // Hierarchical culling, candidate lights of every super-tile
+        bool m_CullLightHierarchical = false;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dSuperTileLightCountBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dSuperTileLightCountBuffers_UAV;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dSuperTileLightCountBuffers_SRV;
+
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dSuperTileLightIndexListBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dSuperTileLightIndexListBuffers_UAV;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dSuperTileLightIndexListBuffers_SRV;
+
+        // Min / max depth pyramid, mip k - 1 holds level k (2^k x 2^k pixels)
+        bool m_UseDepthPyramid = false;
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dDepthPyramid_tex;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dDepthPyramid_SRV;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dDepthPyramid_UAV[DEPTH_PYRAMID_LEVEL_COUNT];
+
+        // Deterministic light lists: CullLight.hlsl appends to the staging lists,
+        // ScanLightGrid.hlsl / ScatterLightLists.hlsl compact them into the index lists in tile order
+        bool m_DeterministicLightLists = true;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dOpaqueLightIndexStagingListBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dOpaqueLightIndexStagingListBuffers_UAV;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dOpaqueLightOffsetBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dOpaqueLightOffsetBuffers_UAV;
+
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dTransparentLightIndexStagingListBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dTransparentLightIndexStagingListBuffers_UAV;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dTransparentLightOffsetBuffers;
+        Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dTransparentLightOffsetBuffers_UAV;
+
+        // Light index list storage: CullLight.hlsl cuts the lists at their capacity and counts what the tiles lost in the
+        // light index counters, read back LIGHT_INDEX_COUNTER_LATENCY frames later to grow the lists
+        int m_MaxLightsPerTile = 0;                 // per tile light budget, MaxLightsPerTile in CullLight.hlsl, 0 = off
+        UINT m_OpaqueLightIndexListCapacity = 0;    // entries of the index list and its staging list
+        UINT m_TransparentLightIndexListCapacity = 0;
+        UINT m_MaxLightIndexListCapacity = 0;       // MAX_LIGHTS_PER_TILE per tile, the most the gpu lists can take
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dLightIndexCounterReadback[LIGHT_INDEX_COUNTER_LATENCY];
+        UINT m_LightIndexCounterFrame = 0;
+        struct LightIndexCounter m_OpaqueLightIndexCounter = {};       // counters of the last frame read back
+        struct LightIndexCounter m_TransparentLightIndexCounter = {};
+        UINT m_LightIndexListGrowCount = 0;
+
+        // Light buffer, structured copy of m_Scene.Lights
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dLightBuffer;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dLightBuffer_SRV;
+        UINT m_LightBufferCapacity = 0;
+        UINT m_LightBufferUploadBytes = 0;
+        Matrix m_LightViewMatrix;       // view matrix of the last view space update of the lights
+        std::vector<Cpu::LightPool::DirtyRange> m_DirtyLightRanges;    // uploaded with one box each
+
+        // Derived light buffer, Cpu::DeriveLight() of every light in m_Scene.Lights, updated and uploaded with its dirty range
+        std::vector<DerivedLight> m_DerivedLights;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dDerivedLightBuffer;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dDerivedLightBuffer_SRV;
+
+        // Indices of the enabled directional lights, kept out of the tile light lists (USE_GLOBAL_LIGHT_LIST in Culling.hlsli)
+        std::vector<uint32_t> m_GlobalLightIndexList;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dGlobalLightListBuffer;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dGlobalLightListBuffer_SRV;
+        UINT m_GlobalLightListCapacity = 0;
+
+        // Cpu light culling, fallback of m_d3dFowrardPlus_CullLightShader
+        bool m_CullLightOnCpu = false;
+        Cpu::ThreadPool m_CpuThreadPool;
+        Cpu::TiledLightCuller m_CpuLightCuller { m_CpuThreadPool };
+        Cpu::DepthPyramid m_CpuDepthPyramid { m_CpuThreadPool };
+        Cpu::LightCullResult m_CpuLightCullResult;
+        std::vector<float> m_CpuDepthBuffer;
+
+        // Layout of the opaque light lists the cpu culling uploads, the gpu culling always writes Uint32.
+        // The Forward+ shading shaders are compiled for GetShadingLightListEncoding() (LIGHT_LIST_ENCODING in TiledLighting.hlsli)
+        Cpu::LightListEncoding m_LightListEncoding = Cpu::LightListEncoding::Uint32;
+        Cpu::LightListEncoding m_ShaderLightListEncoding = Cpu::LightListEncoding::Uint32;
+        Cpu::EncodedLightLists m_CpuEncodedLightLists;
+
+        // Culling + shading time of every tile size on the CPU when the lights are culled on the CPU, see AutotuneTileSize()
+        Cpu::TileSizeTuner m_TileSizeTuner { m_CpuThreadPool };
+        bool m_TileSizeTuned = false;
+
+        // Otherwise the gpu time of the depth pre-pass, culling and shading of every tile size over the next frames:
+        // step k renders GPU_AUTOTUNE_FRAME_COUNT frames with Cpu::SupportedTileSizes[k], the first one untimed
+        GpuPassQueries m_GpuPassQueries[GPU_TIMESTAMP_LATENCY];
+        UINT m_GpuPassQueryFrame = 0;
+        int m_GpuAutotuneStep = -1;     // -1 when not tuning, SupportedTileSizeCount while the last queries are read back
+        int m_GpuAutotuneFrame = 0;     // frames rendered at the current step
+        std::vector<GpuTileSizeTiming> m_GpuAutotuneSamples;    // one per timed frame
+        std::vector<GpuTileSizeTiming> m_GpuTileSizeTimings;    // medians of every tile size of the last autotune
+
+        // Software render mode, the frame of SoftwareRendering uploaded to a texture and drawn over the screen
+        SoftwareRendering m_SoftwareRendering { m_CpuThreadPool };
+        std::vector<Vector4> m_SoftwareColor;
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dSoftwareColor_tex;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_d3dSoftwareColor_SRV;
+
+        // Forward+ frames recorded for FrameReplayBenchmark while a capture is open, see RenderScene_FowardPlus_CaptureFrame()
+        Cpu::FrameCaptureWriter m_FrameCapture;
+        Cpu::CapturedFrame m_CapturedFrame;
+        bool m_FrameCaptureFailed = false;
+
+        // Culling quality of the opaque lists, read back from the GPU lists unless culled on the CPU
+        bool m_CullingStatsEnabled = false;
+        bool m_CullingStatsFalsePositives = false;     // brute force per pixel test, slow
+        Cpu::LightCullResult m_CullingStatsLists;
+        Cpu::TileLightStats m_CullingStats;
+        std::vector<float> m_CullingStatsHistogram;
+        bool m_CullingStatsExported = false;
 
-        std::vector <float> m_debugRWList;
         Microsoft::WRL::ComPtr<ID3D11Buffer> m_d3dDebugRWListBuffers;
         Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_d3dDebugRWListBuffers_UAV;
 
@@ -308,7 +574,7 @@ namespace Yr
         Deferred_DebugMode m_DeferredDebugMode = Deferred_DebugMode::None;
         float m_DeferredDepthPower = 500.0f;
         LightingSpace m_LightingSpace = LightingSpace::World;
-        int m_LightCalculationCount = MAX_LIGHTS;
+        int m_LightCalculationCount = INT_MAX;   // clamped to the light count, see GetLightCalculationCount
         LightCalculationMode m_LightCalculationMode = LightCalculationMode::Single;
 
         // Others
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "RenderTechnique.h"
+#include "Cpu/SoftwareRenderer.h"
+
+// Renders a Scene with Cpu::SoftwareRenderer instead of D3D11: the entities with their Model vertex data, WorldMatrix and
+// Material (textures are not sampled), Scene::Lights and GlobalAmbient, from the camera given to SetCamera().
+// It is the Software render mode of SimpleObj and, as Scene / Entity / Model hold D3D11 buffers, part of the Windows
+// application only; the headless path is Cpu::SoftwareRenderer itself (SoftwareRenderBenchmark).
+class SoftwareRendering : public RenderTechnique
+{
+public:
+    explicit SoftwareRendering(Yr::Cpu::ThreadPool& threadPool);
+
+    void SetCamera(int width, int height, const Vector3& eyePosition, const Matrix& view, const Matrix& projection);
+
+    void SetTechnique(Yr::Cpu::SoftwareTechnique technique) { m_Technique = technique; }
+    Yr::Cpu::SoftwareTechnique GetTechnique() const { return m_Technique; }
+
+    void Render(Scene& scene) override;
+
+    Yr::Cpu::SoftwareRenderer& GetRenderer() { return m_Renderer; }
+
+private:
+    Yr::Cpu::SoftwareRenderer m_Renderer;
+    Yr::Cpu::SoftwareTechnique m_Technique = Yr::Cpu::SoftwareTechnique::ForwardPlus;
+    Yr::Cpu::SoftwareScene m_Scene;
+
+    std::vector<Yr::Cpu::RasterDraw> m_Draws;
+    std::vector<Yr::Cpu::SurfaceMaterial> m_Materials;
+};
@@ -2,6 +2,7 @@
 
 #include "Light.h"
 #include "Material.h"
+#include "CullingTypes.h"
 
 #include "SimpleMath.h"
 using namespace DirectX::SimpleMath;
@@ -29,6 +30,7 @@ namespace Yr
         Forward,
         Deferred,
         ForwardPlus,
+        Software,       // Cpu::SoftwareRenderer through SoftwareRendering, drawn as a full screen texture
         LEN_RENDER_MODE
     };
 
@@ -102,7 +104,7 @@ namespace Yr
     struct LightingCalculationOptions
     {
         int LightingSpace = 0;
-        int LightCount = MAX_LIGHTS;
+        int LightCount = 0;
         int LightIndex;
         float padding;
     };
@@ -110,27 +112,23 @@ namespace Yr
     struct DispatchParams
     {
         int numThreadGroups[3];
-        int padding1;
+        int useDepthPyramid;    // UseDepthPyramid in CullLight.hlsl
 
         int numThreads[3];
-        int padding2;
-    };
+        int deterministicLightLists;    // DeterministicLightLists in CullLight.hlsl
 
-    struct Plane
-    {
-        float N[3];
-        float d;
-    };
-
-    struct Frustum
-    {
-        struct Plane plane[4];
+        unsigned int lightIndexListCapacity[2];     // LightIndexListCapacity in CullLight.hlsl, opaque and transparent
+        int maxLightsPerTile;                       // MaxLightsPerTile in CullLight.hlsl, 0 = no budget
+        int padding;
     };
 
-    struct uint2
+    // o_LightIndexCounter / t_LightIndexCounter of CullLight.hlsl
+    struct LightIndexCounter
     {
-        unsigned int x;
-        unsigned int y;
+        unsigned int RequiredCount;         // entries the tiles asked for, more than the capacity of the index list if it overflowed
+        unsigned int TruncatedListCount;    // tile lists that lost lights to MAX_LIGHTS_PER_TILE, the budget or the capacity
+        unsigned int DroppedLightCount;     // lights lost by those lists
+        unsigned int Padding;
     };
 
     #pragma endregion
@@ -0,0 +1,225 @@
+#include "Cpu/ClusteredLightCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+int ClusterCullResult::GetSlice(float depthVS) const
+{
+    // Slices are exponential, but a binary search on the boundaries keeps the result
+    // consistent with the comparisons the culler makes against SliceDepths
+    auto it = std::upper_bound(SliceDepths.begin() + 1, SliceDepths.end() - 1, depthVS);
+    return static_cast<int>(it - (SliceDepths.begin() + 1));
+}
+
+ClusteredLightCuller::ClusteredLightCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void ClusteredLightCuller::Cull(const LightCullInput& input, const ClusterCullSettings& settings, ClusterCullResult& result)
+{
+    float nearVS = settings.NearVS > 0.0f ? settings.NearVS : ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+    float farVS = settings.FarVS > 0.0f ? settings.FarVS : ClipToView(Float4(0, 0, 1, 1), input.InverseProjection).z;
+
+    result.TileCountX = GetTileCount(input.Width, input.BlockSize);
+    result.TileCountY = GetTileCount(input.Height, input.BlockSize);
+    result.SliceCount = std::min(std::max(settings.SliceCount, 1), (int)ClusterCullSettings::MaxSliceCount);
+    result.ClusterGrid.resize(static_cast<size_t>(result.TileCountX) * result.TileCountY * result.SliceCount);
+
+    result.SliceDepths.resize(result.SliceCount + 1);
+    for (int i = 0; i <= result.SliceCount; ++i)
+    {
+        result.SliceDepths[i] = nearVS * std::pow(farVS / nearVS, i / (float)result.SliceCount);
+    }
+    result.SliceDepths.front() = nearVS;
+    result.SliceDepths.back() = farVS;
+
+    const int sliceCount = result.SliceCount;
+    const uint64_t allSlices = sliceCount == 64 ? ~uint64_t(0) : (uint64_t(1) << sliceCount) - 1;
+    const std::vector<float>& sliceDepths = result.SliceDepths;
+
+    m_RowLightLists.resize(result.TileCountY);
+
+    m_ThreadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<std::vector<uint32_t>> sliceLists(sliceCount);
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            auto& rowList = m_RowLightLists[y];
+            rowList.clear();
+
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                // Slices holding opaque geometry of this tile, the clear depth of 1 is not geometry.
+                // Each cluster is then shrunk to the depth range of its own pixels.
+                uint64_t occupied = allSlices;
+                float clusterMin[ClusterCullSettings::MaxSliceCount];
+                float clusterMax[ClusterCullSettings::MaxSliceCount];
+                for (int s = 0; s < sliceCount; ++s)
+                {
+                    clusterMin[s] = sliceDepths[s];
+                    clusterMax[s] = sliceDepths[s + 1];
+                }
+
+                if (settings.SkipEmptyClusters)
+                {
+                    occupied = 0;
+
+                    int x0 = x * input.BlockSize;
+                    int y0 = static_cast<int>(y) * input.BlockSize;
+                    int x1 = std::min(x0 + input.BlockSize, input.Width);
+                    int y1 = std::min(y0 + input.BlockSize, input.Height);
+                    for (int py = y0; py < y1; ++py)
+                    {
+                        const float* row = input.Depth + static_cast<size_t>(py) * input.Width;
+                        for (int px = x0; px < x1; ++px)
+                        {
+                            if (row[px] < 1.0f)
+                            {
+                                float depthVS = ClipToView(Float4(0, 0, row[px], 1), input.InverseProjection).z;
+                                int slice = result.GetSlice(depthVS);
+                                if ((occupied >> slice) & 1)
+                                {
+                                    clusterMin[slice] = std::min(clusterMin[slice], depthVS);
+                                    clusterMax[slice] = std::max(clusterMax[slice], depthVS);
+                                }
+                                else
+                                {
+                                    occupied |= uint64_t(1) << slice;
+                                    clusterMin[slice] = depthVS;
+                                    clusterMax[slice] = depthVS;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                for (auto& sliceList : sliceLists)
+                {
+                    sliceList.clear();
+                }
+
+                if (occupied)
+                {
+                    int firstSlice = 0;
+                    while (((occupied >> firstSlice) & 1) == 0)
+                    {
+                        ++firstSlice;
+                    }
+                    int lastSlice = sliceCount - 1;
+                    while (((occupied >> lastSlice) & 1) == 0)
+                    {
+                        --lastSlice;
+                    }
+
+                    Frustum frustum = TiledLightCuller::GetTileFrustum(input, x, static_cast<int>(y));
+                    float zMin = clusterMin[firstSlice];
+                    float zMax = clusterMax[lastSlice];
+
+                    for (size_t i = 0; i < input.LightCount; ++i)
+                    {
+                        const Light& light = input.Lights[i];
+                        if (!light.Enabled)
+                        {
+                            continue;
+                        }
+
+                        switch ((LightType)light.LightType)
+                        {
+                        case LightType::Point:
+                        {
+                            // Tile column first, then the slices the sphere's depth range overlaps
+                            Sphere sphere = GetLightSphere(light);
+                            if (!SphereInsideFrustum(sphere, frustum, zMin, zMax))
+                            {
+                                break;
+                            }
+                            for (int s = firstSlice; s <= lastSlice; ++s)
+                            {
+                                if (((occupied >> s) & 1) && sphere.c.z - sphere.r <= clusterMax[s] && sphere.c.z + sphere.r >= clusterMin[s])
+                                {
+                                    sliceLists[s].push_back(static_cast<uint32_t>(i));
+                                }
+                            }
+                        }
+                        break;
+
+                        case LightType::Spotlight:
+                        {
+                            SpotVolume spot = GetLightSpotVolume(light);
+                            if (!ConeInsideFrustum(spot.C, frustum, zMin, zMax) || !SpotIntersectsTileVolume(spot, GetTileVolume(frustum, zMin, zMax)))
+                            {
+                                break;
+                            }
+                            for (int s = firstSlice; s <= lastSlice; ++s)
+                            {
+                                if (((occupied >> s) & 1) &&
+                                    !ConeInsidePlane(spot.C, MakePlane(Float3(0, 0, 1), clusterMin[s])) &&
+                                    !ConeInsidePlane(spot.C, MakePlane(Float3(0, 0, -1), -clusterMax[s])) &&
+                                    spot.Bounds.c.z - spot.Bounds.r <= clusterMax[s] && spot.Bounds.c.z + spot.Bounds.r >= clusterMin[s])
+                                {
+                                    sliceLists[s].push_back(static_cast<uint32_t>(i));
+                                }
+                            }
+                        }
+                        break;
+
+                        case LightType::Directional:
+                        {
+                            for (int s = firstSlice; s <= lastSlice; ++s)
+                            {
+                                if ((occupied >> s) & 1)
+                                {
+                                    sliceLists[s].push_back(static_cast<uint32_t>(i));
+                                }
+                            }
+                        }
+                        break;
+
+                        default:
+                            break;
+                        }
+                    }
+                }
+
+                // Offsets are row local for now, fixed up once every row is known
+                for (int s = 0; s < sliceCount; ++s)
+                {
+                    uint32_t offset = static_cast<uint32_t>(rowList.size());
+                    rowList.insert(rowList.end(), sliceLists[s].begin(), sliceLists[s].end());
+                    result.ClusterGrid[result.GetClusterIndex(x, static_cast<int>(y), s)] = { offset, static_cast<uint32_t>(sliceLists[s].size()) };
+                }
+            }
+        }
+    });
+
+    // Concatenate the rows in order
+    size_t totalCount = 0;
+    for (auto& rowList : m_RowLightLists)
+    {
+        totalCount += rowList.size();
+    }
+    result.LightIndexList.resize(totalCount);
+
+    uint32_t rowOffset = 0;
+    for (int y = 0; y < result.TileCountY; ++y)
+    {
+        auto& rowList = m_RowLightLists[y];
+        std::copy(rowList.begin(), rowList.end(), result.LightIndexList.begin() + rowOffset);
+
+        for (int s = 0; s < sliceCount; ++s)
+        {
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                result.ClusterGrid[result.GetClusterIndex(x, y, s)].x += rowOffset;
+            }
+        }
+        rowOffset += static_cast<uint32_t>(rowList.size());
+    }
+}
@@ -0,0 +1,147 @@
+#include "Cpu/CullingAnalysis.h"
+#include "Cpu/Culling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+bool Cpu::LightTouchesPoint(const Light& light, const Float3& pointVS)
+{
+    switch ((LightType)light.LightType)
+    {
+    case LightType::Point:
+    {
+        Sphere sphere = GetLightSphere(light);
+        Float3 v = pointVS - sphere.c;
+        return Dot(v, v) <= sphere.r * sphere.r;
+    }
+
+    case LightType::Spotlight:
+    {
+        // Within the range of the tip and within the spot angle of the axis, the volume DoSpotCone() lights
+        Cone cone = GetLightCone(light);
+        Float3 v = pointVS - cone.T;
+        float distanceSq = Dot(v, v);
+        if (distanceSq > cone.h * cone.h)
+        {
+            return false;
+        }
+        float t = Dot(v, cone.d);
+        return t >= 0.0f && t * t >= distanceSq * std::cos(light.SpotAngle) * std::cos(light.SpotAngle);
+    }
+
+    case LightType::Directional:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+FalsePositiveStats Cpu::CountFalsePositives(const LightCullInput& input, const LightCullResult& result, ThreadPool& threadPool)
+{
+    TileLightStats stats;
+    ComputeTileLightStats(input, result, true, threadPool, stats);
+    return stats.FalsePositives;
+}
+
+uint32_t Cpu::TileLightStats::Percentile(double fraction) const
+{
+    size_t tileCount = LightCounts.size();
+    size_t target = static_cast<size_t>(std::ceil(fraction * tileCount));
+
+    size_t tiles = 0;
+    for (size_t n = 0; n < Histogram.size(); ++n)
+    {
+        tiles += Histogram[n];
+        if (tiles >= target)
+        {
+            return static_cast<uint32_t>(n);
+        }
+    }
+    return MaxLights;
+}
+
+void Cpu::ComputeTileLightStats(const LightCullInput& input, const LightCullResult& result, bool measureFalsePositives,
+    ThreadPool& threadPool, TileLightStats& stats)
+{
+    size_t tileCount = static_cast<size_t>(result.TileCountX) * result.TileCountY;
+
+    stats.TileCountX = result.TileCountX;
+    stats.TileCountY = result.TileCountY;
+    stats.LightCounts.resize(tileCount);
+    stats.FalsePositiveCounts.assign(measureFalsePositives ? tileCount : 0, 0);
+
+    uint64_t listedLights = 0;
+    stats.MaxLights = 0;
+    for (size_t tile = 0; tile < tileCount; ++tile)
+    {
+        stats.LightCounts[tile] = result.LightGrid[tile].y;
+        stats.MaxLights = std::max(stats.MaxLights, result.LightGrid[tile].y);
+        listedLights += result.LightGrid[tile].y;
+    }
+    stats.MeanLights = tileCount ? listedLights / (double)tileCount : 0.0;
+
+    stats.Histogram.assign(stats.MaxLights + 1, 0);
+    for (uint32_t count : stats.LightCounts)
+    {
+        ++stats.Histogram[count];
+    }
+
+    stats.FalsePositives = FalsePositiveStats();
+    if (!measureFalsePositives)
+    {
+        return;
+    }
+
+    Float2 screenDimensions((float)input.Width, (float)input.Height);
+
+    threadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<Float3> pixels;
+
+        for (size_t tileY = begin; tileY < end; ++tileY)
+        {
+            for (int tileX = 0; tileX < result.TileCountX; ++tileX)
+            {
+                int x0 = tileX * input.BlockSize;
+                int y0 = static_cast<int>(tileY) * input.BlockSize;
+                int x1 = std::min(x0 + input.BlockSize, input.Width);
+                int y1 = std::min(y0 + input.BlockSize, input.Height);
+
+                pixels.clear();
+                for (int y = y0; y < y1; ++y)
+                {
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        float depth = input.Depth[x + static_cast<size_t>(y) * input.Width];
+                        if (depth < 1.0f)
+                        {
+                            pixels.push_back(ScreenToView(Float4(x + 0.5f, y + 0.5f, depth, 1.0f), screenDimensions, input.InverseProjection).xyz());
+                        }
+                    }
+                }
+
+                size_t tile = tileX + tileY * result.TileCountX;
+                const uint2& cell = result.LightGrid[tile];
+                uint32_t wrong = 0;
+                for (uint32_t i = 0; i < cell.y; ++i)
+                {
+                    const Light& light = input.Lights[result.LightIndexList[cell.x + i]];
+                    bool touches = std::any_of(pixels.begin(), pixels.end(), [&](const Float3& p) { return LightTouchesPoint(light, p); });
+                    wrong += touches ? 0 : 1;
+                }
+                stats.FalsePositiveCounts[tile] = wrong;
+            }
+        }
+    });
+
+    stats.FalsePositives.ListedLights = static_cast<size_t>(listedLights);
+    for (uint32_t wrong : stats.FalsePositiveCounts)
+    {
+        stats.FalsePositives.FalsePositives += wrong;
+    }
+}
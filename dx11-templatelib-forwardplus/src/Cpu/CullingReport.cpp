@@ -0,0 +1,114 @@
+#include "Cpu/CullingReport.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    struct Color
+    {
+        uint8_t r, g, b;
+    };
+
+    // Black, blue, green, yellow, red
+    const Color HeatmapColors[] = { { 0, 0, 0 }, { 0, 0, 255 }, { 0, 255, 0 }, { 255, 255, 0 }, { 255, 0, 0 } };
+    const int HeatmapColorCount = sizeof(HeatmapColors) / sizeof(HeatmapColors[0]);
+
+    Color GetHeatmapColor(uint32_t value, uint32_t maxValue)
+    {
+        if (value == 0 || maxValue == 0)
+        {
+            return HeatmapColors[0];
+        }
+
+        float t = std::min(value / (float)maxValue, 1.0f) * (HeatmapColorCount - 1);
+        int i = std::min(static_cast<int>(t), HeatmapColorCount - 2);
+        float f = t - i;
+
+        const Color& a = HeatmapColors[i];
+        const Color& b = HeatmapColors[i + 1];
+        return {
+            static_cast<uint8_t>(a.r + (b.r - a.r) * f + 0.5f),
+            static_cast<uint8_t>(a.g + (b.g - a.g) * f + 0.5f),
+            static_cast<uint8_t>(a.b + (b.b - a.b) * f + 0.5f)
+        };
+    }
+}
+
+bool Cpu::WriteHeatmapPpm(const char* path, const uint32_t* values, int width, int height, uint32_t maxValue, int scale)
+{
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    scale = std::max(scale, 1);
+    std::fprintf(file, "P6\n%d %d\n255\n", width * scale, height * scale);
+
+    std::vector<Color> row(static_cast<size_t>(width) * scale);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            Color color = GetHeatmapColor(values[x + static_cast<size_t>(y) * width], maxValue);
+            std::fill_n(row.begin() + static_cast<size_t>(x) * scale, scale, color);
+        }
+
+        for (int i = 0; i < scale; ++i)
+        {
+            std::fwrite(row.data(), sizeof(Color), row.size(), file);
+        }
+    }
+
+    return std::fclose(file) == 0;
+}
+
+bool Cpu::WriteTileLightStatsCsv(const char* path, const TileLightStats& stats)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::fprintf(file, "tile_x,tile_y,lights,false_positives\n");
+    for (int y = 0; y < stats.TileCountY; ++y)
+    {
+        for (int x = 0; x < stats.TileCountX; ++x)
+        {
+            size_t tile = x + static_cast<size_t>(y) * stats.TileCountX;
+            if (stats.FalsePositiveCounts.empty())
+            {
+                std::fprintf(file, "%d,%d,%u,\n", x, y, stats.LightCounts[tile]);
+            }
+            else
+            {
+                std::fprintf(file, "%d,%d,%u,%u\n", x, y, stats.LightCounts[tile], stats.FalsePositiveCounts[tile]);
+            }
+        }
+    }
+
+    return std::fclose(file) == 0;
+}
+
+bool Cpu::WriteLightCountHistogramCsv(const char* path, const TileLightStats& stats)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::fprintf(file, "lights,tiles\n");
+    for (size_t n = 0; n < stats.Histogram.size(); ++n)
+    {
+        std::fprintf(file, "%zu,%zu\n", n, stats.Histogram[n]);
+    }
+
+    return std::fclose(file) == 0;
+}
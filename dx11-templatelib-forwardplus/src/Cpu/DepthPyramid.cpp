@@ -0,0 +1,119 @@
+#include "Cpu/DepthPyramid.h"
+
+#include <algorithm>
+
+#include "DepthPyramidKernel.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+const int DepthPyramid::MaxLevelCount;
+
+namespace
+{
+    struct Scalar
+    {
+    };
+
+    void ReduceDepthRow_Scalar(const Detail::DepthReduceRow& row)
+    {
+        Detail::ReduceDepthRowScalar<Scalar>(row, 0);
+    }
+}
+
+DepthPyramid::DepthPyramid(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void DepthPyramid::Build(const float* depth, int width, int height, CullKernel kernel, int levelCount)
+{
+    if (!IsCullKernelSupported(kernel))
+    {
+        kernel = CullKernel::Scalar;
+    }
+
+    void (*reduceRow)(const Detail::DepthReduceRow&) = ReduceDepthRow_Scalar;
+    switch (kernel)
+    {
+#ifdef YR_CPU_X86
+    case CullKernel::Sse:
+        reduceRow = Detail::ReduceDepthRow_Sse;
+        break;
+    case CullKernel::Avx2:
+        reduceRow = Detail::ReduceDepthRow_Avx2;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    levelCount = std::max(1, std::min(levelCount, MaxLevelCount));
+
+    m_Width = width;
+    m_Height = height;
+    m_Levels.resize(levelCount);
+    for (int k = 1; k <= levelCount; ++k)
+    {
+        Level& level = m_Levels[k - 1];
+        level.Width = (width + (1 << k) - 1) >> k;
+        level.Height = (height + (1 << k) - 1) >> k;
+        level.Min.resize(static_cast<size_t>(level.Width) * level.Height);
+        level.Max.resize(static_cast<size_t>(level.Width) * level.Height);
+    }
+    m_ZeroRow.assign(width, 0.0f);
+
+    // A band of 2^levelCount pixel rows covers 2^(levelCount - k) rows of level k,
+    // which only depend on rows of the level above inside the same band
+    int bandHeight = 1 << levelCount;
+    int bandCount = (height + bandHeight - 1) / bandHeight;
+
+    m_ThreadPool.ParallelFor(bandCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t band = begin; band < end; ++band)
+        {
+            for (int k = 1; k <= levelCount; ++k)
+            {
+                Level& level = m_Levels[k - 1];
+                const float* sourceMin = k == 1 ? depth : m_Levels[k - 2].Min.data();
+                const float* sourceMax = k == 1 ? depth : m_Levels[k - 2].Max.data();
+                int sourceWidth = k == 1 ? width : m_Levels[k - 2].Width;
+                int sourceHeight = k == 1 ? height : m_Levels[k - 2].Height;
+
+                int rowsPerBand = 1 << (levelCount - k);
+                int rowBegin = static_cast<int>(band) * rowsPerBand;
+                int rowEnd = std::min(rowBegin + rowsPerBand, level.Height);
+
+                for (int y = rowBegin; y < rowEnd; ++y)
+                {
+                    size_t row0 = static_cast<size_t>(2 * y) * sourceWidth;
+                    size_t row1 = row0 + sourceWidth;
+                    bool hasRow1 = 2 * y + 1 < sourceHeight;
+
+                    Detail::DepthReduceRow row;
+                    row.Min0 = sourceMin + row0;
+                    row.Min1 = hasRow1 ? sourceMin + row1 : m_ZeroRow.data();
+                    row.Max0 = sourceMax + row0;
+                    row.Max1 = hasRow1 ? sourceMax + row1 : m_ZeroRow.data();
+                    row.SourceWidth = sourceWidth;
+                    row.Min = level.Min.data() + static_cast<size_t>(y) * level.Width;
+                    row.Max = level.Max.data() + static_cast<size_t>(y) * level.Width;
+                    row.Width = level.Width;
+                    reduceRow(row);
+                }
+            }
+        }
+    });
+}
+
+int DepthPyramid::GetLevelForBlockSize(int blockSize) const
+{
+    for (int k = 1; k <= LevelCount(); ++k)
+    {
+        if (blockSize == 1 << k)
+        {
+            return k;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// Private to src/Cpu: the 2 x 2 min / max reduction of DepthPyramid, instantiated once per
+// instruction set in DepthPyramidKernel_Sse.cpp / DepthPyramidKernel_Avx2.cpp.
+// Same rules as LightMaskKernel.h: everything shared between the translation units is a template
+// on the instruction set, so no inline function built with AVX2 can leak into the scalar path.
+
+#include "LightMaskKernel.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+namespace Detail
+{
+    /// <summary>
+    /// One destination row of a pyramid level and the two source rows it reduces.
+    /// For the first level the min and max source rows are both the depth buffer.
+    /// A source row below the last row points to zeros.
+    /// </summary>
+    struct DepthReduceRow
+    {
+        const float* Min0;
+        const float* Min1;
+        const float* Max0;
+        const float* Max1;
+        int SourceWidth;
+
+        float* Min;
+        float* Max;
+        int Width;
+    };
+
+    void ReduceDepthRow_Sse(const DepthReduceRow& row);
+    void ReduceDepthRow_Avx2(const DepthReduceRow& row);
+
+    /// <summary>
+    /// Destination texels [x, row.Width) one at a time. The right column of the last 2 x 2 block
+    /// may be outside the source and reads as 0, which only lowers the min (depth is never negative).
+    /// </summary>
+    template<class S>
+    void ReduceDepthRowScalar(const DepthReduceRow& row, int x)
+    {
+        for (; x < row.Width; ++x)
+        {
+            int x0 = 2 * x;
+            int x1 = x0 + 1;
+
+            float minDepth = row.Min0[x0] < row.Min1[x0] ? row.Min0[x0] : row.Min1[x0];
+            float maxDepth = row.Max0[x0] > row.Max1[x0] ? row.Max0[x0] : row.Max1[x0];
+            if (x1 < row.SourceWidth)
+            {
+                float min1 = row.Min0[x1] < row.Min1[x1] ? row.Min0[x1] : row.Min1[x1];
+                float max1 = row.Max0[x1] > row.Max1[x1] ? row.Max0[x1] : row.Max1[x1];
+                minDepth = min1 < minDepth ? min1 : minDepth;
+                maxDepth = max1 > maxDepth ? max1 : maxDepth;
+            }
+            else
+            {
+                minDepth = 0.0f;
+            }
+
+            row.Min[x] = minDepth;
+            row.Max[x] = maxDepth;
+        }
+    }
+
+    /// <summary>
+    /// S::Width destination texels per step: min / max of the two source rows, then of neighbouring pairs.
+    /// Min and max are exact, so the result is bit-identical to the scalar version.
+    /// </summary>
+    template<class S>
+    void ReduceDepthRow(const DepthReduceRow& row)
+    {
+        using F = typename S::Float;
+        const int width = static_cast<int>(S::Width);
+
+        int x = 0;
+        for (; 2 * (x + width) <= row.SourceWidth; x += width)
+        {
+            int x0 = 2 * x;
+
+            F minA = S::Min(S::Load(row.Min0 + x0), S::Load(row.Min1 + x0));
+            F minB = S::Min(S::Load(row.Min0 + x0 + width), S::Load(row.Min1 + x0 + width));
+            F maxA = S::Max(S::Load(row.Max0 + x0), S::Load(row.Max1 + x0));
+            F maxB = S::Max(S::Load(row.Max0 + x0 + width), S::Load(row.Max1 + x0 + width));
+
+            S::Store(row.Min + x, S::PairMin(minA, minB));
+            S::Store(row.Max + x, S::PairMax(maxA, maxB));
+        }
+
+        ReduceDepthRowScalar<S>(row, x);
+    }
+}
+}
+}
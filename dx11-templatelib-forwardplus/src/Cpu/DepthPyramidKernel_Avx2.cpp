@@ -0,0 +1,45 @@
+#include "DepthPyramidKernel.h"
+
+#ifdef YR_CPU_X86
+
+#include <immintrin.h>
+
+namespace
+{
+    // 8 texels per instruction, this file is built with AVX2 enabled (see CMakeLists.txt)
+    // and only called after a runtime check
+    struct Avx2
+    {
+        using Float = __m256;
+        static const size_t Width = 8;
+
+        static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, Float a) { _mm256_storeu_ps(p, a); }
+        static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+        static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+        // The in-lane shuffles give (a01, a23, b01, b23 | a45, a67, b45, b67),
+        // the 64-bit permute puts the halves back in order
+        static Float Ordered(Float a)
+        {
+            return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a), _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+
+        static Float PairMin(Float a, Float b)
+        {
+            return Ordered(_mm256_min_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+        }
+
+        static Float PairMax(Float a, Float b)
+        {
+            return Ordered(_mm256_max_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+        }
+    };
+}
+
+void Yr::Cpu::Detail::ReduceDepthRow_Avx2(const DepthReduceRow& row)
+{
+    ReduceDepthRow<Avx2>(row);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#include "DepthPyramidKernel.h"
+
+#ifdef YR_CPU_X86
+
+#include <emmintrin.h>
+
+namespace
+{
+    // 4 texels per instruction, SSE2 is part of the x64 baseline
+    struct Sse
+    {
+        using Float = __m128;
+        static const size_t Width = 4;
+
+        static Float Load(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, Float a) { _mm_storeu_ps(p, a); }
+        static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+        static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+        // (op(a0, a1), op(a2, a3), op(b0, b1), op(b2, b3))
+        static Float PairMin(Float a, Float b)
+        {
+            return _mm_min_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+
+        static Float PairMax(Float a, Float b)
+        {
+            return _mm_max_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    };
+}
+
+void Yr::Cpu::Detail::ReduceDepthRow_Sse(const DepthReduceRow& row)
+{
+    ReduceDepthRow<Sse>(row);
+}
+
+#endif
@@ -0,0 +1,401 @@
+#include "Cpu/FrameCapture.h"
+#include "Cpu/DepthPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    const char CaptureMagic[4] = { 'F', 'P', 'C', 'P' };
+    const uint32_t CaptureVersion = 2;          // 2: the culling settings of the frame
+
+    const uint32_t DepthMax = 0x00ffffff;       // 24 bit unorm 1.0, the cleared depth
+    const int MaxScreenSize = 16384;
+    const uint32_t MaxLightCount = 1u << 24;
+
+    struct FileHeader
+    {
+        char Magic[4];
+        uint32_t Version;
+    };
+
+    struct FrameHeader
+    {
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t TileSize;
+        uint32_t LightCount;
+        uint64_t LightListHash;
+        uint32_t DepthByteCount;
+        uint32_t SuperTileSize;
+        uint32_t MaxLightsPerTile;
+        uint32_t DepthPyramidLevelCount;
+        float View[16];
+        float Projection[16];
+        float InverseProjection[16];
+    };
+
+    static_assert(sizeof(FileHeader) == 8, "FileHeader is written as is");
+    static_assert(sizeof(FrameHeader) == 40 + 3 * 64, "FrameHeader is written as is");
+    static_assert(sizeof(Light) == 112, "Light is written as is, bump CaptureVersion when its layout changes");
+
+    uint32_t QuantizeUnorm24(float depth)
+    {
+        // Exact for depth read back from a D24 buffer as q / 16777215.0f: the product is exact in double and within 0.5 of q
+        double value = std::min(std::max((double)depth, 0.0), 1.0) * DepthMax;
+        return static_cast<uint32_t>(std::lround(value));
+    }
+
+    uint32_t ZigZag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    int32_t UnZigZag(uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    void WriteVarint(std::vector<uint8_t>& bytes, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool ReadVarint(const uint8_t*& bytes, const uint8_t* end, uint32_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            if (bytes == end)
+            {
+                return false;
+            }
+            uint8_t byte = *bytes++;
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Post-projection depth is linear along a row within a plane, so the extrapolation of the two pixels before
+    // leaves residuals of the rounding only, mostly 0 and +-1
+    uint32_t PredictDepth(int x, uint32_t previous, uint32_t beforePrevious)
+    {
+        if (x < 2)
+        {
+            return previous;
+        }
+        int64_t prediction = 2 * static_cast<int64_t>(previous) - beforePrevious;
+        return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(prediction, 0), DepthMax));
+    }
+
+    // Tokens: (zero residual count << 1) | 1, or ZigZag(residual) << 1
+    void EncodeDepth(const float* depth, int width, int height, std::vector<uint8_t>& bytes)
+    {
+        bytes.clear();
+        for (int y = 0; y < height; ++y)
+        {
+            const float* row = depth + static_cast<size_t>(y) * width;
+            uint32_t previous = DepthMax;
+            uint32_t beforePrevious = DepthMax;
+            uint32_t zeroCount = 0;
+
+            for (int x = 0; x < width; ++x)
+            {
+                uint32_t value = QuantizeUnorm24(row[x]);
+                int32_t residual = static_cast<int32_t>(value) - static_cast<int32_t>(PredictDepth(x, previous, beforePrevious));
+
+                if (residual == 0)
+                {
+                    ++zeroCount;
+                }
+                else
+                {
+                    if (zeroCount > 0)
+                    {
+                        WriteVarint(bytes, (zeroCount << 1) | 1);
+                        zeroCount = 0;
+                    }
+                    WriteVarint(bytes, ZigZag(residual) << 1);
+                }
+
+                beforePrevious = previous;
+                previous = value;
+            }
+
+            if (zeroCount > 0)
+            {
+                WriteVarint(bytes, (zeroCount << 1) | 1);
+            }
+        }
+    }
+
+    bool DecodeDepth(const std::vector<uint8_t>& bytes, int width, int height, float* depth)
+    {
+        const uint8_t* read = bytes.data();
+        const uint8_t* end = read + bytes.size();
+
+        for (int y = 0; y < height; ++y)
+        {
+            float* row = depth + static_cast<size_t>(y) * width;
+            uint32_t previous = DepthMax;
+            uint32_t beforePrevious = DepthMax;
+
+            int x = 0;
+            while (x < width)
+            {
+                uint32_t token;
+                if (!ReadVarint(read, end, token))
+                {
+                    return false;
+                }
+
+                uint32_t zeroCount = (token & 1) ? token >> 1 : 1;
+                int32_t residual = (token & 1) ? 0 : UnZigZag(token >> 1);
+                if (zeroCount == 0 || zeroCount > static_cast<uint32_t>(width - x))
+                {
+                    return false;
+                }
+
+                for (uint32_t i = 0; i < zeroCount; ++i, ++x)
+                {
+                    int64_t value = static_cast<int64_t>(PredictDepth(x, previous, beforePrevious)) + residual;
+                    if (value < 0 || value > DepthMax)
+                    {
+                        return false;
+                    }
+
+                    // Same conversion as SimpleObj::ReadDepthBuffer()
+                    row[x] = static_cast<uint32_t>(value) / 16777215.0f;
+                    beforePrevious = previous;
+                    previous = static_cast<uint32_t>(value);
+                }
+            }
+        }
+
+        return read == end;
+    }
+}
+
+FrameCaptureWriter::~FrameCaptureWriter()
+{
+    Close();
+}
+
+bool FrameCaptureWriter::Open(const char* path)
+{
+    Close();
+
+    m_File = std::fopen(path, "wb");
+    m_Failed = false;
+    m_FrameCount = 0;
+    m_ByteCount = 0;
+    if (!m_File)
+    {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.Magic, CaptureMagic, sizeof(header.Magic));
+    header.Version = CaptureVersion;
+    m_Failed = std::fwrite(&header, sizeof(header), 1, m_File) != 1;
+    m_ByteCount = sizeof(header);
+    return !m_Failed;
+}
+
+bool FrameCaptureWriter::Write(const CapturedFrame& frame)
+{
+    if (!m_File || m_Failed)
+    {
+        return false;
+    }
+
+    size_t pixelCount = static_cast<size_t>(frame.Width) * frame.Height;
+    if (frame.Width <= 0 || frame.Height <= 0 || frame.Width > MaxScreenSize || frame.Height > MaxScreenSize ||
+        frame.TileSize <= 0 || frame.SuperTileSize < 0 || frame.MaxLightsPerTile < 0 || frame.DepthPyramidLevelCount < 0 ||
+        frame.Depth.size() != pixelCount || frame.Lights.size() > MaxLightCount)
+    {
+        return false;
+    }
+
+    EncodeDepth(frame.Depth.data(), frame.Width, frame.Height, m_EncodedDepth);
+
+    FrameHeader header = {};
+    header.Width = static_cast<uint32_t>(frame.Width);
+    header.Height = static_cast<uint32_t>(frame.Height);
+    header.TileSize = static_cast<uint32_t>(frame.TileSize);
+    header.LightCount = static_cast<uint32_t>(frame.Lights.size());
+    header.LightListHash = frame.LightListHash;
+    header.DepthByteCount = static_cast<uint32_t>(m_EncodedDepth.size());
+    header.SuperTileSize = static_cast<uint32_t>(frame.SuperTileSize);
+    header.MaxLightsPerTile = static_cast<uint32_t>(frame.MaxLightsPerTile);
+    header.DepthPyramidLevelCount = static_cast<uint32_t>(frame.DepthPyramidLevelCount);
+    std::memcpy(header.View, frame.View.m, sizeof(header.View));
+    std::memcpy(header.Projection, frame.Projection.m, sizeof(header.Projection));
+    std::memcpy(header.InverseProjection, frame.InverseProjection.m, sizeof(header.InverseProjection));
+
+    bool written = std::fwrite(&header, sizeof(header), 1, m_File) == 1;
+    written = written && std::fwrite(frame.Lights.data(), sizeof(Light), frame.Lights.size(), m_File) == frame.Lights.size();
+    written = written && std::fwrite(m_EncodedDepth.data(), 1, m_EncodedDepth.size(), m_File) == m_EncodedDepth.size();
+
+    m_Failed = !written;
+    if (written)
+    {
+        ++m_FrameCount;
+        m_ByteCount += sizeof(header) + sizeof(Light) * frame.Lights.size() + m_EncodedDepth.size();
+    }
+    return written;
+}
+
+bool FrameCaptureWriter::Close()
+{
+    if (!m_File)
+    {
+        return !m_Failed;
+    }
+
+    bool closed = std::fclose(m_File) == 0;
+    m_File = nullptr;
+    m_Failed = m_Failed || !closed;
+    return !m_Failed;
+}
+
+FrameCaptureReader::~FrameCaptureReader()
+{
+    Close();
+}
+
+bool FrameCaptureReader::Open(const char* path)
+{
+    Close();
+
+    m_File = std::fopen(path, "rb");
+    m_Failed = m_File == nullptr;
+    if (m_Failed)
+    {
+        return false;
+    }
+
+    FileHeader header;
+    m_Failed = std::fread(&header, sizeof(header), 1, m_File) != 1 ||
+        std::memcmp(header.Magic, CaptureMagic, sizeof(header.Magic)) != 0 || header.Version != CaptureVersion;
+    if (m_Failed)
+    {
+        Close();
+    }
+    return !m_Failed;
+}
+
+bool FrameCaptureReader::Read(CapturedFrame& frame)
+{
+    if (!m_File || m_Failed)
+    {
+        return false;
+    }
+
+    FrameHeader header;
+    size_t headerBytes = std::fread(&header, 1, sizeof(header), m_File);
+    if (headerBytes == 0 && std::feof(m_File))
+    {
+        return false;
+    }
+
+    m_Failed = headerBytes != sizeof(header) || header.Width == 0 || header.Height == 0 || header.Width > MaxScreenSize ||
+        header.Height > MaxScreenSize || header.TileSize == 0 || header.LightCount > MaxLightCount ||
+        header.SuperTileSize > MaxScreenSize || header.MaxLightsPerTile > MaxLightCount ||
+        header.DepthPyramidLevelCount > DepthPyramid::MaxLevelCount ||
+        header.DepthByteCount > static_cast<uint64_t>(header.Width) * header.Height * 5;
+    if (m_Failed)
+    {
+        return false;
+    }
+
+    frame.Width = static_cast<int>(header.Width);
+    frame.Height = static_cast<int>(header.Height);
+    frame.TileSize = static_cast<int>(header.TileSize);
+    frame.SuperTileSize = static_cast<int>(header.SuperTileSize);
+    frame.MaxLightsPerTile = static_cast<int>(header.MaxLightsPerTile);
+    frame.DepthPyramidLevelCount = static_cast<int>(header.DepthPyramidLevelCount);
+    frame.LightListHash = header.LightListHash;
+    frame.View = Float4x4::FromRowMajor(header.View);
+    frame.Projection = Float4x4::FromRowMajor(header.Projection);
+    frame.InverseProjection = Float4x4::FromRowMajor(header.InverseProjection);
+
+    frame.Lights.resize(header.LightCount);
+    m_EncodedDepth.resize(header.DepthByteCount);
+    frame.Depth.resize(static_cast<size_t>(header.Width) * header.Height);
+
+    m_Failed = std::fread(frame.Lights.data(), sizeof(Light), frame.Lights.size(), m_File) != frame.Lights.size() ||
+        std::fread(m_EncodedDepth.data(), 1, m_EncodedDepth.size(), m_File) != m_EncodedDepth.size() ||
+        !DecodeDepth(m_EncodedDepth, frame.Width, frame.Height, frame.Depth.data());
+
+    m_LastFrameByteCount = sizeof(header) + sizeof(Light) * frame.Lights.size() + m_EncodedDepth.size();
+    return !m_Failed;
+}
+
+void FrameCaptureReader::Close()
+{
+    if (m_File)
+    {
+        std::fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+void Cpu::QuantizeDepth24(float* depth, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        depth[i] = QuantizeUnorm24(depth[i]) / 16777215.0f;
+    }
+}
+
+uint64_t Cpu::HashLightLists(const LightCullResult& result)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](uint32_t value)
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    add(static_cast<uint32_t>(result.TileCountX));
+    add(static_cast<uint32_t>(result.TileCountY));
+
+    // Per tile counts and lights in tile order, so the hash does not depend on where the lists sit in the index list
+    auto addLists = [&add](const std::vector<uint2>& grid, const std::vector<uint32_t>& list)
+    {
+        add(static_cast<uint32_t>(grid.size()));
+        for (const uint2& cell : grid)
+        {
+            add(cell.y);
+            for (uint32_t i = 0; i < cell.y; ++i)
+            {
+                add(list[cell.x + i]);
+            }
+        }
+    };
+
+    addLists(result.LightGrid, result.LightIndexList);
+    addLists(result.TransparentLightGrid, result.TransparentLightIndexList);
+
+    add(static_cast<uint32_t>(result.GlobalLightIndexList.size()));
+    for (uint32_t index : result.GlobalLightIndexList)
+    {
+        add(index);
+    }
+
+    return hash;
+}
@@ -0,0 +1,80 @@
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/Culling.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+Frustum Cpu::ComputeTileFrustum(const Float4x4& inverseProjection, const Float2& screenDimensions, int tileX, int tileY, int blockSize)
+{
+    const Float3 eyePos(0, 0, 0);
+
+    // z = 1 for left-hand coodinate system
+    const float z = 1.0f;
+    const float block = static_cast<float>(blockSize);
+
+    Float4 screenSpace[4];
+    screenSpace[0] = Float4((tileX    ) * block, (tileY    ) * block, z, 1.0f); // top-left point
+    screenSpace[1] = Float4((tileX + 1) * block, (tileY    ) * block, z, 1.0f); // top-right point
+    screenSpace[2] = Float4((tileX    ) * block, (tileY + 1) * block, z, 1.0f); // bottom-left point
+    screenSpace[3] = Float4((tileX + 1) * block, (tileY + 1) * block, z, 1.0f); // bottom-right point
+
+    Float3 viewSpace[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        viewSpace[i] = ScreenToView(screenSpace[i], screenDimensions, inverseProjection).xyz();
+    }
+
+    Frustum frustum;
+    frustum.plane[0] = ComputePlane(eyePos, viewSpace[0], viewSpace[2]); // left plane
+    frustum.plane[1] = ComputePlane(eyePos, viewSpace[3], viewSpace[1]); // right plane
+    frustum.plane[2] = ComputePlane(eyePos, viewSpace[1], viewSpace[0]); // top plane
+    frustum.plane[3] = ComputePlane(eyePos, viewSpace[2], viewSpace[3]); // bottom plane
+    return frustum;
+}
+
+void Cpu::ComputeFrustums(const Float4x4& inverseProjection, int width, int height, int blockSize, std::vector<Frustum>& frustums)
+{
+    int tileCountX = GetTileCount(width, blockSize);
+    int tileCountY = GetTileCount(height, blockSize);
+    Float2 screenDimensions(static_cast<float>(width), static_cast<float>(height));
+
+    frustums.resize(static_cast<size_t>(tileCountX) * tileCountY);
+
+    for (int y = 0; y < tileCountY; ++y)
+    {
+        for (int x = 0; x < tileCountX; ++x)
+        {
+            frustums[x + y * tileCountX] = ComputeTileFrustum(inverseProjection, screenDimensions, x, y, blockSize);
+        }
+    }
+}
+
+void Cpu::ComputeFrustumPlanes(const Float4x4& inverseProjection, int width, int height, int blockSize, FrustumPlaneGrid& grid)
+{
+    grid.TileCountX = GetTileCount(width, blockSize);
+    grid.TileCountY = GetTileCount(height, blockSize);
+    grid.Planes.resize(static_cast<size_t>(grid.TileCountX) + grid.TileCountY + 2);
+
+    const Float3 eyePos(0, 0, 0);
+    const float z = 1.0f;
+    const float block = static_cast<float>(blockSize);
+    Float2 screenDimensions(static_cast<float>(width), static_cast<float>(height));
+
+    // Each edge goes from one end of the grid to the other, the same line as the tile corners on it
+    float right = grid.TileCountX * block;
+    float bottom = grid.TileCountY * block;
+
+    for (int x = 0; x <= grid.TileCountX; ++x)
+    {
+        Float3 topPoint = ScreenToView(Float4(x * block, 0.0f, z, 1.0f), screenDimensions, inverseProjection).xyz();
+        Float3 bottomPoint = ScreenToView(Float4(x * block, bottom, z, 1.0f), screenDimensions, inverseProjection).xyz();
+        grid.Planes[x] = ComputePlane(eyePos, topPoint, bottomPoint); // left plane winding
+    }
+
+    for (int y = 0; y <= grid.TileCountY; ++y)
+    {
+        Float3 leftPoint = ScreenToView(Float4(0.0f, y * block, z, 1.0f), screenDimensions, inverseProjection).xyz();
+        Float3 rightPoint = ScreenToView(Float4(right, y * block, z, 1.0f), screenDimensions, inverseProjection).xyz();
+        grid.Planes[grid.TileCountX + 1 + y] = ComputePlane(eyePos, rightPoint, leftPoint); // top plane winding
+    }
+}
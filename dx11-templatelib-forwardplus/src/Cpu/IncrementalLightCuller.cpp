@@ -0,0 +1,319 @@
+#include "Cpu/IncrementalLightCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    bool Contains(const TileRect& rect, int x, int y)
+    {
+        return x >= rect.MinX && x <= rect.MaxX && y >= rect.MinY && y <= rect.MaxY;
+    }
+}
+
+IncrementalLightCuller::IncrementalLightCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+    , m_Culler(threadPool)
+{
+}
+
+void IncrementalLightCuller::Invalidate()
+{
+    m_Valid = false;
+}
+
+uint32_t IncrementalLightCuller::GetLightDirtyFlags(const Light& previous, const Light& light)
+{
+    uint32_t flags = 0;
+
+    if (previous.LightType != light.LightType || previous.SpotAngle != light.SpotAngle ||
+        previous.PositionVS.x != light.PositionVS.x || previous.PositionVS.y != light.PositionVS.y || previous.PositionVS.z != light.PositionVS.z ||
+        previous.DirectionVS.x != light.DirectionVS.x || previous.DirectionVS.y != light.DirectionVS.y || previous.DirectionVS.z != light.DirectionVS.z)
+    {
+        flags |= LightDirtyPosition;
+    }
+
+    if (previous.ConstantAttenuation != light.ConstantAttenuation || previous.LinearAttenuation != light.LinearAttenuation ||
+        previous.QuadraticAttenuation != light.QuadraticAttenuation || previous.Strength != light.Strength ||
+        previous.Color.x != light.Color.x || previous.Color.y != light.Color.y || previous.Color.z != light.Color.z)
+    {
+        flags |= LightDirtyRange;
+    }
+
+    if ((previous.Enabled != 0) != (light.Enabled != 0))
+    {
+        flags |= LightDirtyEnabled;
+    }
+
+    return flags;
+}
+
+const char* IncrementalLightCuller::GetRebuildReason(const LightCullInput& input, const IncrementalCullSettings& settings) const
+{
+    if (!m_Valid)
+    {
+        return "first frame";
+    }
+
+    if (settings.DepthChanged || input.Depth != m_Input.Depth || input.Pyramid != m_Input.Pyramid)
+    {
+        return "depth changed";
+    }
+
+    if (input.Width != m_Input.Width || input.Height != m_Input.Height || input.BlockSize != m_Input.BlockSize ||
+        input.Frustums != m_Input.Frustums || input.FrustumPlanes != m_Input.FrustumPlanes ||
+        std::memcmp(&input.InverseProjection, &m_Input.InverseProjection, sizeof(Float4x4)) != 0)
+    {
+        return "camera changed";
+    }
+
+    if (input.UseDepthMask != m_Input.UseDepthMask || input.BuildTransparentLists != m_Input.BuildTransparentLists ||
+        input.UseGlobalLightList != m_Input.UseGlobalLightList)
+    {
+        return "settings changed";
+    }
+
+    if (input.LightCount != m_Input.LightCount)
+    {
+        return "light count changed";
+    }
+
+    return nullptr;
+}
+
+void IncrementalLightCuller::Rebuild(const LightCullInput& input, const char* reason)
+{
+    // A cut list depends on every light of its tile, the updates keep whole lists
+    LightCullInput fullInput = input;
+    fullInput.MaxLightsPerTile = 0;
+    m_Culler.Cull(fullInput, m_Result);
+
+    m_Valid = true;
+    m_Input = input;
+    m_Lights.assign(input.Lights, input.Lights + input.LightCount);
+    m_Projection = Inverse(input.InverseProjection);
+    m_NearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+
+    m_Stats.FullRebuild = true;
+    m_Stats.Reason = reason;
+    m_Stats.UpdatedTiles = m_Result.TileCount();
+    m_Stats.LightTestCount = m_Result.LightTestCount;
+}
+
+const LightCullResult& IncrementalLightCuller::Cull(const LightCullInput& input, const IncrementalCullSettings& settings)
+{
+    m_Stats = IncrementalCullStats();
+
+    const char* reason = GetRebuildReason(input, settings);
+    if (reason)
+    {
+        Rebuild(input, reason);
+        return Finish(input);
+    }
+
+    m_DirtyLights.clear();
+    for (size_t i = 0; i < input.LightCount; ++i)
+    {
+        if (GetLightDirtyFlags(m_Lights[i], input.Lights[i]))
+        {
+            m_DirtyLights.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    m_Stats.DirtyLights = m_DirtyLights.size();
+
+    if (m_DirtyLights.size() > settings.MaxDirtyLightFraction * input.LightCount)
+    {
+        Rebuild(input, "too many dirty lights");
+        m_Stats.DirtyLights = m_DirtyLights.size();
+        return Finish(input);
+    }
+
+    if (!m_DirtyLights.empty())
+    {
+        UpdateTiles(input);
+
+        // Directional lights are not in the tile lists with the global list, but may have joined or left it
+        bool globalLightsDirty = false;
+        for (uint32_t i : m_DirtyLights)
+        {
+            globalLightsDirty = globalLightsDirty || (LightType)m_Lights[i].LightType == LightType::Directional ||
+                (LightType)input.Lights[i].LightType == LightType::Directional;
+            m_Lights[i] = input.Lights[i];
+        }
+
+        if (globalLightsDirty)
+        {
+            GatherGlobalLights(input, m_Result.GlobalLightIndexList);
+        }
+    }
+
+    return Finish(input);
+}
+
+const LightCullResult& IncrementalLightCuller::Finish(const LightCullInput& input)
+{
+    // The counters of this frame, not of the last rebuild
+    m_Result.LightTestCount = m_Stats.LightTestCount;
+    m_Result.TruncatedListCount = 0;
+    m_Result.DroppedLightCount = 0;
+
+    m_Output = &m_Result;
+    if (input.MaxLightsPerTile > 0)
+    {
+        m_BudgetResult = m_Result;
+        ApplyLightBudget(m_ThreadPool, input, m_BudgetResult);
+        m_Output = &m_BudgetResult;
+    }
+    return *m_Output;
+}
+
+void IncrementalLightCuller::UpdateTiles(const LightCullInput& input)
+{
+    int tileCountX = m_Result.TileCountX;
+    size_t tileCount = m_Result.TileCount();
+    float farDepthVS = m_Culler.GetFarDepthVS();
+
+    // The tiles that listed a dirty light and the tiles that may list it now
+    m_DirtyRects.resize(2 * m_DirtyLights.size());
+    m_TileUpdated.assign(tileCount, 0);
+    m_UpdatedTiles.clear();
+
+    for (size_t d = 0; d < m_DirtyLights.size(); ++d)
+    {
+        uint32_t i = m_DirtyLights[d];
+        m_DirtyRects[2 * d] = ScatterLightCuller::GetLightTileRect(input, m_Projection, m_NearClipVS, farDepthVS, m_Lights[i]);
+        m_DirtyRects[2 * d + 1] = ScatterLightCuller::GetLightTileRect(input, m_Projection, m_NearClipVS, farDepthVS, input.Lights[i]);
+
+        for (int r = 0; r < 2; ++r)
+        {
+            const TileRect& rect = m_DirtyRects[2 * d + r];
+            for (int y = rect.MinY; y <= rect.MaxY; ++y)
+            {
+                for (int x = rect.MinX; x <= rect.MaxX; ++x)
+                {
+                    size_t tile = x + static_cast<size_t>(y) * tileCountX;
+                    if (!m_TileUpdated[tile])
+                    {
+                        m_TileUpdated[tile] = 1;
+                        m_UpdatedTiles.push_back(static_cast<uint32_t>(tile));
+                    }
+                }
+            }
+        }
+    }
+    std::sort(m_UpdatedTiles.begin(), m_UpdatedTiles.end());
+    m_Stats.UpdatedTiles = m_UpdatedTiles.size();
+
+    // Test the dirty lights against every updated tile their new rectangle covers, (light, TileLightFlags) per tile
+    const std::vector<TileCullContext>& contexts = m_Culler.GetTileContexts();
+    m_TileAdds.resize(m_UpdatedTiles.size());
+    std::vector<uint64_t> testCounts(m_UpdatedTiles.size(), 0);
+
+    m_ThreadPool.ParallelFor(m_UpdatedTiles.size(), 16, [&](size_t begin, size_t end)
+    {
+        for (size_t u = begin; u < end; ++u)
+        {
+            uint32_t tile = m_UpdatedTiles[u];
+            int x = static_cast<int>(tile % tileCountX);
+            int y = static_cast<int>(tile / tileCountX);
+
+            std::vector<uint2>& adds = m_TileAdds[u];
+            adds.clear();
+            for (size_t d = 0; d < m_DirtyLights.size(); ++d)
+            {
+                if (!Contains(m_DirtyRects[2 * d + 1], x, y))
+                {
+                    continue;
+                }
+
+                uint32_t i = m_DirtyLights[d];
+                uint32_t flags = TiledLightCuller::TestLight(contexts[tile], input.Lights[i],
+                    input.DerivedLights ? &input.DerivedLights[i] : nullptr);
+                ++testCounts[u];
+                if (flags)
+                {
+                    adds.push_back(uint2 { i, flags });
+                }
+            }
+        }
+    });
+
+    for (uint64_t testCount : testCounts)
+    {
+        m_Stats.LightTestCount += testCount;
+    }
+
+    UpdateLists(TileLightOpaque, m_Result.LightGrid, m_Result.LightIndexList);
+    if (input.BuildTransparentLists)
+    {
+        UpdateLists(TileLightTransparent, m_Result.TransparentLightGrid, m_Result.TransparentLightIndexList);
+    }
+}
+
+void IncrementalLightCuller::UpdateLists(uint32_t flag, std::vector<uint2>& grid, std::vector<uint32_t>& indexList)
+{
+    size_t tileCount = grid.size();
+    m_Grid.resize(tileCount);
+    m_IndexList.clear();
+    m_IndexList.reserve(indexList.size() + m_UpdatedTiles.size());
+
+    size_t updated = 0;
+    size_t tile = 0;
+    while (tile < tileCount)
+    {
+        // Copy the run of unchanged tiles up to the next updated one in one go
+        size_t runEnd = updated < m_UpdatedTiles.size() ? m_UpdatedTiles[updated] : tileCount;
+        if (runEnd > tile)
+        {
+            uint32_t first = grid[tile].x;
+            uint32_t last = grid[runEnd - 1].x + grid[runEnd - 1].y;
+            uint32_t shift = static_cast<uint32_t>(m_IndexList.size()) - first;
+            m_IndexList.insert(m_IndexList.end(), indexList.begin() + first, indexList.begin() + last);
+            for (size_t t = tile; t < runEnd; ++t)
+            {
+                m_Grid[t] = uint2 { grid[t].x + shift, grid[t].y };
+            }
+            tile = runEnd;
+            continue;
+        }
+
+        // Merge the clean lights of the tile with its accepted dirty lights, both in ascending order
+        uint32_t offset = static_cast<uint32_t>(m_IndexList.size());
+        const uint32_t* list = indexList.data() + grid[tile].x;
+        const uint32_t* listEnd = list + grid[tile].y;
+        const std::vector<uint2>& adds = m_TileAdds[updated];
+        auto add = adds.begin();
+
+        while (list != listEnd || add != adds.end())
+        {
+            if (add != adds.end() && (list == listEnd || add->x < *list))
+            {
+                if (add->y & flag)
+                {
+                    m_IndexList.push_back(add->x);
+                }
+                ++add;
+            }
+            else
+            {
+                if (!std::binary_search(m_DirtyLights.begin(), m_DirtyLights.end(), *list))
+                {
+                    m_IndexList.push_back(*list);
+                }
+                ++list;
+            }
+        }
+
+        m_Grid[tile] = uint2 { offset, static_cast<uint32_t>(m_IndexList.size()) - offset };
+        ++updated;
+        ++tile;
+    }
+
+    grid.swap(m_Grid);
+    indexList.swap(m_IndexList);
+}
@@ -0,0 +1,453 @@
+#include "Cpu/LightBvh.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightListCompaction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Keys per radix sort block, fixed so the blocks and their histograms do not depend on the number of threads
+    const size_t SortBlockSize = 16384;
+    const int RadixBits = 8;
+    const uint32_t RadixSize = 1u << RadixBits;
+    const int MortonBits = 30;
+
+    const size_t LeafGrainSize = 1024;
+
+    AABB EmptyBox()
+    {
+        float max = std::numeric_limits<float>::max();
+        return { Float3(max, max, max), Float3(-max, -max, -max) };
+    }
+
+    AABB Union(const AABB& a, const AABB& b)
+    {
+        return {
+            Float3(std::min(a.Min.x, b.Min.x), std::min(a.Min.y, b.Min.y), std::min(a.Min.z, b.Min.z)),
+            Float3(std::max(a.Max.x, b.Max.x), std::max(a.Max.y, b.Max.y), std::max(a.Max.z, b.Max.z))
+        };
+    }
+
+    // Box around the bounding sphere, grown by a little more than the rounding of the sphere tests so a box
+    // never rejects a frustum its sphere touches. Empty for disabled lights.
+    AABB GetLeafBox(const Light& light)
+    {
+        Sphere sphere;
+        if (!light.Enabled || !GetLightBoundingSphere(light, sphere))
+        {
+            return EmptyBox();
+        }
+
+        float r = sphere.r * 1.0001f + 1e-4f;
+        return { Float3(sphere.c.x - r, sphere.c.y - r, sphere.c.z - r), Float3(sphere.c.x + r, sphere.c.y + r, sphere.c.z + r) };
+    }
+
+    // Spread the low 10 bits of v to every third bit
+    uint32_t ExpandBits(uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    uint32_t GetMortonCode(const Float3& p, const AABB& bounds)
+    {
+        auto quantize = [](float v, float min, float max)
+        {
+            float extent = max - min;
+            float t = extent > 0.0f ? (v - min) / extent : 0.0f;
+            return static_cast<uint32_t>(std::min(std::max(t * 1024.0f, 0.0f), 1023.0f));
+        };
+
+        uint32_t x = quantize(p.x, bounds.Min.x, bounds.Max.x);
+        uint32_t y = quantize(p.y, bounds.Min.y, bounds.Max.y);
+        uint32_t z = quantize(p.z, bounds.Min.z, bounds.Max.z);
+        return (ExpandBits(x) << 2) | (ExpandBits(y) << 1) | ExpandBits(z);
+    }
+}
+
+LightBvh::LightBvh(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void LightBvh::Build(const Light* lights, size_t lightCount)
+{
+    m_LightCount = lightCount;
+    m_Bounded.resize(lightCount);
+    m_UnboundedLights.clear();
+    m_LeafLights.clear();
+
+    Sphere sphere;
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        m_Bounded[i] = GetLightBoundingSphere(lights[i], sphere) ? 1 : 0;
+        if (m_Bounded[i])
+        {
+            m_LeafLights.push_back(static_cast<uint32_t>(i));
+        }
+        else
+        {
+            m_UnboundedLights.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    size_t leafCount = m_LeafLights.size();
+    if (leafCount == 0)
+    {
+        m_Nodes.clear();
+        m_FirstLeaf = 0;
+        return;
+    }
+
+    // 1. bounds of the sphere centers, per block then merged
+    size_t blockCount = (leafCount + SortBlockSize - 1) / SortBlockSize;
+    m_BlockBounds.assign(blockCount, EmptyBox());
+    m_ThreadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        Sphere center;
+        for (size_t block = begin; block < end; ++block)
+        {
+            AABB box = EmptyBox();
+            size_t last = std::min((block + 1) * SortBlockSize, leafCount);
+            for (size_t k = block * SortBlockSize; k < last; ++k)
+            {
+                GetLightBoundingSphere(lights[m_LeafLights[k]], center);
+                box = Union(box, { center.c, center.c });
+            }
+            m_BlockBounds[block] = box;
+        }
+    });
+
+    AABB centerBounds = EmptyBox();
+    for (const AABB& box : m_BlockBounds)
+    {
+        centerBounds = Union(centerBounds, box);
+    }
+
+    // 2. Morton code of every leaf, sorted with the leaf order
+    m_Keys.resize(leafCount);
+    m_Values.resize(leafCount);
+    m_ThreadPool.ParallelFor(leafCount, LeafGrainSize, [&](size_t begin, size_t end)
+    {
+        Sphere center;
+        for (size_t k = begin; k < end; ++k)
+        {
+            GetLightBoundingSphere(lights[m_LeafLights[k]], center);
+            m_Keys[k] = GetMortonCode(center.c, centerBounds);
+            m_Values[k] = static_cast<uint32_t>(k);
+        }
+    });
+
+    SortKeys();
+
+    // Leaves in Morton order, lights with the same code stay in ascending light order
+    for (size_t k = 0; k < leafCount; ++k)
+    {
+        m_ValueScratch[k] = m_LeafLights[m_Values[k]];
+    }
+    m_LeafLights.swap(m_ValueScratch);
+
+    // 3. internal nodes from the sorted codes, then the boxes bottom-up
+    m_FirstLeaf = static_cast<uint32_t>(leafCount - 1);
+    m_Nodes.resize(2 * leafCount - 1);
+    BuildInternalNodes();
+    ComputeLeafBoxes(lights);
+    MergeBoxes();
+}
+
+bool LightBvh::Refit(const Light* lights, size_t lightCount)
+{
+    if (lightCount != m_LightCount)
+    {
+        return false;
+    }
+
+    Sphere sphere;
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        if ((GetLightBoundingSphere(lights[i], sphere) ? 1 : 0) != m_Bounded[i])
+        {
+            return false;
+        }
+    }
+
+    if (!m_Nodes.empty())
+    {
+        ComputeLeafBoxes(lights);
+        MergeBoxes();
+    }
+    return true;
+}
+
+void LightBvh::SortKeys()
+{
+    // LSD radix sort of (key, value) pairs: per block digit histograms, a serial scan over (digit, block), then every
+    // block scatters its keys in order, so every pass is stable
+    size_t count = m_Keys.size();
+    size_t blockCount = (count + SortBlockSize - 1) / SortBlockSize;
+    m_KeyScratch.resize(count);
+    m_ValueScratch.resize(count);
+    m_Histograms.resize(blockCount * RadixSize);
+
+    for (int shift = 0; shift < MortonBits; shift += RadixBits)
+    {
+        m_ThreadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t block = begin; block < end; ++block)
+            {
+                uint32_t* histogram = m_Histograms.data() + block * RadixSize;
+                std::fill(histogram, histogram + RadixSize, 0u);
+
+                size_t last = std::min((block + 1) * SortBlockSize, count);
+                for (size_t k = block * SortBlockSize; k < last; ++k)
+                {
+                    ++histogram[(m_Keys[k] >> shift) & (RadixSize - 1)];
+                }
+            }
+        });
+
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < RadixSize; ++digit)
+        {
+            for (size_t block = 0; block < blockCount; ++block)
+            {
+                uint32_t& slot = m_Histograms[block * RadixSize + digit];
+                uint32_t digitCount = slot;
+                slot = offset;
+                offset += digitCount;
+            }
+        }
+
+        m_ThreadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t block = begin; block < end; ++block)
+            {
+                uint32_t* cursors = m_Histograms.data() + block * RadixSize;
+                size_t last = std::min((block + 1) * SortBlockSize, count);
+                for (size_t k = block * SortBlockSize; k < last; ++k)
+                {
+                    uint32_t destination = cursors[(m_Keys[k] >> shift) & (RadixSize - 1)]++;
+                    m_KeyScratch[destination] = m_Keys[k];
+                    m_ValueScratch[destination] = m_Values[k];
+                }
+            }
+        });
+
+        m_Keys.swap(m_KeyScratch);
+        m_Values.swap(m_ValueScratch);
+    }
+}
+
+void LightBvh::BuildInternalNodes()
+{
+    // Karras 2012, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees".
+    // Equal codes are told apart by their position, appended below the code.
+    const int leafCount = static_cast<int>(m_Keys.size());
+    const uint32_t* keys = m_Keys.data();
+
+    // Length of the common prefix of the keys of leaves i and j, -1 outside the leaves
+    auto delta = [leafCount, keys](int i, int j) -> int
+    {
+        if (j < 0 || j >= leafCount)
+        {
+            return -1;
+        }
+        uint64_t a = (static_cast<uint64_t>(keys[i]) << 32) | static_cast<uint32_t>(i);
+        uint64_t b = (static_cast<uint64_t>(keys[j]) << 32) | static_cast<uint32_t>(j);
+        return 63 - static_cast<int>(FirstBitHigh(a ^ b));
+    };
+
+    m_Nodes[m_FirstLeaf].Parent = 0;
+    m_ThreadPool.ParallelFor(m_FirstLeaf, LeafGrainSize, [&](size_t begin, size_t end)
+    {
+        for (size_t node = begin; node < end; ++node)
+        {
+            int i = static_cast<int>(node);
+
+            // Direction of the range of the node, and its other end
+            int d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+            int minDelta = delta(i, i - d);
+
+            int maxLength = 2;
+            while (delta(i, i + maxLength * d) > minDelta)
+            {
+                maxLength *= 2;
+            }
+
+            int length = 0;
+            for (int t = maxLength / 2; t >= 1; t /= 2)
+            {
+                if (delta(i, i + (length + t) * d) > minDelta)
+                {
+                    length += t;
+                }
+            }
+            int j = i + length * d;
+
+            // Split: the last leaf sharing more than the common prefix of the range with leaf i
+            int nodeDelta = delta(i, j);
+            int split = 0;
+            int step = length;
+            do
+            {
+                step = (step + 1) / 2;
+                if (delta(i, i + (split + step) * d) > nodeDelta)
+                {
+                    split += step;
+                }
+            } while (step > 1);
+            int gamma = i + split * d + std::min(d, 0);
+
+            Node& n = m_Nodes[node];
+            n.Left = std::min(i, j) == gamma ? m_FirstLeaf + gamma : gamma;
+            n.Right = std::max(i, j) == gamma + 1 ? m_FirstLeaf + gamma + 1 : gamma + 1;
+            m_Nodes[n.Left].Parent = static_cast<uint32_t>(node);
+            m_Nodes[n.Right].Parent = static_cast<uint32_t>(node);
+        }
+    });
+}
+
+void LightBvh::ComputeLeafBoxes(const Light* lights)
+{
+    m_ThreadPool.ParallelFor(m_LeafLights.size(), LeafGrainSize, [&](size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            m_Nodes[m_FirstLeaf + k].Box = GetLeafBox(lights[m_LeafLights[k]]);
+        }
+    });
+}
+
+void LightBvh::MergeBoxes()
+{
+    size_t internalCount = m_FirstLeaf;
+    if (m_VisitCapacity < internalCount)
+    {
+        m_Visits.reset(new std::atomic<uint32_t>[internalCount]);
+        m_VisitCapacity = internalCount;
+    }
+    for (size_t node = 0; node < internalCount; ++node)
+    {
+        m_Visits[node].store(0, std::memory_order_relaxed);
+    }
+
+    // Every leaf walks up; the first child to reach a node stops there, the second merges both children and goes on.
+    // The union is the same whichever thread computes it.
+    m_ThreadPool.ParallelFor(m_LeafLights.size(), LeafGrainSize, [&](size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            uint32_t node = m_FirstLeaf + static_cast<uint32_t>(k);
+            while (node != 0)
+            {
+                node = m_Nodes[node].Parent;
+                if (m_Visits[node].fetch_add(1, std::memory_order_acq_rel) == 0)
+                {
+                    break;
+                }
+
+                Node& parent = m_Nodes[node];
+                parent.Box = Union(m_Nodes[parent.Left].Box, m_Nodes[parent.Right].Box);
+            }
+        }
+    });
+}
+
+BvhLightCuller::BvhLightCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void BvhLightCuller::Cull(const LightCullInput& input, const LightBvh& bvh, LightCullResult& result)
+{
+    result.TileCountX = GetTileCount(input.Width, input.BlockSize);
+    result.TileCountY = GetTileCount(input.Height, input.BlockSize);
+    result.LightGrid.resize(static_cast<size_t>(result.TileCountX) * result.TileCountY);
+
+    bool transparent = input.BuildTransparentLists;
+    result.TransparentLightGrid.resize(transparent ? result.LightGrid.size() : 0);
+
+    m_RowLightLists.resize(result.TileCountY);
+    m_RowTransparentLightLists.resize(transparent ? result.TileCountY : 0);
+    m_RowLightTestCounts.assign(result.TileCountY, 0);
+    for (auto& list : m_RowLightLists)
+    {
+        list.clear();
+    }
+    for (auto& list : m_RowTransparentLightLists)
+    {
+        list.clear();
+    }
+
+    float nearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+
+    m_ThreadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<uint32_t> candidates;
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            auto& rowList = m_RowLightLists[y];
+            std::vector<uint32_t>* transparentRowList = transparent ? &m_RowTransparentLightLists[y] : nullptr;
+
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                TileDepthBounds bounds = TiledLightCuller::ComputeTileDepthBounds(input, x, static_cast<int>(y));
+                Frustum frustum = TiledLightCuller::GetTileFrustum(input, x, static_cast<int>(y));
+
+                // Both lists of the tile lie within the near-to-max-depth frustum
+                candidates.clear();
+                m_RowLightTestCounts[y] += bvh.Query(frustum, nearClipVS, bounds.MaxDepthVS, [&](uint32_t light)
+                {
+                    if (!input.UseGlobalLightList || (LightType)input.Lights[light].LightType != LightType::Directional)
+                    {
+                        candidates.push_back(light);
+                    }
+                });
+                std::sort(candidates.begin(), candidates.end());
+                m_RowLightTestCounts[y] += candidates.size();
+
+                size_t tileIndex = x + y * result.TileCountX;
+                uint32_t offset = static_cast<uint32_t>(rowList.size());
+                uint32_t transparentOffset = transparentRowList ? static_cast<uint32_t>(transparentRowList->size()) : 0;
+
+                TiledLightCuller::CullTile(input, x, static_cast<int>(y), bounds, candidates.data(), candidates.size(),
+                    rowList, transparentRowList);
+
+                result.LightGrid[tileIndex] = { offset, static_cast<uint32_t>(rowList.size()) - offset };
+                if (transparentRowList)
+                {
+                    result.TransparentLightGrid[tileIndex] = { transparentOffset, static_cast<uint32_t>(transparentRowList->size()) - transparentOffset };
+                }
+            }
+        }
+    });
+
+    CompactRowLists(m_ThreadPool, m_RowLightLists, result.TileCountX, result.LightGrid, result.LightIndexList, m_TileOffsets);
+    if (transparent)
+    {
+        CompactRowLists(m_ThreadPool, m_RowTransparentLightLists, result.TileCountX, result.TransparentLightGrid,
+            result.TransparentLightIndexList, m_TileOffsets);
+    }
+    else
+    {
+        result.TransparentLightIndexList.clear();
+    }
+
+    GatherGlobalLights(input, result.GlobalLightIndexList);
+    ApplyLightBudget(m_ThreadPool, input, result);
+
+    result.LightTestCount = 0;
+    for (uint64_t count : m_RowLightTestCounts)
+    {
+        result.LightTestCount += count;
+    }
+}
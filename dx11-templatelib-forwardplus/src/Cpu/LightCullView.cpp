@@ -0,0 +1,78 @@
+#include "Cpu/LightCullView.h"
+#include "Cpu/Culling.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+void LightCullView::Build(const Light* lights, size_t count)
+{
+    Count = count;
+    PaddedCount = (count + Alignment - 1) / Alignment * Alignment;
+
+    PositionX.assign(PaddedCount, 0.0f);
+    PositionY.assign(PaddedCount, 0.0f);
+    PositionZ.assign(PaddedCount, 0.0f);
+    Radius.assign(PaddedCount, 0.0f);
+    DirectionX.assign(PaddedCount, 0.0f);
+    DirectionY.assign(PaddedCount, 0.0f);
+    DirectionZ.assign(PaddedCount, 0.0f);
+    ConeRadius.assign(PaddedCount, 0.0f);
+    SpotCos.assign(PaddedCount, 0.0f);
+    SpotSin.assign(PaddedCount, 0.0f);
+    BoundsX.assign(PaddedCount, 0.0f);
+    BoundsY.assign(PaddedCount, 0.0f);
+    BoundsZ.assign(PaddedCount, 0.0f);
+    BoundsRadius.assign(PaddedCount, 0.0f);
+    Type.assign(PaddedCount, Disabled);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Light& light = lights[i];
+        if (!light.Enabled)
+        {
+            continue;
+        }
+
+        switch ((LightType)light.LightType)
+        {
+        case LightType::Point:
+        {
+            Sphere sphere = GetLightSphere(light);
+            PositionX[i] = sphere.c.x;
+            PositionY[i] = sphere.c.y;
+            PositionZ[i] = sphere.c.z;
+            Radius[i] = sphere.r;
+            Type[i] = Point;
+        }
+        break;
+
+        case LightType::Spotlight:
+        {
+            SpotVolume spot = GetLightSpotVolume(light);
+            PositionX[i] = spot.C.T.x;
+            PositionY[i] = spot.C.T.y;
+            PositionZ[i] = spot.C.T.z;
+            Radius[i] = spot.C.h;
+            DirectionX[i] = spot.C.d.x;
+            DirectionY[i] = spot.C.d.y;
+            DirectionZ[i] = spot.C.d.z;
+            ConeRadius[i] = spot.C.r;
+            SpotCos[i] = spot.CosAngle;
+            SpotSin[i] = spot.SinAngle;
+            BoundsX[i] = spot.Bounds.c.x;
+            BoundsY[i] = spot.Bounds.c.y;
+            BoundsZ[i] = spot.Bounds.c.z;
+            BoundsRadius[i] = spot.Bounds.r;
+            Type[i] = Spotlight;
+        }
+        break;
+
+        case LightType::Directional:
+            Type[i] = Directional;
+            break;
+
+        default:
+            break;
+        }
+    }
+}
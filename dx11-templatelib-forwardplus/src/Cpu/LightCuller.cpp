@@ -0,0 +1,557 @@
+#include "Cpu/LightCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/DepthPyramid.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightListCompaction.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // asuint() in HLSL, depth values are never negative so the integer order is the float order
+    inline uint32_t AsUint(float value)
+    {
+        uint32_t result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    inline float AsFloat(uint32_t value)
+    {
+        float result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+}
+
+void Cpu::GatherGlobalLights(const LightCullInput& input, std::vector<uint32_t>& globalLightList)
+{
+    globalLightList.clear();
+    if (!input.UseGlobalLightList)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < input.LightCount; ++i)
+    {
+        const Light& light = input.Lights[i];
+        if (light.Enabled && (LightType)light.LightType == LightType::Directional)
+        {
+            globalLightList.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+namespace
+{
+    // Keep the `budget` entries of largest contribution at the start of list[0, count), in list order
+    void TruncateList(const LightCullInput& input, const AABB& box, uint32_t* list, uint32_t count, uint32_t budget,
+        std::vector<std::pair<float, uint32_t>>& ranking)
+    {
+        ranking.clear();
+        for (uint32_t k = 0; k < count; ++k)
+        {
+            ranking.emplace_back(GetLightContribution(input.Lights[list[k]], box), k);
+        }
+
+        // Largest contribution first, the earlier entry first among equal ones
+        std::nth_element(ranking.begin(), ranking.begin() + budget, ranking.end(),
+            [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+            {
+                return a.first > b.first || (a.first == b.first && a.second < b.second);
+            });
+        ranking.resize(budget);
+
+        std::sort(ranking.begin(), ranking.end(),
+            [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.second < b.second; });
+
+        // Entry k moves to position k or before it, never over an entry still to be moved
+        for (uint32_t k = 0; k < budget; ++k)
+        {
+            list[k] = list[ranking[k].second];
+        }
+    }
+
+    // Close the gaps left by cut lists, the lists are laid out in tile order
+    void CompactLists(std::vector<uint2>& grid, std::vector<uint32_t>& indexList)
+    {
+        uint32_t offset = 0;
+        for (uint2& tile : grid)
+        {
+            std::copy(indexList.begin() + tile.x, indexList.begin() + tile.x + tile.y, indexList.begin() + offset);
+            tile.x = offset;
+            offset += tile.y;
+        }
+        indexList.resize(offset);
+    }
+}
+
+void Cpu::ApplyLightBudget(ThreadPool& threadPool, const LightCullInput& input, LightCullResult& result)
+{
+    result.TruncatedListCount = 0;
+    result.DroppedLightCount = 0;
+    if (input.MaxLightsPerTile <= 0)
+    {
+        return;
+    }
+
+    uint32_t budget = static_cast<uint32_t>(input.MaxLightsPerTile);
+    bool transparent = !result.TransparentLightGrid.empty();
+
+    // The volumes only need the depth range of a tile, not its depth mask
+    LightCullInput boundsInput = input;
+    boundsInput.UseDepthMask = false;
+
+    // Cut lists and dropped lights of every tile row
+    std::vector<uint64_t> rowCounts(static_cast<size_t>(result.TileCountY) * 2, 0);
+
+    threadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<std::pair<float, uint32_t>> ranking;
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                size_t tileIndex = x + y * result.TileCountX;
+                uint2& opaqueList = result.LightGrid[tileIndex];
+                uint2* transparentList = transparent ? &result.TransparentLightGrid[tileIndex] : nullptr;
+                if (opaqueList.y <= budget && (!transparentList || transparentList->y <= budget))
+                {
+                    continue;
+                }
+
+                // The volumes the lights were culled against
+                int tileY = static_cast<int>(y);
+                TileCullContext context = TiledLightCuller::GetTileCullContext(input, TiledLightCuller::GetTileFrustum(input, x, tileY),
+                    TiledLightCuller::ComputeTileDepthBounds(boundsInput, x, tileY));
+
+                if (opaqueList.y > budget)
+                {
+                    TruncateList(input, context.OpaqueVolume.Box, result.LightIndexList.data() + opaqueList.x, opaqueList.y, budget, ranking);
+                    rowCounts[2 * y] += 1;
+                    rowCounts[2 * y + 1] += opaqueList.y - budget;
+                    opaqueList.y = budget;
+                }
+
+                if (transparentList && transparentList->y > budget)
+                {
+                    TruncateList(input, context.TransparentVolume.Box, result.TransparentLightIndexList.data() + transparentList->x,
+                        transparentList->y, budget, ranking);
+                    rowCounts[2 * y] += 1;
+                    rowCounts[2 * y + 1] += transparentList->y - budget;
+                    transparentList->y = budget;
+                }
+            }
+        }
+    });
+
+    for (size_t y = 0; y < rowCounts.size(); y += 2)
+    {
+        result.TruncatedListCount += rowCounts[y];
+        result.DroppedLightCount += rowCounts[y + 1];
+    }
+
+    if (result.TruncatedListCount > 0)
+    {
+        CompactLists(result.LightGrid, result.LightIndexList);
+        if (transparent)
+        {
+            CompactLists(result.TransparentLightGrid, result.TransparentLightIndexList);
+        }
+    }
+}
+
+TiledLightCuller::TiledLightCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+TileDepthBounds TiledLightCuller::ComputeTileDepthBounds(const LightCullInput& input, int tileX, int tileY)
+{
+    int x0 = tileX * input.BlockSize;
+    int y0 = tileY * input.BlockSize;
+    int x1 = std::min(x0 + input.BlockSize, input.Width);
+    int y1 = std::min(y0 + input.BlockSize, input.Height);
+
+    uint32_t uMinDepth = 0xffffffff;
+    uint32_t uMaxDepth = 0;
+
+    // Threads of a partial tile load outside the texture and get 0
+    bool partialTile = x1 - x0 < input.BlockSize || y1 - y0 < input.BlockSize;
+
+    int level = input.Pyramid ? input.Pyramid->GetLevelForBlockSize(input.BlockSize) : -1;
+    if (level > 0)
+    {
+        // The pyramid already counts the pixels outside the screen as 0
+        uMinDepth = AsUint(input.Pyramid->MinDepth(level, tileX, tileY));
+        uMaxDepth = AsUint(input.Pyramid->MaxDepth(level, tileX, tileY));
+    }
+    else
+    {
+        for (int y = y0; y < y1; ++y)
+        {
+            const float* row = input.Depth + static_cast<size_t>(y) * input.Width;
+            for (int x = x0; x < x1; ++x)
+            {
+                uint32_t uDepth = AsUint(row[x]);
+                uMinDepth = std::min(uMinDepth, uDepth);
+                uMaxDepth = std::max(uMaxDepth, uDepth);
+            }
+        }
+
+        if (partialTile)
+        {
+            uMinDepth = 0;
+        }
+    }
+
+    TileDepthBounds bounds;
+    bounds.MinDepthVS = ClipToView(Float4(0, 0, AsFloat(uMinDepth), 1), input.InverseProjection).z;
+    bounds.MaxDepthVS = ClipToView(Float4(0, 0, AsFloat(uMaxDepth), 1), input.InverseProjection).z;
+    bounds.DepthMask = 0xffffffff;
+
+    if (input.UseDepthMask)
+    {
+        // Second pass over the tile once the range is known, as the shader does after its barrier
+        bounds.DepthMask = partialTile ? 1u : 0u;
+        for (int y = y0; y < y1; ++y)
+        {
+            const float* row = input.Depth + static_cast<size_t>(y) * input.Width;
+            for (int x = x0; x < x1; ++x)
+            {
+                float depthVS = ClipToView(Float4(0, 0, row[x], 1), input.InverseProjection).z;
+                bounds.DepthMask |= 1u << GetDepthMaskCell(depthVS, bounds.MinDepthVS, bounds.MaxDepthVS);
+            }
+        }
+    }
+    return bounds;
+}
+
+TileCullContext TiledLightCuller::GetTileCullContext(const LightCullInput& input, const Frustum& frustum, const TileDepthBounds& bounds)
+{
+    TileCullContext context;
+    context.TileFrustum = frustum;
+    context.Bounds = bounds;
+    context.NearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+
+    // Clipping plane for minimum depth value
+    // (used for testing lights within the bounds of opaque geometry).
+    context.MinPlane = MakePlane(Float3(0, 0, 1), bounds.MinDepthVS);
+
+    // Boxes of the transparent and opaque test volumes, for the spot lights
+    context.TransparentVolume = GetTileVolume(frustum, context.NearClipVS, bounds.MaxDepthVS);
+    context.OpaqueVolume = GetTileVolume(frustum, bounds.MinDepthVS, bounds.MaxDepthVS);
+    context.GlobalLightList = input.UseGlobalLightList;
+    return context;
+}
+
+uint32_t TiledLightCuller::TestLight(const TileCullContext& context, const Light& light, const DerivedLight* derived)
+{
+    if (!light.Enabled)
+    {
+        return 0;
+    }
+
+    const Frustum& frustum = context.TileFrustum;
+    const TileDepthBounds& bounds = context.Bounds;
+
+    switch ((LightType)light.LightType)
+    {
+    case LightType::Point:
+    {
+        Sphere sphere = derived ? GetLightSphere(light, *derived) : GetLightSphere(light);
+        if (!SphereInsideFrustum(sphere, frustum, context.NearClipVS, bounds.MaxDepthVS))
+        {
+            return 0;
+        }
+
+        bool opaque = !SphereInsidePlane(sphere, context.MinPlane) &&
+            (GetDepthRangeMask(sphere, bounds.MinDepthVS, bounds.MaxDepthVS) & bounds.DepthMask);
+        return TileLightTransparent | (opaque ? static_cast<uint32_t>(TileLightOpaque) : 0u);
+    }
+
+    case LightType::Spotlight:
+    {
+        SpotVolume spot = derived ? GetLightSpotVolume(light, *derived) : GetLightSpotVolume(light);
+        if (!ConeInsideFrustum(spot.C, frustum, context.NearClipVS, bounds.MaxDepthVS) ||
+            !SpotIntersectsTileVolume(spot, context.TransparentVolume))
+        {
+            return 0;
+        }
+
+        bool opaque = !ConeInsidePlane(spot.C, context.MinPlane) && SpotIntersectsTileVolume(spot, context.OpaqueVolume) &&
+            (GetDepthRangeMask(spot, bounds.MinDepthVS, bounds.MaxDepthVS) & bounds.DepthMask);
+        return TileLightTransparent | (opaque ? static_cast<uint32_t>(TileLightOpaque) : 0u);
+    }
+
+    case LightType::Directional:
+        // Directional lights touch every tile, they are either listed once globally or added to every list
+        return context.GlobalLightList ? 0 : TileLightTransparent | TileLightOpaque;
+
+    default:
+        return 0;
+    }
+}
+
+namespace
+{
+    // Light tests of CullTile(), for the lights lightIndex(0) .. lightIndex(count - 1)
+    template<class LightIndex>
+    void CullTileLights(const LightCullInput& input, const Frustum& frustum, const TileDepthBounds& bounds, size_t count, LightIndex lightIndex,
+        std::vector<uint32_t>& lightList, std::vector<uint32_t>* transparentLightList)
+    {
+        TileCullContext context = TiledLightCuller::GetTileCullContext(input, frustum, bounds);
+
+        for (size_t n = 0; n < count; ++n)
+        {
+            uint32_t i = lightIndex(n);
+            const DerivedLight* derived = input.DerivedLights ? &input.DerivedLights[i] : nullptr;
+            uint32_t result = TiledLightCuller::TestLight(context, input.Lights[i], derived);
+
+            if (transparentLightList && (result & TileLightTransparent))
+            {
+                transparentLightList->push_back(i);
+            }
+
+            if (result & TileLightOpaque)
+            {
+                lightList.push_back(i);
+            }
+        }
+    }
+}
+
+Frustum TiledLightCuller::GetTileFrustum(const LightCullInput& input, int tileX, int tileY)
+{
+    if (input.FrustumPlanes)
+    {
+        return input.FrustumPlanes->GetTileFrustum(tileX, tileY);
+    }
+
+    int tileCountX = GetTileCount(input.Width, input.BlockSize);
+    return input.Frustums[tileX + tileY * tileCountX];
+}
+
+void TiledLightCuller::CullTile(const LightCullInput& input, int tileX, int tileY, std::vector<uint32_t>& lightList,
+    std::vector<uint32_t>* transparentLightList)
+{
+    Frustum frustum = GetTileFrustum(input, tileX, tileY);
+    TileDepthBounds bounds = ComputeTileDepthBounds(input, tileX, tileY);
+
+    CullTileLights(input, frustum, bounds, input.LightCount, [](size_t n) { return static_cast<uint32_t>(n); },
+        lightList, transparentLightList);
+}
+
+void TiledLightCuller::CullTile(const LightCullInput& input, int tileX, int tileY, const TileDepthBounds& bounds,
+    const uint32_t* candidates, size_t candidateCount, std::vector<uint32_t>& lightList, std::vector<uint32_t>* transparentLightList)
+{
+    Frustum frustum = GetTileFrustum(input, tileX, tileY);
+
+    CullTileLights(input, frustum, bounds, candidateCount, [candidates](size_t n) { return candidates[n]; },
+        lightList, transparentLightList);
+}
+
+void TiledLightCuller::CullSuperTile(const LightCullInput& input, int superTileX, int superTileY, float maxDepthVS,
+    std::vector<uint32_t>& candidates)
+{
+    Float2 screenDimensions((float)input.Width, (float)input.Height);
+    Frustum frustum = ComputeTileFrustum(input.InverseProjection, screenDimensions, superTileX, superTileY, input.SuperTileSize);
+    float nearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+    TileVolume volume = GetTileVolume(frustum, nearClipVS, maxDepthVS);
+
+    for (size_t i = 0; i < input.LightCount; ++i)
+    {
+        const Light& light = input.Lights[i];
+        if (!light.Enabled)
+        {
+            continue;
+        }
+
+        const DerivedLight* derived = input.DerivedLights ? &input.DerivedLights[i] : nullptr;
+        bool inside;
+        switch ((LightType)light.LightType)
+        {
+        case LightType::Point:
+            inside = SphereInsideFrustum(derived ? GetLightSphere(light, *derived) : GetLightSphere(light), frustum, nearClipVS, maxDepthVS);
+            break;
+        case LightType::Spotlight:
+        {
+            SpotVolume spot = derived ? GetLightSpotVolume(light, *derived) : GetLightSpotVolume(light);
+            inside = ConeInsideFrustum(spot.C, frustum, nearClipVS, maxDepthVS) && SpotIntersectsTileVolume(spot, volume);
+        }
+        break;
+        case LightType::Directional:
+            inside = !input.UseGlobalLightList;
+            break;
+        default:
+            inside = false;
+            break;
+        }
+
+        if (inside)
+        {
+            candidates.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void TiledLightCuller::Cull(const LightCullInput& input, LightCullResult& result)
+{
+    result.TileCountX = GetTileCount(input.Width, input.BlockSize);
+    result.TileCountY = GetTileCount(input.Height, input.BlockSize);
+    result.LightGrid.resize(static_cast<size_t>(result.TileCountX) * result.TileCountY);
+
+    bool transparent = input.BuildTransparentLists;
+    result.TransparentLightGrid.resize(transparent ? result.LightGrid.size() : 0);
+
+    m_RowLightLists.resize(result.TileCountY);
+    m_RowTransparentLightLists.resize(transparent ? result.TileCountY : 0);
+    m_RowLightTestCounts.assign(result.TileCountY, 0);
+
+    for (int y = 0; y < result.TileCountY; ++y)
+    {
+        m_RowLightLists[y].clear();
+        if (transparent)
+        {
+            m_RowTransparentLightLists[y].clear();
+        }
+    }
+
+    if (input.SuperTileSize > input.BlockSize)
+    {
+        CullSuperTileRows(input, result);
+    }
+    else
+    {
+        CullRows(input, result);
+    }
+
+    CompactRowLists(m_ThreadPool, m_RowLightLists, result.TileCountX, result.LightGrid, result.LightIndexList, m_TileOffsets);
+    if (transparent)
+    {
+        CompactRowLists(m_ThreadPool, m_RowTransparentLightLists, result.TileCountX, result.TransparentLightGrid,
+            result.TransparentLightIndexList, m_TileOffsets);
+    }
+    else
+    {
+        result.TransparentLightIndexList.clear();
+    }
+
+    GatherGlobalLights(input, result.GlobalLightIndexList);
+    ApplyLightBudget(m_ThreadPool, input, result);
+
+    result.LightTestCount = 0;
+    for (uint64_t count : m_RowLightTestCounts)
+    {
+        result.LightTestCount += count;
+    }
+}
+
+void TiledLightCuller::CullRows(const LightCullInput& input, LightCullResult& result)
+{
+    bool transparent = input.BuildTransparentLists;
+
+    m_ThreadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            auto& rowList = m_RowLightLists[y];
+            std::vector<uint32_t>* transparentRowList = transparent ? &m_RowTransparentLightLists[y] : nullptr;
+
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                // Offsets are row local for now, fixed up once every row is known
+                size_t tileIndex = x + y * result.TileCountX;
+                uint32_t offset = static_cast<uint32_t>(rowList.size());
+                uint32_t transparentOffset = transparentRowList ? static_cast<uint32_t>(transparentRowList->size()) : 0;
+
+                CullTile(input, x, static_cast<int>(y), rowList, transparentRowList);
+
+                result.LightGrid[tileIndex] = { offset, static_cast<uint32_t>(rowList.size()) - offset };
+                if (transparentRowList)
+                {
+                    result.TransparentLightGrid[tileIndex] = { transparentOffset, static_cast<uint32_t>(transparentRowList->size()) - transparentOffset };
+                }
+            }
+            m_RowLightTestCounts[y] = static_cast<uint64_t>(result.TileCountX) * input.LightCount;
+        }
+    });
+}
+
+void TiledLightCuller::CullSuperTileRows(const LightCullInput& tileInput, LightCullResult& result)
+{
+    // Super-tiles are made of whole tiles
+    int tilesPerSuperTile = tileInput.SuperTileSize / tileInput.BlockSize;
+    LightCullInput input = tileInput;
+    input.SuperTileSize = tilesPerSuperTile * input.BlockSize;
+
+    bool transparent = input.BuildTransparentLists;
+    int superTileCountX = GetTileCount(input.Width, input.SuperTileSize);
+    int superTileCountY = GetTileCount(input.Height, input.SuperTileSize);
+
+    // One super-tile row covers tilesPerSuperTile tile rows. Within it the super-tiles are visited
+    // left to right, so every tile row list is still appended in tile order.
+    m_ThreadPool.ParallelFor(superTileCountY, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<uint32_t> candidates;
+        std::vector<TileDepthBounds> bounds(static_cast<size_t>(tilesPerSuperTile) * tilesPerSuperTile);
+
+        for (size_t superY = begin; superY < end; ++superY)
+        {
+            int y0 = static_cast<int>(superY) * tilesPerSuperTile;
+            int y1 = std::min(y0 + tilesPerSuperTile, result.TileCountY);
+
+            for (int superX = 0; superX < superTileCountX; ++superX)
+            {
+                int x0 = superX * tilesPerSuperTile;
+                int x1 = std::min(x0 + tilesPerSuperTile, result.TileCountX);
+
+                // The super-tile reaches as deep as its deepest tile
+                float maxDepthVS = -std::numeric_limits<float>::max();
+                for (int y = y0; y < y1; ++y)
+                {
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        TileDepthBounds& tileBounds = bounds[(x - x0) + (y - y0) * tilesPerSuperTile];
+                        tileBounds = ComputeTileDepthBounds(input, x, y);
+                        maxDepthVS = std::max(maxDepthVS, tileBounds.MaxDepthVS);
+                    }
+                }
+
+                candidates.clear();
+                CullSuperTile(input, superX, static_cast<int>(superY), maxDepthVS, candidates);
+                m_RowLightTestCounts[y0] += input.LightCount;
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    auto& rowList = m_RowLightLists[y];
+                    std::vector<uint32_t>* transparentRowList = transparent ? &m_RowTransparentLightLists[y] : nullptr;
+
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        size_t tileIndex = x + static_cast<size_t>(y) * result.TileCountX;
+                        uint32_t offset = static_cast<uint32_t>(rowList.size());
+                        uint32_t transparentOffset = transparentRowList ? static_cast<uint32_t>(transparentRowList->size()) : 0;
+
+                        CullTile(input, x, y, bounds[(x - x0) + (y - y0) * tilesPerSuperTile], candidates.data(), candidates.size(),
+                            rowList, transparentRowList);
+
+                        result.LightGrid[tileIndex] = { offset, static_cast<uint32_t>(rowList.size()) - offset };
+                        if (transparentRowList)
+                        {
+                            result.TransparentLightGrid[tileIndex] = { transparentOffset, static_cast<uint32_t>(transparentRowList->size()) - transparentOffset };
+                        }
+                    }
+                    m_RowLightTestCounts[y] += static_cast<uint64_t>(x1 - x0) * candidates.size();
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,96 @@
+#include "Cpu/LightListCompaction.h"
+
+#include <algorithm>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Elements per block of ExclusiveScan, large enough that a block outweighs the job overhead
+    const size_t ScanBlockSize = 4096;
+}
+
+uint32_t Yr::Cpu::ExclusiveScan(ThreadPool& threadPool, const uint32_t* values, size_t count, uint32_t* offsets)
+{
+    size_t blockCount = (count + ScanBlockSize - 1) / ScanBlockSize;
+    std::vector<uint32_t> blockOffsets(blockCount);
+
+    // 1. sum of every block
+    threadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * ScanBlockSize;
+            size_t last = std::min(first + ScanBlockSize, count);
+
+            uint32_t sum = 0;
+            for (size_t i = first; i < last; ++i)
+            {
+                sum += values[i];
+            }
+            blockOffsets[block] = sum;
+        }
+    });
+
+    // 2. offset of every block
+    uint32_t total = 0;
+    for (size_t block = 0; block < blockCount; ++block)
+    {
+        uint32_t sum = blockOffsets[block];
+        blockOffsets[block] = total;
+        total += sum;
+    }
+
+    // 3. scan every block from its offset
+    threadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * ScanBlockSize;
+            size_t last = std::min(first + ScanBlockSize, count);
+
+            uint32_t offset = blockOffsets[block];
+            for (size_t i = first; i < last; ++i)
+            {
+                uint32_t value = values[i];
+                offsets[i] = offset;
+                offset += value;
+            }
+        }
+    });
+
+    return total;
+}
+
+void Yr::Cpu::CompactRowLists(ThreadPool& threadPool, const std::vector<std::vector<uint32_t>>& rowLists, int tileCountX,
+    std::vector<uint2>& grid, std::vector<uint32_t>& indexList, std::vector<uint32_t>& offsets)
+{
+    size_t tileCount = grid.size();
+
+    // 1. count
+    offsets.resize(tileCount);
+    for (size_t tile = 0; tile < tileCount; ++tile)
+    {
+        offsets[tile] = grid[tile].y;
+    }
+
+    // 2. scan
+    uint32_t total = ExclusiveScan(threadPool, offsets.data(), tileCount, offsets.data());
+    indexList.resize(total);
+
+    // 3. scatter
+    threadPool.ParallelFor(rowLists.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const auto& rowList = rowLists[y];
+            for (int x = 0; x < tileCountX; ++x)
+            {
+                size_t tile = x + y * tileCountX;
+                std::copy_n(rowList.begin() + grid[tile].x, grid[tile].y, indexList.begin() + offsets[tile]);
+                grid[tile].x = offsets[tile];
+            }
+        }
+    });
+}
@@ -0,0 +1,166 @@
+#include "Cpu/LightListEncoding.h"
+
+#include <algorithm>
+
+#include "Cpu/LightListCompaction.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Indices per tile row of the Uint16 layout, rounded up so every row starts on a word
+    uint32_t GetRowIndexCount(const std::vector<uint2>& grid, int tileCountX, int tileY, bool evenCount)
+    {
+        uint32_t count = 0;
+        for (int x = 0; x < tileCountX; ++x)
+        {
+            count += grid[x + static_cast<size_t>(tileY) * tileCountX].y;
+        }
+        return evenCount ? (count + 1) & ~1u : count;
+    }
+}
+
+const char* Yr::Cpu::GetLightListEncodingName(LightListEncoding encoding)
+{
+    switch (encoding)
+    {
+    case LightListEncoding::Uint32:
+        return "uint32";
+    case LightListEncoding::Uint16:
+        return "uint16";
+    case LightListEncoding::Bitmask:
+        return "bitmask";
+    default:
+        return "unknown";
+    }
+}
+
+bool Yr::Cpu::CanEncodeLightCount(LightListEncoding encoding, size_t lightCount)
+{
+    switch (encoding)
+    {
+    case LightListEncoding::Uint32:
+        return lightCount <= UINT32_MAX;
+    case LightListEncoding::Uint16:
+        return lightCount <= 0x10000;
+    case LightListEncoding::Bitmask:
+        return true;
+    default:
+        return false;
+    }
+}
+
+size_t Cpu::EncodedLightLists::TileReadBytes(size_t tileIndex) const
+{
+    switch (Encoding)
+    {
+    case LightListEncoding::Uint32:
+        return sizeof(uint2) + LightGrid[tileIndex].y * sizeof(uint32_t);
+
+    case LightListEncoding::Uint16:
+    {
+        const uint2& tile = LightGrid[tileIndex];
+        size_t words = tile.y ? (tile.x + tile.y - 1) / 2 - tile.x / 2 + 1 : 0;
+        return sizeof(uint2) + words * sizeof(uint32_t);
+    }
+
+    case LightListEncoding::Bitmask:
+        return WordsPerTile * sizeof(uint32_t);
+
+    default:
+        return 0;
+    }
+}
+
+bool Yr::Cpu::EncodeLightLists(ThreadPool& threadPool, const std::vector<uint2>& grid, const std::vector<uint32_t>& indexList,
+    int tileCountX, int tileCountY, size_t lightCount, LightListEncoding encoding, EncodedLightLists& result)
+{
+    result.Encoding = encoding;
+    result.TileCountX = tileCountX;
+    result.TileCountY = tileCountY;
+    result.LightCount = lightCount;
+    result.WordsPerTile = 0;
+    result.LightGrid.clear();
+    result.Words.clear();
+
+    if (!CanEncodeLightCount(encoding, lightCount))
+    {
+        return false;
+    }
+
+    if (encoding == LightListEncoding::Bitmask)
+    {
+        result.WordsPerTile = (lightCount + 31) / 32;
+        result.Words.assign(result.TileCount() * result.WordsPerTile, 0);
+
+        threadPool.ParallelFor(tileCountY, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t tile = begin * tileCountX; tile < end * tileCountX; ++tile)
+            {
+                uint32_t* mask = result.Words.data() + tile * result.WordsPerTile;
+                const uint2& list = grid[tile];
+                for (uint32_t i = 0; i < list.y; ++i)
+                {
+                    uint32_t lightIndex = indexList[list.x + i];
+                    mask[lightIndex / 32] |= 1u << (lightIndex % 32);
+                }
+            }
+        });
+        return true;
+    }
+
+    // Lay the rows out back to back in tile order, whatever the order of the source lists
+    bool packed = encoding == LightListEncoding::Uint16;
+    std::vector<uint32_t> rowOffsets(tileCountY);
+    for (int y = 0; y < tileCountY; ++y)
+    {
+        rowOffsets[y] = GetRowIndexCount(grid, tileCountX, y, packed);
+    }
+    uint32_t indexCount = ExclusiveScan(threadPool, rowOffsets.data(), rowOffsets.size(), rowOffsets.data());
+
+    result.LightGrid.resize(result.TileCount());
+    result.Words.resize(packed ? indexCount / 2 : indexCount);
+
+    threadPool.ParallelFor(tileCountY, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            uint32_t offset = rowOffsets[y];
+            for (size_t tile = y * tileCountX; tile < (y + 1) * tileCountX; ++tile)
+            {
+                const uint2& list = grid[tile];
+                const uint32_t* indices = indexList.data() + list.x;
+                result.LightGrid[tile] = uint2 { offset, list.y };
+
+                if (!packed)
+                {
+                    std::copy_n(indices, list.y, result.Words.data() + offset);
+                    offset += list.y;
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < list.y; ++i, ++offset)
+                {
+                    uint32_t& word = result.Words[offset / 2];
+                    word = offset % 2 ? (word & 0xFFFF) | (indices[i] << 16) : indices[i];
+                }
+            }
+
+            // Padding of an odd row
+            if (packed && offset % 2)
+            {
+                result.Words[offset / 2] &= 0xFFFF;
+            }
+        }
+    });
+
+    return true;
+}
+
+bool Yr::Cpu::EncodeLightLists(ThreadPool& threadPool, const LightCullResult& lists, size_t lightCount, LightListEncoding encoding,
+    EncodedLightLists& result)
+{
+    return EncodeLightLists(threadPool, lists.LightGrid, lists.LightIndexList, lists.TileCountX, lists.TileCountY, lightCount,
+        encoding, result);
+}
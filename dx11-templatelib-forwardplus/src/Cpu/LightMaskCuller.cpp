@@ -0,0 +1,235 @@
+#include "Cpu/LightMaskCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+
+#include "LightMaskKernel.h"
+
+#if defined(YR_CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    bool CpuSupportsAvx2()
+    {
+#if defined(YR_CPU_X86) && defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7)
+        {
+            return false;
+        }
+
+        // AVX needs OS support for saving the ymm registers
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#elif defined(YR_CPU_X86)
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+
+    Detail::LightCullStreams GetStreams(const LightCullView& view)
+    {
+        return {
+            view.PaddedCount,
+            view.PositionX.data(), view.PositionY.data(), view.PositionZ.data(), view.Radius.data(),
+            view.DirectionX.data(), view.DirectionY.data(), view.DirectionZ.data(), view.ConeRadius.data(),
+            view.SpotCos.data(), view.SpotSin.data(),
+            view.BoundsX.data(), view.BoundsY.data(), view.BoundsZ.data(), view.BoundsRadius.data(),
+            view.Type.data()
+        };
+    }
+
+    // One light at a time on the SoA data, the reference for the vector kernels
+    void CullTileLightMask_Scalar(const LightCullView& view, const TileCullBounds& bounds, uint64_t* mask, size_t wordCount)
+    {
+        for (size_t i = 0; i < wordCount; ++i)
+        {
+            mask[i] = 0;
+        }
+
+        Plane minPlane = MakePlane(Float3(0, 0, 1), bounds.MinDepthVS);
+
+        for (size_t i = 0; i < view.Count; ++i)
+        {
+            bool visible = false;
+            switch (view.Type[i])
+            {
+            case LightCullView::Point:
+            {
+                Sphere sphere = { Float3(view.PositionX[i], view.PositionY[i], view.PositionZ[i]), view.Radius[i] };
+                visible = SphereInsideFrustum(sphere, bounds.TileFrustum, bounds.NearVS, bounds.MaxDepthVS) && !SphereInsidePlane(sphere, minPlane);
+            }
+            break;
+
+            case LightCullView::Spotlight:
+            {
+                SpotVolume spot;
+                spot.C = {
+                    Float3(view.PositionX[i], view.PositionY[i], view.PositionZ[i]),
+                    view.Radius[i],
+                    Float3(view.DirectionX[i], view.DirectionY[i], view.DirectionZ[i]),
+                    view.ConeRadius[i]
+                };
+                spot.Bounds = { Float3(view.BoundsX[i], view.BoundsY[i], view.BoundsZ[i]), view.BoundsRadius[i] };
+                spot.CosAngle = view.SpotCos[i];
+                spot.SinAngle = view.SpotSin[i];
+                visible = ConeInsideFrustum(spot.C, bounds.TileFrustum, bounds.NearVS, bounds.MaxDepthVS) &&
+                    SpotIntersectsTileVolume(spot, bounds.TransparentVolume) &&
+                    !ConeInsidePlane(spot.C, minPlane) && SpotIntersectsTileVolume(spot, bounds.OpaqueVolume);
+            }
+            break;
+
+            case LightCullView::Directional:
+                visible = true;
+                break;
+
+            default:
+                break;
+            }
+
+            if (visible)
+            {
+                mask[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+    }
+}
+
+const char* Yr::Cpu::GetCullKernelName(CullKernel kernel)
+{
+    switch (kernel)
+    {
+    case CullKernel::Scalar: return "scalar";
+    case CullKernel::Sse: return "sse";
+    case CullKernel::Avx2: return "avx2";
+    default: return "unknown";
+    }
+}
+
+bool Yr::Cpu::IsCullKernelSupported(CullKernel kernel)
+{
+    switch (kernel)
+    {
+    case CullKernel::Scalar:
+        return true;
+#ifdef YR_CPU_X86
+    case CullKernel::Sse:
+        return true;
+    case CullKernel::Avx2:
+    {
+        static const bool supported = CpuSupportsAvx2();
+        return supported;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+CullKernel Yr::Cpu::GetBestCullKernel()
+{
+    if (IsCullKernelSupported(CullKernel::Avx2))
+    {
+        return CullKernel::Avx2;
+    }
+    if (IsCullKernelSupported(CullKernel::Sse))
+    {
+        return CullKernel::Sse;
+    }
+    return CullKernel::Scalar;
+}
+
+void Yr::Cpu::CullTileLightMask(CullKernel kernel, const LightCullView& view, const TileCullBounds& bounds, uint64_t* mask)
+{
+    size_t wordCount = GetLightMaskWordCount(view.Count);
+
+    switch (kernel)
+    {
+#ifdef YR_CPU_X86
+    case CullKernel::Sse:
+        Detail::CullTileLightMask_Sse(GetStreams(view), bounds, mask, wordCount);
+        break;
+    case CullKernel::Avx2:
+        Detail::CullTileLightMask_Avx2(GetStreams(view), bounds, mask, wordCount);
+        break;
+#endif
+    default:
+        CullTileLightMask_Scalar(view, bounds, mask, wordCount);
+        break;
+    }
+}
+
+void Yr::Cpu::AppendLightMask(const uint64_t* mask, size_t wordCount, std::vector<uint32_t>& lightList)
+{
+    for (size_t word = 0; word < wordCount; ++word)
+    {
+        uint64_t bits = mask[word];
+        while (bits)
+        {
+            uint32_t bit = 0;
+            while (((bits >> bit) & 1) == 0)
+            {
+                ++bit;
+            }
+            lightList.push_back(static_cast<uint32_t>(word * 64 + bit));
+            bits &= bits - 1;
+        }
+    }
+}
+
+LightMaskCuller::LightMaskCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void LightMaskCuller::Cull(const LightCullInput& input, const LightCullView& view, CullKernel kernel, LightMaskResult& result)
+{
+    if (!IsCullKernelSupported(kernel))
+    {
+        kernel = CullKernel::Scalar;
+    }
+
+    result.TileCountX = GetTileCount(input.Width, input.BlockSize);
+    result.TileCountY = GetTileCount(input.Height, input.BlockSize);
+    result.WordsPerTile = GetLightMaskWordCount(view.Count);
+    result.Masks.resize(result.TileCount() * result.WordsPerTile);
+
+    float nearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+
+    m_ThreadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                size_t tileIndex = x + y * result.TileCountX;
+                TileDepthBounds depthBounds = TiledLightCuller::ComputeTileDepthBounds(input, x, static_cast<int>(y));
+
+                TileCullBounds bounds;
+                bounds.TileFrustum = TiledLightCuller::GetTileFrustum(input, x, static_cast<int>(y));
+                bounds.NearVS = nearClipVS;
+                bounds.MinDepthVS = depthBounds.MinDepthVS;
+                bounds.MaxDepthVS = depthBounds.MaxDepthVS;
+                bounds.TransparentVolume = GetTileVolume(bounds.TileFrustum, nearClipVS, depthBounds.MaxDepthVS);
+                bounds.OpaqueVolume = GetTileVolume(bounds.TileFrustum, depthBounds.MinDepthVS, depthBounds.MaxDepthVS);
+
+                CullTileLightMask(kernel, view, bounds, result.Masks.data() + tileIndex * result.WordsPerTile);
+            }
+        }
+    });
+}
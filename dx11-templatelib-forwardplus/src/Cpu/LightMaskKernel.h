@@ -0,0 +1,262 @@
+#pragma once
+
+// Private to src/Cpu: the vectorized light-vs-tile kernel, instantiated once per instruction set
+// in LightMaskKernel_Sse.cpp / LightMaskKernel_Avx2.cpp.
+//
+// Those translation units are compiled with different target flags, so everything they share
+// must be a template on the instruction set (or have internal linkage); otherwise the linker
+// may pick an AVX2 copy of an inline function for a caller running on an SSE only CPU.
+// That is also why the kernels read raw pointers instead of std::vector.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Cpu/LightMaskCuller.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define YR_CPU_X86 1
+#endif
+
+namespace Yr
+{
+namespace Cpu
+{
+namespace Detail
+{
+    /// <summary>
+    /// LightCullView as plain pointers, see the note at the top of the file
+    /// </summary>
+    struct LightCullStreams
+    {
+        size_t PaddedCount;
+        const float* PositionX;
+        const float* PositionY;
+        const float* PositionZ;
+        const float* Radius;
+        const float* DirectionX;
+        const float* DirectionY;
+        const float* DirectionZ;
+        const float* ConeRadius;
+        const float* SpotCos;
+        const float* SpotSin;
+        const float* BoundsX;
+        const float* BoundsY;
+        const float* BoundsZ;
+        const float* BoundsRadius;
+        const int32_t* Type;
+    };
+
+    void CullTileLightMask_Sse(const LightCullStreams& lights, const TileCullBounds& bounds, uint64_t* mask, size_t wordCount);
+    void CullTileLightMask_Avx2(const LightCullStreams& lights, const TileCullBounds& bounds, uint64_t* mask, size_t wordCount);
+
+    /// <summary>
+    /// Plane broadcast to every lane
+    /// </summary>
+    template<class S>
+    struct PlaneLanes
+    {
+        typename S::Float Nx, Ny, Nz, d;
+
+        static PlaneLanes Make(float nx, float ny, float nz, float d)
+        {
+            return { S::Set1(nx), S::Set1(ny), S::Set1(nz), S::Set1(d) };
+        }
+    };
+
+    // The operations below are written in the same order as Culling.h,
+    // so the vector kernels produce bit-identical results to the scalar code.
+
+    template<class S>
+    inline typename S::Float Dot(const PlaneLanes<S>& p, typename S::Float x, typename S::Float y, typename S::Float z)
+    {
+        return S::Add(S::Add(S::Mul(p.Nx, x), S::Mul(p.Ny, y)), S::Mul(p.Nz, z));
+    }
+
+    template<class S>
+    inline typename S::Float SphereInsidePlane(const PlaneLanes<S>& p,
+        typename S::Float cx, typename S::Float cy, typename S::Float cz, typename S::Float negR)
+    {
+        return S::CmpLt(S::Sub(Dot<S>(p, cx, cy, cz), p.d), negR);
+    }
+
+    template<class S>
+    inline typename S::Float ConeInsidePlane(const PlaneLanes<S>& p,
+        typename S::Float tx, typename S::Float ty, typename S::Float tz, typename S::Float h,
+        typename S::Float dx, typename S::Float dy, typename S::Float dz, typename S::Float r)
+    {
+        using F = typename S::Float;
+
+        F zero = S::Set1(0.0f);
+
+        // Bottom center T + d * h, moved by r * sqrt(1 - dot(N, d)^2) towards the plane
+        F bx = S::Add(tx, S::Mul(dx, h));
+        F by = S::Add(ty, S::Mul(dy, h));
+        F bz = S::Add(tz, S::Mul(dz, h));
+        F nd = Dot<S>(p, dx, dy, dz);
+        F extent = S::Mul(r, S::Sqrt(S::Max(S::Sub(S::Set1(1.0f), S::Mul(nd, nd)), zero)));
+
+        F tipInside = S::CmpLt(S::Sub(Dot<S>(p, tx, ty, tz), p.d), zero);
+        F qInside = S::CmpLt(S::Sub(S::Add(Dot<S>(p, bx, by, bz), extent), p.d), zero);
+        return S::And(tipInside, qInside);
+    }
+
+    /// <summary>
+    /// ConeInsidePlane() for the depth planes, N = (0, 0, Nz) with Nz = +-1.
+    /// The zero components drop out of the dot products exactly and dot(N, d)^2 = d.z * d.z,
+    /// so this matches the general version bit for bit. `extent` is r * sqrt(1 - d.z * d.z).
+    /// </summary>
+    template<class S>
+    inline typename S::Float ConeInsideDepthPlane(const PlaneLanes<S>& p,
+        typename S::Float tz, typename S::Float h, typename S::Float dz, typename S::Float extent)
+    {
+        using F = typename S::Float;
+
+        F zero = S::Set1(0.0f);
+        F bz = S::Add(tz, S::Mul(dz, h));
+
+        F tipInside = S::CmpLt(S::Sub(S::Mul(p.Nz, tz), p.d), zero);
+        F qInside = S::CmpLt(S::Sub(S::Add(S::Mul(p.Nz, bz), extent), p.d), zero);
+        return S::And(tipInside, qInside);
+    }
+
+    /// <summary>
+    /// TileVolume broadcast to every lane
+    /// </summary>
+    template<class S>
+    struct VolumeLanes
+    {
+        typename S::Float MinX, MinY, MinZ, MaxX, MaxY, MaxZ;
+        typename S::Float Cx, Cy, Cz, R, NegR;
+
+        static VolumeLanes Make(const TileVolume& v)
+        {
+            return {
+                S::Set1(v.Box.Min.x), S::Set1(v.Box.Min.y), S::Set1(v.Box.Min.z),
+                S::Set1(v.Box.Max.x), S::Set1(v.Box.Max.y), S::Set1(v.Box.Max.z),
+                S::Set1(v.BoxBounds.c.x), S::Set1(v.BoxBounds.c.y), S::Set1(v.BoxBounds.c.z), S::Set1(v.BoxBounds.r), S::Set1(-v.BoxBounds.r)
+            };
+        }
+    };
+
+    /// <summary>
+    /// !SpotIntersectsTileVolume(): the bounding sphere (bx, by, bz, br) misses the box,
+    /// or the cone misses the bounding sphere of the box
+    /// </summary>
+    template<class S>
+    inline typename S::Float SpotOutsideTileVolume(const VolumeLanes<S>& v,
+        typename S::Float bx, typename S::Float by, typename S::Float bz, typename S::Float br,
+        typename S::Float tx, typename S::Float ty, typename S::Float tz, typename S::Float h,
+        typename S::Float dx, typename S::Float dy, typename S::Float dz, typename S::Float cosAngle, typename S::Float sinAngle)
+    {
+        using F = typename S::Float;
+
+        F zero = S::Set1(0.0f);
+
+        // SphereIntersectsAABB()
+        F ox = S::Add(S::Max(S::Sub(v.MinX, bx), zero), S::Max(S::Sub(bx, v.MaxX), zero));
+        F oy = S::Add(S::Max(S::Sub(v.MinY, by), zero), S::Max(S::Sub(by, v.MaxY), zero));
+        F oz = S::Add(S::Max(S::Sub(v.MinZ, bz), zero), S::Max(S::Sub(bz, v.MaxZ), zero));
+        F distanceSq = S::Add(S::Add(S::Mul(ox, ox), S::Mul(oy, oy)), S::Mul(oz, oz));
+        F culled = S::CmpGt(distanceSq, S::Mul(br, br));
+
+        // SpotIntersectsSphere()
+        F vx = S::Sub(v.Cx, tx);
+        F vy = S::Sub(v.Cy, ty);
+        F vz = S::Sub(v.Cz, tz);
+        F lengthSq = S::Add(S::Add(S::Mul(vx, vx), S::Mul(vy, vy)), S::Mul(vz, vz));
+        F axial = S::Add(S::Add(S::Mul(vx, dx), S::Mul(vy, dy)), S::Mul(vz, dz));
+        F distanceToSide = S::Sub(S::Mul(cosAngle, S::Sqrt(S::Max(S::Sub(lengthSq, S::Mul(axial, axial)), zero))), S::Mul(axial, sinAngle));
+
+        culled = S::Or(culled, S::CmpGt(distanceToSide, v.R));
+        culled = S::Or(culled, S::CmpGt(axial, S::Add(v.R, h)));
+        culled = S::Or(culled, S::CmpLt(axial, v.NegR));
+        return culled;
+    }
+
+    template<class S>
+    void CullTileLightMask(const LightCullStreams& lights, const TileCullBounds& bounds, uint64_t* mask, size_t wordCount)
+    {
+        using F = typename S::Float;
+
+        for (size_t i = 0; i < wordCount; ++i)
+        {
+            mask[i] = 0;
+        }
+
+        PlaneLanes<S> planes[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            const Plane& plane = bounds.TileFrustum.plane[i];
+            planes[i] = PlaneLanes<S>::Make(plane.N[0], plane.N[1], plane.N[2], plane.d);
+        }
+
+        PlaneLanes<S> nearPlane = PlaneLanes<S>::Make(0, 0, 1, bounds.NearVS);
+        PlaneLanes<S> farPlane = PlaneLanes<S>::Make(0, 0, -1, -bounds.MaxDepthVS);
+        PlaneLanes<S> minPlane = PlaneLanes<S>::Make(0, 0, 1, bounds.MinDepthVS);
+        VolumeLanes<S> transparentVolume = VolumeLanes<S>::Make(bounds.TransparentVolume);
+        VolumeLanes<S> opaqueVolume = VolumeLanes<S>::Make(bounds.OpaqueVolume);
+
+        F zNear = S::Set1(bounds.NearVS);
+        F zFar = S::Set1(bounds.MaxDepthVS);
+        F zero = S::Set1(0.0f);
+
+        for (size_t i = 0; i < lights.PaddedCount; i += S::Width)
+        {
+            F isPoint = S::TypeEquals(lights.Type + i, LightCullView::Point);
+            F isSpot = S::TypeEquals(lights.Type + i, LightCullView::Spotlight);
+            F visible = S::TypeEquals(lights.Type + i, LightCullView::Directional);
+
+            F px = S::Load(lights.PositionX + i);
+            F py = S::Load(lights.PositionY + i);
+            F pz = S::Load(lights.PositionZ + i);
+            F r = S::Load(lights.Radius + i);
+
+            if (S::MoveMask(isPoint))
+            {
+                F negR = S::Sub(zero, r);
+                F culled = S::Or(S::CmpGt(S::Sub(pz, r), zFar), S::CmpLt(S::Add(pz, r), zNear));
+                for (int p = 0; p < 4; ++p)
+                {
+                    culled = S::Or(culled, SphereInsidePlane<S>(planes[p], px, py, pz, negR));
+                }
+                culled = S::Or(culled, SphereInsidePlane<S>(minPlane, px, py, pz, negR));
+                visible = S::Or(visible, S::AndNot(isPoint, culled));
+            }
+
+            if (S::MoveMask(isSpot))
+            {
+                F dx = S::Load(lights.DirectionX + i);
+                F dy = S::Load(lights.DirectionY + i);
+                F dz = S::Load(lights.DirectionZ + i);
+                F coneR = S::Load(lights.ConeRadius + i);
+
+                F extent = S::Mul(coneR, S::Sqrt(S::Max(S::Sub(S::Set1(1.0f), S::Mul(dz, dz)), S::Set1(0.0f))));
+
+                F culled = S::Or(
+                    ConeInsideDepthPlane<S>(nearPlane, pz, r, dz, extent),
+                    ConeInsideDepthPlane<S>(farPlane, pz, r, dz, extent));
+                for (int p = 0; p < 4; ++p)
+                {
+                    culled = S::Or(culled, ConeInsidePlane<S>(planes[p], px, py, pz, r, dx, dy, dz, coneR));
+                }
+                culled = S::Or(culled, ConeInsideDepthPlane<S>(minPlane, pz, r, dz, extent));
+
+                F bx = S::Load(lights.BoundsX + i);
+                F by = S::Load(lights.BoundsY + i);
+                F bz = S::Load(lights.BoundsZ + i);
+                F br = S::Load(lights.BoundsRadius + i);
+                F cosAngle = S::Load(lights.SpotCos + i);
+                F sinAngle = S::Load(lights.SpotSin + i);
+                culled = S::Or(culled, SpotOutsideTileVolume<S>(transparentVolume, bx, by, bz, br, px, py, pz, r, dx, dy, dz, cosAngle, sinAngle));
+                culled = S::Or(culled, SpotOutsideTileVolume<S>(opaqueVolume, bx, by, bz, br, px, py, pz, r, dx, dy, dz, cosAngle, sinAngle));
+                visible = S::Or(visible, S::AndNot(isSpot, culled));
+            }
+
+            // Width divides 64, so a batch never straddles two words
+            uint64_t bits = static_cast<uint32_t>(S::MoveMask(visible));
+            mask[i / 64] |= bits << (i % 64);
+        }
+    }
+}
+}
+}
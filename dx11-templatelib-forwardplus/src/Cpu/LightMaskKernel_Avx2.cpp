@@ -0,0 +1,43 @@
+#include "LightMaskKernel.h"
+
+#ifdef YR_CPU_X86
+
+#include <immintrin.h>
+
+namespace
+{
+    // 8 lights per instruction, this file is built with AVX2 enabled (see CMakeLists.txt)
+    // and only called after a runtime check
+    struct Avx2
+    {
+        using Float = __m256;
+        static const size_t Width = 8;
+
+        static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+        static Float Set1(float value) { return _mm256_set1_ps(value); }
+        static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+        static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+        static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+        static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+        static Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+        static Float CmpLt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Float CmpGt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+        static Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+        static Float AndNot(Float a, Float b) { return _mm256_andnot_ps(b, a); } // a & ~b
+        static int MoveMask(Float a) { return _mm256_movemask_ps(a); }
+
+        static Float TypeEquals(const int32_t* p, int32_t value)
+        {
+            __m256i type = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(type, _mm256_set1_epi32(value)));
+        }
+    };
+}
+
+void Yr::Cpu::Detail::CullTileLightMask_Avx2(const LightCullStreams& lights, const TileCullBounds& bounds, uint64_t* mask, size_t wordCount)
+{
+    CullTileLightMask<Avx2>(lights, bounds, mask, wordCount);
+}
+
+#endif
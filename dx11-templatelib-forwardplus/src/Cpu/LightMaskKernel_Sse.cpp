@@ -0,0 +1,42 @@
+#include "LightMaskKernel.h"
+
+#ifdef YR_CPU_X86
+
+#include <emmintrin.h>
+
+namespace
+{
+    // 4 lights per instruction, SSE2 is part of the x64 baseline
+    struct Sse
+    {
+        using Float = __m128;
+        static const size_t Width = 4;
+
+        static Float Load(const float* p) { return _mm_loadu_ps(p); }
+        static Float Set1(float value) { return _mm_set1_ps(value); }
+        static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+        static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+        static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+        static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+        static Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+        static Float CmpLt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+        static Float CmpGt(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+        static Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+        static Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+        static Float AndNot(Float a, Float b) { return _mm_andnot_ps(b, a); } // a & ~b
+        static int MoveMask(Float a) { return _mm_movemask_ps(a); }
+
+        static Float TypeEquals(const int32_t* p, int32_t value)
+        {
+            __m128i type = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(type, _mm_set1_epi32(value)));
+        }
+    };
+}
+
+void Yr::Cpu::Detail::CullTileLightMask_Sse(const LightCullStreams& lights, const TileCullBounds& bounds, uint64_t* mask, size_t wordCount)
+{
+    CullTileLightMask<Sse>(lights, bounds, mask, wordCount);
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include "Cpu/LightPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+const LightPool::Handle LightPool::InvalidHandle;
+const size_t LightPool::DirtyPageSize;
+const size_t LightPool::DefaultMaxDirtyRanges;
+
+LightPool::Handle LightPool::Add(const Light& light)
+{
+    Handle handle;
+    if (!m_FreeHandles.empty())
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<Handle>(m_HandleSlots.size());
+        m_HandleSlots.push_back(InvalidHandle);
+    }
+
+    size_t slot = m_Lights.size();
+    m_Lights.push_back(light);
+    m_SlotHandles.push_back(handle);
+    m_HandleSlots[handle] = static_cast<uint32_t>(slot);
+
+    MarkDirty(slot, slot + 1);
+    return handle;
+}
+
+void LightPool::Remove(Handle handle)
+{
+    assert(Contains(handle));
+
+    size_t slot = m_HandleSlots[handle];
+    size_t last = m_Lights.size() - 1;
+
+    // move the last light into the hole to keep the array dense
+    if (slot != last)
+    {
+        m_Lights[slot] = m_Lights[last];
+        m_SlotHandles[slot] = m_SlotHandles[last];
+        m_HandleSlots[m_SlotHandles[slot]] = static_cast<uint32_t>(slot);
+        MarkDirty(slot, slot + 1);
+    }
+
+    m_Lights.pop_back();
+    m_SlotHandles.pop_back();
+    m_HandleSlots[handle] = InvalidHandle;
+    m_FreeHandles.push_back(handle);
+
+    // nothing past the new end needs to be uploaded
+    ClearPagesFrom((m_Lights.size() + DirtyPageSize - 1) / DirtyPageSize);
+}
+
+void LightPool::Update(Handle handle, const Light& light)
+{
+    Edit(GetSlot(handle)) = light;
+}
+
+void LightPool::Clear()
+{
+    m_Lights.clear();
+    m_SlotHandles.clear();
+    m_HandleSlots.clear();
+    m_FreeHandles.clear();
+    ClearDirty();
+}
+
+void LightPool::Reserve(size_t capacity)
+{
+    m_Lights.reserve(capacity);
+    m_SlotHandles.reserve(capacity);
+    m_HandleSlots.reserve(capacity);
+}
+
+bool LightPool::Contains(Handle handle) const
+{
+    return handle < m_HandleSlots.size() && m_HandleSlots[handle] != InvalidHandle;
+}
+
+size_t LightPool::GetSlot(Handle handle) const
+{
+    assert(Contains(handle));
+    return m_HandleSlots[handle];
+}
+
+LightPool::Handle LightPool::GetHandle(size_t slot) const
+{
+    return m_SlotHandles[slot];
+}
+
+Light& LightPool::Edit(size_t slot)
+{
+    MarkDirty(slot, slot + 1);
+    return m_Lights[slot];
+}
+
+Light* LightPool::Edit(size_t begin, size_t end)
+{
+    MarkDirty(begin, end);
+    return m_Lights.data() + begin;
+}
+
+void LightPool::MarkDirty(size_t begin, size_t end)
+{
+    end = (std::min)(end, m_Lights.size());
+    if (begin >= end)
+    {
+        return;
+    }
+
+    size_t lastPage = (end - 1) / DirtyPageSize;
+    if (m_DirtyPages.size() * 64 <= lastPage)
+    {
+        m_DirtyPages.resize(lastPage / 64 + 1, 0);
+    }
+
+    for (size_t page = begin / DirtyPageSize; page <= lastPage; ++page)
+    {
+        uint64_t bit = 1ull << (page % 64);
+        uint64_t& word = m_DirtyPages[page / 64];
+        m_DirtyPageCount += (word & bit) ? 0 : 1;
+        word |= bit;
+    }
+}
+
+void LightPool::ClearDirty()
+{
+    std::fill(m_DirtyPages.begin(), m_DirtyPages.end(), 0);
+    m_DirtyPageCount = 0;
+}
+
+void LightPool::ClearPagesFrom(size_t firstPage)
+{
+    for (size_t page = firstPage; page < m_DirtyPages.size() * 64; ++page)
+    {
+        uint64_t bit = 1ull << (page % 64);
+        uint64_t& word = m_DirtyPages[page / 64];
+        m_DirtyPageCount -= (word & bit) ? 1 : 0;
+        word &= ~bit;
+    }
+}
+
+void LightPool::GetDirtyRanges(std::vector<DirtyRange>& ranges, size_t maxRangeCount) const
+{
+    ranges.clear();
+    if (!IsDirty())
+    {
+        return;
+    }
+
+    // runs of dirty pages
+    size_t pageCount = m_DirtyPages.size() * 64;
+    size_t page = 0;
+    while (page < pageCount)
+    {
+        uint64_t word = m_DirtyPages[page / 64] >> (page % 64);
+        if (!word)
+        {
+            page = (page / 64 + 1) * 64;
+            continue;
+        }
+
+        size_t first = page;
+        while (first < pageCount && !(m_DirtyPages[first / 64] & (1ull << (first % 64))))
+        {
+            ++first;
+        }
+        size_t last = first;
+        while (last < pageCount && (m_DirtyPages[last / 64] & (1ull << (last % 64))))
+        {
+            ++last;
+        }
+
+        ranges.push_back({ first * DirtyPageSize, (std::min)(last * DirtyPageSize, m_Lights.size()) });
+        page = last;
+    }
+
+    // merge across the smallest gaps until the ranges fit: the gaps up to the (excess)-th smallest one close
+    size_t maxRanges = (std::max)(maxRangeCount, (size_t)1);
+    if (ranges.size() <= maxRanges)
+    {
+        return;
+    }
+
+    std::vector<size_t> gaps(ranges.size() - 1);
+    for (size_t i = 1; i < ranges.size(); ++i)
+    {
+        gaps[i - 1] = ranges[i].Begin - ranges[i - 1].End;
+    }
+    size_t excess = ranges.size() - maxRanges;
+    std::nth_element(gaps.begin(), gaps.begin() + (excess - 1), gaps.end());
+    size_t maxGap = gaps[excess - 1];
+
+    // ties at maxGap may close more gaps than needed, never fewer
+    size_t kept = 0;
+    for (size_t i = 1; i < ranges.size(); ++i)
+    {
+        if (ranges[i].Begin - ranges[kept].End <= maxGap)
+        {
+            ranges[kept].End = ranges[i].End;
+        }
+        else
+        {
+            ranges[++kept] = ranges[i];
+        }
+    }
+    ranges.resize(kept + 1);
+}
+
+size_t LightPool::GetDirtyBytes(const std::vector<DirtyRange>& ranges)
+{
+    size_t bytes = 0;
+    for (const DirtyRange& range : ranges)
+    {
+        bytes += (range.End - range.Begin) * sizeof(Light);
+    }
+    return bytes;
+}
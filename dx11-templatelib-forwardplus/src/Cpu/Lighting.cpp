@@ -0,0 +1,94 @@
+#include "Cpu/Lighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "LightingKernel.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // One surface at a time with the standard library pow(), the reference the vector kernels are compared with
+    struct Scalar
+    {
+        using Float = float;
+        static const size_t Width = 1;
+
+        static Float Load(const float* p) { return *p; }
+        static void Store(float* p, Float a) { *p = a; }
+        static Float Set1(float value) { return value; }
+        static Float Add(Float a, Float b) { return a + b; }
+        static Float Sub(Float a, Float b) { return a - b; }
+        static Float Mul(Float a, Float b) { return a * b; }
+        static Float Div(Float a, Float b) { return a / b; }
+        static Float Min(Float a, Float b) { return std::min(a, b); }
+        static Float Max(Float a, Float b) { return std::max(a, b); }
+        static Float Sqrt(Float a) { return std::sqrt(a); }
+        static Float Pow(Float x, Float y) { return std::pow(x, y); }
+    };
+}
+
+void Cpu::PrepareShadingLights(const Light* lights, const uint32_t* indices, size_t lightCount, ShadingSpace space,
+    std::vector<ShadingLight>& result, const DerivedLight* derivedLights)
+{
+    result.clear();
+
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        size_t lightIndex = indices ? indices[i] : i;
+        const Light& light = lights[lightIndex];
+        if (!light.Enabled)
+        {
+            continue;
+        }
+
+        const Vector4& position = space == ShadingSpace::View ? light.PositionVS : light.PositionWS;
+        const Vector4& direction = space == ShadingSpace::View ? light.DirectionVS : light.DirectionWS;
+
+        ShadingLight shadingLight;
+        shadingLight.Position = position.xyz();
+        shadingLight.Direction = light.LightType == (int)LightType::Directional ? Normalize(direction.xyz()) : direction.xyz();
+        shadingLight.Color = light.Color.xyz() * light.Strength;
+        shadingLight.ConstantAttenuation = light.ConstantAttenuation;
+        shadingLight.LinearAttenuation = light.LinearAttenuation;
+        shadingLight.QuadraticAttenuation = light.QuadraticAttenuation;
+        if (derivedLights)
+        {
+            shadingLight.MinCos = derivedLights[lightIndex].SpotCosOuter;
+            shadingLight.MaxCos = derivedLights[lightIndex].SpotCosInner;
+        }
+        else
+        {
+            shadingLight.MinCos = std::cos(light.SpotAngle);
+            shadingLight.MaxCos = (shadingLight.MinCos + 1.0f) / 2.0f;
+        }
+        shadingLight.LightType = light.LightType;
+        result.push_back(shadingLight);
+    }
+}
+
+void Cpu::ComputeLighting(CullKernel kernel, const ShadingLight* lights, size_t lightCount, ShadingSpace space,
+    const Float3& eyePosition, const ShadingSurfaces& surfaces, const ShadingOutput& output)
+{
+    if (!IsCullKernelSupported(kernel))
+    {
+        kernel = CullKernel::Scalar;
+    }
+
+    switch (kernel)
+    {
+#ifdef YR_CPU_X86
+    case CullKernel::Sse:
+        Detail::ComputeLighting_Sse(lights, lightCount, space, eyePosition, surfaces, output);
+        break;
+    case CullKernel::Avx2:
+        Detail::ComputeLighting_Avx2(lights, lightCount, space, eyePosition, surfaces, output);
+        break;
+#endif
+    default:
+        Detail::ComputeLighting<Scalar>(lights, lightCount, space, eyePosition, surfaces, output);
+        break;
+    }
+}
@@ -0,0 +1,300 @@
+#pragma once
+
+// Private to src/Cpu: the batched lighting of Cpu/Lighting.h, instantiated once per instruction set in
+// LightingKernel_Sse.cpp / LightingKernel_Avx2.cpp, and with a one lane "instruction set" in Lighting.cpp.
+// Same rules as LightMaskKernel.h: everything shared between the translation units is a template on the
+// instruction set, and the kernels only read the plain structs of Lighting.h, never call its inline functions.
+
+#include <cstddef>
+
+#include "Cpu/Lighting.h"
+#include "LightMaskKernel.h"
+
+namespace Yr
+{
+namespace Cpu
+{
+namespace Detail
+{
+    void ComputeLighting_Sse(const ShadingLight* lights, size_t lightCount, ShadingSpace space, const Float3& eyePosition,
+        const ShadingSurfaces& surfaces, const ShadingOutput& output);
+    void ComputeLighting_Avx2(const ShadingLight* lights, size_t lightCount, ShadingSpace space, const Float3& eyePosition,
+        const ShadingSurfaces& surfaces, const ShadingOutput& output);
+
+    template<class S>
+    inline typename S::Float Select(typename S::Float mask, typename S::Float a, typename S::Float b)
+    {
+        return S::Or(S::And(mask, a), S::AndNot(b, mask));
+    }
+
+    /// <summary>
+    /// log2(x) for normal x > 0: exponent plus log2 of the mantissa in [sqrt(1/2), sqrt(2)),
+    /// 2 / ln(2) * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172, to the t^9 term
+    /// </summary>
+    template<class S>
+    inline typename S::Float Log2(typename S::Float x)
+    {
+        using F = typename S::Float;
+
+        F e = S::Exponent(x);
+        F m = S::Mantissa(x);
+        F large = S::CmpGt(m, S::Set1(1.41421356f));
+        m = Select<S>(large, S::Mul(m, S::Set1(0.5f)), m);
+        e = Select<S>(large, S::Add(e, S::Set1(1.0f)), e);
+
+        F t = S::Div(S::Sub(m, S::Set1(1.0f)), S::Add(m, S::Set1(1.0f)));
+        F t2 = S::Mul(t, t);
+        F series = S::Add(S::Set1(1.0f / 7.0f), S::Mul(t2, S::Set1(1.0f / 9.0f)));
+        series = S::Add(S::Set1(1.0f / 5.0f), S::Mul(t2, series));
+        series = S::Add(S::Set1(1.0f / 3.0f), S::Mul(t2, series));
+        series = S::Add(S::Set1(1.0f), S::Mul(t2, series));
+        return S::Add(e, S::Mul(S::Mul(t, S::Set1(2.88539008f)), series));
+    }
+
+    /// <summary>
+    /// exp2(x), x clamped to [-126, 127]: 2^round(x) from the exponent bits times e^(f ln 2) for the rest f in [-0.5, 0.5],
+    /// Taylor series to the f^7 term
+    /// </summary>
+    template<class S>
+    inline typename S::Float Exp2(typename S::Float x)
+    {
+        using F = typename S::Float;
+
+        x = S::Max(S::Min(x, S::Set1(127.0f)), S::Set1(-126.0f));
+        F n = S::Round(x);
+        F y = S::Mul(S::Sub(x, n), S::Set1(0.693147181f));
+
+        F series = S::Add(S::Set1(1.0f / 720.0f), S::Mul(y, S::Set1(1.0f / 5040.0f)));
+        series = S::Add(S::Set1(1.0f / 120.0f), S::Mul(y, series));
+        series = S::Add(S::Set1(1.0f / 24.0f), S::Mul(y, series));
+        series = S::Add(S::Set1(1.0f / 6.0f), S::Mul(y, series));
+        series = S::Add(S::Set1(0.5f), S::Mul(y, series));
+        series = S::Add(S::Set1(1.0f), S::Mul(y, series));
+        series = S::Add(S::Set1(1.0f), S::Mul(y, series));
+        return S::Mul(series, S::Pow2(n));
+    }
+
+    /// <summary>
+    /// pow(x, y) for x >= 0 as HLSL evaluates it, exp2(y * log2(x)), 0 for x = 0
+    /// </summary>
+    template<class S>
+    inline typename S::Float Pow(typename S::Float x, typename S::Float y)
+    {
+        using F = typename S::Float;
+
+        F positive = S::CmpGt(x, S::Set1(0.0f));
+        F result = Exp2<S>(S::Mul(y, Log2<S>(S::Max(x, S::Set1(1.17549435e-38f)))));
+        return S::And(positive, result);
+    }
+
+    /// <summary>
+    /// One light broadcast to every lane
+    /// </summary>
+    template<class S>
+    struct ShadingLightLanes
+    {
+        typename S::Float Px, Py, Pz;
+        typename S::Float Dx, Dy, Dz;
+        typename S::Float R, G, B;
+        typename S::Float Constant, Linear, Quadratic;
+        typename S::Float MinCos, CosRange;
+
+        static ShadingLightLanes Make(const ShadingLight& light)
+        {
+            return {
+                S::Set1(light.Position.x), S::Set1(light.Position.y), S::Set1(light.Position.z),
+                S::Set1(light.Direction.x), S::Set1(light.Direction.y), S::Set1(light.Direction.z),
+                S::Set1(light.Color.x), S::Set1(light.Color.y), S::Set1(light.Color.z),
+                S::Set1(light.ConstantAttenuation), S::Set1(light.LinearAttenuation), S::Set1(light.QuadraticAttenuation),
+                S::Set1(light.MinCos), S::Set1(light.MaxCos - light.MinCos)
+            };
+        }
+    };
+
+    /// <summary>
+    /// S::Width surfaces, their view vector and lighting so far
+    /// </summary>
+    template<class S>
+    struct SurfaceLanes
+    {
+        typename S::Float Px, Py, Pz;
+        typename S::Float Nx, Ny, Nz;
+        typename S::Float Vx, Vy, Vz;
+        typename S::Float SpecularPower;
+        typename S::Float DiffuseR, DiffuseG, DiffuseB;
+        typename S::Float SpecularR, SpecularG, SpecularB;
+    };
+
+    template<class S>
+    inline void LoadSurfaces(const ShadingSurfaces& surfaces, size_t i, bool viewSpace, const Float3& eyePosition, SurfaceLanes<S>& s)
+    {
+        using F = typename S::Float;
+
+        s.Px = S::Load(surfaces.PositionX + i);
+        s.Py = S::Load(surfaces.PositionY + i);
+        s.Pz = S::Load(surfaces.PositionZ + i);
+        s.Nx = S::Load(surfaces.NormalX + i);
+        s.Ny = S::Load(surfaces.NormalY + i);
+        s.Nz = S::Load(surfaces.NormalZ + i);
+        s.SpecularPower = S::Load(surfaces.SpecularPower + i);
+
+        // ComputeLightingVS(): normalize(positionVS), ComputeLightingWS(): normalize(eyePosition - positionWS)
+        F vx = viewSpace ? s.Px : S::Sub(S::Set1(eyePosition.x), s.Px);
+        F vy = viewSpace ? s.Py : S::Sub(S::Set1(eyePosition.y), s.Py);
+        F vz = viewSpace ? s.Pz : S::Sub(S::Set1(eyePosition.z), s.Pz);
+        F length = S::Sqrt(S::Add(S::Add(S::Mul(vx, vx), S::Mul(vy, vy)), S::Mul(vz, vz)));
+        s.Vx = S::Div(vx, length);
+        s.Vy = S::Div(vy, length);
+        s.Vz = S::Div(vz, length);
+
+        F zero = S::Set1(0.0f);
+        s.DiffuseR = s.DiffuseG = s.DiffuseB = zero;
+        s.SpecularR = s.SpecularG = s.SpecularB = zero;
+    }
+
+    template<class S>
+    inline void StoreSurfaces(const SurfaceLanes<S>& s, size_t i, const ShadingOutput& output)
+    {
+        S::Store(output.DiffuseR + i, s.DiffuseR);
+        S::Store(output.DiffuseG + i, s.DiffuseG);
+        S::Store(output.DiffuseB + i, s.DiffuseB);
+        S::Store(output.SpecularR + i, s.SpecularR);
+        S::Store(output.SpecularG + i, s.SpecularG);
+        S::Store(output.SpecularB + i, s.SpecularB);
+    }
+
+    /// <summary>
+    /// ComputeLight() of one light for S::Width surfaces, the light type is the same for every lane
+    /// </summary>
+    template<class S>
+    inline void ShadeLight(const ShadingLightLanes<S>& light, int lightType, SurfaceLanes<S>& s)
+    {
+        using F = typename S::Float;
+
+        F zero = S::Set1(0.0f);
+        F lx, ly, lz;
+        F scale;
+
+        if (lightType == (int)LightType::Directional)
+        {
+            lx = light.Dx;
+            ly = light.Dy;
+            lz = light.Dz;
+            scale = S::Set1(1.0f);
+        }
+        else
+        {
+            lx = S::Sub(light.Px, s.Px);
+            ly = S::Sub(light.Py, s.Py);
+            lz = S::Sub(light.Pz, s.Pz);
+            F distance = S::Sqrt(S::Add(S::Add(S::Mul(lx, lx), S::Mul(ly, ly)), S::Mul(lz, lz)));
+            lx = S::Div(lx, distance);
+            ly = S::Div(ly, distance);
+            lz = S::Div(lz, distance);
+
+            // DoAttenuation()
+            F denominator = S::Add(S::Add(light.Constant, S::Mul(light.Linear, distance)), S::Mul(S::Mul(light.Quadratic, distance), distance));
+            scale = S::Div(S::Set1(1.0f), denominator);
+
+            if (lightType == (int)LightType::Spotlight)
+            {
+                // DoSpotCone(light, -normalize(L)): dot(direction, normalize(L)) through smoothstep()
+                F cosAngle = S::Add(S::Add(S::Mul(light.Dx, lx), S::Mul(light.Dy, ly)), S::Mul(light.Dz, lz));
+                F t = S::Div(S::Sub(cosAngle, light.MinCos), light.CosRange);
+                t = S::Min(S::Max(t, zero), S::Set1(1.0f));
+                F spotIntensity = S::Mul(S::Mul(t, t), S::Sub(S::Set1(3.0f), S::Add(t, t)));
+                scale = S::Mul(scale, spotIntensity);
+            }
+        }
+
+        // DoDiffuse()
+        F NdotL = S::Add(S::Add(S::Mul(s.Nx, lx), S::Mul(s.Ny, ly)), S::Mul(s.Nz, lz));
+
+        // DoSpecular(): R = normalize(reflect(-L, N)) = normalize(2 * dot(N, L) * N - L)
+        F twoNdotL = S::Add(NdotL, NdotL);
+        F rx = S::Sub(S::Mul(twoNdotL, s.Nx), lx);
+        F ry = S::Sub(S::Mul(twoNdotL, s.Ny), ly);
+        F rz = S::Sub(S::Mul(twoNdotL, s.Nz), lz);
+        F rLength = S::Sqrt(S::Add(S::Add(S::Mul(rx, rx), S::Mul(ry, ry)), S::Mul(rz, rz)));
+        F RdotV = S::Div(S::Add(S::Add(S::Mul(rx, s.Vx), S::Mul(ry, s.Vy)), S::Mul(rz, s.Vz)), rLength);
+        F specular = S::Pow(S::Max(RdotV, zero), s.SpecularPower);
+
+        F diffuseScale = S::Mul(S::Max(NdotL, zero), scale);
+        F specularScale = S::Mul(specular, scale);
+
+        s.DiffuseR = S::Add(s.DiffuseR, S::Mul(light.R, diffuseScale));
+        s.DiffuseG = S::Add(s.DiffuseG, S::Mul(light.G, diffuseScale));
+        s.DiffuseB = S::Add(s.DiffuseB, S::Mul(light.B, diffuseScale));
+        s.SpecularR = S::Add(s.SpecularR, S::Mul(light.R, specularScale));
+        s.SpecularG = S::Add(s.SpecularG, S::Mul(light.G, specularScale));
+        s.SpecularB = S::Add(s.SpecularB, S::Mul(light.B, specularScale));
+    }
+
+    /// <summary>
+    /// Two registers of surfaces per step, so the light loop has two independent dependency chains.
+    /// The last partial step is shaded from a copy padded with the last surface.
+    /// </summary>
+    template<class S>
+    void ComputeLighting(const ShadingLight* lights, size_t lightCount, ShadingSpace space, const Float3& eyePosition,
+        const ShadingSurfaces& surfaces, const ShadingOutput& output)
+    {
+        const size_t batchSize = 2 * S::Width;
+        bool viewSpace = space == ShadingSpace::View;
+
+        auto shadeBatch = [&](const ShadingSurfaces& batch, size_t i, const ShadingOutput& batchOutput)
+        {
+            SurfaceLanes<S> s0;
+            SurfaceLanes<S> s1;
+            LoadSurfaces<S>(batch, i, viewSpace, eyePosition, s0);
+            LoadSurfaces<S>(batch, i + S::Width, viewSpace, eyePosition, s1);
+
+            for (size_t l = 0; l < lightCount; ++l)
+            {
+                ShadingLightLanes<S> light = ShadingLightLanes<S>::Make(lights[l]);
+                ShadeLight<S>(light, lights[l].LightType, s0);
+                ShadeLight<S>(light, lights[l].LightType, s1);
+            }
+
+            StoreSurfaces<S>(s0, i, batchOutput);
+            StoreSurfaces<S>(s1, i + S::Width, batchOutput);
+        };
+
+        size_t i = 0;
+        for (; i + batchSize <= surfaces.Count; i += batchSize)
+        {
+            shadeBatch(surfaces, i, output);
+        }
+
+        if (i == surfaces.Count)
+        {
+            return;
+        }
+
+        const float* inputs[7] = { surfaces.PositionX, surfaces.PositionY, surfaces.PositionZ,
+            surfaces.NormalX, surfaces.NormalY, surfaces.NormalZ, surfaces.SpecularPower };
+        float input[7][batchSize];
+        for (int c = 0; c < 7; ++c)
+        {
+            for (size_t k = 0; k < batchSize; ++k)
+            {
+                input[c][k] = inputs[c][i + k < surfaces.Count ? i + k : surfaces.Count - 1];
+            }
+        }
+
+        float results[6][batchSize];
+        ShadingSurfaces tail = { batchSize, input[0], input[1], input[2], input[3], input[4], input[5], input[6] };
+        ShadingOutput tailOutput = { results[0], results[1], results[2], results[3], results[4], results[5] };
+        shadeBatch(tail, 0, tailOutput);
+
+        float* outputs[6] = { output.DiffuseR, output.DiffuseG, output.DiffuseB, output.SpecularR, output.SpecularG, output.SpecularB };
+        for (int c = 0; c < 6; ++c)
+        {
+            for (size_t k = 0; i + k < surfaces.Count; ++k)
+            {
+                outputs[c][i + k] = results[c][k];
+            }
+        }
+    }
+}
+}
+}
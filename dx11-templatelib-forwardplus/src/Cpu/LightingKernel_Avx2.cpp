@@ -0,0 +1,61 @@
+#include "LightingKernel.h"
+
+#ifdef YR_CPU_X86
+
+#include <immintrin.h>
+
+namespace
+{
+    // 8 surfaces per instruction, this file is built with AVX2 enabled (see CMakeLists.txt)
+    // and only called after a runtime check
+    struct Avx2
+    {
+        using Float = __m256;
+        static const size_t Width = 8;
+
+        static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, Float a) { _mm256_storeu_ps(p, a); }
+        static Float Set1(float value) { return _mm256_set1_ps(value); }
+        static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+        static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+        static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+        static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+        static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+        static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+        static Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+        static Float CmpGt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+        static Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+        static Float AndNot(Float a, Float b) { return _mm256_andnot_ps(b, a); } // a & ~b
+
+        // Unbiased exponent of a positive float, and its mantissa as a float in [1, 2)
+        static Float Exponent(Float a)
+        {
+            __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(a), 23);
+            return _mm256_cvtepi32_ps(_mm256_sub_epi32(bits, _mm256_set1_epi32(127)));
+        }
+        static Float Mantissa(Float a)
+        {
+            __m256i bits = _mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(0x007fffff));
+            return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f800000)));
+        }
+
+        // Round to nearest, and 2^n for whole numbers n in [-126, 127]
+        static Float Round(Float a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Float Pow2(Float n)
+        {
+            __m256i exponent = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23));
+        }
+
+        static Float Pow(Float x, Float y) { return Yr::Cpu::Detail::Pow<Avx2>(x, y); }
+    };
+}
+
+void Yr::Cpu::Detail::ComputeLighting_Avx2(const ShadingLight* lights, size_t lightCount, ShadingSpace space, const Float3& eyePosition,
+    const ShadingSurfaces& surfaces, const ShadingOutput& output)
+{
+    ComputeLighting<Avx2>(lights, lightCount, space, eyePosition, surfaces, output);
+}
+
+#endif
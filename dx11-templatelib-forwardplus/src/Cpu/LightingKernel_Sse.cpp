@@ -0,0 +1,60 @@
+#include "LightingKernel.h"
+
+#ifdef YR_CPU_X86
+
+#include <emmintrin.h>
+
+namespace
+{
+    // 4 surfaces per instruction, SSE2 is part of the x64 baseline
+    struct Sse
+    {
+        using Float = __m128;
+        static const size_t Width = 4;
+
+        static Float Load(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, Float a) { _mm_storeu_ps(p, a); }
+        static Float Set1(float value) { return _mm_set1_ps(value); }
+        static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+        static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+        static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+        static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+        static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+        static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+        static Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+        static Float CmpGt(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+        static Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+        static Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+        static Float AndNot(Float a, Float b) { return _mm_andnot_ps(b, a); } // a & ~b
+
+        // Unbiased exponent of a positive float, and its mantissa as a float in [1, 2)
+        static Float Exponent(Float a)
+        {
+            __m128i bits = _mm_srli_epi32(_mm_castps_si128(a), 23);
+            return _mm_cvtepi32_ps(_mm_sub_epi32(bits, _mm_set1_epi32(127)));
+        }
+        static Float Mantissa(Float a)
+        {
+            __m128i bits = _mm_and_si128(_mm_castps_si128(a), _mm_set1_epi32(0x007fffff));
+            return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f800000)));
+        }
+
+        // Round to nearest, and 2^n for whole numbers n in [-126, 127]
+        static Float Round(Float a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+        static Float Pow2(Float n)
+        {
+            __m128i exponent = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+            return _mm_castsi128_ps(_mm_slli_epi32(exponent, 23));
+        }
+
+        static Float Pow(Float x, Float y) { return Yr::Cpu::Detail::Pow<Sse>(x, y); }
+    };
+}
+
+void Yr::Cpu::Detail::ComputeLighting_Sse(const ShadingLight* lights, size_t lightCount, ShadingSpace space, const Float3& eyePosition,
+    const ShadingSurfaces& surfaces, const ShadingOutput& output)
+{
+    ComputeLighting<Sse>(lights, lightCount, space, eyePosition, surfaces, output);
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include "Cpu/ObjMesh.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // OBJ indices are 1 based, negative ones count back from the last element read so far
+    bool ResolveIndex(long index, size_t count, size_t& result)
+    {
+        if (index > 0 && static_cast<size_t>(index) <= count)
+        {
+            result = static_cast<size_t>(index - 1);
+            return true;
+        }
+        if (index < 0 && static_cast<size_t>(-index) <= count)
+        {
+            result = count - static_cast<size_t>(-index);
+            return true;
+        }
+        return false;
+    }
+}
+
+bool Cpu::LoadObjMesh(const char* path, std::vector<MeshVertex>& vertices)
+{
+    vertices.clear();
+
+    FILE* file = std::fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::vector<Float3> positions;
+    std::vector<Float3> normals;
+    std::vector<Float2> texCoords;
+    std::vector<MeshVertex> face;
+
+    bool valid = true;
+    char line[1024];
+    while (valid && std::fgets(line, sizeof(line), file))
+    {
+        if (std::strncmp(line, "v ", 2) == 0)
+        {
+            Float3 p;
+            std::sscanf(line + 2, "%f %f %f", &p.x, &p.y, &p.z);
+            positions.push_back(p);
+        }
+        else if (std::strncmp(line, "vn ", 3) == 0)
+        {
+            Float3 n;
+            std::sscanf(line + 3, "%f %f %f", &n.x, &n.y, &n.z);
+            normals.push_back(n);
+        }
+        else if (std::strncmp(line, "vt ", 3) == 0)
+        {
+            Float2 t;
+            std::sscanf(line + 3, "%f %f", &t.x, &t.y);
+            texCoords.push_back(t);
+        }
+        else if (std::strncmp(line, "f ", 2) == 0)
+        {
+            // v, v/vt, v//vn or v/vt/vn per corner
+            face.clear();
+            char* cursor = line + 2;
+            for (;;)
+            {
+                char* next = nullptr;
+                long index = std::strtol(cursor, &next, 10);
+                if (next == cursor)
+                {
+                    break;
+                }
+
+                MeshVertex vertex = {};
+                size_t resolved = 0;
+                if (!ResolveIndex(index, positions.size(), resolved))
+                {
+                    valid = false;
+                    break;
+                }
+                vertex.Position[0] = positions[resolved].x;
+                vertex.Position[1] = positions[resolved].y;
+                vertex.Position[2] = positions[resolved].z;
+
+                cursor = next;
+                if (*cursor == '/')
+                {
+                    ++cursor;
+                    index = std::strtol(cursor, &next, 10);
+                    if (next != cursor && ResolveIndex(index, texCoords.size(), resolved))
+                    {
+                        vertex.TexCoord[0] = texCoords[resolved].x;
+                        vertex.TexCoord[1] = texCoords[resolved].y;
+                    }
+                    cursor = next;
+                }
+                if (*cursor == '/')
+                {
+                    ++cursor;
+                    index = std::strtol(cursor, &next, 10);
+                    if (next != cursor && ResolveIndex(index, normals.size(), resolved))
+                    {
+                        vertex.Normal[0] = normals[resolved].x;
+                        vertex.Normal[1] = normals[resolved].y;
+                        vertex.Normal[2] = normals[resolved].z;
+                    }
+                    cursor = next;
+                }
+                face.push_back(vertex);
+            }
+
+            for (size_t i = 1; i + 1 < face.size(); ++i)
+            {
+                vertices.push_back(face[0]);
+                vertices.push_back(face[i]);
+                vertices.push_back(face[i + 1]);
+            }
+        }
+    }
+
+    std::fclose(file);
+    return valid;
+}
@@ -0,0 +1,270 @@
+#include "Cpu/ScatterLightCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/FrustumGrid.h"
+#include "Cpu/LightListCompaction.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Lights per culling job, fixed so the pairs of a chunk are always the same lights
+    const size_t ChunkSize = 64;
+
+    // Range of a / z over a sphere centered at (ca, cz), z > r: the slopes of the two lines through the eye
+    // tangent to the circle of radius r in the (a, z) plane
+    void GetTangentSlopes(float ca, float cz, float r, float& lo, float& hi)
+    {
+        float t = std::sqrt(std::max(ca * ca + cz * cz - r * r, 0.0f));
+        lo = (ca * t - cz * r) / (cz * t + ca * r);
+        hi = (ca * t + cz * r) / (cz * t - ca * r);
+    }
+
+    // Inclusive tile range of the pixels [p0, p1], one pixel wider on both sides so tiles whose edge plane
+    // grazes the sphere are still tested
+    void GetTileRange(float p0, float p1, int blockSize, int tileCount, int& minTile, int& maxTile)
+    {
+        minTile = std::max(static_cast<int>(std::floor((p0 - 1.0f) / blockSize)), 0);
+        maxTile = std::min(static_cast<int>(std::floor((p1 + 1.0f) / blockSize)), tileCount - 1);
+    }
+}
+
+ScatterLightCuller::ScatterLightCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+TileRect ScatterLightCuller::GetSphereTileRect(const LightCullInput& input, const Float4x4& projection, float nearClipVS, const Sphere& sphere)
+{
+    int tileCountX = GetTileCount(input.Width, input.BlockSize);
+    int tileCountY = GetTileCount(input.Height, input.BlockSize);
+
+    TileRect rect;
+    rect.MaxX = tileCountX - 1;
+    rect.MaxY = tileCountY - 1;
+
+    // Crossing the near plane, the projection is unbounded
+    if (sphere.c.z - sphere.r <= nearClipVS)
+    {
+        return rect;
+    }
+
+    float x0, x1, y0, y1;
+    GetTangentSlopes(sphere.c.x, sphere.c.z, sphere.r, x0, x1);
+    GetTangentSlopes(sphere.c.y, sphere.c.z, sphere.r, y0, y1);
+
+    // Clip space x = x * m[0][0] + z * m[2][0] with w = z, and screen y points down
+    const float (&m)[4][4] = projection.m;
+    float px0 = ((x0 * m[0][0] + m[2][0]) * 0.5f + 0.5f) * input.Width;
+    float px1 = ((x1 * m[0][0] + m[2][0]) * 0.5f + 0.5f) * input.Width;
+    float py0 = (0.5f - (y1 * m[1][1] + m[2][1]) * 0.5f) * input.Height;
+    float py1 = (0.5f - (y0 * m[1][1] + m[2][1]) * 0.5f) * input.Height;
+
+    if (!std::isfinite(px0) || !std::isfinite(px1) || !std::isfinite(py0) || !std::isfinite(py1))
+    {
+        return rect;
+    }
+
+    GetTileRange(px0, px1, input.BlockSize, tileCountX, rect.MinX, rect.MaxX);
+    GetTileRange(py0, py1, input.BlockSize, tileCountY, rect.MinY, rect.MaxY);
+    return rect;
+}
+
+TileRect ScatterLightCuller::GetLightTileRect(const LightCullInput& input, const Float4x4& projection, float nearClipVS, float farDepthVS,
+    const Light& light)
+{
+    TileRect rect;
+    if (!light.Enabled)
+    {
+        return rect;
+    }
+
+    Sphere sphere;
+    if (!GetLightBoundingSphere(light, sphere))
+    {
+        if (input.UseGlobalLightList)
+        {
+            return rect;
+        }
+
+        rect.MaxX = GetTileCount(input.Width, input.BlockSize) - 1;
+        rect.MaxY = GetTileCount(input.Height, input.BlockSize) - 1;
+        return rect;
+    }
+
+    // Entirely in front of the near plane or behind the deepest tile
+    if (sphere.c.z + sphere.r < nearClipVS || sphere.c.z - sphere.r > farDepthVS)
+    {
+        return rect;
+    }
+    return GetSphereTileRect(input, projection, nearClipVS, sphere);
+}
+
+void ScatterLightCuller::Cull(const LightCullInput& input, LightCullResult& result)
+{
+    int tileCountX = GetTileCount(input.Width, input.BlockSize);
+    int tileCountY = GetTileCount(input.Height, input.BlockSize);
+    size_t tileCount = static_cast<size_t>(tileCountX) * tileCountY;
+    bool transparent = input.BuildTransparentLists;
+
+    result.TileCountX = tileCountX;
+    result.TileCountY = tileCountY;
+
+    // 1. depth bounds and test volumes of every tile, as the gather culler computes them
+    m_Tiles.resize(tileCount);
+    m_RowMaxDepths.resize(tileCountY);
+    m_ThreadPool.ParallelFor(tileCountY, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            float maxDepthVS = 0.0f;
+            for (int x = 0; x < tileCountX; ++x)
+            {
+                int tileY = static_cast<int>(y);
+                TileDepthBounds bounds = TiledLightCuller::ComputeTileDepthBounds(input, x, tileY);
+                Frustum frustum = TiledLightCuller::GetTileFrustum(input, x, tileY);
+                m_Tiles[x + y * tileCountX] = TiledLightCuller::GetTileCullContext(input, frustum, bounds);
+                maxDepthVS = std::max(maxDepthVS, bounds.MaxDepthVS);
+            }
+            m_RowMaxDepths[y] = maxDepthVS;
+        }
+    });
+
+    float nearClipVS = ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+    m_FarDepthVS = *std::max_element(m_RowMaxDepths.begin(), m_RowMaxDepths.end());
+    Float4x4 projection = Inverse(input.InverseProjection);
+
+    if (m_CounterCapacity < 2 * tileCount)
+    {
+        m_CounterCapacity = 2 * tileCount;
+        m_Counters.reset(new std::atomic<uint32_t>[m_CounterCapacity]);
+    }
+    for (size_t i = 0; i < 2 * tileCount; ++i)
+    {
+        m_Counters[i].store(0, std::memory_order_relaxed);
+    }
+
+    // 2. every light tests the tiles of its rectangle
+    size_t chunkCount = (input.LightCount + ChunkSize - 1) / ChunkSize;
+    m_ChunkPairs.resize(chunkCount);
+    m_ChunkTestCounts.assign(chunkCount, 0);
+
+    m_ThreadPool.ParallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t chunk = begin; chunk < end; ++chunk)
+        {
+            std::vector<TileLight>& pairs = m_ChunkPairs[chunk];
+            pairs.clear();
+            uint64_t testCount = 0;
+
+            size_t lastLight = std::min((chunk + 1) * ChunkSize, input.LightCount);
+            for (size_t i = chunk * ChunkSize; i < lastLight; ++i)
+            {
+                const Light& light = input.Lights[i];
+                const DerivedLight* derived = input.DerivedLights ? &input.DerivedLights[i] : nullptr;
+                TileRect rect = GetLightTileRect(input, projection, nearClipVS, m_FarDepthVS, light);
+
+                testCount += rect.TileCount();
+                for (int y = rect.MinY; y <= rect.MaxY; ++y)
+                {
+                    for (int x = rect.MinX; x <= rect.MaxX; ++x)
+                    {
+                        uint32_t tile = static_cast<uint32_t>(x + y * tileCountX);
+                        uint32_t flags = TiledLightCuller::TestLight(m_Tiles[tile], light, derived);
+                        if (!transparent)
+                        {
+                            flags &= TileLightOpaque;
+                        }
+                        if (!flags)
+                        {
+                            continue;
+                        }
+
+                        pairs.push_back({ tile, static_cast<uint32_t>(i), flags });
+                        if (flags & TileLightOpaque)
+                        {
+                            m_Counters[tile].fetch_add(1, std::memory_order_relaxed);
+                        }
+                        if (flags & TileLightTransparent)
+                        {
+                            m_Counters[tileCount + tile].fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            }
+
+            m_ChunkTestCounts[chunk] = testCount;
+        }
+    });
+
+    result.LightTestCount = 0;
+    for (uint64_t testCount : m_ChunkTestCounts)
+    {
+        result.LightTestCount += testCount;
+    }
+
+    // 3. count / scan / scatter the pairs into the lists of their tiles
+    BuildLists(tileCount, 0, result.LightGrid, result.LightIndexList);
+    if (transparent)
+    {
+        BuildLists(tileCount, 1, result.TransparentLightGrid, result.TransparentLightIndexList);
+    }
+    else
+    {
+        result.TransparentLightGrid.clear();
+        result.TransparentLightIndexList.clear();
+    }
+
+    GatherGlobalLights(input, result.GlobalLightIndexList);
+    ApplyLightBudget(m_ThreadPool, input, result);
+}
+
+void ScatterLightCuller::BuildLists(size_t tileCount, int listIndex, std::vector<uint2>& grid, std::vector<uint32_t>& indexList)
+{
+    std::atomic<uint32_t>* counters = m_Counters.get() + listIndex * tileCount;
+    uint32_t flag = listIndex == 0 ? TileLightOpaque : TileLightTransparent;
+
+    m_Offsets.resize(tileCount);
+    grid.resize(tileCount);
+    for (size_t tile = 0; tile < tileCount; ++tile)
+    {
+        m_Offsets[tile] = counters[tile].load(std::memory_order_relaxed);
+        grid[tile].y = m_Offsets[tile];
+        counters[tile].store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t total = ExclusiveScan(m_ThreadPool, m_Offsets.data(), tileCount, m_Offsets.data());
+    indexList.resize(total);
+    for (size_t tile = 0; tile < tileCount; ++tile)
+    {
+        grid[tile].x = m_Offsets[tile];
+    }
+
+    m_ThreadPool.ParallelFor(m_ChunkPairs.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t chunk = begin; chunk < end; ++chunk)
+        {
+            for (const TileLight& pair : m_ChunkPairs[chunk])
+            {
+                if (pair.Flags & flag)
+                {
+                    uint32_t index = counters[pair.Tile].fetch_add(1, std::memory_order_relaxed);
+                    indexList[grid[pair.Tile].x + index] = pair.Light;
+                }
+            }
+        }
+    });
+
+    // The chunks finish in any order, sort every list back to ascending light index
+    m_ThreadPool.ParallelFor(tileCount, 256, [&](size_t begin, size_t end)
+    {
+        for (size_t tile = begin; tile < end; ++tile)
+        {
+            auto first = indexList.begin() + grid[tile].x;
+            std::sort(first, first + grid[tile].y);
+        }
+    });
+}
@@ -0,0 +1,438 @@
+#include "Cpu/SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Triangles per setup job
+    const size_t ChunkSize = 2048;
+
+    // Guard band in NDC: x and y are clipped to [-GuardBand * w, GuardBand * w], which keeps the 24.8 fixed point
+    // coordinates and their edge function products in range while hardly ever clipping a visible triangle
+    const float GuardBand = 8.0f;
+
+    const int SubPixelBits = 8;
+    const int SubPixelScale = 1 << SubPixelBits;
+
+    struct ClipVertex
+    {
+        float Clip[4];
+        float Position[3];
+        float Normal[3];
+    };
+
+    ClipVertex Lerp(const ClipVertex& a, const ClipVertex& b, float t)
+    {
+        ClipVertex result;
+        for (int i = 0; i < 4; ++i)
+        {
+            result.Clip[i] = a.Clip[i] + (b.Clip[i] - a.Clip[i]) * t;
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            result.Position[i] = a.Position[i] + (b.Position[i] - a.Position[i]) * t;
+            result.Normal[i] = a.Normal[i] + (b.Normal[i] - a.Normal[i]) * t;
+        }
+        return result;
+    }
+
+    // Signed distance to clip plane `plane`, >= 0 inside: near, far, left, right, bottom, top
+    float PlaneDistance(const ClipVertex& v, int plane)
+    {
+        const float* c = v.Clip;
+        switch (plane)
+        {
+        case 0: return c[2];
+        case 1: return c[3] - c[2];
+        case 2: return c[0] + GuardBand * c[3];
+        case 3: return GuardBand * c[3] - c[0];
+        case 4: return c[1] + GuardBand * c[3];
+        default: return GuardBand * c[3] - c[1];
+        }
+    }
+
+    const int ClipPlaneCount = 6;
+    const int MaxClipVertices = 3 + ClipPlaneCount;
+
+    // Sutherland-Hodgman against one plane
+    int ClipPolygon(const ClipVertex* input, int count, int plane, ClipVertex* output)
+    {
+        int outputCount = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const ClipVertex& a = input[i];
+            const ClipVertex& b = input[(i + 1) % count];
+            float da = PlaneDistance(a, plane);
+            float db = PlaneDistance(b, plane);
+
+            if (da >= 0.0f)
+            {
+                output[outputCount++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                output[outputCount++] = Lerp(a, b, da / (da - db));
+            }
+        }
+        return outputCount;
+    }
+
+    inline int32_t ToFixed(float value)
+    {
+        return static_cast<int32_t>(std::floor(value * SubPixelScale + 0.5f));
+    }
+
+    // Edge from (x0, y0) to (x1, y1) of a triangle clockwise on screen (y down): top edges run to +x, left edges up
+    inline bool IsTopLeft(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+    {
+        return (y0 == y1 && x1 > x0) || y1 < y0;
+    }
+}
+
+const uint32_t RasterTarget::NoMaterial;
+const int SoftwareRasterizer::BinSize;
+
+void RasterTarget::Clear(int width, int height, bool withAttributes)
+{
+    size_t count = static_cast<size_t>(width) * height;
+    Width = width;
+    Height = height;
+    Depth.assign(count, 1.0f);
+
+    if (withAttributes)
+    {
+        for (std::vector<float>* attribute : { &PositionX, &PositionY, &PositionZ, &NormalX, &NormalY, &NormalZ })
+        {
+            attribute->assign(count, 0.0f);
+        }
+        MaterialIndex.assign(count, NoMaterial);
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void SoftwareRasterizer::Setup(const RasterInput& input)
+{
+    m_Input = input;
+    m_BinCountX = (input.Width + BinSize - 1) / BinSize;
+    m_BinCountY = (input.Height + BinSize - 1) / BinSize;
+    size_t binCount = static_cast<size_t>(m_BinCountX) * m_BinCountY;
+
+    // Split the draws into chunks, the storage of earlier frames is reused
+    size_t chunkCount = 0;
+    m_Stats = RasterStats();
+    for (size_t draw = 0; draw < input.DrawCount; ++draw)
+    {
+        size_t triangleCount = input.Draws[draw].VertexCount / 3;
+        m_Stats.TriangleCount += triangleCount;
+
+        for (size_t first = 0; first < triangleCount; first += ChunkSize)
+        {
+            if (chunkCount == m_Chunks.size())
+            {
+                m_Chunks.emplace_back();
+            }
+            Chunk& chunk = m_Chunks[chunkCount++];
+            chunk.Draw = draw;
+            chunk.FirstTriangle = first;
+            chunk.TriangleCount = std::min(ChunkSize, triangleCount - first);
+        }
+    }
+    m_Chunks.resize(chunkCount);
+
+    Float4x4 viewProjection = Multiply(input.View, input.Projection);
+    float width = static_cast<float>(input.Width);
+    float height = static_cast<float>(input.Height);
+
+    m_ThreadPool.ParallelFor(m_Chunks.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            Chunk& chunk = m_Chunks[c];
+            const RasterDraw& draw = input.Draws[chunk.Draw];
+            Float4x4 worldViewProjection = Multiply(draw.World, viewProjection);
+            Float4x4 normalMatrix = Transpose(Inverse(draw.World));
+
+            chunk.Triangles.clear();
+            chunk.Bins.resize(binCount);
+            for (std::vector<uint32_t>& bin : chunk.Bins)
+            {
+                bin.clear();
+            }
+            chunk.BinnedTriangleCount = 0;
+
+            for (size_t t = chunk.FirstTriangle; t < chunk.FirstTriangle + chunk.TriangleCount; ++t)
+            {
+                ClipVertex polygon[2][MaxClipVertices];
+                bool inside = true;
+                for (int i = 0; i < 3; ++i)
+                {
+                    const MeshVertex& vertex = draw.Vertices[3 * t + i];
+                    Float3 position(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+                    Float4 clip = Transform(Float4(position, 1.0f), worldViewProjection);
+                    Float3 positionWS = TransformPoint(position, draw.World);
+                    Float3 normalWS = TransformNormal(Float3(vertex.Normal[0], vertex.Normal[1], vertex.Normal[2]), normalMatrix);
+
+                    ClipVertex& v = polygon[0][i];
+                    v = { { clip.x, clip.y, clip.z, clip.w }, { positionWS.x, positionWS.y, positionWS.z }, { normalWS.x, normalWS.y, normalWS.z } };
+                    for (int plane = 0; plane < ClipPlaneCount; ++plane)
+                    {
+                        inside = inside && PlaneDistance(v, plane) >= 0.0f;
+                    }
+                }
+
+                int count = 3;
+                int current = 0;
+                if (!inside)
+                {
+                    for (int plane = 0; plane < ClipPlaneCount && count > 0; ++plane)
+                    {
+                        count = ClipPolygon(polygon[current], count, plane, polygon[1 - current]);
+                        current = 1 - current;
+                    }
+                }
+
+                // Fan of the clipped polygon
+                for (int i = 1; i + 1 < count; ++i)
+                {
+                    const ClipVertex* vertices[3] = { &polygon[current][0], &polygon[current][i], &polygon[current][i + 1] };
+
+                    Triangle triangle;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const float* c = vertices[k]->Clip;
+                        float invW = 1.0f / c[3];
+                        triangle.X[k] = ToFixed((c[0] * invW * 0.5f + 0.5f) * width);
+                        triangle.Y[k] = ToFixed((0.5f - c[1] * invW * 0.5f) * height);
+                        triangle.Z[k] = c[2] * invW;
+                        triangle.InvW[k] = invW;
+                        for (int j = 0; j < 3; ++j)
+                        {
+                            triangle.Position[k][j] = vertices[k]->Position[j] * invW;
+                            triangle.Normal[k][j] = vertices[k]->Normal[j] * invW;
+                        }
+                    }
+                    triangle.MaterialIndex = draw.MaterialIndex;
+
+                    int64_t area = int64_t(triangle.X[1] - triangle.X[0]) * (triangle.Y[2] - triangle.Y[0]) -
+                        int64_t(triangle.Y[1] - triangle.Y[0]) * (triangle.X[2] - triangle.X[0]);
+                    if (area == 0 || (area < 0 && input.CullMode == RasterCullMode::Back))
+                    {
+                        continue;
+                    }
+                    if (area < 0)
+                    {
+                        std::swap(triangle.X[1], triangle.X[2]);
+                        std::swap(triangle.Y[1], triangle.Y[2]);
+                        std::swap(triangle.Z[1], triangle.Z[2]);
+                        std::swap(triangle.InvW[1], triangle.InvW[2]);
+                        std::swap(triangle.Position[1], triangle.Position[2]);
+                        std::swap(triangle.Normal[1], triangle.Normal[2]);
+                    }
+
+                    // Conservative pixel bounds, the edge functions decide
+                    triangle.MinX = std::max(0, std::min({ triangle.X[0], triangle.X[1], triangle.X[2] }) >> SubPixelBits);
+                    triangle.MinY = std::max(0, std::min({ triangle.Y[0], triangle.Y[1], triangle.Y[2] }) >> SubPixelBits);
+                    triangle.MaxX = std::min(input.Width - 1, std::max({ triangle.X[0], triangle.X[1], triangle.X[2] }) >> SubPixelBits);
+                    triangle.MaxY = std::min(input.Height - 1, std::max({ triangle.Y[0], triangle.Y[1], triangle.Y[2] }) >> SubPixelBits);
+                    if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+                    {
+                        continue;
+                    }
+
+                    uint32_t index = static_cast<uint32_t>(chunk.Triangles.size());
+                    chunk.Triangles.push_back(triangle);
+                    for (int by = triangle.MinY / BinSize; by <= triangle.MaxY / BinSize; ++by)
+                    {
+                        for (int bx = triangle.MinX / BinSize; bx <= triangle.MaxX / BinSize; ++bx)
+                        {
+                            chunk.Bins[bx + static_cast<size_t>(by) * m_BinCountX].push_back(index);
+                            ++chunk.BinnedTriangleCount;
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    for (const Chunk& chunk : m_Chunks)
+    {
+        m_Stats.VisibleTriangleCount += chunk.Triangles.size();
+        m_Stats.BinnedTriangleCount += chunk.BinnedTriangleCount;
+    }
+}
+
+void SoftwareRasterizer::RasterizeDepth(DepthTest test, RasterTarget& target)
+{
+    Rasterize(Pass::Depth, test, BinSize, target, nullptr);
+}
+
+void SoftwareRasterizer::RasterizeGBuffer(DepthTest test, RasterTarget& target)
+{
+    Rasterize(Pass::GBuffer, test, BinSize, target, nullptr);
+}
+
+void SoftwareRasterizer::RasterizeFragments(DepthTest test, int blockSize, RasterTarget& target, const FragmentShader& shader)
+{
+    Rasterize(Pass::Fragments, test, blockSize, target, &shader);
+}
+
+void SoftwareRasterizer::Rasterize(Pass pass, DepthTest test, int blockSize, RasterTarget& target, const FragmentShader* shader)
+{
+    int width = m_Input.Width;
+    int height = m_Input.Height;
+    bool lessEqual = test == DepthTest::LessEqual;
+
+    m_ThreadPool.ParallelFor(static_cast<size_t>(m_BinCountX) * m_BinCountY, 1, [&](size_t begin, size_t end)
+    {
+        // Fragments of one triangle in one block
+        size_t blockArea = static_cast<size_t>(blockSize) * blockSize;
+        std::vector<uint32_t> pixels;
+        std::vector<float> attributes[6];
+        if (pass == Pass::Fragments)
+        {
+            pixels.resize(blockArea);
+            for (std::vector<float>& attribute : attributes)
+            {
+                attribute.resize(blockArea);
+            }
+        }
+
+        for (size_t bin = begin; bin < end; ++bin)
+        {
+            int binX0 = static_cast<int>(bin % m_BinCountX) * BinSize;
+            int binY0 = static_cast<int>(bin / m_BinCountX) * BinSize;
+            int binX1 = std::min(binX0 + BinSize, width) - 1;
+            int binY1 = std::min(binY0 + BinSize, height) - 1;
+
+            for (const Chunk& chunk : m_Chunks)
+            {
+                for (uint32_t index : chunk.Bins[bin])
+                {
+                    const Triangle& triangle = chunk.Triangles[index];
+                    int x0 = std::max(triangle.MinX, binX0);
+                    int y0 = std::max(triangle.MinY, binY0);
+                    int x1 = std::min(triangle.MaxX, binX1);
+                    int y1 = std::min(triangle.MaxY, binY1);
+
+                    // Edge function i is the one opposite vertex i, from vertex j to vertex k:
+                    // E(p) = A * (p.x - X[j]) + B * (p.y - Y[j]), >= 0 inside, exactly 0 on the edge only for top-left edges
+                    int64_t A[3];
+                    int64_t B[3];
+                    int64_t bias[3];
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        int j = (i + 1) % 3;
+                        int k = (i + 2) % 3;
+                        A[i] = -int64_t(triangle.Y[k] - triangle.Y[j]);
+                        B[i] = int64_t(triangle.X[k] - triangle.X[j]);
+                        bias[i] = IsTopLeft(triangle.X[j], triangle.Y[j], triangle.X[k], triangle.Y[k]) ? 0 : -1;
+                    }
+                    int64_t area = A[0] * (triangle.X[0] - triangle.X[1]) + B[0] * (triangle.Y[0] - triangle.Y[1]);
+                    float invArea = 1.0f / static_cast<float>(area);
+
+                    for (int blockY0 = y0 - (y0 - binY0) % blockSize; blockY0 <= y1; blockY0 += blockSize)
+                    {
+                        for (int blockX0 = x0 - (x0 - binX0) % blockSize; blockX0 <= x1; blockX0 += blockSize)
+                        {
+                            size_t fragmentCount = 0;
+
+                            int rowX0 = std::max(x0, blockX0);
+                            int rowX1 = std::min(x1, blockX0 + blockSize - 1);
+                            int rowY1 = std::min(y1, blockY0 + blockSize - 1);
+                            for (int y = std::max(y0, blockY0); y <= rowY1; ++y)
+                            {
+                                int64_t px = int64_t(rowX0) * SubPixelScale + SubPixelScale / 2;
+                                int64_t py = int64_t(y) * SubPixelScale + SubPixelScale / 2;
+                                int64_t e[3];
+                                for (int i = 0; i < 3; ++i)
+                                {
+                                    int j = (i + 1) % 3;
+                                    e[i] = A[i] * (px - triangle.X[j]) + B[i] * (py - triangle.Y[j]) + bias[i];
+                                }
+
+                                for (int x = rowX0; x <= rowX1; ++x, e[0] += A[0] * SubPixelScale, e[1] += A[1] * SubPixelScale, e[2] += A[2] * SubPixelScale)
+                                {
+                                    if ((e[0] | e[1] | e[2]) < 0)
+                                    {
+                                        continue;
+                                    }
+
+                                    float b0 = static_cast<float>(e[0] - bias[0]) * invArea;
+                                    float b1 = static_cast<float>(e[1] - bias[1]) * invArea;
+                                    float b2 = static_cast<float>(e[2] - bias[2]) * invArea;
+                                    float z = b0 * triangle.Z[0] + b1 * triangle.Z[1] + b2 * triangle.Z[2];
+
+                                    size_t pixel = x + static_cast<size_t>(y) * width;
+                                    float& depth = target.Depth[pixel];
+                                    if (!(lessEqual ? z <= depth : z < depth))
+                                    {
+                                        continue;
+                                    }
+                                    depth = z;
+
+                                    if (pass == Pass::Depth)
+                                    {
+                                        continue;
+                                    }
+
+                                    // Perspective correct interpolation, the attributes are stored divided by w
+                                    float w = 1.0f / (b0 * triangle.InvW[0] + b1 * triangle.InvW[1] + b2 * triangle.InvW[2]);
+                                    float value[6];
+                                    for (int c = 0; c < 3; ++c)
+                                    {
+                                        value[c] = (b0 * triangle.Position[0][c] + b1 * triangle.Position[1][c] + b2 * triangle.Position[2][c]) * w;
+                                        value[3 + c] = b0 * triangle.Normal[0][c] + b1 * triangle.Normal[1][c] + b2 * triangle.Normal[2][c];
+                                    }
+                                    float normalLength = std::sqrt(value[3] * value[3] + value[4] * value[4] + value[5] * value[5]);
+                                    for (int c = 3; c < 6; ++c)
+                                    {
+                                        value[c] /= normalLength;
+                                    }
+
+                                    if (pass == Pass::GBuffer)
+                                    {
+                                        target.PositionX[pixel] = value[0];
+                                        target.PositionY[pixel] = value[1];
+                                        target.PositionZ[pixel] = value[2];
+                                        target.NormalX[pixel] = value[3];
+                                        target.NormalY[pixel] = value[4];
+                                        target.NormalZ[pixel] = value[5];
+                                        target.MaterialIndex[pixel] = triangle.MaterialIndex;
+                                        continue;
+                                    }
+
+                                    pixels[fragmentCount] = static_cast<uint32_t>(pixel);
+                                    for (int c = 0; c < 6; ++c)
+                                    {
+                                        attributes[c][fragmentCount] = value[c];
+                                    }
+                                    ++fragmentCount;
+                                }
+                            }
+
+                            if (fragmentCount > 0)
+                            {
+                                FragmentBatch batch;
+                                batch.BlockX = blockX0 / blockSize;
+                                batch.BlockY = blockY0 / blockSize;
+                                batch.MaterialIndex = triangle.MaterialIndex;
+                                batch.Pixels = pixels.data();
+                                batch.Surfaces = { fragmentCount, attributes[0].data(), attributes[1].data(), attributes[2].data(),
+                                    attributes[3].data(), attributes[4].data(), attributes[5].data(), nullptr };
+                                (*shader)(batch);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,270 @@
+#include "Cpu/SoftwareRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#include "Cpu/SyntheticScene.h"
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // Per thread inputs and outputs of ComputeLighting() beyond the rasterizer's surfaces
+    struct ShadingScratch
+    {
+        std::vector<float> SpecularPower;
+        std::vector<float> Channels[6];
+
+        ShadingOutput Resize(size_t count, float specularPower)
+        {
+            SpecularPower.assign(count, specularPower);
+            for (std::vector<float>& channel : Channels)
+            {
+                channel.resize(std::max(channel.size(), count));
+            }
+            return { Channels[0].data(), Channels[1].data(), Channels[2].data(), Channels[3].data(), Channels[4].data(), Channels[5].data() };
+        }
+    };
+
+    thread_local ShadingScratch Scratch;
+
+    const SurfaceMaterial DefaultMaterial;
+}
+
+const char* Yr::Cpu::GetSoftwareTechniqueName(SoftwareTechnique technique)
+{
+    switch (technique)
+    {
+    case SoftwareTechnique::Forward: return "forward";
+    case SoftwareTechnique::Deferred: return "deferred";
+    case SoftwareTechnique::ForwardPlus: return "forward+";
+    default: return "unknown";
+    }
+}
+
+SoftwareRenderer::SoftwareRenderer(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+    , m_Rasterizer(threadPool)
+    , m_Culler(threadPool)
+    , m_Kernel(GetBestCullKernel())
+{
+}
+
+void SoftwareRenderer::Render(const SoftwareScene& scene, SoftwareTechnique technique)
+{
+    m_Scene = scene;
+    m_Stats = SoftwareFrameStats();
+
+    m_Lights.assign(scene.Lights, scene.Lights + scene.LightCount);
+    UpdateLightsViewSpace(m_Lights.data(), m_Lights.size(), scene.View);
+    PrepareShadingLights(m_Lights.data(), nullptr, m_Lights.size(), ShadingSpace::World, m_ShadingLights);
+
+    m_Color.assign(static_cast<size_t>(scene.Width) * scene.Height, Float3(0.0f, 0.0f, 0.0f));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    RasterInput input;
+    input.Width = scene.Width;
+    input.Height = scene.Height;
+    input.View = scene.View;
+    input.Projection = scene.Projection;
+    input.Draws = scene.Draws;
+    input.DrawCount = scene.DrawCount;
+    input.CullMode = scene.CullMode;
+    m_Rasterizer.Setup(input);
+    m_Stats.SetupMs = MillisecondsSince(start);
+
+    switch (technique)
+    {
+    case SoftwareTechnique::Forward:
+        RenderForward();
+        break;
+    case SoftwareTechnique::Deferred:
+        RenderDeferred();
+        break;
+    case SoftwareTechnique::ForwardPlus:
+        RenderForwardPlus();
+        break;
+    default:
+        break;
+    }
+}
+
+void SoftwareRenderer::RenderForward()
+{
+    m_Target.Clear(m_Scene.Width, m_Scene.Height, false);
+
+    std::atomic<uint64_t> fragmentCount(0);
+    auto start = std::chrono::high_resolution_clock::now();
+    m_Rasterizer.RasterizeFragments(DepthTest::Less, 16, m_Target, [&](const FragmentBatch& batch)
+    {
+        ShadeSurfaces(m_ShadingLights.data(), m_ShadingLights.size(), batch.MaterialIndex, batch.Surfaces, batch.Pixels, 0);
+        fragmentCount += batch.Surfaces.Count;
+    });
+    m_Stats.ShadeMs = MillisecondsSince(start);
+
+    m_Stats.ShadedFragmentCount = fragmentCount;
+    m_Stats.ShadedLightCount = fragmentCount * m_ShadingLights.size();
+}
+
+void SoftwareRenderer::RenderDeferred()
+{
+    m_Target.Clear(m_Scene.Width, m_Scene.Height, true);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    m_Rasterizer.RasterizeGBuffer(DepthTest::Less, m_Target);
+    m_Stats.DepthMs = MillisecondsSince(start);
+
+    // Lighting pass over the runs of pixels of one material on every row, read from the G-buffer in place
+    std::atomic<uint64_t> fragmentCount(0);
+    start = std::chrono::high_resolution_clock::now();
+    m_ThreadPool.ParallelFor(m_Scene.Height, 4, [&](size_t begin, size_t end)
+    {
+        uint64_t count = 0;
+        for (size_t y = begin; y < end; ++y)
+        {
+            size_t row = y * m_Scene.Width;
+            int x = 0;
+            while (x < m_Scene.Width)
+            {
+                uint32_t material = m_Target.MaterialIndex[row + x];
+                int runEnd = x + 1;
+                while (runEnd < m_Scene.Width && m_Target.MaterialIndex[row + runEnd] == material)
+                {
+                    ++runEnd;
+                }
+
+                if (material != RasterTarget::NoMaterial)
+                {
+                    size_t first = row + x;
+                    ShadingSurfaces surfaces = { static_cast<size_t>(runEnd - x),
+                        m_Target.PositionX.data() + first, m_Target.PositionY.data() + first, m_Target.PositionZ.data() + first,
+                        m_Target.NormalX.data() + first, m_Target.NormalY.data() + first, m_Target.NormalZ.data() + first, nullptr };
+                    ShadeSurfaces(m_ShadingLights.data(), m_ShadingLights.size(), material, surfaces, nullptr, first);
+                    count += surfaces.Count;
+                }
+                x = runEnd;
+            }
+        }
+        fragmentCount += count;
+    });
+    m_Stats.ShadeMs = MillisecondsSince(start);
+
+    m_Stats.ShadedFragmentCount = fragmentCount;
+    m_Stats.ShadedLightCount = fragmentCount * m_ShadingLights.size();
+}
+
+void SoftwareRenderer::RenderForwardPlus()
+{
+    m_Target.Clear(m_Scene.Width, m_Scene.Height, false);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    m_Rasterizer.RasterizeDepth(DepthTest::Less, m_Target);
+    m_Stats.DepthMs = MillisecondsSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    LightCullInput input;
+    input.Depth = m_Target.Depth.data();
+    input.Width = m_Scene.Width;
+    input.Height = m_Scene.Height;
+    input.BlockSize = m_TileSize;
+    input.InverseProjection = Inverse(m_Scene.Projection);
+    input.FrustumPlanes = &m_FrustumPlanes;
+    input.Lights = m_Lights.data();
+    input.LightCount = m_Lights.size();
+    input.UseGlobalLightList = true;
+    ComputeFrustumPlanes(input.InverseProjection, input.Width, input.Height, m_TileSize, m_FrustumPlanes);
+    m_Culler.Cull(input, m_LightLists);
+
+    // The lights of every tile as the kernels read them, the global lights first
+    m_TileLights.resize(m_LightLists.TileCount());
+    m_ThreadPool.ParallelFor(m_TileLights.size(), 64, [&](size_t begin, size_t end)
+    {
+        std::vector<ShadingLight> tileLights;
+        for (size_t tile = begin; tile < end; ++tile)
+        {
+            std::vector<ShadingLight>& lights = m_TileLights[tile];
+            PrepareShadingLights(m_Lights.data(), m_LightLists.GlobalLightIndexList.data(), m_LightLists.GlobalLightIndexList.size(),
+                ShadingSpace::World, lights);
+
+            const uint2& cell = m_LightLists.LightGrid[tile];
+            PrepareShadingLights(m_Lights.data(), m_LightLists.LightIndexList.data() + cell.x, cell.y, ShadingSpace::World, tileLights);
+            lights.insert(lights.end(), tileLights.begin(), tileLights.end());
+        }
+    });
+    m_Stats.CullMs = MillisecondsSince(start);
+
+    std::atomic<uint64_t> fragmentCount(0);
+    std::atomic<uint64_t> lightCount(0);
+    start = std::chrono::high_resolution_clock::now();
+    m_Rasterizer.RasterizeFragments(DepthTest::LessEqual, m_TileSize, m_Target, [&](const FragmentBatch& batch)
+    {
+        const std::vector<ShadingLight>& lights = m_TileLights[batch.BlockX + static_cast<size_t>(batch.BlockY) * m_LightLists.TileCountX];
+        ShadeSurfaces(lights.data(), lights.size(), batch.MaterialIndex, batch.Surfaces, batch.Pixels, 0);
+        fragmentCount += batch.Surfaces.Count;
+        lightCount += batch.Surfaces.Count * lights.size();
+    });
+    m_Stats.ShadeMs = MillisecondsSince(start);
+
+    m_Stats.ShadedFragmentCount = fragmentCount;
+    m_Stats.ShadedLightCount = lightCount;
+}
+
+void SoftwareRenderer::ShadeSurfaces(const ShadingLight* lights, size_t lightCount, uint32_t materialIndex, const ShadingSurfaces& surfaces,
+    const uint32_t* pixels, size_t firstPixel)
+{
+    const SurfaceMaterial& material = materialIndex < m_Scene.MaterialCount ? m_Scene.Materials[materialIndex] : DefaultMaterial;
+
+    ShadingOutput output = Scratch.Resize(surfaces.Count, material.SpecularPower);
+    ShadingSurfaces withMaterial = surfaces;
+    withMaterial.SpecularPower = Scratch.SpecularPower.data();
+    ComputeLighting(m_Kernel, lights, lightCount, ShadingSpace::World, m_Scene.EyePosition, withMaterial, output);
+
+    // (emissive + ambient + diffuse) * texColor + specular with texColor = 1, see ForwardLighting_LoopLightPS.hlsl
+    Float3 base(
+        material.Emissive.x + material.Ambient.x * m_Scene.GlobalAmbient.x,
+        material.Emissive.y + material.Ambient.y * m_Scene.GlobalAmbient.y,
+        material.Emissive.z + material.Ambient.z * m_Scene.GlobalAmbient.z);
+    for (size_t i = 0; i < surfaces.Count; ++i)
+    {
+        Float3& color = m_Color[pixels ? pixels[i] : firstPixel + i];
+        color.x = base.x + material.Diffuse.x * output.DiffuseR[i] + material.Specular.x * output.SpecularR[i];
+        color.y = base.y + material.Diffuse.y * output.DiffuseG[i] + material.Specular.y * output.SpecularG[i];
+        color.z = base.z + material.Diffuse.z * output.DiffuseB[i] + material.Specular.z * output.SpecularB[i];
+    }
+}
+
+bool SoftwareRenderer::WritePpm(const char* path) const
+{
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::fprintf(file, "P6\n%d %d\n255\n", m_Scene.Width, m_Scene.Height);
+    std::vector<uint8_t> row(static_cast<size_t>(m_Scene.Width) * 3);
+    for (int y = 0; y < m_Scene.Height; ++y)
+    {
+        for (int x = 0; x < m_Scene.Width; ++x)
+        {
+            const Float3& color = m_Color[x + static_cast<size_t>(y) * m_Scene.Width];
+            const float channels[3] = { color.x, color.y, color.z };
+            for (int c = 0; c < 3; ++c)
+            {
+                row[3 * x + c] = static_cast<uint8_t>(std::min(std::max(channels[c], 0.0f), 1.0f) * 255.0f + 0.5f);
+            }
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+
+    bool written = !std::ferror(file);
+    return std::fclose(file) == 0 && written;
+}
@@ -0,0 +1,267 @@
+#include "Cpu/SyntheticScene.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Same values as SimpleObj
+    const float FovInDegree = 45.0f;
+    const float NearPlane = 0.1f;
+    const float FarPlane = 100.0f;
+
+    // Bounds of assets/Models/cornelBox.obj
+    const float BoxHalfExtent = 7.414817f;
+    const float BoxFloor = 0.023348f;
+    const float BoxCeiling = 14.852983f;
+
+    // An axis aligned rectangle at `Value` on `Axis`, bounded on the two other axes
+    struct AxisRect
+    {
+        int Axis;
+        float Value;
+        float Min[3];
+        float Max[3];
+    };
+
+    struct SceneSphere
+    {
+        Float3 Center;
+        float Radius;
+    };
+
+    inline float Component(const Float3& v, int axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    float IntersectRect(const AxisRect& rect, const Float3& origin, const Float3& direction)
+    {
+        float d = Component(direction, rect.Axis);
+        if (d == 0.0f)
+        {
+            return -1.0f;
+        }
+
+        float t = (rect.Value - Component(origin, rect.Axis)) / d;
+        if (t <= 0.0f)
+        {
+            return -1.0f;
+        }
+
+        Float3 p = origin + direction * t;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (axis == rect.Axis)
+            {
+                continue;
+            }
+            float value = Component(p, axis);
+            if (value < rect.Min[axis] || value > rect.Max[axis])
+            {
+                return -1.0f;
+            }
+        }
+        return t;
+    }
+
+    float IntersectSphere(const SceneSphere& sphere, const Float3& origin, const Float3& direction)
+    {
+        Float3 oc = origin - sphere.Center;
+        float a = Dot(direction, direction);
+        float b = Dot(oc, direction);
+        float c = Dot(oc, oc) - sphere.Radius * sphere.Radius;
+        float discriminant = b * b - a * c;
+        if (discriminant < 0.0f)
+        {
+            return -1.0f;
+        }
+
+        float t = (-b - std::sqrt(discriminant)) / a;
+        return t > 0.0f ? t : -1.0f;
+    }
+
+    Light MakeLight(LightType type, const Float3& position, const Float3& direction, float strength)
+    {
+        Light light;
+        light.LightType = (int)type;
+        light.PositionWS = Vector4(position.x, position.y, position.z, 1.0f);
+        float length = Length(direction);
+        Float3 normalized = length > 0.0f ? direction / length : direction;
+        light.DirectionWS = Vector4(normalized.x, normalized.y, normalized.z, 1.0f);
+        light.Strength = strength;
+        light.Enabled = true;
+        return light;
+    }
+}
+
+namespace
+{
+    // SimpleObj's default camera at (0, 7.5, 25) with a yaw of 180 degrees, looking into the cornelBox
+    void SetupDefaultCamera(int width, int height, SyntheticScene& scene)
+    {
+        scene.Width = width;
+        scene.Height = height;
+
+        scene.EyePosition = Float3(0.0f, 7.5f, 25.0f);
+        scene.View = LookAtLH(scene.EyePosition, Float3(0.0f, 7.5f, 24.0f), Float3(0.0f, 1.0f, 0.0f));
+        scene.Projection = PerspectiveFovLH(Radians(FovInDegree), width / (float)height, NearPlane, FarPlane);
+        scene.InverseProjection = Inverse(scene.Projection);
+    }
+
+    // Ray cast the cornelBox and `spheres` into scene.Depth
+    void RenderDepth(SyntheticScene& scene, const std::vector<SceneSphere>& spheres)
+    {
+        const float h = BoxHalfExtent;
+        const AxisRect walls[] =
+        {
+            { 1, BoxFloor,   { -h, 0, -h }, { h, 0, h } },                  // floor
+            { 1, BoxCeiling, { -h, 0, -h }, { h, 0, h } },                  // ceiling
+            { 0, -h,         { 0, BoxFloor, -h }, { 0, BoxCeiling, h } },   // left wall
+            { 0, h,          { 0, BoxFloor, -h }, { 0, BoxCeiling, h } },   // right wall
+            { 2, -h,         { -h, BoxFloor, 0 }, { h, BoxCeiling, 0 } },   // back wall
+        };
+
+        int width = scene.Width;
+        int height = scene.Height;
+        Float4x4 inverseView = Inverse(scene.View);
+        float projectionX = scene.Projection.m[0][0];
+        float projectionY = scene.Projection.m[1][1];
+
+        scene.Depth.resize(static_cast<size_t>(width) * height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+                float ndcY = 1.0f - (y + 0.5f) / height * 2.0f;
+
+                // View space ray with z = 1, so the hit distance along it is the view space depth
+                Float3 directionVS(ndcX / projectionX, ndcY / projectionY, 1.0f);
+                Float3 directionWS = TransformNormal(directionVS, inverseView);
+
+                float closest = std::numeric_limits<float>::max();
+                for (auto& wall : walls)
+                {
+                    float t = IntersectRect(wall, scene.EyePosition, directionWS);
+                    if (t > 0.0f)
+                    {
+                        closest = std::min(closest, t);
+                    }
+                }
+                for (auto& sphere : spheres)
+                {
+                    float t = IntersectSphere(sphere, scene.EyePosition, directionWS);
+                    if (t > 0.0f)
+                    {
+                        closest = std::min(closest, t);
+                    }
+                }
+
+                float depth = 1.0f;
+                if (closest >= NearPlane && closest <= FarPlane)
+                {
+                    depth = scene.Projection.m[2][2] + scene.Projection.m[3][2] / closest;
+                }
+                scene.Depth[x + static_cast<size_t>(y) * width] = depth;
+            }
+        }
+    }
+}
+
+void Cpu::BuildDefaultScene(int width, int height, SyntheticScene& scene)
+{
+    SetupDefaultCamera(width, height, scene);
+
+    // The two bunnies
+    RenderDepth(scene, {
+        { Float3(4.5f, 1.8f, -4.5f), 1.8f },
+        { Float3(-4.5f, 1.8f, 1.0f), 1.8f },
+    });
+
+    // Same lights as SimpleObj::LoadLight()
+    Light directional = MakeLight(LightType::Directional, Float3(0.0f, 6.0f, 0.0f), Float3(1.0f, 0.5f, 0.25f), 0.5f);
+    Light point = MakeLight(LightType::Point, Float3(-0.5f, 3.0f, 0.0f), Float3(0.0f, 0.0f, 0.0f), 8.0f);
+    Light spotlight = MakeLight(LightType::Spotlight, Float3(0.178f, 4.0f, 0.6f), Float3(0.079f, -0.285f, 0.976f), 75.0f);
+    spotlight.SpotAngle = Radians(16.0f);
+
+    scene.Lights = { directional, point, spotlight };
+    UpdateLightsViewSpace(scene.Lights.data(), scene.Lights.size(), scene.View);
+}
+
+void Cpu::BuildStressScene(int width, int height, SyntheticScene& scene, uint32_t seed)
+{
+    SetupDefaultCamera(width, height, scene);
+
+    // Small spheres spread over the depth of the box, so most tiles see a near surface
+    // in front of the back wall with empty space in between
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> horizontal(-BoxHalfExtent, BoxHalfExtent);
+    std::uniform_real_distribution<float> vertical(BoxFloor, BoxCeiling);
+    std::uniform_real_distribution<float> radius(0.3f, 1.0f);
+
+    std::vector<SceneSphere> spheres(64);
+    for (auto& sphere : spheres)
+    {
+        sphere.Center = Float3(horizontal(random), vertical(random), horizontal(random));
+        sphere.Radius = radius(random);
+    }
+    RenderDepth(scene, spheres);
+
+    scene.Lights.clear();
+}
+
+void Cpu::GenerateLights(SyntheticScene& scene, size_t count, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> horizontal(-BoxHalfExtent, BoxHalfExtent);
+    std::uniform_real_distribution<float> vertical(BoxFloor, BoxCeiling);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+
+    scene.Lights.resize(count);
+    for (auto& light : scene.Lights)
+    {
+        Float3 position(horizontal(random), vertical(random), horizontal(random));
+        bool isSpotlight = unit(random) < 0.25f;
+
+        if (isSpotlight)
+        {
+            // Mostly pointing down towards the floor
+            Float3 direction(signedUnit(random) * 0.5f, -1.0f, signedUnit(random) * 0.5f);
+            light = MakeLight(LightType::Spotlight, position, direction, 0.02f + 0.18f * unit(random));
+            light.SpotAngle = Radians(10.0f + 30.0f * unit(random));
+        }
+        else
+        {
+            light = MakeLight(LightType::Point, position, Float3(0.0f, -1.0f, 0.0f), 0.02f + 0.18f * unit(random));
+        }
+
+        light.Color = Vector4(0.5f + 0.5f * unit(random), 0.5f + 0.5f * unit(random), 0.5f + 0.5f * unit(random), 1.0f);
+    }
+
+    UpdateLightsViewSpace(scene.Lights.data(), scene.Lights.size(), scene.View);
+}
+
+void Cpu::UpdateLightsViewSpace(Light* lights, size_t count, const Float4x4& view)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        Light& light = lights[i];
+
+        Float3 positionVS = TransformPoint(Float3(light.PositionWS.x, light.PositionWS.y, light.PositionWS.z), view);
+        light.PositionVS = Vector4(positionVS.x, positionVS.y, positionVS.z, 1.0f);
+
+        Float3 directionVS = TransformNormal(Float3(light.DirectionWS.x, light.DirectionWS.y, light.DirectionWS.z), view);
+        float length = Length(directionVS);
+        if (length > 0.0f)
+        {
+            directionVS = directionVS / length;
+        }
+        light.DirectionVS = Vector4(directionVS.x, directionVS.y, directionVS.z, 1.0f);
+    }
+}
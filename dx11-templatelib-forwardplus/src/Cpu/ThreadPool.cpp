@@ -0,0 +1,119 @@
+#include "Cpu/ThreadPool.h"
+
+#include <algorithm>
+
+using namespace Yr::Cpu;
+
+namespace
+{
+    thread_local bool t_InsideJob = false;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 1; i < threadCount; ++i)
+    {
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_StateMutex);
+        m_Quit = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = std::max<size_t>(1, grainSize);
+
+    // Nothing to share or we are already inside a job: run inline
+    if (m_Workers.empty() || t_InsideJob || count <= grainSize)
+    {
+        for (size_t begin = 0; begin < count; begin += grainSize)
+        {
+            func(begin, std::min(count, begin + grainSize));
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> jobLock(m_JobMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_StateMutex);
+        m_Job = &func;
+        m_JobCount = count;
+        m_JobGrainSize = grainSize;
+        m_NextIndex.store(0);
+        m_ActiveWorkers = static_cast<unsigned int>(m_Workers.size());
+        ++m_Generation;
+    }
+    m_WakeCondition.notify_all();
+
+    RunChunks();
+
+    std::unique_lock<std::mutex> lock(m_StateMutex);
+    m_DoneCondition.wait(lock, [this]() { return m_ActiveWorkers == 0; });
+    m_Job = nullptr;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    unsigned int seenGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_StateMutex);
+            m_WakeCondition.wait(lock, [&]() { return m_Quit || m_Generation != seenGeneration; });
+            if (m_Quit)
+            {
+                return;
+            }
+            seenGeneration = m_Generation;
+        }
+
+        RunChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_StateMutex);
+            --m_ActiveWorkers;
+        }
+        m_DoneCondition.notify_one();
+    }
+}
+
+void ThreadPool::RunChunks()
+{
+    t_InsideJob = true;
+
+    while (true)
+    {
+        size_t begin = m_NextIndex.fetch_add(m_JobGrainSize);
+        if (begin >= m_JobCount)
+        {
+            break;
+        }
+        (*m_Job)(begin, std::min(m_JobCount, begin + m_JobGrainSize));
+    }
+
+    t_InsideJob = false;
+}
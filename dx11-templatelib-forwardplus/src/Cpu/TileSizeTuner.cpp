@@ -0,0 +1,142 @@
+#include "Cpu/TileSizeTuner.h"
+#include "Cpu/Culling.h"
+#include "Cpu/CullingAnalysis.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Keeps the shaded values alive so the shading loop is not optimized away
+    volatile float ShadeSink = 0.0f;
+
+    // Attenuation of one light at p, the stand-in for its lighting
+    float ShadeLight(const Light& light, const Float3& p)
+    {
+        if (!LightTouchesPoint(light, p))
+        {
+            return 0.0f;
+        }
+
+        Float3 v(light.PositionVS.x - p.x, light.PositionVS.y - p.y, light.PositionVS.z - p.z);
+        float d = Length(v);
+        return light.Strength / (light.ConstantAttenuation + light.LinearAttenuation * d + light.QuadraticAttenuation * d * d);
+    }
+
+    template<class Func>
+    double MedianMilliseconds(int iterations, Func&& func)
+    {
+        std::vector<double> samples;
+        for (int i = 0; i < std::max(iterations, 1); ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            func();
+            auto end = std::chrono::high_resolution_clock::now();
+            samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+}
+
+uint64_t Cpu::ShadeLightLists(ThreadPool& threadPool, const LightCullInput& input, const LightCullResult& result)
+{
+    Float2 screenDimensions((float)input.Width, (float)input.Height);
+    const std::vector<uint32_t>& globalList = result.GlobalLightIndexList;
+    std::vector<uint64_t> rowCounts(result.TileCountY, 0);
+    std::vector<float> rowSums(result.TileCountY, 0.0f);
+
+    threadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t tileY = begin; tileY < end; ++tileY)
+        {
+            float sum = 0.0f;
+            uint64_t count = 0;
+
+            for (int tileX = 0; tileX < result.TileCountX; ++tileX)
+            {
+                const uint2& cell = result.LightGrid[tileX + tileY * result.TileCountX];
+                const uint32_t* list = result.LightIndexList.data() + cell.x;
+
+                int x0 = tileX * input.BlockSize;
+                int y0 = static_cast<int>(tileY) * input.BlockSize;
+                int x1 = std::min(x0 + input.BlockSize, input.Width);
+                int y1 = std::min(y0 + input.BlockSize, input.Height);
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        float depth = input.Depth[x + static_cast<size_t>(y) * input.Width];
+                        if (depth >= 1.0f)
+                        {
+                            continue;
+                        }
+
+                        Float3 p = ScreenToView(Float4(x + 0.5f, y + 0.5f, depth, 1.0f), screenDimensions, input.InverseProjection).xyz();
+                        for (uint32_t i : globalList)
+                        {
+                            sum += ShadeLight(input.Lights[i], p);
+                        }
+                        for (uint32_t i = 0; i < cell.y; ++i)
+                        {
+                            sum += ShadeLight(input.Lights[list[i]], p);
+                        }
+                        count += globalList.size() + cell.y;
+                    }
+                }
+            }
+
+            rowSums[tileY] = sum;
+            rowCounts[tileY] = count;
+        }
+    });
+
+    uint64_t shadedLightCount = 0;
+    float sum = 0.0f;
+    for (size_t y = 0; y < rowCounts.size(); ++y)
+    {
+        shadedLightCount += rowCounts[y];
+        sum += rowSums[y];
+    }
+    ShadeSink = sum;
+    return shadedLightCount;
+}
+
+TileSizeTuner::TileSizeTuner(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+    , m_Culler(threadPool)
+{
+}
+
+int TileSizeTuner::Tune(const LightCullInput& frameInput, int iterations)
+{
+    m_Timings.clear();
+
+    for (int tileSize : SupportedTileSizes)
+    {
+        LightCullInput input = frameInput;
+        input.BlockSize = tileSize;
+        input.Frustums = nullptr;
+        input.FrustumPlanes = &m_FrustumPlanes;
+        ComputeFrustumPlanes(input.InverseProjection, input.Width, input.Height, tileSize, m_FrustumPlanes);
+
+        TileSizeTiming timing;
+        timing.TileSize = tileSize;
+
+        // The first run warms the lists up to their final size
+        m_Culler.Cull(input, m_Result);
+        timing.CullMs = MedianMilliseconds(iterations, [&]() { m_Culler.Cull(input, m_Result); });
+        timing.ShadeMs = MedianMilliseconds(iterations, [&]() { timing.ShadedLightCount = ShadeLightLists(m_ThreadPool, input, m_Result); });
+        timing.IndexCount = m_Result.LightIndexList.size();
+        m_Timings.push_back(timing);
+    }
+
+    auto best = std::min_element(m_Timings.begin(), m_Timings.end(),
+        [](const TileSizeTiming& a, const TileSizeTiming& b) { return a.TotalMs() < b.TotalMs(); });
+    return best->TileSize;
+}
@@ -0,0 +1,125 @@
+#include "Cpu/TiledShading.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // Lights of the tile being shaded by this thread
+    thread_local std::vector<ShadingLight> TileLights;
+    thread_local std::vector<ShadingLight> ListLights;
+    thread_local std::vector<uint32_t> DecodedIndices;
+
+    ShadingSurfaces OffsetSurfaces(const ShadingSurfaces& surfaces, size_t first, size_t count)
+    {
+        return { count,
+            surfaces.PositionX + first, surfaces.PositionY + first, surfaces.PositionZ + first,
+            surfaces.NormalX + first, surfaces.NormalY + first, surfaces.NormalZ + first,
+            surfaces.SpecularPower + first };
+    }
+
+    ShadingOutput OffsetOutput(const ShadingOutput& output, size_t first)
+    {
+        return { output.DiffuseR + first, output.DiffuseG + first, output.DiffuseB + first,
+            output.SpecularR + first, output.SpecularG + first, output.SpecularB + first };
+    }
+}
+
+TiledShader::TiledShader(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+    , m_Kernel(GetBestCullKernel())
+{
+}
+
+void TiledShader::Shade(const TiledShadingInput& input, const ShadingOutput& output)
+{
+    const LightCullResult* lists = input.LightLists;
+    int tileSize = lists ? input.TileSize : 16;
+    int tileCountX = (input.Width + tileSize - 1) / tileSize;
+    int tileCountY = (input.Height + tileSize - 1) / tileSize;
+
+    if (!lists)
+    {
+        PrepareShadingLights(input.Lights, nullptr, input.LightCount, ShadingSpace::World, m_AllLights, input.DerivedLights);
+    }
+
+    std::atomic<uint64_t> pixelCount(0);
+    std::atomic<uint64_t> lightCount(0);
+    m_ThreadPool.ParallelFor(static_cast<size_t>(tileCountX) * tileCountY, 4, [&](size_t begin, size_t end)
+    {
+        uint64_t pixels = 0;
+        uint64_t lights = 0;
+        for (size_t tile = begin; tile < end; ++tile)
+        {
+            // global lights first, then the list of the tile, in the order of ForwardPlusLightingPS.hlsl
+            const std::vector<ShadingLight>* tileLights = &m_AllLights;
+            if (lists)
+            {
+                PrepareShadingLights(input.Lights, lists->GlobalLightIndexList.data(), lists->GlobalLightIndexList.size(),
+                    ShadingSpace::World, TileLights, input.DerivedLights);
+
+                if (input.EncodedLists)
+                {
+                    DecodedIndices.clear();
+                    input.EncodedLists->ForEachLight(tile, [](uint32_t lightIndex) { DecodedIndices.push_back(lightIndex); });
+                    PrepareShadingLights(input.Lights, DecodedIndices.data(), DecodedIndices.size(), ShadingSpace::World, ListLights,
+                        input.DerivedLights);
+                }
+                else
+                {
+                    const uint2& cell = lists->LightGrid[tile];
+                    PrepareShadingLights(input.Lights, lists->LightIndexList.data() + cell.x, cell.y, ShadingSpace::World, ListLights,
+                        input.DerivedLights);
+                }
+                TileLights.insert(TileLights.end(), ListLights.begin(), ListLights.end());
+                tileLights = &TileLights;
+            }
+
+            int x0 = static_cast<int>(tile % tileCountX) * tileSize;
+            int y0 = static_cast<int>(tile / tileCountX) * tileSize;
+            int x1 = std::min(x0 + tileSize, input.Width);
+            int y1 = std::min(y0 + tileSize, input.Height);
+
+            // runs of pixels with a surface within every row of the tile, batched into the kernels
+            for (int y = y0; y < y1; ++y)
+            {
+                size_t row = static_cast<size_t>(y) * input.Width;
+                int x = x0;
+                while (x < x1)
+                {
+                    int runEnd = x;
+                    while (runEnd < x1 && input.Depth[row + runEnd] < 1.0f)
+                    {
+                        ++runEnd;
+                    }
+
+                    if (runEnd > x)
+                    {
+                        size_t first = row + x;
+                        size_t count = static_cast<size_t>(runEnd - x);
+                        ComputeLighting(m_Kernel, tileLights->data(), tileLights->size(), ShadingSpace::World, input.EyePosition,
+                            OffsetSurfaces(input.Surfaces, first, count), OffsetOutput(output, first));
+                        pixels += count;
+                        lights += count * tileLights->size();
+                        x = runEnd;
+                    }
+                    else
+                    {
+                        size_t pixel = row + x;
+                        output.DiffuseR[pixel] = output.DiffuseG[pixel] = output.DiffuseB[pixel] = 0.0f;
+                        output.SpecularR[pixel] = output.SpecularG[pixel] = output.SpecularB[pixel] = 0.0f;
+                        ++x;
+                    }
+                }
+            }
+        }
+        pixelCount += pixels;
+        lightCount += lights;
+    });
+
+    m_Stats.ShadedPixelCount = pixelCount;
+    m_Stats.ShadedLightCount = lightCount;
+}
@@ -0,0 +1,184 @@
+#include "Cpu/ZBinLightCuller.h"
+#include "Cpu/Culling.h"
+#include "Cpu/LightMaskCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace Yr;
+using namespace Yr::Cpu;
+
+namespace
+{
+    // View space depth range of a light, false if the light is off
+    bool GetLightDepthRange(const Light& light, float& z0, float& z1)
+    {
+        if (!light.Enabled)
+        {
+            return false;
+        }
+
+        switch ((LightType)light.LightType)
+        {
+        case LightType::Point:
+        {
+            Sphere sphere = GetLightSphere(light);
+            z0 = sphere.c.z - sphere.r;
+            z1 = sphere.c.z + sphere.r;
+            return true;
+        }
+
+        case LightType::Spotlight:
+            GetSpotDepthRange(GetLightSpotVolume(light), z0, z1);
+            return true;
+
+        case LightType::Directional:
+            z0 = -FLT_MAX;
+            z1 = FLT_MAX;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    // Is the light inside both planes (the opposite side planes of a tile column or row)
+    bool LightInsidePlanes(const Light& light, const Plane& a, const Plane& b)
+    {
+        switch ((LightType)light.LightType)
+        {
+        case LightType::Point:
+        {
+            Sphere sphere = GetLightSphere(light);
+            return !SphereInsidePlane(sphere, a) && !SphereInsidePlane(sphere, b);
+        }
+
+        case LightType::Spotlight:
+        {
+            Cone cone = GetLightCone(light);
+            return !ConeInsidePlane(cone, a) && !ConeInsidePlane(cone, b);
+        }
+
+        default:
+            return true;
+        }
+    }
+}
+
+int ZBinResult::GetBin(float depthVS) const
+{
+    float bin = (depthVS - NearVS) / (FarVS - NearVS) * BinCount;
+    return static_cast<int>(std::fmin(std::fmax(bin, 0.0f), BinCount - 1.0f));
+}
+
+ZBinLightCuller::ZBinLightCuller(ThreadPool& threadPool)
+    : m_ThreadPool(threadPool)
+{
+}
+
+void ZBinLightCuller::Cull(const LightCullInput& input, const ZBinSettings& settings, ZBinResult& result)
+{
+    result.TileCountX = GetTileCount(input.Width, input.BlockSize);
+    result.TileCountY = GetTileCount(input.Height, input.BlockSize);
+    result.BinCount = std::max(settings.BinCount, 1);
+    result.NearVS = settings.NearVS > 0.0f ? settings.NearVS : ClipToView(Float4(0, 0, 0, 1), input.InverseProjection).z;
+    result.FarVS = settings.FarVS > 0.0f ? settings.FarVS : ClipToView(Float4(0, 0, 1, 1), input.InverseProjection).z;
+
+    // 1. sort the lights between the near and far plane by their nearest depth, ties in light order
+    m_MinDepths.resize(input.LightCount);
+    m_MaxDepths.resize(input.LightCount);
+    result.SortedLights.clear();
+    for (size_t i = 0; i < input.LightCount; ++i)
+    {
+        float z0, z1;
+        if (GetLightDepthRange(input.Lights[i], z0, z1) && z1 >= result.NearVS && z0 <= result.FarVS)
+        {
+            m_MinDepths[i] = z0;
+            m_MaxDepths[i] = z1;
+            result.SortedLights.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    std::sort(result.SortedLights.begin(), result.SortedLights.end(), [&](uint32_t a, uint32_t b)
+    {
+        return m_MinDepths[a] < m_MinDepths[b] || (m_MinDepths[a] == m_MinDepths[b] && a < b);
+    });
+
+    // 2. range of sorted lights overlapping every bin
+    const uint32_t lightCount = static_cast<uint32_t>(result.SortedLights.size());
+    result.Bins.assign(result.BinCount, uint2{ lightCount, 0 });
+    for (uint32_t i = 0; i < lightCount; ++i)
+    {
+        uint32_t light = result.SortedLights[i];
+        int first = result.GetBin(m_MinDepths[light]);
+        int last = result.GetBin(m_MaxDepths[light]);
+        for (int bin = first; bin <= last; ++bin)
+        {
+            result.Bins[bin].x = std::min(result.Bins[bin].x, i);
+            result.Bins[bin].y = std::max(result.Bins[bin].y, i + 1);
+        }
+    }
+    for (uint2& bin : result.Bins)
+    {
+        if (bin.x >= bin.y)
+        {
+            bin = uint2{ 0, 0 };
+        }
+    }
+
+    // 3. one mask per tile column and per tile row
+    const FrustumPlaneGrid* grid = input.FrustumPlanes;
+    if (!grid)
+    {
+        ComputeFrustumPlanes(input.InverseProjection, input.Width, input.Height, input.BlockSize, m_FrustumPlanes);
+        grid = &m_FrustumPlanes;
+    }
+
+    const size_t wordsPerTile = GetLightMaskWordCount(lightCount);
+    const int columnCount = result.TileCountX;
+    const int lineCount = result.TileCountX + result.TileCountY;
+    m_ColumnMasks.assign(lineCount * wordsPerTile, 0);
+
+    m_ThreadPool.ParallelFor(lineCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t line = begin; line < end; ++line)
+        {
+            Frustum frustum = line < (size_t)columnCount
+                ? grid->GetTileFrustum(static_cast<int>(line), 0)
+                : grid->GetTileFrustum(0, static_cast<int>(line - columnCount));
+            const Plane& a = line < (size_t)columnCount ? frustum.plane[0] : frustum.plane[2];
+            const Plane& b = line < (size_t)columnCount ? frustum.plane[1] : frustum.plane[3];
+
+            uint64_t* mask = m_ColumnMasks.data() + line * wordsPerTile;
+            for (uint32_t i = 0; i < lightCount; ++i)
+            {
+                if (LightInsidePlanes(input.Lights[result.SortedLights[i]], a, b))
+                {
+                    mask[i / 64] |= uint64_t(1) << (i % 64);
+                }
+            }
+        }
+    });
+
+    // 4. tile mask = column mask & row mask
+    result.WordsPerTile = wordsPerTile;
+    result.TileMasks.resize(static_cast<size_t>(result.TileCountX) * result.TileCountY * wordsPerTile);
+
+    m_ThreadPool.ParallelFor(result.TileCountY, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const uint64_t* rowMask = m_ColumnMasks.data() + (columnCount + y) * wordsPerTile;
+            for (int x = 0; x < result.TileCountX; ++x)
+            {
+                const uint64_t* columnMask = m_ColumnMasks.data() + x * wordsPerTile;
+                uint64_t* tileMask = result.TileMasks.data() + (x + y * result.TileCountX) * wordsPerTile;
+                for (size_t word = 0; word < wordsPerTile; ++word)
+                {
+                    tileMask[word] = columnMask[word] & rowMask[word];
+                }
+            }
+        }
+    });
+}
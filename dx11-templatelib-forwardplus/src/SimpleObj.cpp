@@ -399,14 +399,25 @@ void SimpleObj::LoadShaderResources()
         }
     }
 
+    // Tile size permutation of the frustum and light culling shaders, recompiled when m_TileSize changes
+    std::string tileSize = std::to_string(m_TileSize);
+    const D3D_SHADER_MACRO tileSizeDefines[] = { { "BLOCK_SIZE", tileSize.c_str() }, { nullptr, nullptr } };
+    bool tileSizeChanged = m_TileSize != m_ShaderTileSize;
+
+    // Light list layout permutation of the shading shaders, recompiled when GetShadingLightListEncoding() changes
+    Cpu::LightListEncoding lightListEncoding = GetShadingLightListEncoding();
+    std::string lightListEncodingValue = std::to_string((int)lightListEncoding);
+    const D3D_SHADER_MACRO shadingDefines[] = { { "BLOCK_SIZE", tileSize.c_str() }, { "LIGHT_LIST_ENCODING", lightListEncodingValue.c_str() }, { nullptr, nullptr } };
+    bool shadingChanged = tileSizeChanged || lightListEncoding != m_ShaderLightListEncoding;
+
     // Forward plus compute frustum shader
     {
         ComPtr<ID3DBlob> computeShaderBlob = nullptr;
         std::wstring filename = L"assets/Shaders/ForwardPlus/ComputeFrustum.hlsl";
         _int64 size = GetFileSize(filename);
-        if (size != m_d3dFowrardPlus_ComputeFrustumShaderSize)
+        if (size != m_d3dFowrardPlus_ComputeFrustumShaderSize || tileSizeChanged)
         {
-            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest");
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest", tileSizeDefines);
             CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_ComputeFrustumShader);
             m_d3dFowrardPlus_ComputeFrustumShaderSize = size;
         }
@@ -417,13 +428,106 @@ void SimpleObj::LoadShaderResources()
         ComPtr<ID3DBlob> computeShaderBlob = nullptr;
         std::wstring filename = L"assets/Shaders/ForwardPlus/CullLight.hlsl";
         _int64 size = GetFileSize(filename);
-        if (size != m_d3dFowrardPlus_CullLightShaderSize)
+        if (size != m_d3dFowrardPlus_CullLightShaderSize || tileSizeChanged)
         {
-            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest");
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest", tileSizeDefines);
             CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_CullLightShader);
             m_d3dFowrardPlus_CullLightShaderSize = size;
         }
     }
+
+    // Forward plus super-tile culling shader, coarse pass of hierarchical culling
+    {
+        ComPtr<ID3DBlob> computeShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/CullSuperTile.hlsl";
+        _int64 size = GetFileSize(filename);
+        if (size != m_d3dFowrardPlus_CullSuperTileShaderSize)
+        {
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest");
+            CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_CullSuperTileShader);
+            m_d3dFowrardPlus_CullSuperTileShaderSize = size;
+        }
+    }
+
+    // Forward plus light culling shader reading the super-tile candidates, includes CullLight.hlsl
+    {
+        ComPtr<ID3DBlob> computeShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/CullLightHierarchical.hlsl";
+        _int64 size = GetFileSize(filename) + GetFileSize(L"assets/Shaders/ForwardPlus/CullLight.hlsl");
+        if (size != m_d3dFowrardPlus_CullLightHierarchicalShaderSize || tileSizeChanged)
+        {
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest", tileSizeDefines);
+            CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_CullLightHierarchicalShader);
+            m_d3dFowrardPlus_CullLightHierarchicalShaderSize = size;
+        }
+    }
+
+    // Forward plus shading, loops over the light list of the tile of every pixel
+    {
+        ComPtr<ID3DBlob> pixelShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/ForwardPlusLightingPS.hlsl";
+        _int64 size = GetFileSize(filename) + GetFileSize(L"assets/Shaders/ForwardPlus/TiledLighting.hlsli");
+        if (size != m_d3dForwardPlus_Lighting_PixelShaderSize || shadingChanged)
+        {
+            pixelShaderBlob = LoadShader<ID3D11PixelShader>(m_d3dDevice, filename, "main", "latest", shadingDefines);
+            CreateShader(m_d3dDevice, pixelShaderBlob, nullptr, m_d3dForwardPlus_Lighting_PixelShader);
+            m_d3dForwardPlus_Lighting_PixelShaderSize = size;
+        }
+    }
+
+    // Forward plus shading Instanced
+    {
+        ComPtr<ID3DBlob> pixelShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/ForwardPlusLightingPS_Instanced.hlsl";
+        _int64 size = GetFileSize(filename) + GetFileSize(L"assets/Shaders/ForwardPlus/TiledLighting.hlsli");
+        if (size != m_d3dForwardPlus_Lighting_InstancedPixelShaderSize || shadingChanged)
+        {
+            pixelShaderBlob = LoadShader<ID3D11PixelShader>(m_d3dDevice, filename, "main", "latest", shadingDefines);
+            CreateShader(m_d3dDevice, pixelShaderBlob, nullptr, m_d3dForwardPlus_Lighting_InstancedPixelShader);
+            m_d3dForwardPlus_Lighting_InstancedPixelShaderSize = size;
+        }
+    }
+    m_ShaderTileSize = m_TileSize;
+    m_ShaderLightListEncoding = lightListEncoding;
+
+    // Forward plus min / max depth pyramid shader, tile depth bounds of the culling shaders
+    {
+        ComPtr<ID3DBlob> computeShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/DepthPyramid.hlsl";
+        _int64 size = GetFileSize(filename);
+        if (size != m_d3dFowrardPlus_DepthPyramidShaderSize)
+        {
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest");
+            CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_DepthPyramidShader);
+            m_d3dFowrardPlus_DepthPyramidShaderSize = size;
+        }
+    }
+
+    // Forward plus light grid scan shader, offsets of the deterministic light lists
+    {
+        ComPtr<ID3DBlob> computeShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/ScanLightGrid.hlsl";
+        _int64 size = GetFileSize(filename);
+        if (size != m_d3dFowrardPlus_ScanLightGridShaderSize)
+        {
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest");
+            CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_ScanLightGridShader);
+            m_d3dFowrardPlus_ScanLightGridShaderSize = size;
+        }
+    }
+
+    // Forward plus light list scatter shader, copies the staging lists to the scanned offsets
+    {
+        ComPtr<ID3DBlob> computeShaderBlob = nullptr;
+        std::wstring filename = L"assets/Shaders/ForwardPlus/ScatterLightLists.hlsl";
+        _int64 size = GetFileSize(filename);
+        if (size != m_d3dFowrardPlus_ScatterLightListsShaderSize)
+        {
+            computeShaderBlob = LoadShader<ID3D11ComputeShader>(m_d3dDevice, filename, "main", "latest");
+            CreateShader(m_d3dDevice, computeShaderBlob, nullptr, m_d3dFowrardPlus_ScatterLightListsShader);
+            m_d3dFowrardPlus_ScatterLightListsShaderSize = size;
+        }
+    }
 }
 
 /// <summary>
@@ -517,10 +621,10 @@ void SimpleObj::LoadLight()
     spotlight.Strength = 75.0f;
     spotlight.Enabled = true;
 
-    m_Scene.Lights[0] = directional;
-    m_Scene.Lights[1] = point;
-    m_Scene.Lights[2] = spotlight;
-    
+    m_Scene.Lights.Clear();
+    m_Scene.Lights.Add(directional);
+    m_Scene.Lights.Add(point);
+    m_Scene.Lights.Add(spotlight);
 }
 
 /// <summary>
@@ -539,6 +643,9 @@ void SimpleObj::RenderScene(RenderEventArgs& e)
     case RenderMode::ForwardPlus:
         RenderScene_FowardPlus(e);
         break;
+    case RenderMode::Software:
+        RenderScene_Software(e);
+        break;
     }
 }
 
@@ -570,7 +677,7 @@ void SimpleObj::RenderDebug(RenderEventArgs& e)
     m_d3dPrimitiveBatch->Begin();
     {
         float directionalLightDebugLength = 2.0f;
-        for (auto i = 0; i < MAX_LIGHTS; ++i)
+        for (size_t i = 0; i < m_Scene.Lights.Count(); ++i)
         {
             auto light = &m_Scene.Lights[i];
 
@@ -675,11 +782,24 @@ void SimpleObj::RenderImgui(RenderEventArgs& e)
     ImGui::PushID("Render Techniques");
     {
         int renderMode = (int)m_RenderMode;
-        if (ImGui::Combo("Render Techniques", &renderMode, "Forward\0Deferred\0Forward Plus\0"))
+        if (ImGui::Combo("Render Techniques", &renderMode, "Forward\0Deferred\0Forward Plus\0Software\0"))
         {
             m_RenderMode = (RenderMode)renderMode;
         }
 
+        if (m_RenderMode == RenderMode::Software)
+        {
+            int technique = (int)m_SoftwareRendering.GetTechnique();
+            if (ImGui::Combo("Software Technique", &technique, "Forward\0Deferred\0Forward Plus\0"))
+            {
+                m_SoftwareRendering.SetTechnique((Cpu::SoftwareTechnique)technique);
+            }
+
+            const auto& stats = m_SoftwareRendering.GetRenderer().GetStats();
+            ImGui::Text("setup %.2f ms + depth %.2f ms + cull %.2f ms + shade %.2f ms = %.2f ms (cpu)", stats.SetupMs, stats.DepthMs,
+                stats.CullMs, stats.ShadeMs, stats.TotalMs());
+        }
+
         if (m_RenderMode == RenderMode::Forward)
         {
             int lightingSpace = (int)m_LightingSpace;
@@ -720,7 +840,135 @@ void SimpleObj::RenderImgui(RenderEventArgs& e)
             m_DeferredDepthPower = scale;
         }
 
-        ImGui::SliderInt("Light Calc Threshold", &m_LightCalculationCount, 0.0f, MAX_LIGHTS);
+        if (m_RenderMode == RenderMode::ForwardPlus)
+        {
+            ImGui::Checkbox("Cull Lights On CPU", &m_CullLightOnCpu);
+            if (m_CullLightOnCpu)
+            {
+                // the gpu culling writes uint32 lists only
+                int lightListEncoding = (int)m_LightListEncoding;
+                if (ImGui::Combo("Light List Encoding", &lightListEncoding, "uint32\0uint16\0bitmask\0"))
+                {
+                    m_LightListEncoding = (Cpu::LightListEncoding)lightListEncoding;
+                }
+                if (GetShadingLightListEncoding() != m_LightListEncoding)
+                {
+                    ImGui::Text("%s cannot store %zu lights, using uint32", Cpu::GetLightListEncodingName(m_LightListEncoding), m_Scene.Lights.Count());
+                }
+            }
+            ImGui::Checkbox("Hierarchical Culling", &m_CullLightHierarchical);
+            ImGui::Checkbox("Depth Pyramid", &m_UseDepthPyramid);
+            ImGui::Checkbox("Deterministic Light Lists", &m_DeterministicLightLists);
+
+            // 0 keeps every light up to MAX_LIGHTS_PER_TILE
+            ImGui::SliderInt("Max Lights Per Tile", &m_MaxLightsPerTile, 0, MAX_LIGHTS_PER_TILE);
+            ImGui::Text("Light index lists: %u / %u opaque, %u / %u transparent", m_OpaqueLightIndexCounter.RequiredCount,
+                m_OpaqueLightIndexListCapacity, m_TransparentLightIndexCounter.RequiredCount, m_TransparentLightIndexListCapacity);
+            UINT truncatedListCount = m_OpaqueLightIndexCounter.TruncatedListCount + m_TransparentLightIndexCounter.TruncatedListCount;
+            if (truncatedListCount > 0)
+            {
+                ImGui::Text("Lists cut: %u, lights dropped: %u", truncatedListCount,
+                    m_OpaqueLightIndexCounter.DroppedLightCount + m_TransparentLightIndexCounter.DroppedLightCount);
+            }
+            if (m_LightIndexListGrowCount > 0)
+            {
+                ImGui::Text("Light index lists grown %u times", m_LightIndexListGrowCount);
+            }
+
+            int tileSizeIndex = 0;
+            for (int i = 0; i < Cpu::SupportedTileSizeCount; ++i)
+            {
+                tileSizeIndex = Cpu::SupportedTileSizes[i] == m_TileSize ? i : tileSizeIndex;
+            }
+            if (ImGui::Combo("Tile Size", &tileSizeIndex, "8\0" "16\0" "32\0"))
+            {
+                SetTileSize(Cpu::SupportedTileSizes[tileSizeIndex]);
+            }
+            ImGui::SameLine();
+            if (m_GpuAutotuneStep >= 0)
+            {
+                ImGui::Text("Autotuning on the gpu...");
+            }
+            else if (ImGui::Button("Autotune"))
+            {
+                AutotuneTileSize();
+            }
+            if (m_TileSizeTuned)
+            {
+                for (const auto& timing : m_TileSizeTuner.GetTimings())
+                {
+                    ImGui::Text("%2d px: cull %.2f ms + shade %.2f ms = %.2f ms (cpu)", timing.TileSize, timing.CullMs, timing.ShadeMs,
+                        timing.TotalMs());
+                }
+            }
+            for (const auto& timing : m_GpuTileSizeTimings)
+            {
+                ImGui::Text("%2d px: depth %.2f ms + cull %.2f ms + shade %.2f ms = %.2f ms (gpu)", timing.TileSize, timing.DepthPrePassMs,
+                    timing.CullMs, timing.ShadeMs, timing.TotalMs());
+            }
+
+            if (m_FrameCapture.IsOpen())
+            {
+                if (ImGui::Button("Stop Capture"))
+                {
+                    StopFrameCapture();
+                }
+                ImGui::SameLine();
+                ImGui::Text("%zu frames, %.1f MB", m_FrameCapture.FrameCount(), m_FrameCapture.ByteCount() / (1024.0 * 1024.0));
+            }
+            else
+            {
+                if (ImGui::Button("Record Capture"))
+                {
+                    StartFrameCapture("capture.fpcap");
+                }
+                if (m_FrameCaptureFailed)
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("capture.fpcap could not be written");
+                }
+                else if (m_FrameCapture.FrameCount() > 0)
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("capture.fpcap: %zu frames", m_FrameCapture.FrameCount());
+                }
+            }
+
+            ImGui::Checkbox("Culling Stats", &m_CullingStatsEnabled);
+            if (m_CullingStatsEnabled)
+            {
+                ImGui::Checkbox("Count False Positives", &m_CullingStatsFalsePositives);
+                ImGui::Text("Lights per tile: max %u, mean %.2f, p50 %u, p95 %u", m_CullingStats.MaxLights, m_CullingStats.MeanLights,
+                    m_CullingStats.Percentile(0.5), m_CullingStats.Percentile(0.95));
+                if (m_CullingStatsFalsePositives)
+                {
+                    ImGui::Text("False positives: %zu / %zu (%.2f%%)", m_CullingStats.FalsePositives.FalsePositives,
+                        m_CullingStats.FalsePositives.ListedLights, m_CullingStats.FalsePositives.Rate() * 100.0);
+                }
+                if (!m_CullingStatsHistogram.empty())
+                {
+                    ImGui::PlotHistogram("Tiles per light count", m_CullingStatsHistogram.data(), (int)m_CullingStatsHistogram.size(),
+                        0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+                }
+                if (ImGui::Button("Export Culling Stats"))
+                {
+                    m_CullingStatsExported = ExportCullingStats("culling_stats");
+                }
+                if (m_CullingStatsExported)
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("culling_stats_*.ppm / .csv written");
+                }
+            }
+        }
+
+        int lightCalculationCount = GetLightCalculationCount();
+        if (ImGui::SliderInt("Light Calc Threshold", &lightCalculationCount, 0, (int)m_Scene.Lights.Count()))
+        {
+            // at the maximum keep following the light count when lights are added
+            m_LightCalculationCount = lightCalculationCount == (int)m_Scene.Lights.Count() ? INT_MAX : lightCalculationCount;
+        }
+        ImGui::Text("Light Buffer: %u / %u lights, %u bytes uploaded", (UINT)m_Scene.Lights.Count(), m_LightBufferCapacity, m_LightBufferUploadBytes);
     }
     ImGui::PopID();
 
@@ -841,9 +1089,8 @@ void SimpleObj::RenderImgui(RenderEventArgs& e)
 
     if (ImGui::CollapsingHeader("Light List"))
     {
-        for (int i = 0; i < MAX_LIGHTS; ++i)
+        for (int i = 0; i < (int)m_Scene.Lights.Count(); ++i)
         {
-            auto light = &m_Scene.Lights[i];
             auto lightName = format("Light (%d)", i);
             auto name = lightName.c_str();
 
@@ -852,6 +1099,10 @@ void SimpleObj::RenderImgui(RenderEventArgs& e)
 
             if (ImGui::TreeNode(name))
             {
+                // only the lights shown in the UI are marked dirty for upload
+                auto light = &m_Scene.Lights.Edit(i);
+                auto handle = m_Scene.Lights.GetHandle(i);
+
                 bool enabled = light->Enabled == 1;
                 ImGui::Checkbox("Enabled", &enabled);
                 light->Enabled = enabled ? 1 : 0;
@@ -863,15 +1114,26 @@ void SimpleObj::RenderImgui(RenderEventArgs& e)
                     {
                         m_ShowDirectionWindow = true;
                         m_DirectionWindowNameGetter = [lightName]() { return lightName.c_str(); };
-                        m_DirectionWindowVec3Getter = [i, light]()
+                        // the light pool may move the light, look it up by handle every time
+                        m_DirectionWindowVec3Getter = [this, handle]()
                         {
-                            return vec3(light->DirectionWS.x, light->DirectionWS.y, light->DirectionWS.z);
+                            if (!m_Scene.Lights.Contains(handle))
+                            {
+                                return vec3(0.0f, 0.0f, 0.0f);
+                            }
+                            auto& light = m_Scene.Lights[m_Scene.Lights.GetSlot(handle)];
+                            return vec3(light.DirectionWS.x, light.DirectionWS.y, light.DirectionWS.z);
                         };
-                        m_DirectionWindowVec3Setter = [i, light](vec3 value)
+                        m_DirectionWindowVec3Setter = [this, handle](vec3 value)
                         {
-                            light->DirectionWS.x = value.x;
-                            light->DirectionWS.y = value.y;
-                            light->DirectionWS.z = value.z;
+                            if (!m_Scene.Lights.Contains(handle))
+                            {
+                                return;
+                            }
+                            auto& light = m_Scene.Lights.Edit(m_Scene.Lights.GetSlot(handle));
+                            light.DirectionWS.x = value.x;
+                            light.DirectionWS.y = value.y;
+                            light.DirectionWS.z = value.z;
                         };
                     }
                 }
@@ -985,6 +1247,17 @@ SimpleObj::~SimpleObj()
 
 void SimpleObj::OnUpdate(UpdateEventArgs& e)
 {
+    // Apply a tile size changed last frame: shader permutation, light grid buffers and frustums
+    if (m_TileSize != m_ShaderTileSize)
+    {
+        LoadShaderResources();
+        ResizeSwapChain((int)m_ScreenDimensions.x, (int)m_ScreenDimensions.y);
+    }
+    else if (GetShadingLightListEncoding() != m_ShaderLightListEncoding)
+    {
+        LoadShaderResources();
+    }
+
     // Update camera position
     float speedMultipler = (m_bShift ? 8.0f : 4.0f);
 
@@ -1015,8 +1288,20 @@ void SimpleObj::OnUpdate(UpdateEventArgs& e)
         entity->WorldViewProjectionMatrix = model * viewProjectionMatrix;
     }
 
-    for (auto &light : m_Scene.Lights)
+    // view space positions only change for lights edited since the last frame, unless the camera moved
+    auto& lights = m_Scene.Lights;
+    lights.GetDirtyRanges(m_DirtyLightRanges);
+    if (viewMatrix != m_LightViewMatrix)
     {
+        m_DirtyLightRanges.assign(1, { 0, lights.Count() });
+        m_LightViewMatrix = viewMatrix;
+    }
+
+    m_DerivedLights.resize(lights.Count());
+    for (const auto& range : m_DirtyLightRanges)
+    for (size_t i = range.Begin; i < range.End; ++i)
+    {
+        auto& light = lights.Edit(i);
         auto PositionVS = Vector3(Vector4::Transform(light.PositionWS, viewMatrix));
         light.PositionVS = Vector4(PositionVS.x, PositionVS.y, PositionVS.z, 1.0f);
         
@@ -1024,6 +1309,9 @@ void SimpleObj::OnUpdate(UpdateEventArgs& e)
         directionVS.Normalize();
         light.DirectionVS = Vector4(directionVS.x, directionVS.y, directionVS.z, 1.0f);
 
+        // radius, spot cosines and view space bounds, solved here once instead of per tile and per pixel
+        m_DerivedLights[i] = Cpu::DeriveLight(light);
+
         /*
         if (light.LightType != (int)LightType::Directional) continue;
         if (!light.Enabled) continue;
@@ -1062,6 +1350,85 @@ void SimpleObj::Clear(const FLOAT clearColor[4], FLOAT clearDepth, UINT8 clearSt
     }
 }
 
+/// <summary>
+/// Upload the dirty range of the light pool to the structured light buffer, growing the buffer if needed
+/// </summary>
+void SimpleObj::UpdateLightBuffer()
+{
+    HRESULT hr;
+    auto& lights = m_Scene.Lights;
+
+    if (!m_d3dLightBuffer || lights.Count() > m_LightBufferCapacity)
+    {
+        UINT capacity = (std::max)({ (UINT)lights.Count(), m_LightBufferCapacity * 2, 64u });
+
+        hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(Light), capacity, NULL, m_d3dLightBuffer.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Create Buffer", "Unable to create light buffer");
+
+        hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dLightBuffer.Get(), m_d3dLightBuffer_SRV.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Failed to create SRV", "Unable to create m_d3dLightBuffer_SRV");
+
+        hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(DerivedLight), capacity, NULL, m_d3dDerivedLightBuffer.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Create Buffer", "Unable to create derived light buffer");
+
+        hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dDerivedLightBuffer.Get(), m_d3dDerivedLightBuffer_SRV.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Failed to create SRV", "Unable to create m_d3dDerivedLightBuffer_SRV");
+
+        m_LightBufferCapacity = capacity;
+        lights.MarkAllDirty();
+    }
+
+    lights.GetDirtyRanges(m_DirtyLightRanges);
+    m_LightBufferUploadBytes = 0;
+    for (const auto& range : m_DirtyLightRanges)
+    {
+        D3D11_BOX box = { (UINT)(range.Begin * sizeof(Light)), 0, 0, (UINT)(range.End * sizeof(Light)), 1, 1 };
+        m_d3dDeviceContext->UpdateSubresource(m_d3dLightBuffer.Get(), 0, &box, lights.Data() + range.Begin, 0, 0);
+
+        // OnUpdate() derived the same range
+        D3D11_BOX derivedBox = { (UINT)(range.Begin * sizeof(DerivedLight)), 0, 0, (UINT)(range.End * sizeof(DerivedLight)), 1, 1 };
+        m_d3dDeviceContext->UpdateSubresource(m_d3dDerivedLightBuffer.Get(), 0, &derivedBox, m_DerivedLights.data() + range.Begin, 0, 0);
+        m_LightBufferUploadBytes += (UINT)((range.End - range.Begin) * (sizeof(Light) + sizeof(DerivedLight)));
+    }
+
+    if (lights.IsDirty())
+    {
+        lights.ClearDirty();
+
+        UpdateGlobalLightList();
+    }
+}
+
+void SimpleObj::UpdateGlobalLightList()
+{
+    HRESULT hr;
+
+    Cpu::LightCullInput input;
+    input.Lights = m_Scene.Lights.Data();
+    input.LightCount = m_Scene.Lights.Count();
+    input.UseGlobalLightList = true;
+    Cpu::GatherGlobalLights(input, m_GlobalLightIndexList);
+
+    if (!m_d3dGlobalLightListBuffer || m_GlobalLightIndexList.size() > m_GlobalLightListCapacity)
+    {
+        UINT capacity = (std::max)({ (UINT)m_GlobalLightIndexList.size(), m_GlobalLightListCapacity * 2, 16u });
+
+        hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(uint32_t), capacity, NULL, m_d3dGlobalLightListBuffer.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Create Buffer", "Unable to create global light list buffer");
+
+        hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dGlobalLightListBuffer.Get(), m_d3dGlobalLightListBuffer_SRV.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Failed to create SRV", "Unable to create m_d3dGlobalLightListBuffer_SRV");
+
+        m_GlobalLightListCapacity = capacity;
+    }
+
+    if (!m_GlobalLightIndexList.empty())
+    {
+        D3D11_BOX box = { 0, 0, 0, (UINT)(m_GlobalLightIndexList.size() * sizeof(uint32_t)), 1, 1 };
+        m_d3dDeviceContext->UpdateSubresource(m_d3dGlobalLightListBuffer.Get(), 0, &box, m_GlobalLightIndexList.data(), 0, 0);
+    }
+}
+
 void SimpleObj::OnRender(RenderEventArgs& e)
 {
     m_DrawCallCount = 0;
@@ -1076,11 +1443,17 @@ void SimpleObj::OnRender(RenderEventArgs& e)
     // Setup Light CB
     m_LightPropertiesConstantBuffer.EyePosition = Vector4(m_Camera.get_Translation());
     m_LightPropertiesConstantBuffer.GlobalAmbient = m_Scene.GlobalAmbient;
-    for (int i = 0; i < MAX_LIGHTS; ++i)
-    {
-        m_LightPropertiesConstantBuffer.Lights[i] = m_Scene.Lights[i];
-    }
+    m_LightPropertiesConstantBuffer.LightCount = (uint32_t)m_Scene.Lights.Count();
+
+    // Setup Light Buffer and global light list, stay bound to LIGHT_BUFFER_SLOT / GLOBAL_LIGHT_LIST_SLOT for the whole frame
+    UpdateLightBuffer();
+    m_LightPropertiesConstantBuffer.GlobalLightCount = (uint32_t)m_GlobalLightIndexList.size();
     m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_Light].Get(), 0, nullptr, &m_LightPropertiesConstantBuffer, 0, 0);
+    m_d3dDeviceContext->PSSetShaderResources(LIGHT_BUFFER_SLOT, 1, m_d3dLightBuffer_SRV.GetAddressOf());
+    m_d3dDeviceContext->CSSetShaderResources(LIGHT_BUFFER_SLOT, 1, m_d3dLightBuffer_SRV.GetAddressOf());
+    m_d3dDeviceContext->PSSetShaderResources(DERIVED_LIGHT_BUFFER_SLOT, 1, m_d3dDerivedLightBuffer_SRV.GetAddressOf());
+    m_d3dDeviceContext->CSSetShaderResources(DERIVED_LIGHT_BUFFER_SLOT, 1, m_d3dDerivedLightBuffer_SRV.GetAddressOf());
+    m_d3dDeviceContext->PSSetShaderResources(GLOBAL_LIGHT_LIST_SLOT, 1, m_d3dGlobalLightListBuffer_SRV.GetAddressOf());
 
     // update Debug CB
     m_DebugPropertiesConstantBuffer.DeferredDebugMode = (int)m_DeferredDebugMode;
@@ -1089,7 +1462,7 @@ void SimpleObj::OnRender(RenderEventArgs& e)
 
     // update LightCalculationOptions CB
     m_LightingCalculationOptionsConstrantBuffer.LightingSpace = (int)m_LightingSpace;
-    m_LightingCalculationOptionsConstrantBuffer.LightCount = m_LightCalculationCount;
+    m_LightingCalculationOptionsConstrantBuffer.LightCount = GetLightCalculationCount();
     m_LightingCalculationOptionsConstrantBuffer.LightIndex = 0;
     m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_LightCalculationOptions].Get(), 0, nullptr, &m_LightingCalculationOptionsConstrantBuffer, 0, 0);
 
@@ -1454,48 +1827,56 @@ bool SimpleObj::ResizeSwapChain(int width, int height)
 
         hr = m_d3dDevice->CreateDepthStencilView(m_d3dDepthStencilView_depth_tex.Get(), &depthStencilViewDesc, &m_d3dDepthStencilView_depth);
         AssertIfFailed(hr, "Failed to create DepthStencilView.", "m_d3dDepthStencilView_depth");
+
+        // staging copy read back by the cpu culling, culling stats and frame captures, see ReadDepthBuffer()
+        D3D11_TEXTURE2D_DESC readbackDesc = textureDesc;
+        readbackDesc.Usage = D3D11_USAGE_STAGING;
+        readbackDesc.BindFlags = 0;
+        readbackDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        readbackDesc.MiscFlags = 0;
+
+        hr = m_d3dDevice->CreateTexture2D(&readbackDesc, nullptr, m_d3dDepthStencilView_depth_readback_tex.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Failed to create texture", "m_d3dDepthStencilView_depth_readback_tex");
     }
 
     {
-        int threadGroupCountX = std::ceilf((float)width / (float)BLOCK_SIZE);
-        int threadGroupCountY = std::ceilf((float)height / (float)BLOCK_SIZE);
+        int threadGroupCountX = std::ceilf((float)width / (float)m_TileSize);
+        int threadGroupCountY = std::ceilf((float)height / (float)m_TileSize);
         int threadGroupCountZ = 1;
         int totalGroupCounts = threadGroupCountX * threadGroupCountY * threadGroupCountZ;
 
-        // m_d3dFrustumBuffers
+        // m_d3dFrustumBuffers, one plane per vertical and horizontal tile edge
         {
-            m_frustums.resize(totalGroupCounts);
-            m_opaqueLightIndexCounter.resize(totalGroupCounts);
-            m_opaqueLightIndexList.resize(totalGroupCounts);
+            int frustumPlaneCount = (threadGroupCountX + 1) + (threadGroupCountY + 1);
 
             // TODO: Resize the buffer instead of re-create it
-            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(struct Frustum), totalGroupCounts, NULL, m_d3dFrustumBuffers.GetAddressOf());
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(struct Plane), frustumPlaneCount, NULL, m_d3dFrustumBuffers.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dFrustumBuffers");
 
             // TODO: Resize the buffer instead of re-create it
-            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dFrustumBuffers.Get(), m_d3dFrustumBuffers_UAV.GetAddressOf());
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dFrustumBuffers.Get(), m_d3dFrustumBuffers_UAV.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dFrustumBuffersUAV");
 
-            hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dFrustumBuffers.Get(), m_d3dFrustumBuffers_SRV.GetAddressOf());
+            hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dFrustumBuffers.Get(), m_d3dFrustumBuffers_SRV.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Failed to create SRV", "Unable to create m_d3dFrustumBuffers_SRV");
         }
 
-        // m_d3dOpaqueLightIndexCounterBuffers
+        // m_d3dOpaqueLightIndexCounterBuffers, one LightIndexCounter
         {
-            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(int), totalGroupCounts, NULL, m_d3dOpaqueLightIndexCounterBuffers.GetAddressOf());
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), sizeof(struct LightIndexCounter) / sizeof(UINT), NULL, m_d3dOpaqueLightIndexCounterBuffers.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Create Buffer", "Unable to create m_opaqueLightIndexCounterBuffers");
 
-            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dOpaqueLightIndexCounterBuffers.Get(), m_d3dOpaqueLightIndexCounterBuffers_UAV.GetAddressOf());
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dOpaqueLightIndexCounterBuffers.Get(), m_d3dOpaqueLightIndexCounterBuffers_UAV.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_opaqueLightIndexCounterBuffersUAV");
         }
 
-        // m_d3dOpaqueLightIndexListBuffers
+        // m_d3dOpaqueLightIndexListBuffers / m_d3dTransparentLightIndexListBuffers and their staging lists,
+        // INITIAL_LIGHTS_PER_TILE entries per tile, grown by ReserveLightIndexLists() when the tiles ask for more
         {
-            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(int), totalGroupCounts, NULL, m_d3dOpaqueLightIndexListBuffers.GetAddressOf());
-            AssertIfFailed(hr, "Create Buffer", "Unable to create m_opaqueLightIndexListBuffers");
-
-            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dOpaqueLightIndexListBuffers.Get(), m_d3dOpaqueLightIndexListBuffers_UAV.GetAddressOf());
-            AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_opaqueLightIndexListBuffersUAV");
+            m_OpaqueLightIndexListCapacity = 0;
+            m_TransparentLightIndexListCapacity = 0;
+            m_MaxLightIndexListCapacity = totalGroupCounts * MAX_LIGHTS_PER_TILE;
+            ReserveLightIndexLists(totalGroupCounts * INITIAL_LIGHTS_PER_TILE, totalGroupCounts * INITIAL_LIGHTS_PER_TILE);
         }
 
         // m_d3dOpaqueLightGrid
@@ -1519,23 +1900,144 @@ bool SimpleObj::ResizeSwapChain(int width, int height)
             D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
             uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
 
-            hr = m_d3dDevice->CreateUnorderedAccessView(m_d3dOpaqueLightGridBuffers.Get(), &uavDesc, m_d3dOpaqueLightGrid_UAV.GetAddressOf());
+            hr = m_d3dDevice->CreateUnorderedAccessView(m_d3dOpaqueLightGridBuffers.Get(), &uavDesc, m_d3dOpaqueLightGrid_UAV.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Failed to create UAV", "m_d3dOpaqueLightGrid_UAV");
+
+            // read by the Forward+ shading pass at LIGHT_GRID_SLOT
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.Format = DXGI_FORMAT_R32G32_UINT;
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MipLevels = 1;
+
+            hr = m_d3dDevice->CreateShaderResourceView(m_d3dOpaqueLightGridBuffers.Get(), &srvDesc, m_d3dOpaqueLightGrid_SRV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create SRV", "m_d3dOpaqueLightGrid_SRV");
+
+            // staging copy read back by the culling stats, see ReadLightLists()
+            textureDesc.Usage = D3D11_USAGE_STAGING;
+            textureDesc.BindFlags = 0;
+            textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+            hr = m_d3dDevice->CreateTexture2D(&textureDesc, nullptr, m_d3dOpaqueLightGridReadback_tex.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create texture", "m_d3dOpaqueLightGridReadback_tex");
         }
 
-        // m_debugRWList
+        // m_d3dTransparentLightIndexCounterBuffers, one LightIndexCounter
         {
-            m_debugRWList.resize(totalGroupCounts);
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), sizeof(struct LightIndexCounter) / sizeof(UINT), NULL, m_d3dTransparentLightIndexCounterBuffers.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dTransparentLightIndexCounterBuffers");
+
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dTransparentLightIndexCounterBuffers.Get(), m_d3dTransparentLightIndexCounterBuffers_UAV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dTransparentLightIndexCounterBuffers_UAV");
+        }
 
-            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(float), totalGroupCounts, NULL, m_d3dDebugRWListBuffers.GetAddressOf());
+        // m_d3dTransparentLightGrid
+        {
+            D3D11_TEXTURE2D_DESC textureDesc;
+            ZeroMemory(&textureDesc, sizeof(textureDesc));
+            textureDesc.Width = threadGroupCountX;
+            textureDesc.Height = threadGroupCountY;
+            textureDesc.MipLevels = 1;
+            textureDesc.ArraySize = 1;
+            textureDesc.Format = DXGI_FORMAT_R32G32_UINT; // uint2
+            textureDesc.SampleDesc.Count = 1;
+            textureDesc.Usage = D3D11_USAGE_DEFAULT;
+            textureDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+            textureDesc.CPUAccessFlags = 0;
+            textureDesc.MiscFlags = 0;
+            
+            hr = m_d3dDevice->CreateTexture2D(&textureDesc, nullptr, &m_d3dTransparentLightGridBuffers);
+            AssertIfFailed(hr, "Failed to create texture", "m_d3dTransparentLightGridBuffers");
+
+            D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+            uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+
+            hr = m_d3dDevice->CreateUnorderedAccessView(m_d3dTransparentLightGridBuffers.Get(), &uavDesc, m_d3dTransparentLightGrid_UAV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create UAV", "m_d3dTransparentLightGrid_UAV");
+        }
+
+        // m_d3dDebugRWListBuffers
+        {
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(float), totalGroupCounts, NULL, m_d3dDebugRWListBuffers.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dDebugRWListBuffers");
 
-            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dDebugRWListBuffers.Get(), m_d3dDebugRWListBuffers_UAV.GetAddressOf());
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dDebugRWListBuffers.Get(), m_d3dDebugRWListBuffers_UAV.ReleaseAndGetAddressOf());
             AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dDebugRWListBuffers_UAV");
         }
 
+        // m_d3dSuperTileLightCountBuffers / m_d3dSuperTileLightIndexListBuffers, MAX_LIGHTS_PER_SUPER_TILE slots per super-tile
+        {
+            int superTileCount = (int)(std::ceilf((float)width / SUPER_TILE_SIZE) * std::ceilf((float)height / SUPER_TILE_SIZE));
+
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), superTileCount, NULL, m_d3dSuperTileLightCountBuffers.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dSuperTileLightCountBuffers");
+
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dSuperTileLightCountBuffers.Get(), m_d3dSuperTileLightCountBuffers_UAV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dSuperTileLightCountBuffers_UAV");
+
+            hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dSuperTileLightCountBuffers.Get(), m_d3dSuperTileLightCountBuffers_SRV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create SRV", "Unable to create m_d3dSuperTileLightCountBuffers_SRV");
+
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), superTileCount * MAX_LIGHTS_PER_SUPER_TILE, NULL, m_d3dSuperTileLightIndexListBuffers.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dSuperTileLightIndexListBuffers");
+
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dSuperTileLightIndexListBuffers.Get(), m_d3dSuperTileLightIndexListBuffers_UAV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dSuperTileLightIndexListBuffers_UAV");
+
+            hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), m_d3dSuperTileLightIndexListBuffers.Get(), m_d3dSuperTileLightIndexListBuffers_SRV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create SRV", "Unable to create m_d3dSuperTileLightIndexListBuffers_SRV");
+        }
+
+        // m_d3dOpaqueLightOffsetBuffers / m_d3dTransparentLightOffsetBuffers, one offset per tile
+        {
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), totalGroupCounts, NULL, m_d3dOpaqueLightOffsetBuffers.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dOpaqueLightOffsetBuffers");
+
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dOpaqueLightOffsetBuffers.Get(), m_d3dOpaqueLightOffsetBuffers_UAV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dOpaqueLightOffsetBuffers_UAV");
+
+            hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), totalGroupCounts, NULL, m_d3dTransparentLightOffsetBuffers.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dTransparentLightOffsetBuffers");
+
+            hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), m_d3dTransparentLightOffsetBuffers.Get(), m_d3dTransparentLightOffsetBuffers_UAV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Create Buffer UAV", "Unable to create m_d3dTransparentLightOffsetBuffers_UAV");
+        }
+
+        // m_d3dDepthPyramid_tex, mip 0 is padded to whole DEPTH_PYRAMID_TILE_SIZE blocks
+        // so every mip has exactly one texel per 2^k x 2^k pixels
+        {
+            D3D11_TEXTURE2D_DESC textureDesc;
+            ZeroMemory(&textureDesc, sizeof(textureDesc));
+            textureDesc.Width = (UINT)std::ceilf((float)width / DEPTH_PYRAMID_TILE_SIZE) * (DEPTH_PYRAMID_TILE_SIZE / 2);
+            textureDesc.Height = (UINT)std::ceilf((float)height / DEPTH_PYRAMID_TILE_SIZE) * (DEPTH_PYRAMID_TILE_SIZE / 2);
+            textureDesc.MipLevels = DEPTH_PYRAMID_LEVEL_COUNT;
+            textureDesc.ArraySize = 1;
+            textureDesc.Format = DXGI_FORMAT_R32G32_FLOAT; // min, max
+            textureDesc.SampleDesc.Count = 1;
+            textureDesc.Usage = D3D11_USAGE_DEFAULT;
+            textureDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+            textureDesc.CPUAccessFlags = 0;
+            textureDesc.MiscFlags = 0;
+
+            hr = m_d3dDevice->CreateTexture2D(&textureDesc, nullptr, m_d3dDepthPyramid_tex.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create texture", "m_d3dDepthPyramid_tex");
+
+            hr = m_d3dDevice->CreateShaderResourceView(m_d3dDepthPyramid_tex.Get(), nullptr, m_d3dDepthPyramid_SRV.ReleaseAndGetAddressOf());
+            AssertIfFailed(hr, "Failed to create SRV", "m_d3dDepthPyramid_SRV");
+
+            for (int mip = 0; mip < DEPTH_PYRAMID_LEVEL_COUNT; ++mip)
+            {
+                D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+                uavDesc.Format = textureDesc.Format;
+                uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+                uavDesc.Texture2D.MipSlice = mip;
+
+                hr = m_d3dDevice->CreateUnorderedAccessView(m_d3dDepthPyramid_tex.Get(), &uavDesc, m_d3dDepthPyramid_UAV[mip].ReleaseAndGetAddressOf());
+                AssertIfFailed(hr, "Failed to create UAV", "m_d3dDepthPyramid_UAV");
+            }
+        }
+
         // Prepare frustum for forward plus
-        ComputeFrustum(width, height, BLOCK_SIZE);
+        ComputeFrustum(width, height, m_TileSize);
     }
     
     return true;
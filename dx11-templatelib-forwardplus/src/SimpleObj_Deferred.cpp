@@ -278,7 +278,7 @@ void SimpleObj::RenderScene_Deferred_LightingPass_Loop()
     m_d3dDeviceContext->PSSetShaderResources(0, _countof(pSRV), pSRV);
 }
 
-void SimpleObj::DrawLightVolume(Light* light)
+void SimpleObj::DrawLightVolume(const Light* light)
 {
     auto ToVector3 = [](Vector4 vec4, bool isNormalized=false)
     {
@@ -449,7 +449,7 @@ void SimpleObj::RenderScene_Deferred_LightingPass_Stencil()
     m_d3dDeviceContext->CopyResource(backBuffer.Get(), m_d3dDepthStencilView_depth_tex.Get());
     backBuffer.Reset();
     
-    for (int i = 0; i < m_LightCalculationCount; ++i)
+    for (int i = 0, lightCount = GetLightCalculationCount(); i < lightCount; ++i)
     {
         auto light = &m_Scene.Lights[i];
         
@@ -642,7 +642,7 @@ void SimpleObj::RenderScene_Deferred_LightingPass_Single()
     m_d3dDeviceContext->OMSetDepthStencilState(m_d3dDepthStencilState_DisableDepthTest.Get(), 1);
     m_d3dDeviceContext->OMSetBlendState(m_d3dBlendState_Add.Get(), nullptr, 0xffffffff);
 
-    for (int i = 0; i < m_LightCalculationCount; ++i)
+    for (int i = 0, lightCount = GetLightCalculationCount(); i < lightCount; ++i)
     {
         if (!m_Scene.Lights[i].Enabled)
         {
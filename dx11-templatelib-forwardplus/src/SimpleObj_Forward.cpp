@@ -222,7 +222,7 @@ void SimpleObj::RenderScene_Forward(RenderEventArgs& e)
                     &offset                                 // pointer to offset values
                 );
 
-                for (int i = -1; i < m_LightCalculationCount; ++i)
+                for (int i = -1, lightCount = GetLightCalculationCount(); i < lightCount; ++i)
                 {
                     if (i > 0 && !m_Scene.Lights[i].Enabled)
                     {
@@ -299,7 +299,7 @@ void SimpleObj::RenderScene_Forward(RenderEventArgs& e)
                 m_d3dDeviceContext->IASetVertexBuffers(0, _countof(buffers), buffers, vertexStride, offset);
 
                 bool hasDrawAnyModel = false;
-                for (int i = -1; i < m_LightCalculationCount; ++i)
+                for (int i = -1, lightCount = GetLightCalculationCount(); i < lightCount; ++i)
                 {
                     if (i > 0 && !m_Scene.Lights[i].Enabled)
                     {
@@ -1,8 +1,22 @@
 #include "SimpleObj.h"
 
+#include <algorithm>
+
+#include "Cpu/CullingReport.h"
+#include "Cpu/FrustumGrid.h"
+
 using namespace Microsoft::WRL;
 using namespace Yr;
 
+namespace
+{
+    double Median(std::vector<double>& values)
+    {
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        return values[values.size() / 2];
+    }
+}
+
 HRESULT SimpleObj::CreateStructuredBufferSRV(ID3D11Device* pDevice, ID3D11Buffer* pBuffer, ID3D11ShaderResourceView** ppSRVOut)
 {
     D3D11_BUFFER_DESC descBuf = {};
@@ -88,18 +102,26 @@ HRESULT SimpleObj::CreateStructuredBuffer (ID3D11Device* pDevice, UINT uElementS
 
 void SimpleObj::ComputeFrustum(int width, int height, int blockSize)
 {
-    int threadGroupCountX = std::ceilf((float)width / (float)blockSize);
-    int threadGroupCountY = std::ceilf((float)height / (float)blockSize);
+    // one thread per vertical and horizontal tile edge
+    int tileCountX = std::ceilf((float)width / (float)blockSize);
+    int tileCountY = std::ceilf((float)height / (float)blockSize);
+    int frustumPlaneCount = (tileCountX + 1) + (tileCountY + 1);
+
+    int threadGroupCountX = std::ceilf((float)frustumPlaneCount / (float)FRUSTUM_PLANE_GROUP_SIZE);
+    int threadGroupCountY = 1;
     int threadGroupCountZ = 1;
-    int totalGroupCounts = threadGroupCountX * threadGroupCountY * threadGroupCountZ;
     
     m_ScreenToViewParamsConstantBuffer.InverseView = m_Camera.get_InverseViewMatrix();
     m_ScreenToViewParamsConstantBuffer.InverseProjection = m_Camera.get_InverseProjectionMatrix();
     m_ScreenToViewParamsConstantBuffer.ScreenDimensions = Vector2(width, height);
     m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_ScreenToViewParams].Get(), 0, nullptr, &m_ScreenToViewParamsConstantBuffer, 0, 0);
 
-    m_DispatchParamsConstantBuffer.numThreads[0] = width;
-    m_DispatchParamsConstantBuffer.numThreads[1] = height;
+    // same planes on the cpu, used by the cpu light culling
+    auto inverseProjection = Cpu::Float4x4::FromRowMajor(&m_ScreenToViewParamsConstantBuffer.InverseProjection._11);
+    Cpu::ComputeFrustumPlanes(inverseProjection, width, height, blockSize, m_FrustumPlanes);
+
+    m_DispatchParamsConstantBuffer.numThreads[0] = tileCountX;
+    m_DispatchParamsConstantBuffer.numThreads[1] = tileCountY;
     m_DispatchParamsConstantBuffer.numThreads[2] = 1;
     m_DispatchParamsConstantBuffer.numThreadGroups[0] = threadGroupCountX;
     m_DispatchParamsConstantBuffer.numThreadGroups[1] = threadGroupCountY;
@@ -135,7 +157,7 @@ void SimpleObj::ComputeFrustum(int width, int height, int blockSize)
 
         D3D11_MAPPED_SUBRESOURCE MappedResource;
         m_d3dDeviceContext->Map(tempBuffer, 0, D3D11_MAP_READ, 0, &MappedResource);
-        std::copy_n((struct Frustum*)MappedResource.pData, m_frustums.size(), m_frustums.data());
+        std::copy_n((struct Plane*)MappedResource.pData, m_FrustumPlanes.Planes.size(), m_FrustumPlanes.Planes.data());
 
         // Clean up
         m_d3dDeviceContext->Unmap(tempBuffer, 0);
@@ -144,11 +166,198 @@ void SimpleObj::ComputeFrustum(int width, int height, int blockSize)
 #endif
 }
 
+void SimpleObj::SetTileSize(int tileSize)
+{
+    // the shaders, grid buffers and frustums follow at the start of the next update
+    if (Cpu::IsSupportedTileSize(tileSize))
+    {
+        m_TileSize = tileSize;
+    }
+}
+
+void SimpleObj::AutotuneTileSize()
+{
+    if (!m_CullLightOnCpu)
+    {
+        // the passes run on the gpu, time them over the next frames with every tile size, see UpdateGpuAutotune()
+        m_TileSizeTuned = false;
+        m_GpuAutotuneSamples.clear();
+        m_GpuTileSizeTimings.clear();
+        m_GpuAutotuneStep = 0;
+        m_GpuAutotuneFrame = 0;
+        SetTileSize(Cpu::SupportedTileSizes[0]);
+        return;
+    }
+
+    // time culling + shading of the last frame on the cpu for every tile size
+    m_GpuTileSizeTimings.clear();
+    ReadDepthBuffer(m_CpuDepthBuffer);
+
+    Cpu::LightCullInput input;
+    input.Depth = m_CpuDepthBuffer.data();
+    input.Width = (int)m_ScreenDimensions.x;
+    input.Height = (int)m_ScreenDimensions.y;
+    input.InverseProjection = Cpu::Float4x4::FromRowMajor(&m_ScreenToViewParamsConstantBuffer.InverseProjection._11);
+    input.Lights = m_Scene.Lights.Data();
+    input.LightCount = m_Scene.Lights.Count();
+    input.DerivedLights = m_DerivedLights.data(); // derived in OnUpdate(), as the culling shaders read them
+    input.UseDepthMask = true; // USE_DEPTH_MASK in CullLight.hlsl
+    input.UseGlobalLightList = true; // USE_GLOBAL_LIGHT_LIST in Culling.hlsli
+
+    SetTileSize(m_TileSizeTuner.Tune(input));
+    m_TileSizeTuned = true;
+}
+
+GpuPassQueries* SimpleObj::BeginGpuPassQueries()
+{
+    // only while autotuning, and not the first frame of a tile size, which may still pay for its new shaders and buffers
+    if (m_GpuAutotuneStep < 0 || m_GpuAutotuneStep >= Cpu::SupportedTileSizeCount || m_GpuAutotuneFrame == 0)
+    {
+        return nullptr;
+    }
+
+    // if the gpu is still behind, skip this frame instead of waiting
+    GpuPassQueries& queries = m_GpuPassQueries[m_GpuPassQueryFrame % GPU_TIMESTAMP_LATENCY];
+    if (queries.Pending)
+    {
+        return nullptr;
+    }
+
+    if (!queries.Disjoint)
+    {
+        D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+        HRESULT hr = m_d3dDevice->CreateQuery(&desc, queries.Disjoint.GetAddressOf());
+        AssertIfFailed(hr, "Create Query", "Unable to create the timestamp disjoint query");
+
+        desc.Query = D3D11_QUERY_TIMESTAMP;
+        for (auto& timestamp : queries.Timestamps)
+        {
+            hr = m_d3dDevice->CreateQuery(&desc, timestamp.GetAddressOf());
+            AssertIfFailed(hr, "Create Query", "Unable to create the timestamp query");
+        }
+    }
+
+    ++m_GpuPassQueryFrame;
+    queries.TileSize = m_TileSize;
+    queries.Pending = true;
+    m_d3dDeviceContext->Begin(queries.Disjoint.Get());
+    m_d3dDeviceContext->End(queries.Timestamps[GpuTimestamp_Begin].Get());
+    return &queries;
+}
+
+void SimpleObj::EndGpuPassQuery(GpuPassQueries* queries, GpuTimestamp timestamp)
+{
+    if (queries)
+    {
+        m_d3dDeviceContext->End(queries->Timestamps[timestamp].Get());
+    }
+}
+
+void SimpleObj::UpdateGpuAutotune()
+{
+    // read back the queries the gpu has finished
+    for (auto& queries : m_GpuPassQueries)
+    {
+        if (!queries.Pending)
+        {
+            continue;
+        }
+
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+        if (m_d3dDeviceContext->GetData(queries.Disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+        {
+            continue;
+        }
+
+        UINT64 timestamps[NumGpuTimestamps];
+        bool ready = true;
+        for (int i = 0; i < NumGpuTimestamps; ++i)
+        {
+            ready = ready && m_d3dDeviceContext->GetData(queries.Timestamps[i].Get(), &timestamps[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+        }
+        if (!ready)
+        {
+            continue;
+        }
+        queries.Pending = false;
+
+        // the timestamps are meaningless if the gpu clock changed in between
+        if (!disjoint.Disjoint)
+        {
+            double msPerTick = 1000.0 / disjoint.Frequency;
+            GpuTileSizeTiming sample;
+            sample.TileSize = queries.TileSize;
+            sample.DepthPrePassMs = (timestamps[GpuTimestamp_DepthPrePass] - timestamps[GpuTimestamp_Begin]) * msPerTick;
+            sample.CullMs = (timestamps[GpuTimestamp_CullLight] - timestamps[GpuTimestamp_DepthPrePass]) * msPerTick;
+            sample.ShadeMs = (timestamps[GpuTimestamp_Shading] - timestamps[GpuTimestamp_CullLight]) * msPerTick;
+            m_GpuAutotuneSamples.push_back(sample);
+        }
+    }
+
+    // next tile size after GPU_AUTOTUNE_FRAME_COUNT frames
+    if (m_GpuAutotuneStep < Cpu::SupportedTileSizeCount && ++m_GpuAutotuneFrame >= GPU_AUTOTUNE_FRAME_COUNT)
+    {
+        m_GpuAutotuneFrame = 0;
+        if (++m_GpuAutotuneStep < Cpu::SupportedTileSizeCount)
+        {
+            SetTileSize(Cpu::SupportedTileSizes[m_GpuAutotuneStep]);
+        }
+    }
+
+    if (m_GpuAutotuneStep < Cpu::SupportedTileSizeCount)
+    {
+        return;
+    }
+    for (const auto& queries : m_GpuPassQueries)
+    {
+        if (queries.Pending)
+        {
+            return;
+        }
+    }
+
+    // every frame is read back, keep the tile size with the lowest median of the passes
+    int bestTileSize = m_TileSize;
+    double bestMs = 0.0;
+    for (int tileSize : Cpu::SupportedTileSizes)
+    {
+        std::vector<double> depthPrePassMs, cullMs, shadeMs;
+        for (const auto& sample : m_GpuAutotuneSamples)
+        {
+            if (sample.TileSize == tileSize)
+            {
+                depthPrePassMs.push_back(sample.DepthPrePassMs);
+                cullMs.push_back(sample.CullMs);
+                shadeMs.push_back(sample.ShadeMs);
+            }
+        }
+        if (cullMs.empty())
+        {
+            continue;
+        }
+
+        GpuTileSizeTiming timing;
+        timing.TileSize = tileSize;
+        timing.DepthPrePassMs = Median(depthPrePassMs);
+        timing.CullMs = Median(cullMs);
+        timing.ShadeMs = Median(shadeMs);
+        if (m_GpuTileSizeTimings.empty() || timing.TotalMs() < bestMs)
+        {
+            bestTileSize = tileSize;
+            bestMs = timing.TotalMs();
+        }
+        m_GpuTileSizeTimings.push_back(timing);
+    }
+
+    SetTileSize(bestTileSize);
+    m_GpuAutotuneStep = -1;
+}
+
 void SimpleObj::RenderScene_FowardPlus(RenderEventArgs& e)
 {
     // update subResource first
-    int threadGroupCountX = std::ceilf((float)m_ScreenDimensions.x / (float)BLOCK_SIZE);
-    int threadGroupCountY = std::ceilf((float)m_ScreenDimensions.y / (float)BLOCK_SIZE);
+    int threadGroupCountX = std::ceilf((float)m_ScreenDimensions.x / (float)m_TileSize);
+    int threadGroupCountY = std::ceilf((float)m_ScreenDimensions.y / (float)m_TileSize);
     int threadGroupCountZ = 1;
     int totalGroupCounts = threadGroupCountX * threadGroupCountY * threadGroupCountZ;
 
@@ -163,16 +372,644 @@ void SimpleObj::RenderScene_FowardPlus(RenderEventArgs& e)
     m_DispatchParamsConstantBuffer.numThreadGroups[0] = threadGroupCountX;
     m_DispatchParamsConstantBuffer.numThreadGroups[1] = threadGroupCountY;
     m_DispatchParamsConstantBuffer.numThreadGroups[2] = threadGroupCountZ;
+    m_DispatchParamsConstantBuffer.useDepthPyramid = m_UseDepthPyramid;
+    m_DispatchParamsConstantBuffer.deterministicLightLists = m_DeterministicLightLists;
+    m_DispatchParamsConstantBuffer.lightIndexListCapacity[0] = m_OpaqueLightIndexListCapacity;
+    m_DispatchParamsConstantBuffer.lightIndexListCapacity[1] = m_TransparentLightIndexListCapacity;
+    m_DispatchParamsConstantBuffer.maxLightsPerTile = m_MaxLightsPerTile;
     m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_DispatchParams].Get(), 0, nullptr, &m_DispatchParamsConstantBuffer, 0, 0);
 
-    RenderScene_FowardPlus_CullLightPass(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+    // timestamps around the passes while autotuning the tile size on the gpu, null otherwise
+    GpuPassQueries* queries = BeginGpuPassQueries();
+
+    RenderScene_FowardPlus_DepthPrePass();
+    EndGpuPassQuery(queries, GpuTimestamp_DepthPrePass);
+
+    if (m_CullLightOnCpu)
+    {
+        RenderScene_FowardPlus_CullLightPass_Cpu(threadGroupCountX, threadGroupCountY);
+    }
+    else
+    {
+        RenderScene_FowardPlus_CullLightPass(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+    }
+    EndGpuPassQuery(queries, GpuTimestamp_CullLight);
+
+    // shade before reading the counters back, growing the light index lists drops their content
+    RenderScene_FowardPlus_ShadingPass();
+    EndGpuPassQuery(queries, GpuTimestamp_Shading);
+    if (queries)
+    {
+        m_d3dDeviceContext->End(queries->Disjoint.Get());
+    }
+
+    if (m_GpuAutotuneStep >= 0)
+    {
+        UpdateGpuAutotune();
+    }
+
+    RenderScene_FowardPlus_ReadLightIndexCounters();
+
+    if (m_CullingStatsEnabled)
+    {
+        RenderScene_FowardPlus_CullingStats(threadGroupCountX, threadGroupCountY);
+    }
+
+    if (m_FrameCapture.IsOpen())
+    {
+        RenderScene_FowardPlus_CaptureFrame();
+    }
+}
+
+void SimpleObj::RenderScene_FowardPlus_DepthPrePass()
+{
+    // depth only into m_d3dDepthStencilView_depth, read by the culling pass and tested by the shading pass
+    m_d3dDeviceContext->OMSetRenderTargets(0, nullptr, m_d3dDepthStencilView_depth.Get());
+    m_d3dDeviceContext->OMSetDepthStencilState(m_d3dDepthStencilState.Get(), 1);
+    m_d3dDeviceContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+
+    RenderScene_FowardPlus_DrawEntities(nullptr, nullptr);
+
+    // clean up, the depth is bound as an SRV next
+    m_d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
+}
+
+void SimpleObj::RenderScene_FowardPlus_ShadingPass()
+{
+    ComPtr<ID3D11SamplerState> samplerStates[] = { m_d3dSamplerState };
+    m_d3dDeviceContext->PSSetSamplers(0, 1, samplerStates->GetAddressOf());
+
+    ComPtr<ID3D11ShaderResourceView> textures[] = { m_GridTexture };
+    m_d3dDeviceContext->PSSetShaderResources(0, 1, textures->GetAddressOf());
+
+    // opaque light lists of the culling pass, the light buffer and the global light list stay bound from OnRender()
+    m_d3dDeviceContext->PSSetShaderResources(LIGHT_GRID_SLOT, 1, m_d3dOpaqueLightGrid_SRV.GetAddressOf());
+    m_d3dDeviceContext->PSSetShaderResources(LIGHT_INDEX_LIST_SLOT, 1, m_d3dOpaqueLightIndexListBuffers_SRV.GetAddressOf());
+
+    // test against the depth of the pre-pass without writing it, every visible pixel is shaded once
+    m_d3dDeviceContext->OMSetRenderTargets(1, m_d3dRenderTargetView.GetAddressOf(), m_d3dDepthStencilView_depth.Get());
+    m_d3dDeviceContext->OMSetDepthStencilState(m_d3dDepthStencilState_Overlay.Get(), 1);
+    m_d3dDeviceContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+
+    RenderScene_FowardPlus_DrawEntities(m_d3dForwardPlus_Lighting_PixelShader.Get(), m_d3dForwardPlus_Lighting_InstancedPixelShader.Get());
+
+    // clean up, the culling pass of the next frame writes the lists and reads the depth
+    ID3D11ShaderResourceView* nullSRVs[1] = {};
+    m_d3dDeviceContext->PSSetShaderResources(LIGHT_GRID_SLOT, 1, nullSRVs);
+    m_d3dDeviceContext->PSSetShaderResources(LIGHT_INDEX_LIST_SLOT, 1, nullSRVs);
+    m_d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
+}
+
+void SimpleObj::RenderScene_FowardPlus_DrawEntities(ID3D11PixelShader* pixelShader, ID3D11PixelShader* instancedPixelShader)
+{
+    // Draw Regular Entities, no pixel shader for the depth pre-pass
+    {
+        m_d3dDeviceContext->IASetInputLayout(m_d3dRegularInputLayout.Get());
+        m_d3dDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        m_d3dDeviceContext->VSSetShader(m_d3dRegularVertexShader.Get(), nullptr, 0);
+
+        ID3D11Buffer* vertexShaderConstantBuffers[] =
+        {
+            m_d3dConstantBuffers[CB_Frame].Get(),
+            m_d3dConstantBuffers[CB_Object].Get()
+        };
+        m_d3dDeviceContext->VSSetConstantBuffers(0, _countof(vertexShaderConstantBuffers), vertexShaderConstantBuffers);
+
+        m_d3dDeviceContext->PSSetShader(pixelShader, nullptr, 0);
+        ID3D11Buffer* pixelShaderConstantBuffers[] =
+        {
+            m_d3dConstantBuffers[CB_Material].Get(),
+            m_d3dConstantBuffers[CB_Light].Get(),
+            m_d3dConstantBuffers[CB_LightCalculationOptions].Get(),
+        };
+        m_d3dDeviceContext->PSSetConstantBuffers(0, _countof(pixelShaderConstantBuffers), pixelShaderConstantBuffers);
+
+        UINT vertexStride = sizeof(VertexData);
+        UINT offset = 0;
+        for (auto entity : m_Scene.Entities)
+        {
+            if (entity->Instanced)
+                continue;
+
+            // Setup Material CB
+            if (pixelShader)
+            {
+                m_MaterialPropertiesConstantBuffer.Material = entity->Material;
+                m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_Material].Get(), 0, nullptr, &m_MaterialPropertiesConstantBuffer, 0, 0);
+            }
+
+            // Setup Object CB
+            m_ObjectConstantBuffer.WorldMatrix = entity->WorldMatrix;
+            m_ObjectConstantBuffer.InverseTransposeWorldMatrix = entity->InverseTransposeWorldMatrix;
+            m_ObjectConstantBuffer.InverseTransposeWorldViewMatrix = entity->InverseTransposeWorldViewMatrix;
+            m_ObjectConstantBuffer.WorldViewProjectionMatrix = entity->WorldViewProjectionMatrix;
+            m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_Object].Get(), 0, nullptr, &m_ObjectConstantBuffer, 0, 0);
+
+            auto vertexBuffer = entity->Model->VertexBuffer();
+            m_d3dDeviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &offset);
+            Draw(entity->Model->VertexCount(), 0);
+        }
+    }
+
+    // Draw Instanced Entities
+    {
+        m_d3dDeviceContext->IASetInputLayout(m_d3dInstancedInputLayout.Get());
+        m_d3dDeviceContext->VSSetShader(m_d3dInstancedVertexShader.Get(), nullptr, 0);
+
+        ID3D11Buffer* vertexShaderConstantBuffers[] =
+        {
+            m_d3dConstantBuffers[CB_Frame].Get()
+        };
+        m_d3dDeviceContext->VSSetConstantBuffers(0, _countof(vertexShaderConstantBuffers), vertexShaderConstantBuffers);
+
+        m_d3dDeviceContext->PSSetShader(instancedPixelShader, nullptr, 0);
+        ID3D11Buffer* pixelShaderConstantBuffers[] =
+        {
+            m_d3dConstantBuffers[CB_Light].Get(),
+            m_d3dConstantBuffers[CB_LightCalculationOptions].Get(),
+        };
+        m_d3dDeviceContext->PSSetConstantBuffers(0, _countof(pixelShaderConstantBuffers), pixelShaderConstantBuffers);
+
+        const UINT vertexStride[2] = { sizeof(VertexData), sizeof(InstancedObjectConstantBuffer) };
+        const UINT offset[2] = { 0, 0 };
+        std::vector<InstancedObjectConstantBuffer> instanceData;
+        for (auto const& pair : m_Scene.InstancedEntity)
+        {
+            auto key = pair.first;
+
+            instanceData.clear();
+            for (auto const& instancedEntity : pair.second)
+            {
+                instanceData.push_back({
+                    instancedEntity->WorldMatrix,
+                    instancedEntity->InverseTransposeWorldMatrix,
+                    instancedEntity->InverseTransposeWorldViewMatrix,
+                    instancedEntity->Material
+                    });
+            }
+
+            // update perInstanceBuffer
+            m_d3dDeviceContext->UpdateSubresource(Model::GetInstancedVertexBuffer(key), 0, nullptr, instanceData.data(), 0, 0);
+
+            ID3D11Buffer* buffers[] = { Model::GetVertexBuffer(key), Model::GetInstancedVertexBuffer(key) };
+            m_d3dDeviceContext->IASetVertexBuffers(0, _countof(buffers), buffers, vertexStride, offset);
+
+            DrawInstanced(Model::GetVertexCount(key), (UINT)pair.second.size(), 0, 0);
+        }
+    }
+}
+
+Cpu::LightListEncoding SimpleObj::GetShadingLightListEncoding() const
+{
+    // only the cpu culling encodes its lists, Uint16 cannot index more than 65536 lights
+    bool encoded = m_CullLightOnCpu && Cpu::CanEncodeLightCount(m_LightListEncoding, m_Scene.Lights.Count());
+    return encoded ? m_LightListEncoding : Cpu::LightListEncoding::Uint32;
+}
+
+void SimpleObj::ReadDepthBuffer(std::vector<float>& depth)
+{
+    // the staging texture is created with the depth buffer in ResizeSwapChain()
+    ID3D11Texture2D* cpuReadTexture = m_d3dDepthStencilView_depth_readback_tex.Get();
+    D3D11_TEXTURE2D_DESC desc = {};
+    cpuReadTexture->GetDesc(&desc);
+
+    m_d3dDeviceContext->CopyResource(cpuReadTexture, m_d3dDepthStencilView_depth_tex.Get());
+
+    D3D11_MAPPED_SUBRESOURCE MappedResource;
+    m_d3dDeviceContext->Map(cpuReadTexture.Get(), 0, D3D11_MAP_READ, 0, &MappedResource);
+
+    // DXGI_FORMAT_R24G8_TYPELESS: depth is the lower 24 bits as unorm, stencil the upper 8 bits
+    depth.resize(desc.Width * desc.Height);
+    for (UINT y = 0; y < desc.Height; ++y)
+    {
+        auto row = (const UINT*)((const BYTE*)MappedResource.pData + y * MappedResource.RowPitch);
+        for (UINT x = 0; x < desc.Width; ++x)
+        {
+            depth[x + y * desc.Width] = (row[x] & 0x00ffffff) / 16777215.0f;
+        }
+    }
+
+    m_d3dDeviceContext->Unmap(cpuReadTexture, 0);
+}
+
+void SimpleObj::RenderScene_FowardPlus_CullLightPass_Cpu(int threadGroupCountX, int threadGroupCountY)
+{
+    ReadDepthBuffer(m_CpuDepthBuffer);
+
+    Cpu::LightCullInput input;
+    input.Depth = m_CpuDepthBuffer.data();
+    input.Width = (int)m_ScreenDimensions.x;
+    input.Height = (int)m_ScreenDimensions.y;
+    input.BlockSize = m_TileSize;
+    input.InverseProjection = Cpu::Float4x4::FromRowMajor(&m_ScreenToViewParamsConstantBuffer.InverseProjection._11);
+    input.FrustumPlanes = &m_FrustumPlanes;
+    input.Lights = m_Scene.Lights.Data();
+    input.LightCount = m_Scene.Lights.Count();
+    input.DerivedLights = m_DerivedLights.data(); // derived in OnUpdate(), as the culling shaders read them
+    input.UseDepthMask = true; // USE_DEPTH_MASK in CullLight.hlsl
+    input.UseGlobalLightList = true; // USE_GLOBAL_LIGHT_LIST in Culling.hlsli
+    input.SuperTileSize = m_CullLightHierarchical ? SUPER_TILE_SIZE : 0;
+    input.MaxLightsPerTile = m_MaxLightsPerTile;
+
+    if (m_UseDepthPyramid)
+    {
+        m_CpuDepthPyramid.Build(input.Depth, input.Width, input.Height, Cpu::GetBestCullKernel(), DEPTH_PYRAMID_LEVEL_COUNT);
+        input.Pyramid = &m_CpuDepthPyramid;
+    }
+
+    input.BuildTransparentLists = true;
+
+    m_CpuLightCuller.Cull(input, m_CpuLightCullResult);
+
+    const auto& result = m_CpuLightCullResult;
+
+    // the opaque lists in the layout the shading shaders were compiled for; the bitmask has no grid of its own, the
+    // shading only reads the masks but the light count debug view still reads the counts of the uint32 grid
+    const std::vector<struct uint2>* opaqueGrid = &result.LightGrid;
+    const std::vector<uint32_t>* opaqueList = &result.LightIndexList;
+    if (m_ShaderLightListEncoding != Cpu::LightListEncoding::Uint32 &&
+        Cpu::EncodeLightLists(m_CpuThreadPool, result, input.LightCount, m_ShaderLightListEncoding, m_CpuEncodedLightLists))
+    {
+        opaqueGrid = m_ShaderLightListEncoding == Cpu::LightListEncoding::Bitmask ? &result.LightGrid : &m_CpuEncodedLightLists.LightGrid;
+        opaqueList = &m_CpuEncodedLightLists.Words;
+    }
+
+    ReserveLightIndexLists((UINT)opaqueList->size(), (UINT)result.TransparentLightIndexList.size());
+
+    // the cpu culler counts the cut lists of both kinds together, they go to the opaque counter
+    struct LightIndexCounter opaqueCounter = { (UINT)opaqueList->size(), (UINT)result.TruncatedListCount, (UINT)result.DroppedLightCount, 0 };
+    struct LightIndexCounter transparentCounter = { (UINT)result.TransparentLightIndexList.size(), 0, 0, 0 };
+
+    // upload the results to the same buffers the compute shader writes
+    UploadCpuLightLists(*opaqueGrid, *opaqueList, threadGroupCountX, m_d3dOpaqueLightGridBuffers.Get(),
+        m_d3dOpaqueLightIndexListBuffers.Get(), m_d3dOpaqueLightIndexCounterBuffers.Get(), opaqueCounter);
+
+    UploadCpuLightLists(result.TransparentLightGrid, result.TransparentLightIndexList, threadGroupCountX, m_d3dTransparentLightGridBuffers.Get(),
+        m_d3dTransparentLightIndexListBuffers.Get(), m_d3dTransparentLightIndexCounterBuffers.Get(), transparentCounter);
+}
+
+void SimpleObj::ReadLightLists(ID3D11Texture2D* lightGridTexture, ID3D11Texture2D* lightGridReadbackTexture, ID3D11Buffer* lightIndexListBuffer,
+    ComPtr<ID3D11Buffer>& lightIndexListReadbackBuffer, int tileCountX, int tileCountY, Cpu::LightCullResult& result)
+{
+    // the grid's staging texture is created with the grid in ResizeSwapChain()
+    m_d3dDeviceContext->CopyResource(lightGridReadbackTexture, lightGridTexture);
+
+    D3D11_MAPPED_SUBRESOURCE MappedResource;
+    m_d3dDeviceContext->Map(lightGridReadbackTexture, 0, D3D11_MAP_READ, 0, &MappedResource);
+
+    result.TileCountX = tileCountX;
+    result.TileCountY = tileCountY;
+    result.LightGrid.resize(tileCountX * tileCountY);
+    for (int y = 0; y < tileCountY; ++y)
+    {
+        auto row = (const struct uint2*)((const BYTE*)MappedResource.pData + y * MappedResource.RowPitch);
+        std::copy_n(row, tileCountX, result.LightGrid.data() + y * tileCountX);
+    }
+
+    m_d3dDeviceContext->Unmap(lightGridReadbackTexture, 0);
+
+    // the index list grows outside ResizeSwapChain() (ReserveLightIndexList()), its staging copy is re-created with it
+    D3D11_BUFFER_DESC bufferDesc = {};
+    lightIndexListBuffer->GetDesc(&bufferDesc);
+
+    D3D11_BUFFER_DESC readbackDesc = {};
+    if (lightIndexListReadbackBuffer)
+    {
+        lightIndexListReadbackBuffer->GetDesc(&readbackDesc);
+    }
+    if (readbackDesc.ByteWidth != bufferDesc.ByteWidth)
+    {
+        readbackDesc = bufferDesc;
+        readbackDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        readbackDesc.Usage = D3D11_USAGE_STAGING;
+        readbackDesc.BindFlags = 0;
+        readbackDesc.MiscFlags = 0;
+
+        HRESULT hr = m_d3dDevice->CreateBuffer(&readbackDesc, nullptr, lightIndexListReadbackBuffer.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Read Light Lists", "Unable to create lightIndexListReadbackBuffer");
+    }
+
+    m_d3dDeviceContext->CopyResource(lightIndexListReadbackBuffer.Get(), lightIndexListBuffer);
+
+    m_d3dDeviceContext->Map(lightIndexListReadbackBuffer.Get(), 0, D3D11_MAP_READ, 0, &MappedResource);
+    result.LightIndexList.resize(bufferDesc.ByteWidth / sizeof(uint32_t));
+    std::copy_n((const uint32_t*)MappedResource.pData, result.LightIndexList.size(), result.LightIndexList.data());
+    m_d3dDeviceContext->Unmap(lightIndexListReadbackBuffer.Get(), 0);
+}
+
+void SimpleObj::RenderScene_FowardPlus_CullingStats(int threadGroupCountX, int threadGroupCountY)
+{
+    const Cpu::LightCullResult* result = &m_CpuLightCullResult;
+    if (!m_CullLightOnCpu)
+    {
+        // the cpu path already read the depth of this frame
+        ReadDepthBuffer(m_CpuDepthBuffer);
+        ReadLightLists(m_d3dOpaqueLightGridBuffers.Get(), m_d3dOpaqueLightGridReadback_tex.Get(), m_d3dOpaqueLightIndexListBuffers.Get(),
+            m_d3dOpaqueLightIndexListReadbackBuffer, threadGroupCountX, threadGroupCountY, m_CullingStatsLists);
+        result = &m_CullingStatsLists;
+    }
+
+    Cpu::LightCullInput input;
+    input.Depth = m_CpuDepthBuffer.data();
+    input.Width = (int)m_ScreenDimensions.x;
+    input.Height = (int)m_ScreenDimensions.y;
+    input.BlockSize = m_TileSize;
+    input.InverseProjection = Cpu::Float4x4::FromRowMajor(&m_ScreenToViewParamsConstantBuffer.InverseProjection._11);
+    input.Lights = m_Scene.Lights.Data();
+    input.LightCount = m_Scene.Lights.Count();
+
+    Cpu::ComputeTileLightStats(input, *result, m_CullingStatsFalsePositives, m_CpuThreadPool, m_CullingStats);
+
+    m_CullingStatsHistogram.assign(m_CullingStats.Histogram.begin(), m_CullingStats.Histogram.end());
+}
+
+bool SimpleObj::ExportCullingStats(const char* prefix)
+{
+    const Cpu::TileLightStats& stats = m_CullingStats;
+    std::string path = prefix;
+
+    bool written = Cpu::WriteHeatmapPpm((path + "_lights.ppm").c_str(), stats.LightCounts.data(), stats.TileCountX, stats.TileCountY,
+        stats.MaxLights, m_TileSize);
+    if (!stats.FalsePositiveCounts.empty())
+    {
+        written = written && Cpu::WriteHeatmapPpm((path + "_false_positives.ppm").c_str(), stats.FalsePositiveCounts.data(),
+            stats.TileCountX, stats.TileCountY, stats.MaxLights, m_TileSize);
+    }
+    written = written && Cpu::WriteTileLightStatsCsv((path + "_tiles.csv").c_str(), stats);
+    written = written && Cpu::WriteLightCountHistogramCsv((path + "_histogram.csv").c_str(), stats);
+    return written;
+}
+
+void SimpleObj::StartFrameCapture(const char* path)
+{
+    m_FrameCaptureFailed = !m_FrameCapture.Open(path);
+}
+
+void SimpleObj::StopFrameCapture()
+{
+    m_FrameCaptureFailed = !m_FrameCapture.Close() || m_FrameCaptureFailed;
+}
+
+void SimpleObj::RenderScene_FowardPlus_CaptureFrame()
+{
+    Cpu::CapturedFrame& frame = m_CapturedFrame;
+
+    // the cpu culling pass has read this frame's depth already
+    if (m_CullLightOnCpu)
+    {
+        frame.Depth = m_CpuDepthBuffer;
+    }
+    else
+    {
+        ReadDepthBuffer(frame.Depth);
+    }
+
+    Matrix viewMatrix = m_Camera.get_ViewMatrix();
+    Matrix projectionMatrix = m_Camera.get_ProjectionMatrix();
+
+    frame.Width = (int)m_ScreenDimensions.x;
+    frame.Height = (int)m_ScreenDimensions.y;
+    frame.TileSize = m_TileSize;
+    frame.SuperTileSize = m_CullLightHierarchical ? SUPER_TILE_SIZE : 0;
+    frame.MaxLightsPerTile = m_MaxLightsPerTile;
+    frame.DepthPyramidLevelCount = m_UseDepthPyramid ? DEPTH_PYRAMID_LEVEL_COUNT : 0;
+    frame.View = Cpu::Float4x4::FromRowMajor(&viewMatrix._11);
+    frame.Projection = Cpu::Float4x4::FromRowMajor(&projectionMatrix._11);
+    frame.InverseProjection = Cpu::Float4x4::FromRowMajor(&m_ScreenToViewParamsConstantBuffer.InverseProjection._11);
+    frame.Lights.assign(m_Scene.Lights.Data(), m_Scene.Lights.Data() + m_Scene.Lights.Count());
+
+    // the cpu lists are culled with the depth mask, transparent lists and the settings above as the replay does, the gpu
+    // lists are not read back
+    frame.LightListHash = m_CullLightOnCpu ? Cpu::HashLightLists(m_CpuLightCullResult) : 0;
+
+    if (!m_FrameCapture.Write(frame))
+    {
+        m_FrameCaptureFailed = true;
+        StopFrameCapture();
+    }
+}
+
+void SimpleObj::UploadCpuLightLists(const std::vector<struct uint2>& lightGrid, const std::vector<uint32_t>& lightIndexList, int tileCountX,
+    ID3D11Texture2D* lightGridTexture, ID3D11Buffer* lightIndexListBuffer, ID3D11Buffer* lightIndexCounterBuffer,
+    const struct LightIndexCounter& lightIndexCounter)
+{
+    m_d3dDeviceContext->UpdateSubresource(lightGridTexture, 0, nullptr, lightGrid.data(), tileCountX * sizeof(struct uint2), 0);
+
+    if (!lightIndexList.empty())
+    {
+        D3D11_BOX box = { 0, 0, 0, (UINT)(lightIndexList.size() * sizeof(uint32_t)), 1, 1 };
+        m_d3dDeviceContext->UpdateSubresource(lightIndexListBuffer, 0, &box, lightIndexList.data(), 0, 0);
+    }
+
+    m_d3dDeviceContext->UpdateSubresource(lightIndexCounterBuffer, 0, nullptr, &lightIndexCounter, 0, 0);
+}
+
+void SimpleObj::ReserveLightIndexLists(UINT opaqueCount, UINT transparentCount)
+{
+    ReserveLightIndexList(opaqueCount, m_d3dOpaqueLightIndexListBuffers, m_d3dOpaqueLightIndexListBuffers_UAV, m_d3dOpaqueLightIndexListBuffers_SRV,
+        m_d3dOpaqueLightIndexStagingListBuffers, m_d3dOpaqueLightIndexStagingListBuffers_UAV, m_OpaqueLightIndexListCapacity);
+
+    ReserveLightIndexList(transparentCount, m_d3dTransparentLightIndexListBuffers, m_d3dTransparentLightIndexListBuffers_UAV,
+        m_d3dTransparentLightIndexListBuffers_SRV, m_d3dTransparentLightIndexStagingListBuffers, m_d3dTransparentLightIndexStagingListBuffers_UAV, m_TransparentLightIndexListCapacity);
+}
+
+void SimpleObj::ReserveLightIndexList(UINT count, ComPtr<ID3D11Buffer>& lightIndexListBuffer, ComPtr<ID3D11UnorderedAccessView>& lightIndexListUAV,
+    ComPtr<ID3D11ShaderResourceView>& lightIndexListSRV, ComPtr<ID3D11Buffer>& stagingListBuffer, ComPtr<ID3D11UnorderedAccessView>& stagingListUAV, UINT& capacity)
+{
+    if (count <= capacity)
+    {
+        return;
+    }
+
+    // only the index list and its staging list are re-created, at twice the size but no more than MAX_LIGHTS_PER_TILE
+    // lights per tile need, unless more is asked for (the cpu lists have no limit per tile)
+    m_LightIndexListGrowCount += capacity > 0 ? 1 : 0;
+    capacity = (std::max)(count, (std::min)(capacity * 2, m_MaxLightIndexListCapacity));
+
+    HRESULT hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), capacity, NULL, lightIndexListBuffer.ReleaseAndGetAddressOf());
+    AssertIfFailed(hr, "Create Buffer", "Unable to create light index list buffer");
+
+    hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), lightIndexListBuffer.Get(), lightIndexListUAV.ReleaseAndGetAddressOf());
+    AssertIfFailed(hr, "Create Buffer UAV", "Unable to create light index list UAV");
+
+    hr = CreateStructuredBufferSRV(m_d3dDevice.Get(), lightIndexListBuffer.Get(), lightIndexListSRV.ReleaseAndGetAddressOf());
+    AssertIfFailed(hr, "Create Buffer SRV", "Unable to create light index list SRV");
+
+    hr = CreateStructuredBuffer(m_d3dDevice.Get(), sizeof(UINT), capacity, NULL, stagingListBuffer.ReleaseAndGetAddressOf());
+    AssertIfFailed(hr, "Create Buffer", "Unable to create light index staging list buffer");
+
+    hr = CreateStructuredBufferUAV(m_d3dDevice.Get(), stagingListBuffer.Get(), stagingListUAV.ReleaseAndGetAddressOf());
+    AssertIfFailed(hr, "Create Buffer UAV", "Unable to create light index staging list UAV");
+}
+
+void SimpleObj::RenderScene_FowardPlus_ReadLightIndexCounters()
+{
+    // copy the counters of this frame into the ring of staging buffers
+    UINT slot = m_LightIndexCounterFrame % LIGHT_INDEX_COUNTER_LATENCY;
+    if (!m_d3dLightIndexCounterReadback[slot])
+    {
+        D3D11_BUFFER_DESC desc = {};
+        desc.ByteWidth = 2 * sizeof(struct LightIndexCounter);
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+        HRESULT hr = m_d3dDevice->CreateBuffer(&desc, nullptr, m_d3dLightIndexCounterReadback[slot].GetAddressOf());
+        AssertIfFailed(hr, "Create Buffer", "Unable to create m_d3dLightIndexCounterReadback");
+    }
+
+    ID3D11Buffer* readback = m_d3dLightIndexCounterReadback[slot].Get();
+    m_d3dDeviceContext->CopySubresourceRegion(readback, 0, 0, 0, 0, m_d3dOpaqueLightIndexCounterBuffers.Get(), 0, nullptr);
+    m_d3dDeviceContext->CopySubresourceRegion(readback, 0, sizeof(struct LightIndexCounter), 0, 0, m_d3dTransparentLightIndexCounterBuffers.Get(), 0, nullptr);
+    ++m_LightIndexCounterFrame;
+
+    if (m_LightIndexCounterFrame < LIGHT_INDEX_COUNTER_LATENCY)
+    {
+        return;
+    }
+
+    // the next slot of the ring holds the oldest copy, LIGHT_INDEX_COUNTER_LATENCY - 1 frames ago.
+    // If the gpu is still behind, try again next frame instead of waiting
+    ID3D11Buffer* oldest = m_d3dLightIndexCounterReadback[m_LightIndexCounterFrame % LIGHT_INDEX_COUNTER_LATENCY].Get();
+    D3D11_MAPPED_SUBRESOURCE MappedResource;
+    if (FAILED(m_d3dDeviceContext->Map(oldest, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &MappedResource)))
+    {
+        return;
+    }
+
+    auto counters = (const struct LightIndexCounter*)MappedResource.pData;
+    m_OpaqueLightIndexCounter = counters[0];
+    m_TransparentLightIndexCounter = counters[1];
+    m_d3dDeviceContext->Unmap(oldest, 0);
+
+    // the tiles that did not fit get their lights back a few frames later
+    ReserveLightIndexLists(m_OpaqueLightIndexCounter.RequiredCount, m_TransparentLightIndexCounter.RequiredCount);
+}
+
+void SimpleObj::RenderScene_FowardPlus_CullSuperTilePass()
+{
+    int superTileCountX = std::ceilf(m_ScreenDimensions.x / (float)SUPER_TILE_SIZE);
+    int superTileCountY = std::ceilf(m_ScreenDimensions.y / (float)SUPER_TILE_SIZE);
+
+    m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_CullSuperTileShader.Get(), nullptr, 0);
+
+    ID3D11Buffer* computeShaderConstantBuffers[] =
+    {
+        m_d3dConstantBuffers[CB_DispatchParams].Get(),
+        m_d3dConstantBuffers[CB_ScreenToViewParams].Get(),
+        m_d3dConstantBuffers[CB_Light].Get(),
+    };
+
+    ComPtr<ID3D11UnorderedAccessView> buffers[] =
+    {
+        m_d3dSuperTileLightCountBuffers_UAV.Get(),
+        m_d3dSuperTileLightIndexListBuffers_UAV.Get(),
+    };
+
+    // bind input
+    m_d3dDeviceContext->CSSetConstantBuffers(0, _countof(computeShaderConstantBuffers), computeShaderConstantBuffers);
+    m_d3dDeviceContext->CSSetShaderResources(0, 1, m_d3dDepthStencilView_depth_SRV.GetAddressOf());
+
+    // bind output
+    m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(buffers), buffers->GetAddressOf(), nullptr);
+
+    // one group per super-tile
+    m_d3dDeviceContext->Dispatch(superTileCountX, superTileCountY, 1);
+
+    // clean up, the candidate lists are read as SRVs by the fine pass
+    ID3D11UnorderedAccessView* nullUAVs[_countof(buffers)] = {};
+    m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(nullUAVs), nullUAVs, nullptr);
+}
+
+void SimpleObj::RenderScene_FowardPlus_DepthPyramidPass()
+{
+    int groupCountX = std::ceilf(m_ScreenDimensions.x / (float)DEPTH_PYRAMID_TILE_SIZE);
+    int groupCountY = std::ceilf(m_ScreenDimensions.y / (float)DEPTH_PYRAMID_TILE_SIZE);
+
+    m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_DepthPyramidShader.Get(), nullptr, 0);
+
+    // bind input
+    m_d3dDeviceContext->CSSetShaderResources(0, 1, m_d3dDepthStencilView_depth_SRV.GetAddressOf());
+
+    // bind output, one mip per UAV
+    m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(m_d3dDepthPyramid_UAV), m_d3dDepthPyramid_UAV->GetAddressOf(), nullptr);
+
+    // one group per DEPTH_PYRAMID_TILE_SIZE block, writes all levels
+    m_d3dDeviceContext->Dispatch(groupCountX, groupCountY, 1);
+
+    // clean up, the pyramid is read as an SRV by the culling pass
+    ID3D11UnorderedAccessView* nullUAVs[DEPTH_PYRAMID_LEVEL_COUNT] = {};
+    m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(nullUAVs), nullUAVs, nullptr);
+}
+
+void SimpleObj::RenderScene_FowardPlus_CompactLightListsPass(int threadGroupCountX, int threadGroupCountY)
+{
+    m_d3dDeviceContext->CSSetConstantBuffers(0, 1, m_d3dConstantBuffers[CB_DispatchParams].GetAddressOf());
+
+    // scan the tile light counts into the offsets of the final lists, a single group for the whole grid
+    {
+        ComPtr<ID3D11UnorderedAccessView> buffers[] =
+        {
+            m_d3dOpaqueLightGrid_UAV.Get(),
+            m_d3dTransparentLightGrid_UAV.Get(),
+            m_d3dOpaqueLightOffsetBuffers_UAV.Get(),
+            m_d3dTransparentLightOffsetBuffers_UAV.Get(),
+        };
+
+        m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_ScanLightGridShader.Get(), nullptr, 0);
+        m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(buffers), buffers->GetAddressOf(), nullptr);
+        m_d3dDeviceContext->Dispatch(1, 1, 1);
+
+        ID3D11UnorderedAccessView* nullUAVs[_countof(buffers)] = {};
+        m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(nullUAVs), nullUAVs, nullptr);
+    }
+
+    // copy every tile from the staging lists to its offset, one group per tile
+    {
+        ComPtr<ID3D11UnorderedAccessView> buffers[] =
+        {
+            m_d3dOpaqueLightIndexStagingListBuffers_UAV.Get(),
+            m_d3dOpaqueLightIndexListBuffers_UAV.Get(),
+            m_d3dOpaqueLightGrid_UAV.Get(),
+            m_d3dOpaqueLightOffsetBuffers_UAV.Get(),
+            m_d3dTransparentLightIndexStagingListBuffers_UAV.Get(),
+            m_d3dTransparentLightIndexListBuffers_UAV.Get(),
+            m_d3dTransparentLightGrid_UAV.Get(),
+            m_d3dTransparentLightOffsetBuffers_UAV.Get(),
+        };
+
+        m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_ScatterLightListsShader.Get(), nullptr, 0);
+        m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(buffers), buffers->GetAddressOf(), nullptr);
+        m_d3dDeviceContext->Dispatch(threadGroupCountX, threadGroupCountY, 1);
+
+        ID3D11UnorderedAccessView* nullUAVs[_countof(buffers)] = {};
+        m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(nullUAVs), nullUAVs, nullptr);
+    }
+
+    // clean up
+    m_d3dDeviceContext->CSSetShader(nullptr, nullptr, 0);
+
+    ID3D11Buffer* nullConstantBuffers[1] = { nullptr };
+    m_d3dDeviceContext->CSSetConstantBuffers(0, _countof(nullConstantBuffers), nullConstantBuffers);
 }
 
 void SimpleObj::RenderScene_FowardPlus_CullLightPass(int threadGroupCountX, int threadGroupCountY, int threadGroupCountZ)
 {
     int totalGroupCounts = threadGroupCountX * threadGroupCountY * threadGroupCountZ;
 
-    m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_CullLightShader.Get(), nullptr, 0);
+    if (m_UseDepthPyramid)
+    {
+        RenderScene_FowardPlus_DepthPyramidPass();
+    }
+
+    if (m_CullLightHierarchical)
+    {
+        RenderScene_FowardPlus_CullSuperTilePass();
+        m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_CullLightHierarchicalShader.Get(), nullptr, 0);
+    }
+    else
+    {
+        m_d3dDeviceContext->CSSetShader(m_d3dFowrardPlus_CullLightShader.Get(), nullptr, 0);
+    }
 
     ID3D11Buffer* computeShaderConstantBuffers[] =
     {
@@ -185,16 +1022,28 @@ void SimpleObj::RenderScene_FowardPlus_CullLightPass(int threadGroupCountX, int
     {
         m_d3dDepthStencilView_depth_SRV,
         m_d3dFrustumBuffers_SRV,
+        m_d3dSuperTileLightCountBuffers_SRV,         // only read by the hierarchical shader
+        m_d3dSuperTileLightIndexListBuffers_SRV,
+        m_d3dDepthPyramid_SRV,                      // only read if useDepthPyramid is set
     };
 
+    // deterministic lists are appended to the staging lists and compacted into the index lists afterwards
     ComPtr<ID3D11UnorderedAccessView> buffers[] =
     {
         m_d3dOpaqueLightIndexCounterBuffers_UAV.Get(),
-        m_d3dOpaqueLightIndexListBuffers_UAV.Get(),
+        m_DeterministicLightLists ? m_d3dOpaqueLightIndexStagingListBuffers_UAV.Get() : m_d3dOpaqueLightIndexListBuffers_UAV.Get(),
         m_d3dOpaqueLightGrid_UAV.Get(),
         m_d3dDebugRWListBuffers_UAV.Get(),
+        m_d3dTransparentLightIndexCounterBuffers_UAV.Get(),
+        m_DeterministicLightLists ? m_d3dTransparentLightIndexStagingListBuffers_UAV.Get() : m_d3dTransparentLightIndexListBuffers_UAV.Get(),
+        m_d3dTransparentLightGrid_UAV.Get(),
     };
 
+    // the counters hold the size of the lists of this frame only
+    const UINT zero[4] = { 0, 0, 0, 0 };
+    m_d3dDeviceContext->ClearUnorderedAccessViewUint(m_d3dOpaqueLightIndexCounterBuffers_UAV.Get(), zero);
+    m_d3dDeviceContext->ClearUnorderedAccessViewUint(m_d3dTransparentLightIndexCounterBuffers_UAV.Get(), zero);
+
     // bind input
     m_d3dDeviceContext->CSSetConstantBuffers(0, _countof(computeShaderConstantBuffers), computeShaderConstantBuffers);
     m_d3dDeviceContext->CSSetShaderResources(0, _countof(textures), textures->GetAddressOf());
@@ -208,66 +1057,17 @@ void SimpleObj::RenderScene_FowardPlus_CullLightPass(int threadGroupCountX, int
     // clean up
     m_d3dDeviceContext->CSSetShader(nullptr, nullptr, 0);
 
-    ID3D11UnorderedAccessView* nullUAVs[3] = { nullptr, nullptr, nullptr };
+    ID3D11UnorderedAccessView* nullUAVs[_countof(buffers)] = {};
     m_d3dDeviceContext->CSSetUnorderedAccessViews(0, _countof(nullUAVs), nullUAVs, nullptr);
 
     ID3D11Buffer* nullConstantBuffers[3] = { nullptr, nullptr, nullptr };
     m_d3dDeviceContext->CSSetConstantBuffers(0, _countof(nullConstantBuffers), nullConstantBuffers);
 
-    ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
+    ID3D11ShaderResourceView* nullSRVs[_countof(textures)] = {};
     m_d3dDeviceContext->CSSetShaderResources(0, _countof(nullSRVs), nullSRVs);
 
-#ifdef _DEBUG
+    if (m_DeterministicLightLists)
     {
-        {
-            // copy result back to m_opaqueLightIndexCounter
-            auto tempBuffer = ReadBuffer(m_d3dDevice.Get(), m_d3dDeviceContext.Get(), m_d3dDebugRWListBuffers.Get());
-
-            D3D11_MAPPED_SUBRESOURCE MappedResource;
-            m_d3dDeviceContext->Map(tempBuffer, 0, D3D11_MAP_READ, 0, &MappedResource);
-            std::copy_n((float*)MappedResource.pData, m_debugRWList.size(), m_debugRWList.data());
-
-            // Clean up
-            m_d3dDeviceContext->Unmap(tempBuffer, 0);
-            SafeRelease(tempBuffer);
-        }
-
-        {
-            // copy result back to m_opaqueLightIndexCounter
-            auto tempBuffer = ReadBuffer(m_d3dDevice.Get(), m_d3dDeviceContext.Get(), m_d3dOpaqueLightIndexCounterBuffers.Get());
-
-            D3D11_MAPPED_SUBRESOURCE MappedResource;
-            m_d3dDeviceContext->Map(tempBuffer, 0, D3D11_MAP_READ, 0, &MappedResource);
-            std::copy_n((int*)MappedResource.pData, m_opaqueLightIndexCounter.size(), m_opaqueLightIndexCounter.data());
-
-            // Clean up
-            m_d3dDeviceContext->Unmap(tempBuffer, 0);
-            SafeRelease(tempBuffer);
-        }
-
-        {
-            // copy result back to m_opaqueLightIndexList
-            auto tempBuffer = ReadBuffer(m_d3dDevice.Get(), m_d3dDeviceContext.Get(), m_d3dOpaqueLightIndexListBuffers.Get());
-
-            D3D11_MAPPED_SUBRESOURCE MappedResource;
-            m_d3dDeviceContext->Map(tempBuffer, 0, D3D11_MAP_READ, 0, &MappedResource);
-            std::copy_n((int*)MappedResource.pData, m_opaqueLightIndexList.size(), m_opaqueLightIndexList.data());
-
-            int zeroCount = 0;
-            for (auto i : m_opaqueLightIndexList) {
-                if (i == 0) {
-                    zeroCount += 1;
-                }
-                else {
-                    std::cout << i << ",";
-                }
-            }
-            std::cout << "Zero Count = " << zeroCount << " / " << m_opaqueLightIndexList.size() << std::endl;
-
-            // Clean up
-            m_d3dDeviceContext->Unmap(tempBuffer, 0);
-            SafeRelease(tempBuffer);
-        }
+        RenderScene_FowardPlus_CompactLightListsPass(threadGroupCountX, threadGroupCountY);
     }
-#endif
 }
@@ -0,0 +1,79 @@
+#include "SimpleObj.h"
+
+using namespace Microsoft::WRL;
+using namespace Yr;
+
+void SimpleObj::RenderScene_Software(RenderEventArgs& e)
+{
+    AssertIfNull(m_d3dDevice, "Render Scene", "Device is null");
+    AssertIfNull(m_d3dDeviceContext, "Render Scene", "Device Context is null");
+
+    // the whole frame on the cpu, from the same camera, entities and lights
+    int width = (int)m_ScreenDimensions.x;
+    int height = (int)m_ScreenDimensions.y;
+    m_SoftwareRendering.SetCamera(width, height, m_Camera.get_Translation(), m_Camera.get_ViewMatrix(), m_Camera.get_ProjectionMatrix());
+    m_SoftwareRendering.Render(m_Scene);
+
+    // (re)create the texture the frame is uploaded to when the screen size changed
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    if (m_d3dSoftwareColor_tex)
+    {
+        m_d3dSoftwareColor_tex->GetDesc(&textureDesc);
+    }
+    if (!m_d3dSoftwareColor_tex || textureDesc.Width != (UINT)width || textureDesc.Height != (UINT)height)
+    {
+        textureDesc = {};
+        textureDesc.Width = width;
+        textureDesc.Height = height;
+        textureDesc.MipLevels = 1;
+        textureDesc.ArraySize = 1;
+        textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        textureDesc.SampleDesc.Count = 1;
+        textureDesc.Usage = D3D11_USAGE_DEFAULT;
+        textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+        HRESULT hr = m_d3dDevice->CreateTexture2D(&textureDesc, nullptr, m_d3dSoftwareColor_tex.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Create Texture", "Unable to create m_d3dSoftwareColor_tex");
+
+        hr = m_d3dDevice->CreateShaderResourceView(m_d3dSoftwareColor_tex.Get(), nullptr, m_d3dSoftwareColor_SRV.ReleaseAndGetAddressOf());
+        AssertIfFailed(hr, "Create SRV", "Unable to create m_d3dSoftwareColor_SRV");
+    }
+
+    const auto& color = m_SoftwareRendering.GetRenderer().GetColor();
+    m_SoftwareColor.resize(color.size());
+    for (size_t i = 0; i < color.size(); ++i)
+    {
+        m_SoftwareColor[i] = Vector4(color[i].x, color[i].y, color[i].z, 1.0f);
+    }
+    m_d3dDeviceContext->UpdateSubresource(m_d3dSoftwareColor_tex.Get(), 0, nullptr, m_SoftwareColor.data(), width * sizeof(Vector4), 0);
+
+    // draw it over the whole screen with the light accumulation view of the deferred debug pass
+    m_DebugPropertiesConstantBuffer.DeferredDebugMode = (int)Deferred_DebugMode::LightAccumulation;
+    m_d3dDeviceContext->UpdateSubresource(m_d3dConstantBuffers[CB_Debug].Get(), 0, nullptr, &m_DebugPropertiesConstantBuffer, 0, 0);
+
+    m_d3dDeviceContext->OMSetRenderTargets(1, m_d3dRenderTargetView.GetAddressOf(), nullptr);
+    m_d3dDeviceContext->OMSetDepthStencilState(m_d3dDepthStencilState_DisableDepthTest.Get(), 1);
+    m_d3dDeviceContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+
+    m_d3dDeviceContext->RSSetState(m_d3dRasterizerState.Get());
+    D3D11_VIEWPORT viewport = m_Camera.get_Viewport();
+    m_d3dDeviceContext->RSSetViewports(1, &viewport);
+
+    m_d3dDeviceContext->VSSetShader(m_d3dDebugVertexShader.Get(), nullptr, 0);
+    m_d3dDeviceContext->PSSetShader(m_d3dDebugPixelShader.Get(), nullptr, 0);
+    m_d3dDeviceContext->PSSetConstantBuffers(0, 1, m_d3dConstantBuffers[CB_Debug].GetAddressOf());
+
+    m_d3dDeviceContext->IASetInputLayout(nullptr);
+    m_d3dDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+    ComPtr<ID3D11SamplerState> samplerStates[] = { m_d3dSamplerState };
+    m_d3dDeviceContext->PSSetSamplers(0, 1, samplerStates->GetAddressOf());
+    m_d3dDeviceContext->PSSetShaderResources(0, 1, m_d3dSoftwareColor_SRV.GetAddressOf());
+
+    Draw(4, 0);
+
+    // Clean up, the debug wireframe is drawn with the depth buffer next
+    ID3D11ShaderResourceView* nullSRVs[1] = {};
+    m_d3dDeviceContext->PSSetShaderResources(0, 1, nullSRVs);
+    m_d3dDeviceContext->OMSetRenderTargets(1, m_d3dRenderTargetView.GetAddressOf(), m_d3dDepthStencilView.Get());
+}
@@ -0,0 +1,66 @@
+#include "SoftwareRendering.h"
+
+using namespace Yr;
+
+static_assert(sizeof(VertexData) == sizeof(Cpu::MeshVertex), "Cpu::MeshVertex must match the layout of VertexData");
+
+namespace
+{
+    Cpu::Float3 ToFloat3(const Vector4& value)
+    {
+        return Cpu::Float3(value.x, value.y, value.z);
+    }
+}
+
+SoftwareRendering::SoftwareRendering(Cpu::ThreadPool& threadPool)
+    : m_Renderer(threadPool)
+{
+}
+
+void SoftwareRendering::SetCamera(int width, int height, const Vector3& eyePosition, const Matrix& view, const Matrix& projection)
+{
+    m_Scene.Width = width;
+    m_Scene.Height = height;
+    m_Scene.EyePosition = Cpu::Float3(eyePosition.x, eyePosition.y, eyePosition.z);
+    m_Scene.View = Cpu::Float4x4::FromRowMajor(&view._11);
+    m_Scene.Projection = Cpu::Float4x4::FromRowMajor(&projection._11);
+}
+
+void SoftwareRendering::Render(Scene& scene)
+{
+    // One material per entity, as SimpleObj binds one per draw call
+    m_Draws.clear();
+    m_Materials.clear();
+    for (auto entity : scene.Entities)
+    {
+        if (entity->Model == nullptr)
+        {
+            continue;
+        }
+
+        Cpu::RasterDraw draw;
+        draw.Vertices = reinterpret_cast<const Cpu::MeshVertex*>(entity->Model->Head());
+        draw.VertexCount = entity->Model->VertexCount();
+        draw.World = Cpu::Float4x4::FromRowMajor(&entity->WorldMatrix._11);
+        draw.MaterialIndex = (uint32_t)m_Materials.size();
+        m_Draws.emplace_back(draw);
+
+        Cpu::SurfaceMaterial material;
+        material.Emissive = ToFloat3(entity->Material.Emissive);
+        material.Ambient = ToFloat3(entity->Material.Ambient);
+        material.Diffuse = ToFloat3(entity->Material.Diffuse);
+        material.Specular = ToFloat3(entity->Material.Specular);
+        material.SpecularPower = entity->Material.SpecularPower;
+        m_Materials.emplace_back(material);
+    }
+
+    m_Scene.GlobalAmbient = ToFloat3(scene.GlobalAmbient);
+    m_Scene.Draws = m_Draws.data();
+    m_Scene.DrawCount = m_Draws.size();
+    m_Scene.Materials = m_Materials.data();
+    m_Scene.MaterialCount = m_Materials.size();
+    m_Scene.Lights = scene.Lights.Data();
+    m_Scene.LightCount = scene.Lights.Count();
+
+    m_Renderer.Render(m_Scene, m_Technique);
+}